@@ -0,0 +1,18 @@
+#!/usr/bin/bash
+# Builds and runs the micro-benchmarks in bench/bench_hot_paths.c, and saves the results as JSON
+# named after the current commit, so that runs on different commits can be compared.
+#
+# Usage: bench.sh [output file]
+set -e
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+	commit="$commit-dirty"
+fi
+output=${1:-bench_$commit.json}
+
+clang tests/hello.c -o hello
+clang bench/bench_hot_paths.c -o bench_hot_paths -Wall -Wextra -pedantic -Wno-unused-function -Wno-unused-variable -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -lm
+
+./bench_hot_paths ./hello "$commit" > "$output"
+echo "Results saved to $output"
@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// What the benchmarks share. Included after the sources of dush, or at least dush_base.c: times
+// are taken with time_now_ns().
+
+// For qsort() of samples.
+static int
+bench_compare_u64(const void *a, const void *b) {
+	u64 x = *cast(u64 *) a;
+	u64 y = *cast(u64 *) b;
+	return (x > y) - (x < y);
+}
+
+// Sorts the samples, which are in nanoseconds, and prints their median and their minimum, in
+// milliseconds from 1 ms up and in microseconds below.
+static void
+bench_report(char *name, u64 *samples, i64 count) {
+	qsort(samples, cast(size_t) count, sizeof(u64), bench_compare_u64);
+	double p50 = cast(double) samples[count / 2];
+	if (p50 >= 1e6) {
+		printf("%-32s p50 %9.2f ms  min %9.2f ms\n", name, p50 / 1e6, cast(double) samples[0] / 1e6);
+	} else {
+		printf("%-32s p50 %9.1f us  min %9.1f us\n", name, p50 / 1e3, cast(double) samples[0] / 1e3);
+	}
+}
+
+#endif
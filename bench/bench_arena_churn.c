@@ -0,0 +1,146 @@
+// Benchmark for an arena that grows past the decommit threshold and shrinks back over and over,
+// like a scratch arena through a script where a command that needs a lot of memory comes between
+// ones that need very little. Each cycle is one big push, touched page by page and popped, then
+// a few small pushes and pops. The same cycles are run on two arenas:
+// - immediate: a decommit delay of 0, which is how pop_to() worked before the delay
+// - delayed:   the default ARENA_DECOMMIT_DELAY_US
+// For each, the time of a cycle, the decommits done and the page faults taken are printed, and
+// the time of a small push and pop while the memory over the threshold is still committed.
+// Linux only.
+//
+// Usage: bench_arena_churn [cycles] [small pushes per cycle]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+
+#include "../src/dush_base.c"
+#include "bench.h"
+
+#include <sys/resource.h>
+
+#define BENCH_BIG_SIZE        (ARENA_DECOMMIT_THRESHOLD + megabytes(32))
+#define BENCH_SMALL_SIZE      kilobytes(4)
+#define BENCH_SMALL_PAIRS     1000000
+#define BENCH_PAGE_SIZE       4096
+
+static u64
+bench_minor_faults(void) {
+	struct rusage usage = {0};
+	getrusage(RUSAGE_SELF, &usage);
+	return cast(u64) usage.ru_minflt;
+}
+
+typedef struct Bench_Result Bench_Result;
+struct Bench_Result {
+	u64 cycle_ns;
+	u64 decommits;
+	u64 faults;
+	u64 small_pair_ns;
+};
+
+static void
+bench_touch(u8 *data, u64 size) {
+	for (u64 i = 0; i < size; i += BENCH_PAGE_SIZE) {
+		data[i] = cast(u8) i;
+	}
+}
+
+// Pops to `pos`, and counts whether it gave memory back.
+static void
+bench_pop(Arena *arena, u64 pos, u64 *decommits) {
+	u64 commit_pos = arena->commit_pos;
+	pop_to(arena, pos);
+	if (arena->commit_pos < commit_pos) *decommits += 1;
+}
+
+static Bench_Result
+bench_churn(Arena *arena, int cycles, int small_count) {
+	Bench_Result result = {0};
+	
+	u64 faults = bench_minor_faults();
+	u64 start  = time_now_ns();
+	for (int c = 0; c < cycles; c += 1) {
+		u8 *big = push_nozero(arena, BENCH_BIG_SIZE);
+		bench_touch(big, BENCH_BIG_SIZE);
+		bench_pop(arena, 0, &result.decommits);
+		
+		for (int s = 0; s < small_count; s += 1) {
+			u8 *small = push_nozero(arena, BENCH_SMALL_SIZE);
+			bench_touch(small, BENCH_SMALL_SIZE);
+			bench_pop(arena, 0, &result.decommits);
+		}
+	}
+	result.cycle_ns = (time_now_ns() - start) / cast(u64) cycles;
+	result.faults   = bench_minor_faults() - faults;
+	
+	// With the big push committed again, for the arena that keeps it.
+	push_nozero(arena, BENCH_BIG_SIZE);
+	pop_to(arena, 0);
+	
+	start = time_now_ns();
+	for (int i = 0; i < BENCH_SMALL_PAIRS; i += 1) {
+		u8 *small = push_nozero(arena, 64);
+		small[0] = cast(u8) i;
+		pop_to(arena, 0);
+	}
+	result.small_pair_ns = (time_now_ns() - start) / BENCH_SMALL_PAIRS;
+	
+	return result;
+}
+
+int
+main(int argc, char **argv) {
+	int cycles      = argc > 1 ? atoi(argv[1]) : 50;
+	int small_count = argc > 2 ? atoi(argv[2]) : 20;
+	
+	Arena arenas[2] = {0};
+	char *names[]   = {"immediate", "delayed"};
+	bool  ok = arena_init(&arenas[0], .decommit_delay_us = 0) && arena_init(&arenas[1]);
+	
+	Bench_Result results[2] = {0};
+	if (ok) {
+		printf("%d cycles of a %llu MB push and %d %llu KB pushes\n", cycles, cast(unsigned long long) (BENCH_BIG_SIZE / megabytes(1)),
+			   small_count, cast(unsigned long long) (BENCH_SMALL_SIZE / kilobytes(1)));
+		printf("%-10s %12s %10s %12s %14s\n", "", "cycle", "decommits", "page faults", "small pair");
+		for (int a = 0; a < 2; a += 1) {
+			results[a] = bench_churn(&arenas[a], cycles, small_count);
+			printf("%-10s %9.2f ms %10llu %12llu %11.1f ns\n", names[a], cast(double) results[a].cycle_ns / 1e6,
+				   cast(unsigned long long) results[a].decommits, cast(unsigned long long) results[a].faults,
+				   cast(double) results[a].small_pair_ns);
+		}
+		
+		// The delayed arena still gives the memory back once it went unused for long enough.
+		Arena arena = {0};
+		ok = arena_init(&arena, .decommit_delay_us = 50000);
+		if (ok) {
+			push_nozero(&arena, BENCH_BIG_SIZE);
+			pop_to(&arena, 0);
+			pop_to(&arena, 0);
+			bool kept = arena.commit_pos >= BENCH_BIG_SIZE;
+			usleep(60000);
+			for (int i = 0; i < ARENA_DECOMMIT_CHECK_INTERVAL; i += 1) {
+				pop_to(&arena, 0);
+			}
+			ok = kept && arena.commit_pos < ARENA_DECOMMIT_THRESHOLD;
+			
+			// And at once when it's idle.
+			push_nozero(&arena, BENCH_BIG_SIZE);
+			pop_to(&arena, 0);
+			arena_decommit_idle(&arena);
+			ok = ok && arena.commit_pos < ARENA_DECOMMIT_THRESHOLD;
+			arena_fini(&arena);
+		}
+	}
+	
+	if (!ok) {
+		printf("FAIL: the memory over the threshold wasn't given back after the delay, or when idle\n");
+	} else {
+		printf("\na delayed cycle takes %.2fx the time of an immediate one, with %llu decommits instead of %llu\n",
+			   cast(double) results[1].cycle_ns / cast(double) results[0].cycle_ns,
+			   cast(unsigned long long) results[1].decommits, cast(unsigned long long) results[0].decommits);
+	}
+	
+	arena_fini(&arenas[0]);
+	arena_fini(&arenas[1]);
+	return !ok;
+}
@@ -0,0 +1,183 @@
+// Benchmark for the builtins and expansion operators that save scripts from starting helper
+// processes. The same loop takes the base name and the directory of a path and counts, in
+// three ways:
+// - operators: ${p##*/}, ${p%/*} and $((...)), which never leave the shell
+// - builtins:  $(basename ...), $(dirname ...) and $(expr ...), which dush runs itself with
+//              their output captured
+// - external:  the same with /usr/bin/basename, /usr/bin/dirname and /usr/bin/expr, a process
+//              each, which is what other shells do for the builtins case too
+// The external case runs fewer iterations, since every one of them starts three processes; the
+// times are compared per iteration. Linux only.
+//
+// Usage: bench_builtin_ops [path to dush] [iterations] [external iterations] [runs] [other shells...]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+
+#include "../src/dush_base.c"
+#include "bench.h"
+
+extern char **environ;
+
+#define BENCH_SCRIPT_FILE "/tmp/dush_bench_builtin_ops.dush"
+#define BENCH_OUTPUT_FILE "/tmp/dush_bench_builtin_ops_output"
+
+// The three ways of doing it go between the head and the tail of the loop.
+static char *bench_script_head =
+	"i=0\n"
+	"n=0\n"
+	"while [ $i -lt %lld ]; do\n"
+	"	p=/usr/lib/pkg-$((i %% 100))/lib$i.so\n";
+
+static char *bench_script_tail =
+	"	i=$((i + 1))\n"
+	"done\n"
+	"echo $b $d $n\n";
+
+static char *bench_operators_body =
+	"	b=${p##*/}\n"
+	"	d=${p%/*}\n"
+	"	n=$((n + 1))\n";
+
+static char *bench_builtins_body =
+	"	b=$(basename $p)\n"
+	"	d=$(dirname $p)\n"
+	"	n=$(expr $n + 1)\n";
+
+static char *bench_external_body =
+	"	b=$(/usr/bin/basename $p)\n"
+	"	d=$(/usr/bin/dirname $p)\n"
+	"	n=$(/usr/bin/expr $n + 1)\n";
+
+static int
+bench_write_script(char *body, long long iterations) {
+	FILE *file = fopen(BENCH_SCRIPT_FILE, "wb");
+	if (file != NULL) {
+		fprintf(file, bench_script_head, iterations);
+		fputs(body, file);
+		fputs(bench_script_tail, file);
+		fclose(file);
+	}
+	return file != NULL;
+}
+
+// Runs the script with the shell, its standard output going to the output file, and returns
+// how long that took.
+static u64
+bench_run(char *shell) {
+	char *argv[] = {shell, BENCH_SCRIPT_FILE, NULL};
+	
+	int fd = open(BENCH_OUTPUT_FILE, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fd, STDOUT_FILENO);
+	
+	u64 start = time_now_ns();
+	pid_t pid = 0;
+	if (posix_spawn(&pid, shell, &actions, NULL, argv, environ) != 0) {
+		fprintf(stderr, "Could not run '%s'\n", shell);
+		exit(1);
+	}
+	waitpid(pid, NULL, 0);
+	u64 elapsed = time_now_ns() - start;
+	
+	posix_spawn_file_actions_destroy(&actions);
+	close(fd);
+	return elapsed;
+}
+
+static void
+bench_read_output(char *buffer, size_t cap) {
+	buffer[0] = 0;
+	FILE *file = fopen(BENCH_OUTPUT_FILE, "rb");
+	if (file != NULL) {
+		size_t len = fread(buffer, 1, cap - 1, file);
+		buffer[len] = 0;
+		fclose(file);
+	}
+}
+
+// Runs the case with every shell and prints the time per iteration of each. Returns the one of
+// the first shell, or 0 if a shell printed something else than it.
+static double
+bench_case(char *name, char *body, long long iterations, int runs, char **shells, int shell_count) {
+	double result = 0;
+	if (!bench_write_script(body, iterations)) {
+		fprintf(stderr, "Could not write %s\n", BENCH_SCRIPT_FILE);
+		exit(1);
+	}
+	
+	char expected[256] = {0};
+	u64 *samples = malloc(runs * sizeof(u64));
+	for (int s = 0; s < shell_count; s += 1) {
+		for (int i = 0; i < runs; i += 1) {
+			samples[i] = bench_run(shells[s]);
+		}
+		qsort(samples, runs, sizeof(samples[0]), bench_compare_u64);
+		
+		char output[256];
+		bench_read_output(output, sizeof(output));
+		if (s == 0) {
+			memcpy(expected, output, sizeof(output));
+		}
+		
+		double per_iteration = (double) samples[runs / 2] / (double) iterations;
+		if (s == 0) result = per_iteration;
+		printf("%-10s %-24s %8lld iterations  p50 %9.1f ms  %9.0f ns/iteration",
+			   name, shells[s], iterations, (double) samples[runs / 2] / 1e6, per_iteration);
+		if (strcmp(output, expected) != 0) {
+			printf("  FAIL: printed %s", output);
+			result = 0;
+		}
+		printf("\n");
+	}
+	
+	free(samples);
+	return result;
+}
+
+int
+main(int argc, char **argv) {
+	char     *dush                = argc > 1 ? argv[1] : "./dush";
+	long long iterations          = argc > 2 ? atoll(argv[2]) : 100000;
+	long long external_iterations = argc > 3 ? atoll(argv[3]) : 2000;
+	int       runs                = argc > 4 ? atoi(argv[4]) : 3;
+	
+	// The operators and external cases are POSIX, so other shells can run them too.
+	char *shells[16] = {dush};
+	int   shell_count = 1;
+	if (argc > 5) {
+		for (int i = 5; i < argc && shell_count < 16; i += 1) {
+			shells[shell_count] = argv[i];
+			shell_count += 1;
+		}
+	} else if (access("/bin/dash", X_OK) == 0) {
+		shells[shell_count] = "/bin/dash";
+		shell_count += 1;
+	}
+	
+	printf("p50 of %d runs\n", runs);
+	double operators = bench_case("operators", bench_operators_body, iterations, runs, shells, shell_count);
+	double builtins  = bench_case("builtins", bench_builtins_body, iterations, runs, shells, 1);
+	double external  = bench_case("external", bench_external_body, external_iterations, runs, shells, shell_count);
+	
+	int failed = operators == 0 || builtins == 0 || external == 0;
+	if (!failed) {
+		printf("\nper iteration, external commands take %.0fx as long as the builtins, and %.0fx as long as the operators\n",
+			   external / builtins, external / operators);
+	}
+	
+	unlink(BENCH_SCRIPT_FILE);
+	unlink(BENCH_OUTPUT_FILE);
+	return failed;
+}
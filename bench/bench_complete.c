@@ -0,0 +1,133 @@
+// Benchmark for command completion: building the index, keeping it up to date and looking up
+// prefixes, with a PATH directory that holds thousands of executables.
+// Linux only.
+//
+// Usage: bench_complete [executable count]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+#include "../src/dush_pool.h"
+#include "../src/dush_expand.h"
+#include "../src/dush_history.h"
+#include "../src/dush_complete.h"
+#include "../src/dush_builtins.h"
+#include "../src/dush_script.h"
+#include "../src/dush.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "../src/dush_complete.c"
+#include "../src/dush_linux.c"
+#include "bench.h"
+
+int
+main(int argc, char **argv) {
+	i64 file_count = argc > 1 ? atoll(argv[1]) : 12000;
+	
+	char *dir = "/tmp/dush_bench_complete";
+	mkdir(dir, 0755);
+	
+	// Names like "tool-a-00042" so that prefixes of every length have many matches.
+	char *stems[] = {"git-", "gcc-", "python-", "tool-a-", "tool-b-", "x"};
+	for (i64 i = 0; i < file_count; i += 1) {
+		char path[256];
+		snprintf(path, sizeof(path), "%s/%s%05lld", dir, stems[i % array_count(stems)], cast(long long) i);
+		int fd = open(path, O_CREAT|O_WRONLY, 0755);
+		if (fd >= 0) close(fd);
+	}
+	
+	char *old_path = getenv("PATH");
+	char  new_path[8192];
+	snprintf(new_path, sizeof(new_path), "%s:%s", dir, old_path != NULL ? old_path : "");
+	setenv("PATH", new_path, 1);
+	
+	// A few of the shell's builtins, which the index merges with the executables.
+	String builtin_names[] = {
+		string_from_lit("cd"),
+		string_from_lit("echo"),
+		string_from_lit("grep"),
+		string_from_lit("pwd"),
+		string_from_lit("wc"),
+	};
+	
+	Path_Cache       path_cache = {0};
+	Completion_Index index      = {0};
+	completion_index_init(&index, &path_cache, builtin_names, array_count(builtin_names));
+	
+	// The shell does this before every line it reads.
+	path_cache_update(&path_cache, string_from_cstring(new_path));
+	
+	u64 start = time_now_ns();
+	completion_index_update(&index);
+	u64 build_ns = time_now_ns() - start;
+	
+	// Wait for the second to change, so the directories listed in the same second as they were
+	// last modified stop being listed again on every update.
+	sleep(1);
+	completion_index_update(&index);
+	
+	i64 iterations = 10000;
+	u64 *samples = malloc(iterations * sizeof(u64));
+	
+	start = time_now_ns();
+	for (i64 i = 0; i < iterations; i += 1) {
+		completion_index_update(&index);
+	}
+	u64 update_ns = (time_now_ns() - start) / iterations;
+	
+	printf("%lld commands in %lld directories\n", cast(long long) index.name_count, cast(long long) index.dir_count);
+	printf("build               %9.3f ms\n", cast(double) build_ns / 1e6);
+	printf("update (unchanged)  %9.3f us\n", cast(double) update_ns / 1e3);
+	
+	// What a Tab press costs: the update plus the lookup.
+	char *prefixes[] = {"", "g", "git-", "tool-", "tool-b-0111", "x1", "zzz"};
+	for (i64 p = 0; p < array_count(prefixes); p += 1) {
+		String line = string_from_cstring(prefixes[p]);
+		i64 count = 0;
+		
+		for (i64 i = 0; i < iterations; i += 1) {
+			Scratch scratch = scratch_begin(0, 0);
+			u64 t = time_now_ns();
+			Completion completion = complete_line(&index, scratch.arena, line, line.len);
+			samples[i] = time_now_ns() - t;
+			count = completion.count;
+			scratch_end(scratch);
+		}
+		
+		qsort(samples, cast(size_t) iterations, sizeof(u64), bench_compare_u64);
+		printf("tab '%s'%*s %6lld matches  p50 %7.1f us  p99 %7.1f us  max %7.1f us\n",
+			   prefixes[p], cast(int) (12 - strlen(prefixes[p])), "", cast(long long) count,
+			   cast(double) samples[iterations / 2] / 1e3,
+			   cast(double) samples[iterations * 99 / 100] / 1e3,
+			   cast(double) samples[iterations - 1] / 1e3);
+	}
+	
+	// A new executable only causes its directory to be listed again.
+	{
+		char path[256];
+		snprintf(path, sizeof(path), "%s/%s", dir, "newly-installed");
+		int fd = open(path, O_CREAT|O_WRONLY, 0755);
+		if (fd >= 0) close(fd);
+		
+		u64 listed = index.dirs_listed;
+		start = time_now_ns();
+		completion_index_update(&index);
+		u64 incremental_ns = time_now_ns() - start;
+		
+		Scratch scratch = scratch_begin(0, 0);
+		Completion completion = complete_command(&index, scratch.arena, string_from_lit("newly"));
+		printf("incremental update  %9.3f ms (%lld directory listed, new command %s)\n",
+			   cast(double) incremental_ns / 1e6, cast(long long) (index.dirs_listed - listed),
+			   completion.count == 1 ? "found" : "NOT found");
+		scratch_end(scratch);
+		unlink(path);
+	}
+	
+	completion_index_fini(&index);
+	free(samples);
+	
+	return 0;
+}
@@ -0,0 +1,167 @@
+// Benchmark for the cp builtin against coreutils cp:
+// - small: "cp -r" of a tree of many small files
+// - large: "cp -r" of a directory with a few large files
+// The builtin runs in this process and coreutils cp is spawned; each copy goes to a fresh
+// destination, which is compared with the source once with diff -r.
+// Linux only.
+//
+// Usage: bench_cp [directory] [runs]
+
+#define _GNU_SOURCE
+#include <spawn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define DUSH_NO_MAIN
+#include "../src/dush.c"
+#include "bench.h"
+
+extern char **environ;
+
+static bool
+bench_run(char *command) {
+	return system(command) == 0;
+}
+
+static bool
+bench_write_file(char *path, i64 size, u64 seed) {
+	static u8 buffer[1 << 16];
+	bool ok = false;
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd >= 0) {
+		ok = true;
+		u64 x = seed | 1;
+		for (i64 written = 0; ok && written < size;) {
+			i64 chunk = min(size - written, cast(i64) sizeof(buffer));
+			for (i64 i = 0; i < chunk; i += 8) {
+				x ^= x << 13;
+				x ^= x >> 7;
+				x ^= x << 17;
+				memcpy(buffer + i, &x, min(8, chunk - i));
+			}
+			ok = write(fd, buffer, chunk) == chunk;
+			written += chunk;
+		}
+		close(fd);
+	}
+	return ok;
+}
+
+// The builtin copying `from` to `to`.
+static u64
+bench_builtin(Builtins *builtins, char *from, char *to) {
+	String argv[] = {string_from_lit("-r"), string_from_cstring(from), string_from_cstring(to)};
+	u64 start = time_now_ns();
+	i32 status = builtin_cp(builtins, argv, array_count(argv));
+	u64 elapsed = time_now_ns() - start;
+	if (status != 0) {
+		fprintf(stderr, "The builtin failed\n");
+		exit(1);
+	}
+	return elapsed;
+}
+
+static u64
+bench_coreutils(char *from, char *to) {
+	char *argv[] = {"cp", "-r", from, to, NULL};
+	u64 start = time_now_ns();
+	pid_t pid = 0;
+	int status = 1;
+	if (posix_spawnp(&pid, "cp", NULL, NULL, argv, environ) == 0) {
+		waitpid(pid, &status, 0);
+	}
+	u64 elapsed = time_now_ns() - start;
+	if (status != 0) {
+		fprintf(stderr, "cp failed\n");
+		exit(1);
+	}
+	return elapsed;
+}
+
+static bool
+bench_case(Builtins *builtins, char *name, char *from, char *to, i64 runs) {
+	char command[1024];
+	snprintf(command, sizeof(command), "rm -rf %s && sync", to);
+	
+	// Warm up the page cache, and check the copy. The sync after each deletion keeps its
+	// writeback out of the next copy.
+	bench_run(command);
+	bench_builtin(builtins, from, to);
+	char diff[1024];
+	snprintf(diff, sizeof(diff), "diff -r %s %s > /dev/null", from, to);
+	bool ok = bench_run(diff);
+	
+	if (!ok) {
+		printf("%-32s FAIL: the copy differs\n", name);
+	} else {
+		u64 *builtin_samples   = calloc(runs, sizeof(u64));
+		u64 *coreutils_samples = calloc(runs, sizeof(u64));
+		for (i64 i = 0; i < runs; i += 1) {
+			bench_run(command);
+			builtin_samples[i] = bench_builtin(builtins, from, to);
+			bench_run(command);
+			coreutils_samples[i] = bench_coreutils(from, to);
+		}
+		bench_run(command);
+		
+		char label[256];
+		snprintf(label, sizeof(label), "%s: builtin", name);
+		bench_report(label, builtin_samples, runs);
+		snprintf(label, sizeof(label), "%s: coreutils cp", name);
+		bench_report(label, coreutils_samples, runs);
+		
+		free(builtin_samples);
+		free(coreutils_samples);
+	}
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	char *dir  = argc > 1 ? argv[1] : "/tmp/dush_bench_cp";
+	i64   runs = argc > 2 ? atoll(argv[2]) : 5;
+	
+	char small[512], large[512], copy[512];
+	snprintf(small, sizeof(small), "%s/small", dir);
+	snprintf(large, sizeof(large), "%s/large", dir);
+	snprintf(copy,  sizeof(copy),  "%s/copy",  dir);
+	
+	mkdir(dir, 0755);
+	mkdir(small, 0755);
+	mkdir(large, 0755);
+	
+	// 10000 files of up to 4 kB in 100 directories, and 4 files of 64 MB.
+	i64 small_count = 10000;
+	bool ok = true;
+	for (i64 i = 0; ok && i < small_count; i += 1) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%02lld", small, cast(long long) (i % 100));
+		if (i < 100) mkdir(path, 0755);
+		snprintf(path, sizeof(path), "%s/%02lld/%05lld", small, cast(long long) (i % 100), cast(long long) i);
+		ok = bench_write_file(path, (i * 7919) % 4096 + 1, cast(u64) i);
+	}
+	for (i64 i = 0; ok && i < 4; i += 1) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%lld.bin", large, cast(long long) i);
+		ok = bench_write_file(path, megabytes(64), cast(u64) i + 1);
+	}
+	if (!ok) {
+		printf("FAIL: could not create the files in %s\n", dir);
+		return 1;
+	}
+	
+	Builtins builtins = {0};
+	printf("%lld processors\n", cast(long long) get_processor_count());
+	
+	ok = bench_case(&builtins, "small: 10000 files", small, copy, runs) && ok;
+	ok = bench_case(&builtins, "large: 4 x 64 MB", large, copy, runs) && ok;
+	
+	builtins_fini(&builtins);
+	
+	char command[1024];
+	snprintf(command, sizeof(command), "rm -rf %s", dir);
+	bench_run(command);
+	
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Benchmark for expand_command_line(): expands wildcard patterns against a directory
+// with many files. Linux only.
+//
+// Usage: bench_expand [file count] [iterations]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+#include "../src/dush_expand.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "../src/dush_expand.c"
+#include "bench.h"
+
+static bool
+bench_make_directory(char *root, i64 file_count) {
+	bool ok = mkdir(root, 0755) == 0 || errno == EEXIST;
+	
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/src", root);
+	ok = ok && (mkdir(path, 0755) == 0 || errno == EEXIST);
+	
+	char *extensions[] = {"c", "h", "o", "txt"};
+	for (i64 i = 0; ok && i < file_count; i += 1) {
+		snprintf(path, sizeof(path), "%s/src/file_%06lld.%s", root, cast(long long) i, extensions[i % array_count(extensions)]);
+		int fd = open(path, O_CREAT|O_WRONLY, 0644);
+		if (fd < 0) {
+			ok = false;
+		} else {
+			close(fd);
+		}
+	}
+	
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	i64 file_count = argc > 1 ? atoll(argv[1]) : 50000;
+	i64 iterations = argc > 2 ? atoll(argv[2]) : 20;
+	
+	char root[] = "/tmp/dush_bench_expand";
+	if (!bench_make_directory(root, file_count)) {
+		fprintf(stderr, "Could not create %lld files in '%s': %s\n", cast(long long) file_count, root, strerror(errno));
+		return 1;
+	}
+	
+	if (chdir(root) != 0) {
+		fprintf(stderr, "Could not change directory to '%s': %s\n", root, strerror(errno));
+		return 1;
+	}
+	
+	String lines[] = {
+		string_from_lit("cc src/*.c"),
+		string_from_lit("cc src/file_01*.c src/file_02*.h"),
+		string_from_lit("cc src/*.c src/*.h src/*.o"),
+		string_from_lit("cc src/file_?????7.*"),
+		string_from_lit("echo $HOME/$USER no wildcards here"),
+	};
+	
+	Arena arena = {0};
+	arena_init(&arena);
+	
+	printf("%lld files, %lld iterations\n", cast(long long) file_count, cast(long long) iterations);
+	for (i64 line_index = 0; line_index < array_count(lines); line_index += 1) {
+		u64 best  = ~0ULL;
+		u64 total = 0;
+		i64 argc_out = 0;
+		
+		for (i64 it = 0; it < iterations; it += 1) {
+			u64 start = time_now_ns();
+			Expanded_Command expanded = expand_command_line(&arena, lines[line_index]);
+			u64 elapsed = time_now_ns() - start;
+			
+			argc_out = expanded.argc;
+			best   = min(best, elapsed);
+			total += elapsed;
+			arena_reset(&arena);
+		}
+		
+		printf("%-40.*s %8lld args  best %9.3f ms  mean %9.3f ms\n", string_expand(lines[line_index]),
+			   cast(long long) argc_out, cast(double) best / 1e6, cast(double) total / cast(double) iterations / 1e6);
+	}
+	
+	arena_fini(&arena);
+	return 0;
+}
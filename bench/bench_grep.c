@@ -0,0 +1,159 @@
+// Benchmark for the grep builtin against GNU grep:
+// - tree: "grep -rn <text> <tree>" over a large source tree, the builtin in this process and
+//   GNU grep spawned, with both outputs going to a file and compared
+// - small: "grep -n <text> <file>" on a single small file many times, where spawning a process
+//   is most of the cost
+// Linux only.
+//
+// Usage: bench_grep [tree] [text] [runs]
+
+#define _GNU_SOURCE
+#include <spawn.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define DUSH_NO_MAIN
+#include "../src/dush.c"
+#include "bench.h"
+
+extern char **environ;
+
+#define BENCH_OUTPUT_FILE "/tmp/dush_bench_grep_output"
+
+static void
+bench_reset_output(int fd) {
+	if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+		fprintf(stderr, "Could not reset %s\n", BENCH_OUTPUT_FILE);
+		exit(1);
+	}
+}
+
+static String
+bench_read_output(Arena *arena) {
+	Read_File_Result read = read_file(arena, string_from_lit(BENCH_OUTPUT_FILE));
+	return string_from_sliceu8(read.contents);
+}
+
+// The builtin, with its standard output sent to the output file.
+static u64
+bench_builtin(Builtins *builtins, int fd, char **args, i64 arg_count) {
+	String argv[8];
+	for (i64 i = 0; i < arg_count; i += 1) {
+		argv[i] = string_from_cstring(args[i]);
+	}
+	
+	bench_reset_output(fd);
+	fflush(stdout);
+	int saved_stdout = dup(STDOUT_FILENO);
+	dup2(fd, STDOUT_FILENO);
+	
+	u64 start = time_now_ns();
+	builtin_grep(builtins, argv, arg_count);
+	u64 elapsed = time_now_ns() - start;
+	
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	return elapsed;
+}
+
+// GNU grep, with its standard output sent to the output file. Not /dev/null: GNU grep notices
+// it and stops at the first match.
+static u64
+bench_gnu(int fd, char **args, i64 arg_count) {
+	char *argv[10] = {"grep"};
+	for (i64 i = 0; i < arg_count; i += 1) {
+		argv[i + 1] = args[i];
+	}
+	argv[arg_count + 1] = NULL;
+	
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fd, STDOUT_FILENO);
+	
+	bench_reset_output(fd);
+	
+	u64 start = time_now_ns();
+	pid_t pid = 0;
+	if (posix_spawnp(&pid, "grep", &actions, NULL, argv, environ) != 0) {
+		fprintf(stderr, "Could not run grep\n");
+		exit(1);
+	}
+	waitpid(pid, NULL, 0);
+	u64 elapsed = time_now_ns() - start;
+	
+	posix_spawn_file_actions_destroy(&actions);
+	return elapsed;
+}
+
+// Runs both with the same arguments, checks that they print the same thing, and prints the
+// timings.
+static bool
+bench_case(Builtins *builtins, int fd, char *name, char **args, i64 arg_count, i64 runs) {
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// Warm up the page cache, and compare the outputs.
+	bench_builtin(builtins, fd, args, arg_count);
+	String builtin_output = bench_read_output(scratch.arena);
+	bench_gnu(fd, args, arg_count);
+	String gnu_output = bench_read_output(scratch.arena);
+	
+	bool ok = string_equals(builtin_output, gnu_output);
+	if (!ok) {
+		printf("%-32s FAIL: the outputs differ (%lld and %lld bytes)\n", name,
+			   cast(long long) builtin_output.len, cast(long long) gnu_output.len);
+	} else {
+		u64 *builtin_samples = push_array(scratch.arena, u64, runs);
+		u64 *gnu_samples     = push_array(scratch.arena, u64, runs);
+		for (i64 i = 0; i < runs; i += 1) {
+			builtin_samples[i] = bench_builtin(builtins, fd, args, arg_count);
+			gnu_samples[i]     = bench_gnu(fd, args, arg_count);
+		}
+		
+		char label[256];
+		snprintf(label, sizeof(label), "%s: builtin", name);
+		bench_report(label, builtin_samples, runs);
+		snprintf(label, sizeof(label), "%s: GNU grep", name);
+		bench_report(label, gnu_samples, runs);
+		printf("%-32s %lld bytes of output\n", "", cast(long long) builtin_output.len);
+	}
+	
+	scratch_end(scratch);
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	char *tree = argc > 1 ? argv[1] : "/usr/include";
+	char *text = argc > 2 ? argv[2] : "memcpy";
+	i64   runs = argc > 3 ? atoll(argv[3]) : 10;
+	
+	int fd = open(BENCH_OUTPUT_FILE, O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not create %s\n", BENCH_OUTPUT_FILE);
+		return 1;
+	}
+	
+	Builtins builtins = {0};
+	printf("%lld processors\n", cast(long long) get_processor_count());
+	
+	char *tree_args[] = {"-rn", text, tree};
+	bool ok = bench_case(&builtins, fd, "tree", tree_args, array_count(tree_args), runs);
+	
+	// A file the size of a typical script.
+	char *small_file = "/tmp/dush_bench_grep_small";
+	FILE *small = fopen(small_file, "wb");
+	for (int i = 0; small != NULL && i < 100; i += 1) {
+		fprintf(small, "line %d: %s\n", i, i % 10 == 0 ? text : "nothing to see here");
+	}
+	if (small != NULL) fclose(small);
+	
+	char *small_args[] = {"-n", text, small_file};
+	ok = bench_case(&builtins, fd, "small", small_args, array_count(small_args), runs * 50) && ok;
+	
+	builtins_fini(&builtins);
+	close(fd);
+	unlink(BENCH_OUTPUT_FILE);
+	unlink(small_file);
+	
+	return ok ? 0 : 1;
+}
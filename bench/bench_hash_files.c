@@ -0,0 +1,180 @@
+// Benchmark for hash_bytes() and the hash-files builtin:
+// - hash: hash_bytes() throughput on buffers of a few sizes, with the scalar and the SSE2 loop,
+//   which must give the same hashes
+// - tree: "hash-files -r" over a tree of many small files, without a cache, filling the cache
+//   (cold) and with the cache filled (warm), with the outputs compared
+// Linux only.
+//
+// Usage: bench_hash_files [file count] [runs]
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define DUSH_NO_MAIN
+#include "../src/dush.c"
+#include "bench.h"
+
+#define BENCH_TREE        "/tmp/dush_bench_hash_files"
+#define BENCH_CACHE_FILE  "/tmp/dush_bench_hash_files_cache"
+#define BENCH_OUTPUT_FILE "/tmp/dush_bench_hash_files_output"
+
+// 100 directories of files between a few bytes and a few kB, like a source tree. Their
+// modification time is set in the past, since the cache doesn't trust files modified in the
+// second it was written.
+static bool
+bench_make_tree(i64 file_count) {
+	bool ok = true;
+	mkdir(BENCH_TREE, 0755);
+	
+	char buffer[8192];
+	u64 x = 0x9E3779B97F4A7C15ULL;
+	for (i64 i = 0; ok && i < file_count; i += 1) {
+		char path[256];
+		snprintf(path, sizeof(path), BENCH_TREE "/%03lld", cast(long long) (i % 100));
+		if (i < 100) mkdir(path, 0755);
+		snprintf(path, sizeof(path), BENCH_TREE "/%03lld/%07lld.txt", cast(long long) (i % 100), cast(long long) i);
+		
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		i64 size = cast(i64) (x % 4096) + 16;
+		for (i64 j = 0; j < size; j += 1) {
+			buffer[j] = cast(char) ('a' + (x >> (j % 56)) % 26);
+		}
+		
+		int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+		ok = fd >= 0 && write(fd, buffer, size) == size;
+		if (fd >= 0) {
+			struct timespec times[2] = {{1000000000, 0}, {1000000000, 0}};
+			futimens(fd, times);
+			close(fd);
+		}
+	}
+	return ok;
+}
+
+// The builtin, with its standard output sent to the output file.
+static u64
+bench_builtin(Builtins *builtins, bool with_cache) {
+	String argv[] = {string_from_lit("-r"), string_from_lit("-c"), string_from_lit(BENCH_CACHE_FILE), string_from_lit(BENCH_TREE)};
+	
+	int fd = open(BENCH_OUTPUT_FILE, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	fflush(stdout);
+	int saved_stdout = dup(STDOUT_FILENO);
+	dup2(fd, STDOUT_FILENO);
+	
+	u64 start = time_now_ns();
+	if (with_cache) {
+		builtin_hash_files(builtins, argv, array_count(argv));
+	} else {
+		String no_cache[] = {argv[0], argv[3]};
+		builtin_hash_files(builtins, no_cache, array_count(no_cache));
+	}
+	u64 elapsed = time_now_ns() - start;
+	
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	close(fd);
+	return elapsed;
+}
+
+static String
+bench_read_output(Arena *arena) {
+	Read_File_Result read = read_file(arena, string_from_lit(BENCH_OUTPUT_FILE));
+	return string_from_sliceu8(read.contents);
+}
+
+int
+main(int argc, char **argv) {
+	i64 file_count = argc > 1 ? atoll(argv[1]) : 100000;
+	i64 runs       = argc > 2 ? atoll(argv[2]) : 5;
+	bool ok = true;
+	
+	printf("%lld processors\n\n", cast(long long) get_processor_count());
+	
+	//- Hash
+	
+	{
+		i64 sizes[] = {16, 256, kilobytes(4), megabytes(1)};
+		i64 total   = megabytes(256);
+		u8 *buffer  = malloc(sizes[3]);
+		for (i64 i = 0; i < sizes[3]; i += 1) {
+			buffer[i] = cast(u8) (i * 131 + (i >> 9));
+		}
+		
+		for (i64 s = 0; s < array_count(sizes); s += 1) {
+			String data = string(buffer, sizes[s]);
+			i64 count = total / sizes[s];
+			double gbps[2] = {0};
+			u64 hashes[2] = {0};
+			for (int vectorized = 0; vectorized < 2; vectorized += 1) {
+				u64 start = time_now_ns();
+				u64 hash = 0;
+				for (i64 i = 0; i < count; i += 1) {
+					hash ^= _hash_bytes(data, cast(u64) i, vectorized);
+				}
+				gbps[vectorized]   = cast(double) total / cast(double) (time_now_ns() - start);
+				hashes[vectorized] = hash;
+			}
+			
+			printf("hash %8lld bytes: scalar %6.2f GB/s  sse2 %6.2f GB/s", cast(long long) sizes[s], gbps[0], gbps[1]);
+			if (hashes[0] != hashes[1]) {
+				printf("  FAIL: the hashes differ");
+				ok = false;
+			}
+			printf("\n");
+		}
+		free(buffer);
+	}
+	
+	//- Tree
+	
+	printf("\ncreating %lld files in %s\n", cast(long long) file_count, BENCH_TREE);
+	if (!bench_make_tree(file_count)) {
+		printf("FAIL: could not create the files\n");
+		return 1;
+	}
+	
+	Builtins builtins = {0};
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// Warm up the page cache and the pool first: cold means the cache of hashes is empty, not
+	// that the files are on disk.
+	bench_builtin(&builtins, false);
+	String expected = bench_read_output(scratch.arena);
+	
+	u64 *none_samples = push_array(scratch.arena, u64, runs);
+	u64 *cold_samples = push_array(scratch.arena, u64, runs);
+	u64 *warm_samples = push_array(scratch.arena, u64, runs);
+	for (i64 i = 0; ok && i < runs; i += 1) {
+		none_samples[i] = bench_builtin(&builtins, false);
+		
+		unlink(BENCH_CACHE_FILE);
+		cold_samples[i] = bench_builtin(&builtins, true);
+		ok = string_equals(bench_read_output(scratch.arena), expected);
+		
+		warm_samples[i] = bench_builtin(&builtins, true);
+		ok = ok && string_equals(bench_read_output(scratch.arena), expected);
+	}
+	
+	if (ok) {
+		bench_report("tree: no cache", none_samples, runs);
+		bench_report("tree: cold cache", cold_samples, runs);
+		bench_report("tree: warm cache", warm_samples, runs);
+		printf("%-32s %lld bytes of output\n", "", cast(long long) expected.len);
+	} else {
+		printf("FAIL: the outputs with and without the cache differ\n");
+	}
+	
+	scratch_end(scratch);
+	builtins_fini(&builtins);
+	unlink(BENCH_CACHE_FILE);
+	unlink(BENCH_OUTPUT_FILE);
+	
+	char command[256];
+	snprintf(command, sizeof(command), "rm -rf %s", BENCH_TREE);
+	if (system(command) != 0) ok = false;
+	
+	return ok ? 0 : 1;
+}
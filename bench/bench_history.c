@@ -0,0 +1,69 @@
+// Benchmark for the history log: indexing and substring search with millions of entries.
+// Linux only.
+//
+// Usage: bench_history [entry count]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+#include "../src/dush_history.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "../src/dush_history.c"
+#include "bench.h"
+
+int
+main(int argc, char **argv) {
+	i64 entry_count = argc > 1 ? atoll(argv[1]) : 2000000;
+	
+	String file_name = string_from_lit("/tmp/dush_bench_history");
+	unlink("/tmp/dush_bench_history");
+	
+	char *commands[] = {"ls -la", "cd src", "build.sh", "git status", "grep -rn arena src", "vim dush.c", "make test"};
+	
+	History history = {0};
+	if (!history_init(&history, file_name)) {
+		fprintf(stderr, "Could not open '%.*s'\n", string_expand(file_name));
+		return 1;
+	}
+	
+	u64 start = time_now_ns();
+	for (i64 i = 0; i < entry_count; i += 1) {
+		char line[128];
+		int len = snprintf(line, sizeof(line), "%s %lld", commands[i % array_count(commands)], cast(long long) i);
+		history_append(&history, string(cast(u8 *) line, len));
+	}
+	u64 append_ns = time_now_ns() - start;
+	history_fini(&history);
+	
+	start = time_now_ns();
+	history_init(&history, file_name);
+	u64 load_ns = time_now_ns() - start;
+	
+	printf("%lld entries (%.1f MB)\n", cast(long long) history.entry_count, cast(double) history.mapping.len / 1e6);
+	printf("append      %9.3f ms (%.0f ns/entry)\n", cast(double) append_ns / 1e6, cast(double) append_ns / cast(double) entry_count);
+	printf("load+index  %9.3f ms\n", cast(double) load_ns / 1e6);
+	
+	String needles[] = {
+		string_from_lit("status 1999"),
+		string_from_lit("arena src 7"),
+		string_from_lit("not in there"),
+	};
+	
+	for (i64 n = 0; n < array_count(needles); n += 1) {
+		start = time_now_ns();
+		i64 hits = 0;
+		for (i64 index = history_search(&history, needles[n], 0); index >= 0; index = history_search(&history, needles[n], index + 1)) {
+			hits += 1;
+		}
+		u64 search_ns = time_now_ns() - start;
+		printf("search %-16.*s %7lld hits %9.3f ms\n", string_expand(needles[n]), cast(long long) hits, cast(double) search_ns / 1e6);
+	}
+	
+	history_fini(&history);
+	unlink("/tmp/dush_bench_history");
+	return 0;
+}
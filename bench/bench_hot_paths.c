@@ -0,0 +1,390 @@
+// Micro-benchmarks for the hot paths of the shell: arenas, string primitives, get_line(),
+// read_file(), PATH resolution and spawning a process. Prints the results as JSON on stdout,
+// so that they can be saved and compared across commits (see bench.sh), and a summary on stderr.
+// Linux only.
+//
+// Every benchmark is calibrated so that a sample takes about BENCH_SAMPLE_NS, then timed for
+// BENCH_SAMPLE_COUNT samples. The statistics are per operation, over the samples.
+//
+// Usage: bench_hot_paths [path to tests/hello] [label]
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <math.h>
+
+#define DUSH_NO_MAIN
+#include "../src/dush.c"
+#include "bench.h"
+
+#define BENCH_SAMPLE_COUNT 31
+#define BENCH_SAMPLE_NS    2000000
+
+typedef void Bench_Proc(i64 iterations);
+
+typedef struct Bench_Result Bench_Result;
+struct Bench_Result {
+	char *name;
+	i64   iterations; // Per sample
+	double   median_ns;
+	double   mean_ns;
+	double   variance_ns;
+	double   min_ns;
+	double   max_ns;
+};
+
+// What the benchmarks work on, set up once by main().
+typedef struct Bench_Data Bench_Data;
+struct Bench_Data {
+	Arena  arena;
+	String text_4k;
+	String text_4k_copy;
+	String needle;
+	String small_file;
+	String large_file;
+	i64    lines_left;
+	i64    line_count;
+	String hello_name;
+	Path_Cache path_cache;
+	String command;
+	String current_dir;
+	volatile u64 checksum; // Keeps the compiler from dropping the work.
+};
+
+static Bench_Data bench;
+
+static int
+bench_compare_f64(const void *a, const void *b) {
+	double x = *cast(double *) a;
+	double y = *cast(double *) b;
+	return (x > y) - (x < y);
+}
+
+//- Benchmarks
+
+static void
+bench_arena_push_pop(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		u64 pos = arena_pos(bench.arena);
+		for (i64 j = 0; j < 16; j += 1) {
+			u8 *p = push_nozero(&bench.arena, 64);
+			bench.checksum += cast(u64) p[0];
+		}
+		pop_to(&bench.arena, pos);
+	}
+}
+
+static void
+bench_arena_temp_region(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Arena_Restore_Point restore = arena_begin_temp_region(&bench.arena);
+		u8 *p = push_array(&bench.arena, u8, 1024);
+		bench.checksum += cast(u64) p[512];
+		arena_end_temp_region(restore);
+	}
+}
+
+static void
+bench_scratch_begin_end(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		bench.checksum += arena_pos(*scratch.arena);
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_string_equals(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		bench.checksum += string_equals(bench.text_4k, bench.text_4k_copy);
+	}
+}
+
+static void
+bench_string_find_substring(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		bench.checksum += cast(u64) string_find_substring(bench.text_4k, bench.needle);
+	}
+}
+
+static void
+bench_string_compare(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		bench.checksum += cast(u64) string_compare(bench.text_4k, bench.text_4k_copy);
+	}
+}
+
+static void
+bench_strings_concat(i64 iterations) {
+	String pieces[] = {string_from_lit("/usr/local/bin"), get_separator(), string_from_lit("some-command.dush")};
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		String s = strings_concat(scratch.arena, pieces, array_count(pieces));
+		bench.checksum += cast(u64) s.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_push_stringf(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		String s = push_stringf(scratch.arena, "%6lld  %s", cast(long long) i, "echo hello");
+		bench.checksum += cast(u64) s.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_get_line(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		if (bench.lines_left == 0) {
+			rewind(stdin);
+			bench.lines_left = bench.line_count;
+		}
+		Scratch scratch = scratch_begin(0, 0);
+		String line = get_line(scratch.arena);
+		bench.checksum += cast(u64) line.len;
+		bench.lines_left -= 1;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_read_file_small(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		Read_File_Result read = read_file(scratch.arena, bench.small_file);
+		bench.checksum += cast(u64) read.contents.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_read_file_large(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		Read_File_Result read = read_file(scratch.arena, bench.large_file);
+		bench.checksum += cast(u64) read.contents.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_find_in_path_hit(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		String path = find_in_path(scratch.arena, &bench.path_cache, bench.hello_name);
+		bench.checksum += cast(u64) path.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_find_in_path_miss(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		Scratch scratch = scratch_begin(0, 0);
+		String path = find_in_path(scratch.arena, &bench.path_cache, string_from_lit("no-such-command.dush"));
+		bench.checksum += cast(u64) path.len;
+		scratch_end(scratch);
+	}
+}
+
+static void
+bench_start_process_sync(i64 iterations) {
+	for (i64 i = 0; i < iterations; i += 1) {
+		bench.checksum += start_process_sync(&bench.command, 1, bench.current_dir, string_from_lit(""));
+	}
+}
+
+//- Runner
+
+static Bench_Result
+bench_run(char *name, Bench_Proc *proc) {
+	Bench_Result result = {0};
+	result.name = name;
+	
+	// Warm up, then double the iterations until a sample is long enough to time reliably.
+	proc(1);
+	i64 iterations = 1;
+	while (true) {
+		u64 start = time_now_ns();
+		proc(iterations);
+		u64 elapsed = time_now_ns() - start;
+		if (elapsed >= BENCH_SAMPLE_NS / 2) break;
+		iterations *= 2;
+	}
+	result.iterations = iterations;
+	
+	double samples[BENCH_SAMPLE_COUNT];
+	for (i64 i = 0; i < BENCH_SAMPLE_COUNT; i += 1) {
+		u64 start = time_now_ns();
+		proc(iterations);
+		samples[i] = cast(double) (time_now_ns() - start) / cast(double) iterations;
+	}
+	
+	qsort(samples, BENCH_SAMPLE_COUNT, sizeof(double), bench_compare_f64);
+	
+	double sum = 0;
+	for (i64 i = 0; i < BENCH_SAMPLE_COUNT; i += 1) sum += samples[i];
+	result.mean_ns = sum / BENCH_SAMPLE_COUNT;
+	
+	double squares = 0;
+	for (i64 i = 0; i < BENCH_SAMPLE_COUNT; i += 1) {
+		double d = samples[i] - result.mean_ns;
+		squares += d * d;
+	}
+	result.variance_ns = squares / (BENCH_SAMPLE_COUNT - 1);
+	result.median_ns   = samples[BENCH_SAMPLE_COUNT / 2];
+	result.min_ns      = samples[0];
+	result.max_ns      = samples[BENCH_SAMPLE_COUNT - 1];
+	
+	fprintf(stderr, "%-24s median %12.1f ns  stddev %5.1f%%  (%lld per sample)\n", name, result.median_ns,
+			result.mean_ns > 0 ? 100.0 * sqrt(result.variance_ns) / result.mean_ns : 0.0, cast(long long) iterations);
+	
+	return result;
+}
+
+static bool
+bench_write_file(char *path, String contents) {
+	bool ok = false;
+	FILE *file = fopen(path, "wb");
+	if (file != NULL) {
+		ok = fwrite(contents.data, 1, cast(size_t) contents.len, file) == cast(size_t) contents.len;
+		ok = fclose(file) == 0 && ok;
+	}
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	char *hello = argc > 1 ? argv[1] : "./hello";
+	char *label = argc > 2 ? argv[2] : "";
+	
+	// Run on a single CPU so that samples don't move between cores with different clocks.
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(sched_getcpu() >= 0 ? sched_getcpu() : 0, &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+	
+	if (!arena_init(&bench.arena, .reserve_size = megabytes(256))) {
+		fprintf(stderr, "Could not create the arena: %.*s\n", string_expand(last_alloc_error_string()));
+		return 1;
+	}
+	
+	char root[] = "/tmp/dush_bench_hot_paths";
+	mkdir(root, 0755);
+	
+	// The same pseudo-random text on every run.
+	{
+		u64 seed = 0x9e3779b97f4a7c15ULL;
+		String text = push_string(&bench.arena, 4096);
+		for (i64 i = 0; i < text.len; i += 1) {
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			text.data[i] = cast(u8) ('a' + (seed >> 33) % 26);
+		}
+		bench.text_4k      = text;
+		bench.text_4k_copy = string_clone(&bench.arena, text);
+		bench.needle       = string_stop(string_skip(text, text.len - 16), 16);
+	}
+	
+	// Files for read_file(): a script-sized one and a big one.
+	{
+		String large = push_string(&bench.arena, megabytes(1));
+		for (i64 i = 0; i < large.len; i += 1) large.data[i] = bench.text_4k.data[i % bench.text_4k.len];
+		
+		bench.small_file = push_stringf(&bench.arena, "%s/small.dush", root);
+		bench.large_file = push_stringf(&bench.arena, "%s/large.txt", root);
+		if (!bench_write_file(cast(char *) bench.small_file.data, string_stop(bench.text_4k, 4096)) ||
+			!bench_write_file(cast(char *) bench.large_file.data, large)) {
+			fprintf(stderr, "Could not write the files in '%s': %s\n", root, strerror(errno));
+			return 1;
+		}
+	}
+	
+	// Lines for get_line(), read from stdin like the shell does when its input is a pipe.
+	{
+		bench.line_count = 10000;
+		char path[256];
+		snprintf(path, sizeof(path), "%s/lines.txt", root);
+		FILE *file = fopen(path, "wb");
+		for (i64 i = 0; file != NULL && i < bench.line_count; i += 1) {
+			fprintf(file, "echo line %06lld with some arguments *.c $HOME\n", cast(long long) i);
+		}
+		if (file == NULL || fclose(file) != 0 || freopen(path, "rb", stdin) == NULL) {
+			fprintf(stderr, "Could not write '%s': %s\n", path, strerror(errno));
+			return 1;
+		}
+		bench.lines_left = bench.line_count;
+	}
+	
+	// The PATH resolution looks for hello.dush in the directory of hello, which goes last.
+	{
+		char  hello_dir[4096];
+		char *resolved = realpath(hello, NULL);
+		if (resolved == NULL) {
+			fprintf(stderr, "Could not find '%s'; build it with build_tests.sh.\n", hello);
+			return 1;
+		}
+		snprintf(hello_dir, sizeof(hello_dir), "%s", resolved);
+		*strrchr(hello_dir, '/') = 0;
+		
+		char script[4096 + 32];
+		snprintf(script, sizeof(script), "%s/hello.dush", hello_dir);
+		bench_write_file(script, string_from_lit("hello\n"));
+		
+		char *old_path = getenv("PATH");
+		String new_path = push_stringf(&bench.arena, "%s:%s", old_path != NULL ? old_path : "", hello_dir);
+		setenv("PATH", cast(char *) new_path.data, 1);
+		path_cache_update(&bench.path_cache, new_path);
+		
+		bench.hello_name  = string_from_lit("hello.dush");
+		bench.command     = string_clone(&bench.arena, string_from_cstring(resolved));
+		bench.current_dir = get_current_directory(&bench.arena);
+		free(resolved);
+	}
+	
+	// The JSON goes to the original stdout; what the spawned processes print goes nowhere.
+	FILE *json = fdopen(dup(STDOUT_FILENO), "w");
+	int   null_fd = open("/dev/null", O_WRONLY);
+	if (json == NULL || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+		fprintf(stderr, "Could not redirect stdout: %s\n", strerror(errno));
+		return 1;
+	}
+	close(null_fd);
+	
+	Bench_Result results[] = {
+		bench_run("arena_push_pop_16x64",   bench_arena_push_pop),
+		bench_run("arena_temp_region_1k",   bench_arena_temp_region),
+		bench_run("scratch_begin_end",      bench_scratch_begin_end),
+		bench_run("string_equals_4k",       bench_string_equals),
+		bench_run("string_compare_4k",      bench_string_compare),
+		bench_run("string_find_substring",  bench_string_find_substring),
+		bench_run("strings_concat",         bench_strings_concat),
+		bench_run("push_stringf",           bench_push_stringf),
+		bench_run("get_line",               bench_get_line),
+		bench_run("read_file_4k",           bench_read_file_small),
+		bench_run("read_file_1m",           bench_read_file_large),
+		bench_run("find_in_path_hit",       bench_find_in_path_hit),
+		bench_run("find_in_path_miss",      bench_find_in_path_miss),
+		bench_run("start_process_sync",     bench_start_process_sync),
+	};
+	
+	fprintf(json, "{\n");
+	fprintf(json, "  \"label\": \"%s\",\n", label);
+	fprintf(json, "  \"unit\": \"ns\",\n");
+	fprintf(json, "  \"samples\": %d,\n", BENCH_SAMPLE_COUNT);
+	fprintf(json, "  \"benchmarks\": [\n");
+	for (i64 i = 0; i < array_count(results); i += 1) {
+		Bench_Result *r = &results[i];
+		fprintf(json, "    {\"name\": \"%s\", \"iterations\": %lld, \"median\": %.2f, \"mean\": %.2f, \"variance\": %.2f, \"min\": %.2f, \"max\": %.2f}%s\n",
+				r->name, cast(long long) r->iterations, r->median_ns, r->mean_ns, r->variance_ns, r->min_ns, r->max_ns,
+				i + 1 < array_count(results) ? "," : "");
+	}
+	fprintf(json, "  ]\n");
+	fprintf(json, "}\n");
+	fclose(json);
+	
+	arena_fini(&bench.arena);
+	
+	return 0;
+}
@@ -0,0 +1,126 @@
+// Benchmark for waiting on many processes at once, which is what a script that starts commands
+// with '&' and then waits for them does. The same number of processes is started and waited for
+// in three ways:
+// - sequential: start_process_sync() one after the other, the baseline
+// - threads:    a thread per process that blocks in start_process_sync(), which is how a shell
+//               that can only wait for one process at a time runs them together
+// - group:      start_process_async() for all of them, then process_group_wait() from this thread
+//               until the group is empty, which is what the shell does
+// Prints the median time of each, and how many threads it took. Linux only.
+//
+// Usage: bench_jobs [process count] [runs] [command]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "bench.h"
+
+typedef struct Bench_Job Bench_Job;
+struct Bench_Job {
+	Thread thread;
+	String command;
+	String working_dir;
+	bool   ok;
+};
+
+static bool
+bench_sequential(String command, String working_dir, i64 count) {
+	bool ok = true;
+	for (i64 i = 0; i < count; i += 1) {
+		ok &= start_process_sync(&command, 1, working_dir, string_from_lit(""));
+	}
+	return ok;
+}
+
+static void
+bench_job_thread(void *param) {
+	Bench_Job *job = cast(Bench_Job *) param;
+	job->ok = start_process_sync(&job->command, 1, job->working_dir, string_from_lit(""));
+	scratch_arenas_fini();
+}
+
+static bool
+bench_threads(Bench_Job *jobs, String command, String working_dir, i64 count) {
+	bool ok = true;
+	for (i64 i = 0; i < count; i += 1) {
+		jobs[i].command     = command;
+		jobs[i].working_dir = working_dir;
+		jobs[i].ok          = false;
+		ok &= thread_start(&jobs[i].thread, bench_job_thread, &jobs[i]);
+	}
+	for (i64 i = 0; i < count; i += 1) {
+		thread_join(&jobs[i].thread);
+		ok &= jobs[i].ok;
+	}
+	return ok;
+}
+
+static bool
+bench_group(String command, String working_dir, i64 count) {
+	bool ok = true;
+	
+	Process_Group group = {0};
+	for (i64 i = 0; i < count; i += 1) {
+		Process process = {0};
+		ok &= start_process_async(&command, 1, working_dir, string_from_lit(""), &process);
+		ok &= process_group_add(&group, process, cast(u64) i);
+	}
+	
+	u64 tag = 0;
+	while (group.count > 0) {
+		ok &= process_group_wait(&group, true, &tag);
+	}
+	process_group_fini(&group);
+	
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	i64    count   = argc > 1 ? atoll(argv[1]) : 256;
+	int    runs    = argc > 2 ? atoi(argv[2]) : 5;
+	String command = string_from_cstring((argc > 3 ? argv[3] : "/bin/true"));
+	
+	Scratch scratch = scratch_begin(0, 0);
+	String     working_dir = string_from_lit("/tmp");
+	Bench_Job *jobs        = push_array(scratch.arena, Bench_Job, count);
+	u64       *samples     = push_array(scratch.arena, u64, runs);
+	
+	char *names[]   = {"sequential", "threads", "group"};
+	i64   threads[] = {1, count + 1, 1};
+	u64   medians[3] = {0};
+	bool  ok = true;
+	
+	printf("%lld processes of '%.*s', p50 of %d runs\n", cast(long long) count, string_expand(command), runs);
+	for (int c = 0; c < 3; c += 1) {
+		for (int r = 0; r < runs; r += 1) {
+			u64 start = time_now_ns();
+			switch (c) {
+				case 0: ok &= bench_sequential(command, working_dir, count); break;
+				case 1: ok &= bench_threads(jobs, command, working_dir, count); break;
+				case 2: ok &= bench_group(command, working_dir, count); break;
+			}
+			samples[r] = time_now_ns() - start;
+		}
+		qsort(samples, runs, sizeof(samples[0]), bench_compare_u64);
+		medians[c] = samples[runs / 2];
+		
+		printf("%-10s  %9.2f ms  %8.1f us/process  %5lld threads\n", names[c], cast(double) medians[c] / 1e6,
+			   cast(double) medians[c] / 1e3 / cast(double) count, cast(long long) threads[c]);
+	}
+	
+	if (!ok) {
+		printf("FAIL: a process could not be started or waited for\n");
+	} else {
+		printf("\nthe group takes %.2fx the time of the threads, and %.2fx the time of running them one by one\n",
+			   cast(double) medians[2] / cast(double) medians[1], cast(double) medians[2] / cast(double) medians[0]);
+	}
+	
+	scratch_end(scratch);
+	return !ok;
+}
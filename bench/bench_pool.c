@@ -0,0 +1,200 @@
+// Benchmark for the thread pool:
+// - scaling: a fixed amount of CPU work split into tasks that each use their worker's scratch
+//   arena, run serially and with 1, 2, 4, ... workers up to twice the processor count
+// - overhead: the cost of pushing and running an empty task
+// - shutdown: the address space reserved before the pool started, while it ran, and after
+//   thread_pool_fini(), which must be back where it was
+// Linux only.
+//
+// Usage: bench_pool [task count] [work per task]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+#include "../src/dush_pool.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "../src/dush_pool.c"
+#include "bench.h"
+
+typedef struct Bench_Task Bench_Task;
+struct Bench_Task {
+	u64 seed;
+	i64 work;
+	u64 result;
+};
+
+// The address space of the process in kB, from /proc/self/status.
+static i64
+bench_vm_size_kb(void) {
+	i64 result = -1;
+	FILE *file = fopen("/proc/self/status", "r");
+	if (file != NULL) {
+		char line[256];
+		while (fgets(line, sizeof(line), file) != NULL) {
+			if (strncmp(line, "VmSize:", 7) == 0) {
+				result = atoll(line + 7);
+				break;
+			}
+		}
+		fclose(file);
+	}
+	return result;
+}
+
+// Fills a scratch buffer with a xorshift sequence and folds it, so each task touches memory of
+// its own thread like a real builtin would.
+static void
+bench_task_proc(void *param) {
+	Bench_Task *task = cast(Bench_Task *) param;
+	
+	Scratch scratch = scratch_begin(NULL, 0);
+	i64  count  = 1024;
+	u64 *buffer = push_array(scratch.arena, u64, count);
+	
+	u64 x = task->seed | 1;
+	u64 result = 0;
+	for (i64 round = 0; round < task->work; round += 1) {
+		for (i64 i = 0; i < count; i += 1) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			buffer[i] += x;
+		}
+		for (i64 i = 0; i < count; i += 1) {
+			result += buffer[i];
+		}
+	}
+	task->result = result;
+	
+	scratch_end(scratch);
+}
+
+static void
+bench_empty_proc(void *param) {
+	(void) param;
+}
+
+static u64
+bench_checksum(Bench_Task *tasks, i64 task_count) {
+	u64 result = 0;
+	for (i64 i = 0; i < task_count; i += 1) {
+		result ^= tasks[i].result;
+	}
+	return result;
+}
+
+int
+main(int argc, char **argv) {
+	i64 task_count = argc > 1 ? atoll(argv[1]) : 2048;
+	i64 work       = argc > 2 ? atoll(argv[2]) : 64;
+	i64 processors = get_processor_count();
+	
+	Bench_Task *tasks = calloc(task_count, sizeof(Bench_Task));
+	for (i64 i = 0; i < task_count; i += 1) {
+		tasks[i].seed = cast(u64) i * 0x9E3779B97F4A7C15ULL;
+		tasks[i].work = work;
+	}
+	
+	printf("%lld processors, %lld tasks\n\n", cast(long long) processors, cast(long long) task_count);
+	
+	//- Scaling
+	
+	u64 start = time_now_ns();
+	for (i64 i = 0; i < task_count; i += 1) {
+		bench_task_proc(&tasks[i]);
+	}
+	double serial_ms = cast(double) (time_now_ns() - start) / 1e6;
+	u64 expected = bench_checksum(tasks, task_count);
+	
+	printf("%-8s %12s %9s\n", "workers", "time", "speedup");
+	printf("%-8s %9.2f ms %8.2fx\n", "serial", serial_ms, 1.0);
+	
+	bool ok = true;
+	for (i64 worker_count = 1; worker_count <= max(2 * processors, 4); worker_count *= 2) {
+		Thread_Pool pool = {0};
+		if (!thread_pool_init(&pool, worker_count)) {
+			printf("%-8lld FAIL: could not start the pool\n", cast(long long) worker_count);
+			ok = false;
+			break;
+		}
+		
+		for (i64 i = 0; i < task_count; i += 1) {
+			tasks[i].result = 0;
+		}
+		
+		start = time_now_ns();
+		Task_Group group = {0};
+		for (i64 i = 0; i < task_count; i += 1) {
+			thread_pool_push(&pool, &group, bench_task_proc, &tasks[i]);
+		}
+		thread_pool_wait(&pool, &group);
+		double ms = cast(double) (time_now_ns() - start) / 1e6;
+		
+		if (bench_checksum(tasks, task_count) != expected) {
+			printf("%-8lld FAIL: wrong results\n", cast(long long) worker_count);
+			ok = false;
+		} else {
+			printf("%-8lld %9.2f ms %8.2fx\n", cast(long long) worker_count, ms, serial_ms / ms);
+		}
+		
+		thread_pool_fini(&pool);
+	}
+	
+	//- Overhead
+	
+	{
+		i64 empty_count = 100000;
+		Thread_Pool pool = {0};
+		thread_pool_init(&pool, 0);
+		
+		// In batches that fit in the queue, so that the tasks go through it instead of running
+		// inline when a single producer outpaces the workers.
+		i64 batch = THREAD_POOL_QUEUE_CAP / 2;
+		start = time_now_ns();
+		for (i64 i = 0; i < empty_count; i += batch) {
+			Task_Group group = {0};
+			for (i64 j = i; j < min(i + batch, empty_count); j += 1) {
+				thread_pool_push(&pool, &group, bench_empty_proc, NULL);
+			}
+			thread_pool_wait(&pool, &group);
+		}
+		double ns = cast(double) (time_now_ns() - start) / cast(double) empty_count;
+		
+		printf("\n%-28s %8.1f ns per task (%llu of %lld run inline because the queue was full)\n",
+			   "overhead: empty tasks", ns, cast(unsigned long long) atomic_load_u64(&pool.tasks_run_inline), cast(long long) empty_count);
+		
+		thread_pool_fini(&pool);
+	}
+	
+	//- Shutdown
+	
+	{
+		i64 before = bench_vm_size_kb();
+		
+		Thread_Pool pool = {0};
+		thread_pool_init(&pool, max(processors, 4));
+		Task_Group group = {0};
+		for (i64 i = 0; i < task_count; i += 1) {
+			thread_pool_push(&pool, &group, bench_task_proc, &tasks[i]);
+		}
+		thread_pool_wait(&pool, &group);
+		i64 during = bench_vm_size_kb();
+		
+		thread_pool_fini(&pool);
+		i64 after = bench_vm_size_kb();
+		
+		printf("\n%-28s before %lld MB, running %lld MB, after fini %lld MB\n", "shutdown: address space",
+			   cast(long long) before / 1024, cast(long long) during / 1024, cast(long long) after / 1024);
+		if (after > before) {
+			printf("%-28s FAIL: %lld MB still reserved\n", "shutdown", cast(long long) (after - before) / 1024);
+			ok = false;
+		}
+	}
+	
+	free(tasks);
+	return ok ? 0 : 1;
+}
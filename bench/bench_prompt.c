@@ -0,0 +1,93 @@
+// Benchmark for the prompt: how long it takes from starting to render the prompt until the
+// shell can read input, with and without a slow segment, and how long until a late segment
+// shows up.
+// Linux only.
+//
+// Usage: bench_prompt [simulated delay of the git segment in ms]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+#include "../src/dush_prompt.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "../src/dush_prompt.c"
+#include "bench.h"
+
+typedef struct Bench_Case Bench_Case;
+struct Bench_Case {
+	char *name;
+	char *format;
+	u64   budget_us;
+	u64   delay_us;
+};
+
+int
+main(int argc, char **argv) {
+	u64 delay_us = cast(u64) ((argc > 1 ? atof(argv[1]) : 50.0) * 1000);
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	char cwd[PROMPT_PATH_CAP];
+	if (getcwd(cwd, sizeof(cwd)) == NULL) return 1;
+	
+	Bench_Case cases[] = {
+		{"cwd only",                  "\\w>",     PROMPT_DEFAULT_BUDGET_US, 0},
+		{"cwd + git",                 "\\w\\g>",  PROMPT_DEFAULT_BUDGET_US, 0},
+		{"cwd + slow git, sync",      "\\w\\g>",  delay_us * 10,            delay_us},
+		{"cwd + slow git, async",     "\\w\\g>",  PROMPT_DEFAULT_BUDGET_US, delay_us},
+	};
+	
+	printf("%-24s %12s %12s %16s\n", "case", "ready p50", "ready max", "complete p50");
+	for (i64 c = 0; c < array_count(cases); c += 1) {
+		Bench_Case *bench = &cases[c];
+		
+		Prompt prompt = {0};
+		prompt_init(&prompt, string_from_cstring(bench->format), bench->budget_us);
+		prompt.worker.simulated_delay_us = bench->delay_us;
+		
+		i64 iterations = bench->delay_us > 0 ? 20 : 2000;
+		u64 ready[2000];
+		u64 complete[2000];
+		
+		for (i64 i = 0; i < iterations; i += 1) {
+			Arena_Restore_Point restore = arena_begin_temp_region(scratch.arena);
+			
+			Prompt_State state = {0};
+			state.current_dir = string_from_cstring(cwd);
+			
+			u64 start = time_now_us();
+			String text = prompt_render(&prompt, scratch.arena, state);
+			ready[i] = time_now_us() - start;
+			
+			// Wait for the late segments like the line editor would.
+			while (prompt.pending) {
+				struct pollfd pfd = { .fd = cast(int) (prompt.waker.value - 1), .events = POLLIN };
+				poll(&pfd, 1, -1);
+				u64 count = 0;
+				ssize_t nread = read(pfd.fd, &count, sizeof(count));
+				(void)nread;
+				prompt_poll(&prompt, scratch.arena, &text);
+			}
+			complete[i] = time_now_us() - start;
+			
+			if (i == 0 && c == 1) printf("(prompt: %.*s)\n", string_expand(text));
+			arena_end_temp_region(restore);
+		}
+		
+		qsort(ready,    cast(size_t) iterations, sizeof(u64), bench_compare_u64);
+		qsort(complete, cast(size_t) iterations, sizeof(u64), bench_compare_u64);
+		printf("%-24s %9.3f ms %9.3f ms %13.3f ms\n", bench->name,
+			   cast(double) ready[iterations / 2] / 1e3, cast(double) ready[iterations - 1] / 1e3,
+			   cast(double) complete[iterations / 2] / 1e3);
+		
+		prompt_fini(&prompt);
+	}
+	
+	scratch_end(scratch);
+	
+	return 0;
+}
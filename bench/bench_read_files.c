@@ -0,0 +1,113 @@
+// Benchmark for reading many small files, which is what grep -r and hash-files spend their time
+// on. The same files are read from one thread in three ways:
+// - read_file:     one at a time, the way the builtins read them before read_files()
+// - read_files 32: read_files() on groups of BUILTIN_READ_BATCH_SIZE files, like a builtin task
+// - read_files 128: read_files() on groups as big as one submission takes
+// The files are written once, before, so they are all in the page cache: what is measured is
+// the cost of the system calls, not of the disk. Where io_uring is unavailable, read_files() is
+// read_file() in a loop, and the three take the same time. Linux only.
+//
+// Usage: bench_read_files [file count] [runs] [directory]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+#include "../src/dush_os.h"
+#include "../src/dush_trace.h"
+
+#include "../src/dush_base.c"
+#include "../src/dush_os.c"
+#include "../src/dush_trace.c"
+#include "bench.h"
+
+#define BENCH_FILES_PER_DIRECTORY 1000
+
+// Reads every file in groups of `group` files, or with read_file() if it's 0. Returns the total
+// size read, or -1 if a file couldn't be.
+static i64
+bench_read(Read_Files_Item *items, i64 count, i64 group) {
+	i64 result = 0;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	for (i64 first = 0; first < count && result >= 0; first += max(group, 1)) {
+		u64 pos = arena_pos(*scratch.arena);
+		
+		i64 group_count = min(max(group, 1), count - first);
+		if (group == 0) {
+			items[first].result = read_file(scratch.arena, items[first].file_name);
+		} else {
+			read_files(scratch.arena, items + first, group_count);
+		}
+		
+		for (i64 i = first; i < first + group_count && result >= 0; i += 1) {
+			result = items[i].result.ok ? result + items[i].result.contents.len : -1;
+		}
+		pop_to(scratch.arena, pos);
+	}
+	scratch_end(scratch);
+	
+	return result;
+}
+
+int
+main(int argc, char **argv) {
+	i64    count     = argc > 1 ? atoll(argv[1]) : 100000;
+	int    runs      = argc > 2 ? atoi(argv[2]) : 5;
+	String directory = string_from_cstring((argc > 3 ? argv[3] : "/tmp/dush_bench_read_files"));
+	
+	Scratch scratch = scratch_begin(0, 0);
+	Read_Files_Item *items   = push_array(scratch.arena, Read_Files_Item, count);
+	u64             *samples = push_array(scratch.arena, u64, runs);
+	
+	// A few hundred bytes each, in directories of BENCH_FILES_PER_DIRECTORY.
+	directory_create(directory);
+	for (i64 i = 0; i < count; i += 1) {
+		String sub = push_stringf(scratch.arena, "%.*s/%lld", string_expand(directory), cast(long long) (i / BENCH_FILES_PER_DIRECTORY));
+		if (i % BENCH_FILES_PER_DIRECTORY == 0) directory_create(sub);
+		
+		items[i].file_name = push_stringf(scratch.arena, "%.*s/%lld.txt", string_expand(sub), cast(long long) i);
+		String contents = push_stringf(scratch.arena, "file %lld\n%0*d\n", cast(long long) i, cast(int) (100 + i % 400), 0);
+		
+		File_Handle file = file_open(items[i].file_name, File_Open_WRITE|File_Open_CREATE|File_Open_TRUNCATE);
+		file_write(file, contents);
+		file_close(file);
+	}
+	
+	char *names[]  = {"read_file", "read_files 32", "read_files 128"};
+	i64   groups[] = {0, 32, 128};
+	u64   medians[3] = {0};
+	i64   sizes[3]   = {0};
+	
+	printf("%lld files, p50 of %d runs\n", cast(long long) count, runs);
+	for (int c = 0; c < 3; c += 1) {
+		for (int r = 0; r < runs; r += 1) {
+			u64 start = time_now_ns();
+			sizes[c]   = bench_read(items, count, groups[c]);
+			samples[r] = time_now_ns() - start;
+		}
+		qsort(samples, runs, sizeof(samples[0]), bench_compare_u64);
+		medians[c] = samples[runs / 2];
+		
+		printf("%-15s %9.2f ms  %7.2f us/file  %lld bytes\n", names[c], cast(double) medians[c] / 1e6,
+			   cast(double) medians[c] / 1e3 / cast(double) count, cast(long long) sizes[c]);
+	}
+	
+	bool ok = sizes[0] >= 0 && sizes[1] == sizes[0] && sizes[2] == sizes[0];
+	if (!ok) {
+		printf("FAIL: the files weren't all read, or not the same\n");
+	} else {
+		printf("\nread_files takes %.2fx the time of read_file in groups of 32, and %.2fx in groups of 128%s\n",
+			   cast(double) medians[1] / cast(double) medians[0], cast(double) medians[2] / cast(double) medians[0],
+			   _linux_ring_support == 1 ? "" : " (without io_uring)");
+	}
+	
+	for (i64 i = 0; i < count; i += 1) {
+		file_delete(items[i].file_name);
+		if (i % BENCH_FILES_PER_DIRECTORY == BENCH_FILES_PER_DIRECTORY - 1 || i == count - 1) {
+			directory_delete(push_stringf(scratch.arena, "%.*s/%lld", string_expand(directory), cast(long long) (i / BENCH_FILES_PER_DIRECTORY)));
+		}
+	}
+	directory_delete(directory);
+	
+	scratch_end(scratch);
+	return !ok;
+}
@@ -0,0 +1,146 @@
+// Benchmark for finding a command in a PATH of deep directories, the way the shell does before
+// starting it. The same lookups are done in three ways:
+// - full paths:      each directory joined with the name and walked by the kernel from the root,
+//                    which is how the lookup worked before the PATH cache
+// - cache, opened:   find_executable() with the directories of the PATH already open, so that
+//                    only the name is looked up in each
+// - cache, reopened: the same, but the cache is thrown away before every lookup, so the
+//                    directories are opened again; what a lookup costs after the PATH changed
+// Each is timed for a command in the last directory, and for one that is nowhere. Linux only.
+//
+// Usage: bench_resolve [directory count] [depth] [directory]
+
+#define DUSH_NO_MAIN
+#include "../src/dush.c"
+#include "bench.h"
+
+#define BENCH_ITERATIONS 2000
+#define BENCH_RUNS       9
+
+// The lookup without the cache: a full path for every directory.
+static String
+bench_find_full_paths(Arena *arena, String command) {
+	String result = {0};
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	String system_path = get_system_path(scratch.arena);
+	for (String loc = path_list_next(&system_path); loc.data != NULL; loc = path_list_next(&system_path)) {
+		String temp[] = {loc, string_from_lit("/"), command};
+		String full_path = strings_concat(scratch.arena, temp, array_count(temp));
+		if (file_is_executable(full_path)) {
+			result = string_clone(arena, full_path);
+			break;
+		}
+	}
+	scratch_end(scratch);
+	
+	return result;
+}
+
+// Median time of one lookup, in nanoseconds. Sets `found` to whether the command was.
+static u64
+bench_lookups(int way, String command, bool *found) {
+	u64 samples[BENCH_RUNS] = {0};
+	Path_Cache cache = {0};
+	
+	// The shell brings the cache up to date before every lookup.
+	Scratch path_scratch = scratch_begin(0, 0);
+	String  system_path  = get_system_path(path_scratch.arena);
+	
+	for (int r = 0; r < BENCH_RUNS; r += 1) {
+		u64 start = time_now_ns();
+		for (int i = 0; i < BENCH_ITERATIONS; i += 1) {
+			Scratch scratch = scratch_begin(0, 0);
+			bool   missing = false;
+			String path    = {0};
+			switch (way) {
+				case 0: path = bench_find_full_paths(scratch.arena, command); break;
+				case 1: {
+					path_cache_update(&cache, system_path);
+					path = find_executable(scratch.arena, &cache, command, &missing);
+				} break;
+				case 2: {
+					path_cache_fini(&cache);
+					path_cache_update(&cache, system_path);
+					path = find_executable(scratch.arena, &cache, command, &missing);
+				} break;
+			}
+			*found = path.len > 0;
+			scratch_end(scratch);
+		}
+		samples[r] = (time_now_ns() - start) / BENCH_ITERATIONS;
+	}
+	path_cache_fini(&cache);
+	scratch_end(path_scratch);
+	
+	qsort(samples, BENCH_RUNS, sizeof(samples[0]), bench_compare_u64);
+	return samples[BENCH_RUNS / 2];
+}
+
+int
+main(int argc, char **argv) {
+	int   count = argc > 1 ? atoi(argv[1]) : 30;
+	int   depth = argc > 2 ? atoi(argv[2]) : 12;
+	char *root  = argc > 3 ? argv[3] : "/tmp/dush_bench_resolve";
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// Every directory of the PATH is `depth` levels under the root; the command is in the last.
+	String system_path = {0};
+	String last_dir    = {0};
+	mkdir(root, 0755);
+	for (int i = 0; i < count; i += 1) {
+		String dir = push_stringf(scratch.arena, "%s/%02d", root, i);
+		for (int d = 0; d < depth; d += 1) {
+			mkdir(cast(char *) dir.data, 0755);
+			dir = push_stringf(scratch.arena, "%.*s/level%d", string_expand(dir), d);
+		}
+		mkdir(cast(char *) dir.data, 0755);
+		
+		system_path = i == 0 ? dir : push_stringf(scratch.arena, "%.*s:%.*s", string_expand(system_path), string_expand(dir));
+		last_dir    = dir;
+	}
+	String target = push_stringf(scratch.arena, "%.*s/bench-target", string_expand(last_dir));
+	File_Handle file = file_open(target, File_Open_WRITE|File_Open_CREATE|File_Open_TRUNCATE);
+	file_write(file, string_from_lit("#!/bin/sh\n"));
+	file_close(file);
+	chmod(cast(char *) target.data, 0755);
+	
+	char *old_path = getenv("PATH");
+	old_path = old_path != NULL ? strdup(old_path) : NULL;
+	setenv("PATH", cast(char *) system_path.data, 1);
+	
+	char  *names[]   = {"full paths", "cache, opened", "cache, reopened"};
+	String commands[] = {string_from_lit("bench-target"), string_from_lit("no-such-command")};
+	u64    medians[3][2] = {0};
+	bool   ok = true;
+	
+	printf("%d PATH directories %d levels deep, p50 of %d runs of %d lookups\n", count, depth + 1, BENCH_RUNS, BENCH_ITERATIONS);
+	printf("%-16s %12s %12s\n", "", "hit (last)", "miss");
+	for (int w = 0; w < 3; w += 1) {
+		for (int c = 0; c < 2; c += 1) {
+			bool found = false;
+			medians[w][c] = bench_lookups(w, commands[c], &found);
+			ok &= found == (c == 0);
+		}
+		printf("%-16s %9.2f us %9.2f us\n", names[w], cast(double) medians[w][0] / 1e3, cast(double) medians[w][1] / 1e3);
+	}
+	
+	if (!ok) {
+		printf("FAIL: a lookup didn't find what it should have\n");
+	} else {
+		printf("\nwith the directories open, a lookup takes %.2fx the time of full paths for a hit, and %.2fx for a miss\n",
+			   cast(double) medians[1][0] / cast(double) medians[0][0], cast(double) medians[1][1] / cast(double) medians[0][1]);
+	}
+	
+	if (old_path != NULL) setenv("PATH", old_path, 1);
+	free(old_path);
+	
+	char command[4096];
+	snprintf(command, sizeof(command), "rm -rf '%s'", root);
+	int removed = system(command);
+	(void)removed;
+	
+	scratch_end(scratch);
+	return !ok;
+}
@@ -0,0 +1,126 @@
+// Benchmark for scratch_begin()/scratch_end(): nested pairs the way functions that take an arena
+// use them, each level passing the arena of the level above as a conflict. Compares with the
+// previous implementation, which compared every conflict with every scratch arena.
+// Linux only.
+//
+// Usage: bench_scratch [iterations]
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+
+#include "../src/dush_base.c"
+#include "bench.h"
+
+// The previous scratch_begin(), for comparison.
+static Scratch
+bench_scratch_begin_linear(Arena **conflicts, i64 conflict_count) {
+	last_alloc_error = Alloc_Error_NONE;
+	
+	Scratch scratch = {0};
+	
+	last_alloc_error = Alloc_Error_OUT_OF_MEMORY;
+	for (i64 scratch_arena_index = 0; scratch_arena_index < array_count(scratch_arenas); scratch_arena_index += 1) {
+		bool is_conflicting = false;
+		for (i64 conflict_index = 0; conflict_index < conflict_count; conflict_index += 1) {
+			if (conflicts[conflict_index] == &scratch_arenas[scratch_arena_index]) {
+				is_conflicting = true;
+				break;
+			}
+		}
+		
+		if (!is_conflicting) {
+			Arena *arena = &scratch_arenas[scratch_arena_index];
+			if (arena->ptr == NULL && scratch_arenas_init_errors[scratch_arena_index] == Alloc_Error_NONE) {
+				arena_init(arena, .reserve_size = SCRATCH_ARENA_RESERVE_SIZE);
+				scratch_arenas_init_errors[scratch_arena_index] = last_alloc_error;
+			}
+			
+			if (arena->ptr != NULL) {
+				last_alloc_error = Alloc_Error_NONE;
+				scratch.arena = arena;
+				scratch.pos   = arena->pos;
+				break;
+			} else {
+				last_alloc_error = scratch_arenas_init_errors[scratch_arena_index];
+			}
+		}
+	}
+	
+	return scratch;
+}
+
+static void
+bench_scratch_end_linear(Scratch scratch) {
+	pop_to(scratch.arena, scratch.pos);
+}
+
+// Each level allocates a little and calls the next one with its own arena, like a chain of
+// functions that return their results in the caller's arena.
+static u64
+bench_nested(Arena *arena, i64 depth, i64 extra_conflicts, Arena *others) {
+	u64 result = 0;
+	if (depth > 0) {
+		Arena *conflicts[3] = {arena, &others[0], &others[1]};
+		Scratch scratch = scratch_begin(conflicts, 1 + extra_conflicts);
+		u8 *p = push_nozero(scratch.arena, 32);
+		result = cast(u64) p[0] + bench_nested(scratch.arena, depth - 1, extra_conflicts, others);
+		scratch_end(scratch);
+	}
+	return result;
+}
+
+static u64
+bench_nested_linear(Arena *arena, i64 depth, i64 extra_conflicts, Arena *others) {
+	u64 result = 0;
+	if (depth > 0) {
+		Arena *conflicts[3] = {arena, &others[0], &others[1]};
+		Scratch scratch = bench_scratch_begin_linear(conflicts, 1 + extra_conflicts);
+		u8 *p = push_nozero(scratch.arena, 32);
+		result = cast(u64) p[0] + bench_nested_linear(scratch.arena, depth - 1, extra_conflicts, others);
+		bench_scratch_end_linear(scratch);
+	}
+	return result;
+}
+
+int
+main(int argc, char **argv) {
+	i64 iterations = argc > 1 ? atoll(argv[1]) : 2000000;
+	
+	Arena caller = {0};
+	Arena others[2] = {0};
+	arena_init(&caller, .reserve_size = megabytes(1));
+	arena_init(&others[0], .reserve_size = megabytes(1));
+	arena_init(&others[1], .reserve_size = megabytes(1));
+	
+	volatile u64 sink = 0;
+	
+	printf("%-6s %-10s %14s %14s\n", "depth", "conflicts", "linear", "bitmask");
+	for (i64 depth = 1; depth <= 8; depth *= 2) {
+		for (i64 extra = 0; extra <= 2; extra += 2) {
+			// Warm up, and reserve the scratch arenas outside of the timed loops.
+			sink += bench_nested(&caller, depth, extra, others);
+			sink += bench_nested_linear(&caller, depth, extra, others);
+			
+			u64 start = time_now_ns();
+			for (i64 i = 0; i < iterations; i += 1) {
+				sink += bench_nested_linear(&caller, depth, extra, others);
+			}
+			double linear_ns = cast(double) (time_now_ns() - start) / cast(double) (iterations * depth);
+			
+			start = time_now_ns();
+			for (i64 i = 0; i < iterations; i += 1) {
+				sink += bench_nested(&caller, depth, extra, others);
+			}
+			double bitmask_ns = cast(double) (time_now_ns() - start) / cast(double) (iterations * depth);
+			
+			printf("%-6lld %-10lld %11.2f ns %11.2f ns  (per begin/end pair)\n",
+				   cast(long long) depth, cast(long long) (1 + extra), linear_ns, bitmask_ns);
+		}
+	}
+	
+	arena_fini(&caller);
+	arena_fini(&others[0]);
+	arena_fini(&others[1]);
+	
+	return 0;
+}
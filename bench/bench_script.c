@@ -0,0 +1,194 @@
+// Benchmark for the script interpreter: runs loop-heavy scripts with dush and with the other
+// shells given on the command line (dash by default), and compares their time and output. The
+// scripts are written in the subset of the POSIX shell language that dush understands, so every
+// shell runs the same file:
+// - arith: a counter, a sum and a product in $((...)), tested with [
+// - string: building and comparing strings, and a small function call every iteration
+// - builtin: builtins and assignments whose words are all constant
+// - sequence: builtins joined by &&, || and ';' under set -e, half of them skipped, and $?
+// Linux only.
+//
+// Usage: bench_script [path to dush] [iterations] [runs] [other shells...]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+
+#include "../src/dush_base.c"
+#include "bench.h"
+
+extern char **environ;
+
+#define BENCH_SCRIPT_FILE "/tmp/dush_bench_script.dush"
+#define BENCH_OUTPUT_FILE "/tmp/dush_bench_script_output"
+
+static char *bench_arith_script =
+	"i=0\n"
+	"sum=0\n"
+	"while [ $i -lt %lld ]; do\n"
+	"	sum=$((sum + i * 3 %% 7))\n"
+	"	i=$((i + 1))\n"
+	"done\n"
+	"echo $i $sum\n";
+
+static char *bench_string_script =
+	"check() {\n"
+	"	if [ \"$1\" = \"item-500\" ]; then found=$2; fi\n"
+	"}\n"
+	"i=0\n"
+	"line=\n"
+	"while [ $i -lt %lld ]; do\n"
+	"	name=\"item-$((i %% 1000))\"\n"
+	"	line=\"$name:$i\"\n"
+	"	check $name $i\n"
+	"	i=$((i + 1))\n"
+	"done\n"
+	"echo $line $found\n";
+
+static char *bench_builtin_script =
+	"i=0\n"
+	"while [ $i -lt %lld ]; do\n"
+	"	true\n"
+	"	test -n \"a b\"\n"
+	"	: \"constant words\" 'are the same' every time\n"
+	"	x=abc\"def\"'ghi'\n"
+	"	i=$((i + 1))\n"
+	"done\n"
+	"echo $i $x\n";
+
+static char *bench_sequence_script =
+	"set -e\n"
+	"i=0\n"
+	"n=0\n"
+	"while [ $i -lt %lld ]; do\n"
+	"	true && n=$((n + 1)) || n=0\n"
+	"	false || true && :\n"
+	"	false && n=0; s=$?\n"
+	"	[ $s -ne 0 ] || false\n"
+	"	i=$((i + 1))\n"
+	"done\n"
+	"echo $i $n $s\n";
+
+static int
+bench_write_script(char *format, long long iterations) {
+	FILE *file = fopen(BENCH_SCRIPT_FILE, "wb");
+	if (file != NULL) {
+		fprintf(file, format, iterations);
+		fclose(file);
+	}
+	return file != NULL;
+}
+
+// Runs the script with the shell, its standard output going to the output file, and returns
+// how long that took.
+static u64
+bench_run(char *shell) {
+	char *argv[] = {shell, BENCH_SCRIPT_FILE, NULL};
+	
+	int fd = open(BENCH_OUTPUT_FILE, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fd, STDOUT_FILENO);
+	
+	u64 start = time_now_ns();
+	pid_t pid = 0;
+	if (posix_spawn(&pid, shell, &actions, NULL, argv, environ) != 0) {
+		fprintf(stderr, "Could not run '%s'\n", shell);
+		exit(1);
+	}
+	waitpid(pid, NULL, 0);
+	u64 elapsed = time_now_ns() - start;
+	
+	posix_spawn_file_actions_destroy(&actions);
+	close(fd);
+	return elapsed;
+}
+
+static void
+bench_read_output(char *buffer, size_t cap) {
+	buffer[0] = 0;
+	FILE *file = fopen(BENCH_OUTPUT_FILE, "rb");
+	if (file != NULL) {
+		size_t len = fread(buffer, 1, cap - 1, file);
+		buffer[len] = 0;
+		fclose(file);
+	}
+}
+
+// Runs the script with every shell, and prints each one's time next to the first one's. Returns
+// 0 if they all printed the same thing.
+static int
+bench_case(char *name, char *format, long long iterations, int runs, char **shells, int shell_count) {
+	int failed = 0;
+	if (!bench_write_script(format, iterations)) {
+		fprintf(stderr, "Could not write %s\n", BENCH_SCRIPT_FILE);
+		exit(1);
+	}
+	
+	char expected[256];
+	double first_p50 = 0;
+	u64 *samples = malloc(runs * sizeof(u64));
+	for (int s = 0; s < shell_count; s += 1) {
+		for (int i = 0; i < runs; i += 1) {
+			samples[i] = bench_run(shells[s]);
+		}
+		qsort(samples, runs, sizeof(samples[0]), bench_compare_u64);
+		
+		char output[256];
+		bench_read_output(output, sizeof(output));
+		if (s == 0) {
+			memcpy(expected, output, sizeof(output));
+		}
+		
+		double p50 = (double) samples[runs / 2];
+		if (s == 0) first_p50 = p50;
+		printf("%-8s %-24s p50 %9.1f ms  min %9.1f ms  %6.0f ns/iteration  %5.2fx",
+			   name, shells[s], p50 / 1e6, (double) samples[0] / 1e6, p50 / (double) iterations, p50 / first_p50);
+		if (strcmp(output, expected) != 0) {
+			printf("  FAIL: printed %s", output);
+			failed = 1;
+		}
+		printf("\n");
+	}
+	
+	free(samples);
+	return failed;
+}
+
+int
+main(int argc, char **argv) {
+	char     *dush       = argc > 1 ? argv[1] : "./dush";
+	long long iterations = argc > 2 ? atoll(argv[2]) : 1000000;
+	int       runs       = argc > 3 ? atoi(argv[3]) : 3;
+	
+	char *shells[16] = {dush};
+	int   shell_count = 1;
+	if (argc > 4) {
+		for (int i = 4; i < argc && shell_count < 16; i += 1) {
+			shells[shell_count] = argv[i];
+			shell_count += 1;
+		}
+	} else if (access("/bin/dash", X_OK) == 0) {
+		shells[shell_count] = "/bin/dash";
+		shell_count += 1;
+	}
+	
+	printf("%lld iterations, p50 of %d runs\n", iterations, runs);
+	int failed = bench_case("arith", bench_arith_script, iterations, runs, shells, shell_count);
+	failed |= bench_case("string", bench_string_script, iterations, runs, shells, shell_count);
+	failed |= bench_case("builtin", bench_builtin_script, iterations, runs, shells, shell_count);
+	failed |= bench_case("sequence", bench_sequence_script, iterations, runs, shells, shell_count);
+	
+	unlink(BENCH_SCRIPT_FILE);
+	unlink(BENCH_OUTPUT_FILE);
+	return failed;
+}
@@ -0,0 +1,84 @@
+// Benchmark for startup time: runs "<shell> -c ''" thousands of times and measures the time from
+// spawning it until it exited, for dush and for the other shells given on the command line.
+// Linux only.
+//
+// Usage: bench_startup [path to dush] [run count] [other shells...]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "../src/dush_ctx_crack.h"
+#include "../src/dush_base.h"
+
+#include "../src/dush_base.c"
+#include "bench.h"
+
+extern char **environ;
+
+static void
+bench_shell(char *shell, char *command, int runs, u64 *samples) {
+	char *argv[] = {shell, "-c", command, NULL};
+
+	// Warm up the page cache and the dynamic loader.
+	for (int i = 0; i < 10; i += 1) {
+		pid_t pid = 0;
+		if (posix_spawn(&pid, shell, NULL, NULL, argv, environ) == 0) waitpid(pid, NULL, 0);
+	}
+
+	struct rusage before = {0};
+	getrusage(RUSAGE_CHILDREN, &before);
+
+	for (int i = 0; i < runs; i += 1) {
+		u64 start = time_now_ns();
+		pid_t pid = 0;
+		if (posix_spawn(&pid, shell, NULL, NULL, argv, environ) != 0) {
+			fprintf(stderr, "Could not run '%s'\n", shell);
+			exit(1);
+		}
+		waitpid(pid, NULL, 0);
+		samples[i] = time_now_ns() - start;
+	}
+
+	struct rusage after = {0};
+	getrusage(RUSAGE_CHILDREN, &after);
+	long minor_faults = after.ru_minflt - before.ru_minflt;
+
+	qsort(samples, runs, sizeof(samples[0]), bench_compare_u64);
+
+	double mean = 0;
+	for (int i = 0; i < runs; i += 1) mean += (double) samples[i];
+	mean /= runs;
+
+	printf("%-24s -c %-8s  mean %7.1f us  p50 %7.1f us  p90 %7.1f us  %5.1f page faults/run\n",
+		   shell, command[0] ? command : "''", mean / 1e3, (double) samples[runs / 2] / 1e3,
+		   (double) samples[runs * 9 / 10] / 1e3, (double) minor_faults / runs);
+}
+
+int
+main(int argc, char **argv) {
+	char *dush = argc > 1 ? argv[1] : "./dush";
+	int   runs = argc > 2 ? atoi(argv[2]) : 5000;
+
+	u64 *samples = malloc(runs * sizeof(u64));
+
+	bench_shell(dush, "", runs, samples);
+	bench_shell(dush, "exit", runs, samples);
+
+	if (argc > 3) {
+		for (int i = 3; i < argc; i += 1) {
+			bench_shell(argv[i], "", runs, samples);
+		}
+	} else if (access("/bin/dash", X_OK) == 0) {
+		bench_shell("/bin/dash", "", runs, samples);
+	}
+
+	free(samples);
+	return 0;
+}
@@ -0,0 +1,18 @@
+#!/usr/bin/bash
+clang bench/bench_expand.c -o bench_expand -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_history.c -o bench_history -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_complete.c -o bench_complete -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_prompt.c -o bench_prompt -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_startup.c -o bench_startup -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_hot_paths.c -o bench_hot_paths -Wall -Wextra -pedantic -Wno-unused-function -Wno-unused-variable -Wno-initializer-overrides -g -O3 -lm
+clang bench/bench_scratch.c -o bench_scratch -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
+clang bench/bench_pool.c -o bench_pool -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
+clang bench/bench_grep.c -o bench_grep -Wall -Wextra -pedantic -Wno-unused-function -Wno-unused-variable -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
+clang bench/bench_hash_files.c -o bench_hash_files -Wall -Wextra -pedantic -Wno-unused-function -Wno-unused-variable -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
+clang bench/bench_cp.c -o bench_cp -Wall -Wextra -pedantic -Wno-unused-function -Wno-unused-variable -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
+clang bench/bench_script.c -o bench_script -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_builtin_ops.c -o bench_builtin_ops -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang bench/bench_jobs.c -o bench_jobs -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -lpthread
+clang bench/bench_read_files.c -o bench_read_files -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -lpthread
+clang bench/bench_resolve.c -o bench_resolve -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -lm
+clang bench/bench_arena_churn.c -o bench_arena_churn -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3 -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0
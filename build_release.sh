@@ -1,2 +1,2 @@
 #!/usr/bin/bash
-clang src/dush.c -o dush -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -g -O3
+clang src/dush.c -o dush -Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -g -O3
@@ -0,0 +1,165 @@
+#!/usr/bin/bash
+# Profile-guided release build.
+#
+# 1. Builds an instrumented dush and runs it over a training workload: running scripts, looking
+#    up commands in the PATH, listing directories through wildcards and spawning tests/hello.c.
+# 2. Merges the profile and builds the release binaries with it, one per -march variant.
+# 3. Times every workload with the plain -O3 build (like build_release.sh) and with each variant,
+#    and prints the speedups.
+#
+# The result is "dush" for the first variant (the most portable one) and "dush-<variant>" for the
+# others. Everything else is left in pgo/.
+#
+# Usage: build_release_pgo.sh [march variants...]
+# Environment: RUNS is how many times every workload is timed (default 20), and LLVM_PROFDATA is
+# the llvm-profdata to merge the profile with (default llvm-profdata, for clang's own version).
+set -e
+
+profdata=${LLVM_PROFDATA:-llvm-profdata}
+if ! command -v clang > /dev/null; then
+	echo "clang is needed for the profile-guided build." >&2
+	exit 1
+fi
+if ! command -v "$profdata" > /dev/null; then
+	echo "$profdata is needed to merge the profile. Set LLVM_PROFDATA to the one that comes with clang, like llvm-profdata-18." >&2
+	exit 1
+fi
+
+if [ $# -gt 0 ]; then
+	variants=("$@")
+elif [ "$(uname -m)" = "x86_64" ]; then
+	variants=(x86-64 x86-64-v2 x86-64-v3 native)
+else
+	variants=(native)
+fi
+runs=${RUNS:-20}
+
+# The flags of build_release.sh, which the -O3 baseline is built with too.
+flags="-Wall -Wextra -pedantic -Wno-unused-function -Wno-initializer-overrides -DAGGRESSIVE_ASSERTS=0 -DAGGRESSIVE_MEM_ZERO=0 -g -O3"
+
+root=$(pwd)
+work=$root/pgo
+rm -rf "$work"
+mkdir -p "$work/profile" "$work/tree" "$work/bin"
+
+# Training data
+
+clang tests/hello.c -o "$work/bin/hello"
+
+# A directory tree for the wildcards, which dush only expands in the last component of a path.
+for d in $(seq 0 19); do
+	mkdir -p "$work/tree/dir$d"
+	for f in $(seq 0 99); do
+		: > "$work/tree/dir$d/file$f.c"
+		: > "$work/tree/dir$d/file$f.h"
+	done
+done
+
+printf 'echo script\n' > "$work/train.dush"
+printf 'echo script in the path\n' > "$work/bin/in-path.dush"
+
+# One file per workload, each fed to dush as its input.
+for i in $(seq 200); do
+	echo "train"
+	echo "in-path"
+	echo "echo \$HOME \$PATH"
+done > "$work/workload_script.txt"
+
+for i in $(seq 200); do
+	echo "no-such-command"
+	echo "hello"
+done > "$work/workload_path.txt"
+
+for i in $(seq 50); do
+	echo "echo tree/*"
+	echo "echo tree/dir1*"
+	echo "echo tree/dir2/*.c"
+	echo "echo tree/dir3/file9?.h"
+done > "$work/workload_listing.txt"
+
+for i in $(seq 200); do
+	echo "./bin/hello"
+done > "$work/workload_spawn.txt"
+
+workloads=(script path listing spawn)
+
+# Runs dush over a workload from the pgo directory, with its own history and the test
+# executables in the PATH.
+run_workload() {
+	(cd "$work" && PATH="$work/bin:$PATH" DUSH_HISTORY="$work/history" "$1" < "$work/workload_$2.txt" > /dev/null 2>&1) || true
+}
+
+# Instrumented build and training run
+
+echo "Building the instrumented binary..."
+clang src/dush.c -o "$work/dush_instrumented" $flags -fprofile-generate="$work/profile"
+
+echo "Running the training workload..."
+for w in "${workloads[@]}"; do
+	run_workload "$work/dush_instrumented" "$w"
+done
+for i in $(seq 100); do
+	"$work/dush_instrumented" -c '' > /dev/null
+done
+
+"$profdata" merge -output="$work/dush.profdata" "$work"/profile/*.profraw
+
+# Release builds
+
+echo "Building the release binaries..."
+clang src/dush.c -o "$work/dush_o3" $flags
+for v in "${variants[@]}"; do
+	clang src/dush.c -o "$work/dush_$v" $flags -march="$v" -fprofile-use="$work/dush.profdata" -Wno-profile-instr-unprofiled
+done
+
+# Report
+
+# Mean time of a workload in microseconds.
+time_workload() {
+	local start end
+	start=$(date +%s%N)
+	for i in $(seq "$runs"); do
+		run_workload "$1" "$2"
+	done
+	end=$(date +%s%N)
+	echo $(( (end - start) / runs / 1000 ))
+}
+
+time_startup() {
+	local start end
+	start=$(date +%s%N)
+	for i in $(seq $(( runs * 50 ))); do
+		"$1" -c '' > /dev/null
+	done
+	end=$(date +%s%N)
+	echo $(( (end - start) / (runs * 50) / 1000 ))
+}
+
+echo
+printf '%-10s %12s' "workload" "-O3"
+for v in "${variants[@]}"; do printf ' %20s' "pgo $v"; done
+printf '\n'
+
+for w in startup "${workloads[@]}"; do
+	if [ "$w" = "startup" ]; then
+		base=$(time_startup "$work/dush_o3")
+	else
+		base=$(time_workload "$work/dush_o3" "$w")
+	fi
+	printf '%-10s %9d us' "$w" "$base"
+
+	for v in "${variants[@]}"; do
+		if [ "$w" = "startup" ]; then
+			t=$(time_startup "$work/dush_$v")
+		else
+			t=$(time_workload "$work/dush_$v" "$w")
+		fi
+		printf ' %9d us (%5sx)' "$t" "$(awk "BEGIN { printf \"%.2f\", $base / ($t > 0 ? $t : 1) }")"
+	done
+	printf '\n'
+done
+
+cp "$work/dush_${variants[0]}" dush
+for v in "${variants[@]:1}"; do
+	cp "$work/dush_$v" "dush-$v"
+done
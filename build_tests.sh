@@ -0,0 +1,6 @@
+#!/usr/bin/bash
+clang tests/hello.c -o hello
+clang tests/greet.c -o greet
+clang tests/line_editor_bytes.c -o line_editor_bytes -Wall -Wextra
+clang tests/pty_end_to_end.c -o pty_end_to_end -Wall -Wextra -O2
+clang tests/script_behavior.c -o script_behavior -Wall -Wextra
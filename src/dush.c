@@ -1,11 +1,29 @@
 #include "dush_ctx_crack.h"
 #include "dush_base.h"
 #include "dush_os.h"
+#include "dush_trace.h"
+#include "dush_pool.h"
+#include "dush_expand.h"
+#include "dush_history.h"
+#include "dush_complete.h"
+#include "dush_prompt.h"
+#include "dush_line_editor.h"
+#include "dush_builtins.h"
+#include "dush_script.h"
+#include "dush.h"
 
 #include "dush_base.c"
 #include "dush_os.c"
+#include "dush_trace.c"
+#include "dush_pool.c"
+#include "dush_expand.c"
+#include "dush_history.c"
+#include "dush_complete.c"
+#include "dush_prompt.c"
+#include "dush_line_editor.c"
+#include "dush_builtins.c"
+#include "dush_script.c"
 
-#include "dush.h"
 #if OS_WINDOWS
 # include "dush_windows.c"
 #elif OS_LINUX
@@ -66,148 +84,794 @@ get_line(Arena *arena) {
 	return result;
 }
 
-int
-main(void) {
+static String
+find_in_path(Arena *arena, Path_Cache *cache, String file_name) {
+	String result = {0};
+	
+	Trace_Span span = trace_begin("find in path", file_name);
+	
+	for (i64 i = 0; i < cache->count; i += 1) {
+		if (cache->entries[i].dir.path.len == 0) continue;
+		
+		// Only the file that's found gets a full path.
+		Directory_Handle dir   = path_cache_directory(cache, i);
+		File_Flags       flags = 0;
+		if (file_exists_in(dir, file_name, &flags) && !(flags & File_Flag_IS_DIRECTORY)) {
+			String temp[] = {dir.path, get_separator(), file_name};
+			result = strings_concat(arena, temp, array_count(temp));
+			break;
+		}
+	}
+	
+	trace_end(span);
+	
+	return result;
+}
+
+// Joins arguments back together with a single space between them.
+static String
+string_join_args(Arena *arena, String *argv, i64 argc) {
+	i64 total_len = 0;
+	for (i64 i = 0; i < argc; i += 1) {
+		total_len += argv[i].len + 1;
+	}
+	
+	String result = {0};
+	if (total_len > 0) {
+		String_Builder builder = {0};
+		string_builder_init(&builder, push_sliceu8(arena, total_len));
+		if (builder.data != NULL) {
+			for (i64 i = 0; i < argc; i += 1) {
+				if (i > 0) string_builder_append(&builder, string_from_lit(" "));
+				string_builder_append(&builder, argv[i]);
+			}
+			
+			result = string_from_builder(builder);
+		}
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ Shell
+
+// Where the command was found in that PATH, the last time it ran or now. Sets `missing` like
+// find_executable(); a command that's missing is looked for again every time, since it might
+// have been installed in the meantime.
+static String
+_shell_find_executable(Shell *shell, String system_path, String command, bool *missing) {
+	Scratch scratch = scratch_begin(0, 0);
+	
+	path_cache_update(&shell->path_cache, system_path);
+	if (shell->command_paths_generation != shell->path_cache.generation) {
+		variables_fini(&shell->command_paths);
+		shell->command_paths_generation = shell->path_cache.generation;
+	}
+	
+	String result = {0};
+	*missing = false;
+	if (!variables_get(&shell->command_paths, command, &result)) {
+		String found = find_executable(scratch.arena, &shell->path_cache, command, missing);
+		if (!*missing) {
+			variables_set(&shell->command_paths, command, found);
+			variables_get(&shell->command_paths, command, &result);
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+// Waits for a job to end, or without `block` only takes one that already did, and records its
+// status. NULL if there was none, or if Ctrl+C interrupted the wait.
+static Job *
+_shell_reap_job(Shell *shell, bool block) {
+	Job *result = NULL;
+	
+	u64 tag = 0;
+	if (process_group_wait(&shell->jobs, block, &tag)) {
+		result = cast(Job *) tag;
+		result->done   = true;
+		result->status = last_process_exit_code;
+		builtins_account(&shell->builtins, string_from_cstring(result->name), last_process_usage);
+	}
+	
+	return result;
+}
+
+// Puts a new job in front of the list. NULL without the memory for it.
+static Job *
+_shell_add_job(Shell *shell, i64 pid, String name) {
+	Job *job = shell->free_jobs;
+	if (job != NULL) {
+		shell->free_jobs = job->next;
+	} else if (shell->job_arena.ptr != NULL || arena_init(&shell->job_arena)) {
+		job = push_array(&shell->job_arena, Job, 1);
+	}
+	
+	if (job != NULL) {
+		memset(job, 0, sizeof(Job));
+		job->pid = pid;
+		if (name.len > 0) memcpy(job->name, name.data, min(name.len, cast(i64) sizeof(job->name) - 1));
+		job->next = shell->first_job;
+		shell->first_job = job;
+	}
+	
+	return job;
+}
+
+static void
+_shell_forget_job(Shell *shell, Job **link) {
+	Job *job = *link;
+	*link = job->next;
+	job->next = shell->free_jobs;
+	shell->free_jobs = job;
+}
+
+// Starts the process with the NAME=value strings of `env` in its environment, and waits for it
+// unless it goes in the background.
+static bool
+_shell_start_process(Shell *shell, String *argv, i64 argc, String working_dir, String executable, String *env, i64 env_count, bool background) {
+	bool result = false;
+	
+	if (background) {
+		// Scripts that never wait would otherwise pile up the jobs that ended.
+		while (_shell_reap_job(shell, false) != NULL) {}
+		
+		Process process = {0};
+		result = start_process_async(argv, argc, working_dir, executable, &process, .env = env, .env_count = env_count);
+		if (result) {
+			shell->last_job_pid = process.pid;
+			
+			Job *job = _shell_add_job(shell, process.pid, argv[0]);
+			if (job == NULL || !process_group_add(&shell->jobs, process, cast(u64) job)) {
+				// A process that can't be waited for with the others is waited for now, so that
+				// it doesn't stay a zombie and its handle isn't kept open.
+				fprintf(stderr, "Could not keep track of '%.*s' in the background: out of memory; waiting for it\n", string_expand(argv[0]));
+				process_wait(process);
+				if (job != NULL) {
+					job->done   = true;
+					job->status = last_process_exit_code;
+				}
+			}
+		}
+	} else {
+		result = start_process_sync(argv, argc, working_dir, executable, .env = env, .env_count = env_count);
+		shell->ran_process = result;
+	}
+	
+	return result;
+}
+
+// wait [pid...]
+// Without pids, waits for every job and returns 0, like POSIX shells; otherwise returns the
+// status of the last one. 127 if a pid isn't one of a job, 130 if Ctrl+C stops the wait.
+static i32
+_shell_wait(Shell *shell, String *argv, i64 argc) {
+	i32 result = 0;
 	
 	init_ctrl_c_handler();
 	
-	bool should_exit = false;
-	while (!should_exit) {
-		Scratch scratch = scratch_begin(0, 0);
+	bool interrupted = false;
+	if (argc == 0) {
+		while (shell->jobs.count > 0 && _shell_reap_job(shell, true) != NULL) {}
+		interrupted = shell->jobs.count > 0;
 		
-		// Print prompt
-		String current_dir = get_current_directory(scratch.arena);
-		printf("%.*s>", string_expand(current_dir));
-		
-		// Process command
-		// TODO: Evaluate variables, e.g. %PATH%
-		String line = get_line(scratch.arena);
-		line = string_skip_chop_whitespace(line);
-		
-		i64 space_index = string_find_first(line, ' ');
-		if (space_index < 0) space_index = line.len;
-		
-		String command = string_stop(line, space_index);
-		String args    = string_skip(line, space_index+1);
-		
-		if (command.len > 0) {
-			if (string_equals(command, string_from_lit("exit"))) {
-				should_exit = true;
-			} else if (string_equals(command, string_from_lit("help"))) {
-				printf(HELP_TEXT);
-			} else if (string_equals(command, string_from_lit("pwd"))) {
-				printf("%.*s\n", string_expand(current_dir));
-			} else if (string_equals(command, string_from_lit("cd"))) {
-				if (args.len == 0) {
-					printf("%.*s\n", string_expand(current_dir));
-				} else {
-					set_current_directory(args);
+		for (Job **link = &shell->first_job; *link != NULL;) {
+			if ((*link)->done) {
+				_shell_forget_job(shell, link);
+			} else {
+				link = &(*link)->next;
+			}
+		}
+	}
+	
+	for (i64 i = 0; i < argc && !interrupted; i += 1) {
+		i64   pid  = 0;
+		Job **link = &shell->first_job;
+		if (string_to_i64(argv[i], 10, &pid)) {
+			while (*link != NULL && (*link)->pid != pid) link = &(*link)->next;
+		}
+		
+		if (*link == NULL) {
+			fprintf(stderr, "wait: '%.*s' is not the pid of a job\n", string_expand(argv[i]));
+			result = 127;
+		} else {
+			// The other jobs that end first keep their status for later.
+			Job *job = *link;
+			while (!job->done && _shell_reap_job(shell, true) != NULL) {}
+			interrupted = !job->done;
+			
+			if (!interrupted) {
+				result = job->status;
+				
+				// Jobs are added in front, so the link may have moved.
+				link = &shell->first_job;
+				while (*link != job) link = &(*link)->next;
+				_shell_forget_job(shell, link);
+			}
+		}
+	}
+	
+	if (interrupted) result = 130;
+	return result;
+}
+
+static i32
+shell_run_command(Shell *shell, Builtin_Id builtin, String *argv, i64 argc, Command_Env env, bool background) {
+	// Builtins succeed unless they return a status of their own.
+	i32 result = 0;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	Builtins *builtins = &shell->builtins;
+	
+	String command = argv[0];
+	shell->ran_process = false;
+	bool started_job = false;
+	
+	// Renamed below if the command isn't a builtin.
+	Trace_Span command_span = trace_begin("builtin", command);
+	
+	switch (builtin) {
+		case Builtin_HELP: {
+			printf(HELP_TEXT);
+		} break;
+		
+		case Builtin_PWD: {
+			printf("%.*s\n", string_expand(get_current_directory(scratch.arena)));
+		} break;
+		
+		case Builtin_ECHO: {
+			printf("%.*s\n", string_expand(string_join_args(scratch.arena, argv + 1, argc - 1)));
+		} break;
+		
+		case Builtin_TEST:
+		case Builtin_BRACKET: {
+			result = builtin_test(argv + 1, argc - 1, builtin == Builtin_BRACKET);
+		} break;
+		
+		case Builtin_TRUE:
+		case Builtin_COLON: {
+			result = 0;
+		} break;
+		
+		case Builtin_FALSE: {
+			result = 1;
+		} break;
+		
+		case Builtin_BASENAME: {
+			result = builtin_basename(argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_DIRNAME: {
+			result = builtin_dirname(argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_EXPR: {
+			result = builtin_expr(argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_WC: {
+			result = builtin_wc(argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_TR: {
+			result = builtin_tr(argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_GREP: {
+			// It writes to the standard output directly.
+			fflush(stdout);
+			result = builtin_grep(builtins, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_CP: {
+			result = builtin_cp(builtins, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_MV: {
+			result = builtin_mv(builtins, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_HASH_FILES: {
+			fflush(stdout);
+			result = builtin_hash_files(builtins, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_ACCOUNTING: {
+			result = builtin_accounting(builtins, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_HISTORY: {
+			// Without arguments, list everything; otherwise list the entries that contain the
+			// arguments as typed.
+			String args = string_join_args(scratch.arena, argv + 1, argc - 1);
+			history_refresh(shell->history);
+			for (i64 index = history_search(shell->history, args, 0); index >= 0; index = history_search(shell->history, args, index + 1)) {
+				String entry = history_get(shell->history, index);
+				printf("%6lld  %.*s\n", cast(long long) index + 1, string_expand(entry));
+			}
+		} break;
+		
+		case Builtin_WAIT: {
+			result = _shell_wait(shell, argv + 1, argc - 1);
+		} break;
+		
+		case Builtin_CD: {
+			String args = string_join_args(scratch.arena, argv + 1, argc - 1);
+			if (args.len == 0) {
+				printf("%.*s\n", string_expand(get_current_directory(scratch.arena)));
+			} else if (!set_current_directory(args)) {
+				result = 1;
+			}
+		} break;
+		
+		default: {
+			// Try to start a process or run a script
+			command_span.name = "command";
+			
+			String current_dir = get_current_directory(scratch.arena);
+			
+			// Whatever was printed so far has to come before the output of the process, and
+			// Ctrl+C must only stop the process, not the shell.
+			fflush(stdout);
+			init_ctrl_c_handler();
+			
+			// The assignments come last, so that they win over the variables.
+			String *env_strings = NULL;
+			i64     env_count   = variables_environment(scratch.arena, env.variables, &env_strings);
+			String *process_env = push_array(scratch.arena, String, env_count + env.assignment_count);
+			if (process_env != NULL) {
+				if (env_count > 0) memcpy(process_env, env_strings, sizeof(String) * env_count);
+				if (env.assignment_count > 0) memcpy(process_env + env_count, env.assignments, sizeof(String) * env.assignment_count);
+				env_count += env.assignment_count;
+			} else {
+				env_count = 0;
+			}
+			
+			String system_path = variables_lookup(env.variables, string_from_lit("PATH"));
+			for (i64 i = 0; i < env.assignment_count; i += 1) {
+				if (string_starts_with(env.assignments[i], string_from_lit("PATH="))) {
+					system_path = string_skip(env.assignments[i], 5);
 				}
+			}
+			
+			// Once it was found in the PATH, it's run from there; if it's gone, it's looked for again.
+			// When it's nowhere, there is no process to start only to have exec fail in it.
+			bool   missing    = false;
+			String executable = _shell_find_executable(shell, system_path, command, &missing);
+			bool   started    = false;
+			if (missing) {
+				last_process_error = Process_Error_FILE_NOT_FOUND;
 			} else {
-				// Try to start a process or run a script
+				started = _shell_start_process(shell, argv, argc, current_dir, executable, process_env, env_count, background);
+				if (!started && executable.len > 0 && last_process_error == Process_Error_FILE_NOT_FOUND) {
+					variables_unset(&shell->command_paths, command);
+					started = _shell_start_process(shell, argv, argc, current_dir, string_from_lit(""), process_env, env_count, background);
+				}
+			}
+			
+			if (started && background) {
+				// Only wait gets its status, and the accounting its usage.
+				started_job = true;
+				result = 0;
+			} else if (started) {
+				result = last_process_exit_code;
+				builtins_account(builtins, command, last_process_usage);
+			} else {
+				// Like other shells: 126 if the command can't be run, 127 if it wasn't found.
+				result = last_process_error == Process_Error_FILE_NOT_FOUND ? 127 : 126;
 				
-				if (!start_process_sync(line, current_dir)) {
+				// Don't treat FILE_NOT_FOUND and BAD_EXE_FORMAT as errors.
+				// If the file wasn't found, print the specialized error message later;
+				// If the file is not a valid executable, it probabily is some other kind of
+				// file which will be interpreted according to its extension.
+				//
+				// TODO: Is this the expected behaviour on Linux?
+				if (last_process_error != Process_Error_FILE_NOT_FOUND &&
+					last_process_error != Process_Error_BAD_EXE_FORMAT) {
 					
-					// Don't treat FILE_NOT_FOUND and BAD_EXE_FORMAT as errors.
-					// If the file wasn't found, print the specialized error message later;
-					// If the file is not a valid executable, it probabily is some other kind of
-					// file which will be interpreted according to its extension.
+					// Note: On Windows, 'command' might not match the exact executable that CreateProcessA
+					// tried to spawn (for example, the command might be 'dush' but the chosen executable
+					// is 'dush.exe').
 					//
-					// TODO: Is this the expected behaviour on Linux?
-					if (last_process_error != Process_Error_FILE_NOT_FOUND &&
-						last_process_error != Process_Error_BAD_EXE_FORMAT) {
-						
-						// Note: On Windows, 'command' might not match the exact executable that CreateProcessA
-						// tried to spawn (for example, the command might be 'dush' but the chosen executable
-						// is 'dush.exe').
-						//
-						// There is not an easy way to know which file was chosen as the executable; the only way
-						// is to simply replicate all the steps the OS did, as written in the documentation
-						// for CreateProcessA.
-						//
-						// It's not super important, so we just use 'command'.
-						fprintf(stderr, "Could not run '%.*s': %.*s\n", string_expand(command), string_expand(last_process_error_string()));
-					} else {
-						// Find a file in this folder with the .dush extension
-						// If nothing is found, search in the path
-						
-						// If the command has no extension, add a '.dush' extension,
-						// otherwise leave it as it is.
-						String extension = string_from_lit(".dush");
-						String file_name = command;
-						{
-							String base = path_base(command);
-							if (!string_contains(base, '.')) {
-								String temp[] = {command, extension};
-								file_name = strings_concat(scratch.arena, temp, array_count(temp));
-							}
+					// There is not an easy way to know which file was chosen as the executable; the only way
+					// is to simply replicate all the steps the OS did, as written in the documentation
+					// for CreateProcessA.
+					//
+					// It's not super important, so we just use 'command'.
+					fprintf(stderr, "Could not run '%.*s': %.*s\n", string_expand(command), string_expand(last_process_error_string()));
+				} else {
+					// Find a file in this folder with the .dush extension
+					// If nothing is found, search in the path
+					
+					// If the command has no extension, add a '.dush' extension,
+					// otherwise leave it as it is.
+					String extension = string_from_lit(".dush");
+					String file_name = command;
+					{
+						String base = path_base(command);
+						if (!string_contains(base, '.')) {
+							String temp[] = {command, extension};
+							file_name = strings_concat(scratch.arena, temp, array_count(temp));
 						}
-						
-						if (string_ends_with(file_name, extension)) {
-							// Simply read the whole file. If it doesn't fit in memory, don't run it at all.
-							Read_File_Result script_read = read_file(scratch.arena, file_name);
-							if (!script_read.ok && last_file_error == File_Error_NOT_EXISTS) {
-								// Search in the PATH if the file name does not contain a path,
-								// e.g. "build.dush" (with nothing before).
-								
-								String base = path_base(file_name);
-								if (base.len == file_name.len) {
-									String system_path = get_system_path(scratch.arena);
-									
-									for (;;) {
-										i64 split_index = string_find_first(system_path, ';');
-										if (split_index < 0) break;
-										
-										String loc  = string_stop(system_path, split_index);
-										system_path = string_skip(system_path, split_index + 1);
-										
-										String full_path = {0};
-										{
-											String temp[] = {loc, get_separator(), file_name};
-											full_path = strings_concat(scratch.arena, temp, array_count(temp));
-										}
-										
-										script_read = read_file(scratch.arena, full_path);
-										if (script_read.ok || last_file_error != File_Error_NOT_EXISTS) {
-											// Either we loaded the file correctly, or we found it but couldn't
-											// read it for some other reason: stop searching.
-											break;
-										}
-									}
-									
-									allow_break();
-								}
-							}
+					}
+					
+					if (string_ends_with(file_name, extension)) {
+						// Only the file that's chosen is read, whole. If it doesn't fit in memory,
+						// don't run it at all.
+						Read_File_Result script_read = {0};
+						if (file_exists(file_name, NULL)) {
+							script_read = read_file(scratch.arena, file_name);
+						} else if (last_file_error == File_Error_NOT_EXISTS) {
+							// Search in the PATH if the file name does not contain a path,
+							// e.g. "build.dush" (with nothing before).
 							
-							if (script_read.ok) {
-								printf("Running script '%.*s'...\n", string_expand(file_name));
-							} else {
-								if (last_file_error != File_Error_NOT_EXISTS) {
-									fprintf(stderr, "Could not run script '%.*s': %.*s\n", string_expand(file_name), string_expand(last_file_error_string()));
+							String base = path_base(file_name);
+							if (base.len == file_name.len) {
+								String full_path = find_in_path(scratch.arena, &shell->path_cache, file_name);
+								if (full_path.len > 0) {
+									script_read = read_file(scratch.arena, full_path);
 								} else {
-									fprintf(stderr, "'%.*s' is not a known command, executable file or dush script in the current directory or in the path.\n", string_expand(command));
+									last_file_error = File_Error_NOT_EXISTS;
 								}
+								
+								allow_break();
+							}
+						}
+						
+						if (script_read.ok) {
+							result = shell_run_script(shell, file_name, string_from_sliceu8(script_read.contents), argv + 1, argc - 1, process_env, env_count);
+						} else {
+							if (last_file_error != File_Error_NOT_EXISTS) {
+								fprintf(stderr, "Could not run script '%.*s': %.*s\n", string_expand(file_name), string_expand(last_file_error_string()));
+							} else {
+								fprintf(stderr, "'%.*s' is not a known command, executable file or dush script in the current directory or in the path.\n", string_expand(command));
 							}
-						} else if (string_ends_with(file_name, string_from_lit(".txt"))) {
-							// This is an example of how the if-else chain can be continued.
-							// Associate each extension with the selected program that opens it.
-							//
-							// For now, do nothing.
-							
-							allow_break();
 						}
+					} else if (string_ends_with(file_name, string_from_lit(".txt"))) {
+						// This is an example of how the if-else chain can be continued.
+						// Associate each extension with the selected program that opens it.
+						//
+						// For now, do nothing.
+						
+						allow_break();
 					}
 				}
-				
-				allow_break();
 			}
 			
-			if (!should_exit) printf("\n");
+			allow_break();
+		} break;
+	}
+	
+	// What ran in the shell itself, or failed to start, has ended by now.
+	if (background && !started_job) {
+		shell_add_done_job(shell, command, result);
+		result = 0;
+	}
+	
+	trace_end(command_span);
+	scratch_end(scratch);
+	
+	return result;
+}
+
+static void
+shell_add_done_job(Shell *shell, String name, i32 status) {
+	shell->shell_job_count += 1;
+	shell->last_job_pid = SHELL_JOB_FIRST_PID + shell->shell_job_count - 1;
+	
+	Job *job = _shell_add_job(shell, shell->last_job_pid, name);
+	if (job != NULL) {
+		job->done   = true;
+		job->status = status;
+	}
+}
+
+static void
+shell_report_jobs(Shell *shell) {
+	while (_shell_reap_job(shell, false) != NULL) {}
+	
+	for (Job **link = &shell->first_job; *link != NULL;) {
+		Job *job = *link;
+		if (job->done) {
+			if (job->status == 0) {
+				printf("[%lld] Done  %s\n", cast(long long) job->pid, job->name);
+			} else {
+				printf("[%lld] Exit %d  %s\n", cast(long long) job->pid, job->status, job->name);
+			}
+			_shell_forget_job(shell, link);
+		} else {
+			link = &job->next;
+		}
+	}
+}
+
+static i32
+shell_run_script(Shell *shell, String file_name, String source, String *argv, i64 argc, String *env, i64 env_count) {
+	i32 result = 2;
+	
+	if (shell->call_depth >= SCRIPT_MAX_CALL_DEPTH) {
+		fprintf(stderr, "Could not run script '%.*s': too many nested calls\n", string_expand(file_name));
+	} else {
+		Scratch scratch = scratch_begin(0, 0);
+		Trace_Span span = trace_begin("script", file_name);
+		
+		String  current_dir = get_current_directory(scratch.arena);
+		Script *script      = script_parse(scratch.arena, source, file_name);
+		
+		Script_Scope scope = {0};
+		scope.name      = file_name;
+		scope.args      = argv;
+		scope.arg_count = argc;
+		for (i64 i = 0; i < env_count; i += 1) {
+			i64 equals = string_find_first(env[i], '=');
+			if (equals > 0) {
+				String name = string_stop(env[i], equals);
+				variables_set(&scope.variables, name, string_skip(env[i], equals + 1));
+				variables_export(&scope.variables, name, true);
+			}
 		}
 		
+		shell->call_depth += 1;
+		result = script_run(shell, &scope, script);
+		shell->call_depth -= 1;
+		
+		script_scope_fini(&scope);
+		
+		if (!string_equals(get_current_directory(scratch.arena), current_dir)) {
+			set_current_directory(current_dir);
+		}
+		
+		trace_end(span);
+		scratch_end(scratch);
+	}
+	
+	return result;
+}
+
+#if !defined(DUSH_NO_MAIN)
+
+int
+main(int argc, char **argv) {
+	
+	// "dush -c <command line>" runs a single command line and exits with its status, and
+	// "dush <script> [arguments...]" runs a script. Nothing that only matters to a session that
+	// reads commands (history, prompt, completion) is set up, so that startup stays cheap for
+	// scripts that run dush in a loop.
+	char *command_string = NULL;
+	char *script_file    = NULL;
+	if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+		command_string = argv[2];
+	} else if (argc >= 2) {
+		script_file = argv[1];
+	}
+	bool reads_commands = command_string == NULL && script_file == NULL;
+	
+	// Only a terminal gets the line editor and the history. Pipes and files are read as they are.
+	bool interactive = reads_commands && console_is_interactive();
+	
+	trace_init();
+	
+	History history = {0};
+	if (interactive) {
+		Scratch scratch = scratch_begin(0, 0);
+		
+		String history_file_name = {0};
+		char  *history_file_env  = getenv("DUSH_HISTORY");
+		if (history_file_env != NULL) {
+			history_file_name = string_from_cstring(history_file_env);
+		} else {
+			String home = get_home_directory(scratch.arena);
+			if (home.len > 0) {
+				String temp[] = {home, get_separator(), string_from_lit(HISTORY_FILE_NAME)};
+				history_file_name = strings_concat(scratch.arena, temp, array_count(temp));
+			}
+		}
+		
+		if (history_file_name.len > 0) {
+			history_init(&history, history_file_name);
+		}
+		
+		scratch_end(scratch);
+	}
+	
+	bool use_line_editor = interactive;
+	
+	Shell shell = {0};
+	shell.history = &history;
+	{
+		char *accounting_env = getenv("DUSH_ACCOUNTING");
+		shell.builtins.accounting = accounting_env != NULL && accounting_env[0] != 0 && strcmp(accounting_env, "0") != 0;
+	}
+	
+	// Offered by the completion along with the executables in the PATH.
+	read_only static String builtin_names[] = {
+		string_from_lit_const("["),
+		string_from_lit_const("accounting"),
+		string_from_lit_const("basename"),
+		string_from_lit_const("cd"),
+		string_from_lit_const("cp"),
+		string_from_lit_const("dirname"),
+		string_from_lit_const("echo"),
+		string_from_lit_const("exit"),
+		string_from_lit_const("export"),
+		string_from_lit_const("expr"),
+		string_from_lit_const("false"),
+		string_from_lit_const("grep"),
+		string_from_lit_const("hash-files"),
+		string_from_lit_const("help"),
+		string_from_lit_const("history"),
+		string_from_lit_const("mv"),
+		string_from_lit_const("pwd"),
+		string_from_lit_const("set"),
+		string_from_lit_const("test"),
+		string_from_lit_const("time"),
+		string_from_lit_const("tr"),
+		string_from_lit_const("true"),
+		string_from_lit_const("unset"),
+		string_from_lit_const("wait"),
+		string_from_lit_const("wc"),
+	};
+	
+	// The index is only built on the first Tab, so it costs nothing to shells that never complete.
+	Completion_Index completion = {0};
+	completion_index_init(&completion, &shell.path_cache, cast(String *) builtin_names, array_count(builtin_names));
+	
+	Prompt prompt = {0};
+	if (reads_commands) {
+		char *format_env = getenv("DUSH_PROMPT");
+		char *budget_env = getenv("DUSH_PROMPT_BUDGET_MS");
+		String format    = format_env != NULL ? string_from_cstring(format_env) : string_from_lit("");
+		u64    budget_us = budget_env != NULL ? cast(u64) (atof(budget_env) * 1000) : PROMPT_DEFAULT_BUDGET_US;
+		prompt_init(&prompt, format, budget_us);
+	}
+	
+	Line_Editor line_editor = {0};
+	line_editor_init(&line_editor, &history, &completion, &prompt);
+	
+	i32  last_exit_code = 0;
+	bool should_exit = false;
+	if (script_file != NULL) {
+		Scratch scratch = scratch_begin(0, 0);
+		
+		String file_name = string_from_cstring(script_file);
+		Read_File_Result script_read = read_file(scratch.arena, file_name);
+		if (script_read.ok) {
+			i64     arg_count = argc - 2;
+			String *args      = push_array(scratch.arena, String, arg_count);
+			for (i64 i = 0; args != NULL && i < arg_count; i += 1) {
+				args[i] = string_from_cstring(argv[i + 2]);
+			}
+			last_exit_code = shell_run_script(&shell, file_name, string_from_sliceu8(script_read.contents), args, arg_count, NULL, 0);
+		} else {
+			fprintf(stderr, "Could not run script '%.*s': %.*s\n", string_expand(file_name), string_expand(last_file_error_string()));
+			last_exit_code = 127;
+		}
+		
+		scratch_end(scratch);
+		should_exit = true;
+	}
+	
+	while (!should_exit) {
+		Scratch scratch = scratch_begin(0, 0);
+		
+		String current_dir = get_current_directory(scratch.arena);
+		
+		// Read command
+		String  source = {0};
+		Script *script = NULL;
+		if (command_string != NULL) {
+			source = string_from_cstring(command_string);
+			should_exit = true;
+			
+			Trace_Span parse_span = trace_begin("parse", source);
+			script = script_parse(scratch.arena, source, string_from_lit(""));
+			trace_end(parse_span);
+		} else {
+			// Ctrl+C must not kill the shell while it waits for input.
+			init_ctrl_c_handler();
+			shell_report_jobs(&shell);
+			
+			Prompt_State prompt_state = {0};
+			prompt_state.current_dir    = current_dir;
+			prompt_state.last_exit_code = last_exit_code;
+			Trace_Span prompt_span = trace_begin("prompt", current_dir);
+			String prompt_text = prompt_render(&prompt, scratch.arena, prompt_state);
+			trace_end(prompt_span);
+			
+			// The memory a big command needed isn't kept while the shell waits.
+			scratch_arenas_decommit_idle();
+			
+			// The completion offers what's in the PATH of the shell.
+			path_cache_update(&shell.path_cache, variables_lookup(&shell.scope.variables, string_from_lit("PATH")));
+			
+			// Lines are read until they make up whole statements: while they leave a quote, an if
+			// or a $(...) open, or end with a backslash, the next one goes on with them. Each one
+			// gets back its newline, which joins it to the next.
+			for (bool more = true; more;) {
+				String line = {0};
+				
+				// Mostly the time the user takes to type, but also what the line editor does.
+				Trace_Span line_span = trace_begin("read line", string_from_lit(""));
+				if (use_line_editor) {
+					fflush(stdout);
+					line = line_editor_read(&line_editor, scratch.arena, prompt_text);
+					if (line_editor.unavailable) {
+						use_line_editor = false;
+					} else if (line_editor.eof) {
+						should_exit = true;
+					} else if (line_editor.interrupted) {
+						// Ctrl+C abandons the lines before too.
+						source = string_from_lit("");
+						line   = string_from_lit("");
+					}
+				}
+				if (!use_line_editor) {
+					printf("%.*s", string_expand(prompt_text));
+					line = get_line(scratch.arena);
+					
+					// The last line might not end with a newline, so it still runs.
+					if (feof(stdin) || ferror(stdin)) {
+						should_exit = true;
+					}
+				}
+				trace_end(line_span);
+				
+				String temp[] = {source, line, string_from_lit("\n")};
+				source = strings_concat(scratch.arena, temp, array_count(temp));
+				
+				Trace_Span parse_span = trace_begin("parse", line);
+				script = script_parse(scratch.arena, source, string_from_lit(""));
+				trace_end(parse_span);
+				
+				more = !script->ok && script->incomplete && !should_exit;
+				prompt_text = string_from_lit(SHELL_CONTINUATION_PROMPT);
+			}
+		}
+		
+		String line = string_skip_chop_whitespace(source);
+		history_append(&history, line);
+		
+		if (script->ok && script->function_count > 0) {
+			// The lines that come after can call the functions it defines.
+			script = script_keep(&shell.scope, script);
+		}
+		
+		ctrl_c_pressed = 0;
+		last_exit_code = script_run(&shell, &shell.scope, script);
+		if (shell.scope.flow == Script_Flow_EXIT) {
+			should_exit = true;
+		}
+		
+		if (line.len > 0 && !should_exit) printf("\n");
+		
 		scratch_end(scratch);
 		allow_break();
 	}
 	
-	return 0;
+	if (reads_commands) {
+		prompt_fini(&prompt);
+	}
+	if (interactive) {
+		history_fini(&history);
+	}
+	completion_index_fini(&completion);
+	if (shell.builtins.first_usage != NULL) {
+		fflush(stdout);
+		builtins_print_accounting(&shell.builtins, stderr);
+	}
+	script_scope_fini(&shell.scope);
+	variables_fini(&shell.command_paths);
+	path_cache_fini(&shell.path_cache);
+	process_group_fini(&shell.jobs);
+	if (shell.job_arena.ptr != NULL) arena_fini(&shell.job_arena);
+	builtins_fini(&shell.builtins);
+	trace_fini();
+	
+	return last_exit_code;
 }
+
+#endif
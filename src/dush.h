@@ -3,17 +3,148 @@
 
 #define HELP_TEXT \
 "The dush shell has a minimal set of commands:\n" \
+"  accounting [on|off|reset]\n" \
+"      \tPrints what the processes of each command used, or turns accounting on or off\n" \
+"  basename path [suffix], dirname path...\n" \
+"      \tPrint the last component of a path, or everything before it\n" \
 "  cd  \tPrints or sets the current directory\n" \
-"  exit\tExits the shell\n" \
+"  cp [-r] source... destination\n" \
+"      \tCopies files, and directories with -r\n" \
+"  echo\tPrints its arguments after expanding variables and wildcards\n" \
+"  exit [status]\n" \
+"      \tExits the shell, or the script\n" \
+"  export name[=value]...\n" \
+"      \tPasses variables on to the processes the shell starts\n" \
+"  expr expression\n" \
+"      \tPrints the value of an integer, comparison, string or regular expression expression\n" \
+"  grep [-rnlc] text [path...]\n" \
+"      \tPrints the lines of the files that contain the text; -r searches directories\n" \
+"  hash-files [-r] [-c cache file] path...\n" \
+"      \tPrints a hash of the contents of each file; the cache skips unchanged files\n" \
 "  help\tPrints this text\n" \
-"  pwd \tPrints the current directory\n"
+"  history [text]\n" \
+"      \tPrints the command history, or only the commands that contain the text\n" \
+"  mv source... destination\n" \
+"      \tMoves or renames files and directories\n" \
+"  pwd \tPrints the current directory\n" \
+"  set -e, set +e\n" \
+"      \tTurns on or off exiting when a command fails\n" \
+"  test expression, [ expression ]\n" \
+"      \tChecks strings (-n -z = !=), numbers (-eq -ne -lt -le -gt -ge) or files (-e -f -d -s)\n" \
+"  time command...\n" \
+"      \tRuns the command and prints the time and memory it used\n" \
+"  tr [-ds] set1 [set2]\n" \
+"      \tReplaces, deletes or squeezes bytes of the standard input\n" \
+"  true, false\n" \
+"      \tSucceed or fail\n" \
+"  unset name...\n" \
+"      \tForgets variables\n" \
+"  wait [pid...]\n" \
+"      \tWaits for the commands started in the background, or for the ones with those pids\n" \
+"  wc [-lwc] [file...]\n" \
+"      \tCounts the lines, words and bytes of the files or the standard input\n" \
+"Commands can be combined with variables (name=value), if, while, for and functions, like\n" \
+"in other shells, and use $((arithmetic)), $(command output) and ${name#pattern}-style\n" \
+"operators; a command followed by '&' runs in the background, and $! is its pid. 'a && b' runs\n" \
+"b only if a succeeds, 'a || b' only if it fails, and $? is the status of the last command.\n" \
+".dush scripts are written the same way.\n"
 
+// A process started with '&', from when it starts until the prompt tells that it ended, or wait
+// returns its status. Builtins, functions and assignments followed by '&' run in the shell
+// before it goes on, so their jobs have no process and have already ended: they get pids from
+// SHELL_JOB_FIRST_PID up, past the largest one Linux gives out.
+#define SHELL_JOB_FIRST_PID (1 << 30)
+
+// Shown instead of the prompt while the lines read so far leave a quote, an if or a $(...) open,
+// or end with a backslash.
+#if !defined(SHELL_CONTINUATION_PROMPT)
+#define SHELL_CONTINUATION_PROMPT "> "
+#endif
+
+typedef struct Job Job;
+struct Job {
+	Job *next;
+	i64  pid;
+	bool done;
+	i32  status;
+	char name[64]; // Of the command, cut if it's longer.
+};
+
+// What the lines typed at the prompt, and the scripts they run, share.
+struct Shell {
+	Builtins     builtins;
+	History     *history;
+	Script_Scope scope;       // Of the lines typed at the prompt.
+	i32          call_depth;  // Of the functions and scripts that are running.
+	bool         ran_process; // Whether the last command started a process, for time.
+	
+	// Where the processes started so far were found in the PATH, so that starting them again
+	// doesn't search it again; an empty path if the OS has to search it. Forgotten when the PATH
+	// or a directory in it changes, which the generation of the cache tells.
+	Variables    command_paths;
+	u64          command_paths_generation;
+	Path_Cache   path_cache;
+	
+	// The jobs that are running are in the process group, tagged with their Job. The ones that
+	// ended stay in the list until they are told or waited for.
+	Process_Group jobs;
+	Arena         job_arena;
+	Job          *first_job;
+	Job          *free_jobs;
+	i64           last_job_pid;   // $!, 0 until a job starts.
+	i64           shell_job_count; // Of the jobs without a process so far.
+};
+
+// What the processes and scripts a command starts get in their environment: the exported
+// variables, then the NAME=value assignments written before the command, which only last for it.
+// The PATH among them is where the command is looked for.
+typedef struct Command_Env Command_Env;
+struct Command_Env {
+	Variables *variables;
+	String    *assignments;
+	i64        assignment_count;
+};
+
+// Runs a builtin, a process, or a .dush script found in the current directory or in the
+// PATH, and returns its exit status. argv[0] is the command, and builtin what builtin_find()
+// returns for it. With `background` a process is started as a job and 0 returned right away;
+// builtins and scripts still run before this returns, and leave a job that ended with their status.
+static i32 shell_run_command(Shell *shell, Builtin_Id builtin, String *argv, i64 argc, Command_Env env, bool background);
+
+// Adds a job without a process, which ended with that status, and makes it $!. For what runs in
+// the shell itself when it's put in the background.
+static void shell_add_done_job(Shell *shell, String name, i32 status);
+
+// Prints the jobs that ended since the last time, and forgets them.
+static void shell_report_jobs(Shell *shell);
+
+// Runs the script like a child shell would: with its own variables, which start with the
+// NAME=value strings of `env` exported, and in the current directory of the shell, which it gets
+// back when the script ends.
+static i32 shell_run_script(Shell *shell, String file_name, String source, String *argv, i64 argc, String *env, i64 env_count);
+
+// Set when Ctrl+C is pressed, once the handler is installed. Loops stop when they see it.
+static volatile int ctrl_c_pressed;
+
+// Only does something the first time, so it can be called right before it's needed.
 static void init_ctrl_c_handler(void);
 
 static String get_line(Arena *arena);
+static String string_join_args(Arena *arena, String *argv, i64 argc);
 static String get_current_directory(Arena *arena);
 static String get_system_path(Arena *arena);
+static String get_home_directory(Arena *arena);
+static bool   set_environment_variable(String name, String value);
+
+// The full path of the first file with that name in a directory of the PATH, or an empty string.
+// Like find_executable(), it looks in the PATH the cache was last updated with.
+static String find_in_path(Arena *arena, Path_Cache *cache, String file_name);
+
+// The file start_process_sync() would run for arguments that start with the command, or
+// an empty string if where it is has to be left to the OS, or if there is nothing to run: then
+// `missing` is set. The cache must be up to date with the PATH the process gets.
+static String find_executable(Arena *arena, Path_Cache *cache, String command, bool *missing);
 
-static void   set_current_directory(String dir);
+static bool   set_current_directory(String dir);
 
 #endif
@@ -74,6 +74,36 @@ round_up_to_multiple_of_i64(i64 n, i64 r) {
     return result;
 }
 
+static i64
+count_trailing_zeros_u32(u32 n) {
+	assert(n != 0);
+#if COMPILER_MSVC
+	unsigned long index = 0;
+	_BitScanForward(&index, n);
+	return cast(i64) index;
+#else
+	return cast(i64) __builtin_ctz(n);
+#endif
+}
+
+static i64
+count_set_bits_u32(u32 n) {
+#if COMPILER_MSVC
+	return cast(i64) __popcnt(n);
+#else
+	return cast(i64) __builtin_popcount(n);
+#endif
+}
+
+//- Atomics
+
+#if !COMPILER_MSVC
+static bool
+_atomic_compare_exchange_u64(u64 *p, u64 expected, u64 desired) {
+	return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
 ////////////////////////////////
 //~ Memory
 
@@ -112,6 +142,10 @@ _arena_init(Arena *arena, Arena_Init_Params params) {
 		arena->pos  = 0;
 		arena->peak = 0;
 		arena->commit_pos = 0;
+		arena->decommit_threshold = params.decommit_threshold;
+		arena->decommit_delay_us  = params.decommit_delay_us;
+		arena->excess_unused_us   = 0;
+		arena->excess_unused_pops = 0;
 	} else if (params.reserve_size > 0) {
 		assert(last_alloc_error);
 	}
@@ -215,6 +249,16 @@ push_zero_aligned(Arena *arena, u64 size, u64 alignment) {
 
 //- Arena operations: pop
 
+static void
+_arena_decommit_from(Arena *arena, u64 pos_aligned_to_commit_chunks) {
+	u64   decommit_size = arena->commit_pos - pos_aligned_to_commit_chunks;
+	void *decommit_base = arena->ptr + pos_aligned_to_commit_chunks;
+	
+	mem_decommit(decommit_base, decommit_size);
+	arena->commit_pos       = pos_aligned_to_commit_chunks;
+	arena->excess_unused_us = 0;
+}
+
 static void
 pop_to(Arena *arena, u64 pos) {
 	last_alloc_error = Alloc_Error_NONE;
@@ -225,16 +269,41 @@ pop_to(Arena *arena, u64 pos) {
 	memset(arena->ptr + pos, 0, arena->pos - pos);
 #endif
 	
+	u64 used_pos = arena->pos;
 	arena->pos = pos;
 	
 	u64 pos_aligned_to_commit_chunks = clamp_top(align_forward(arena->pos, ARENA_COMMIT_GRANULARITY), arena->cap);
 	
-	if (pos_aligned_to_commit_chunks + ARENA_DECOMMIT_THRESHOLD <= arena->commit_pos) {
-		u64   decommit_size = arena->commit_pos - pos_aligned_to_commit_chunks;
-		void *decommit_base = arena->ptr + pos_aligned_to_commit_chunks;
+	if (pos_aligned_to_commit_chunks + arena->decommit_threshold <= arena->commit_pos) {
+		// The memory over the threshold is only given back after going unused for the whole delay:
+		// the pops that come back from inside it restart the wait. Reading the clock costs more
+		// than the rest of a pop, so it's done when the wait starts and then only once in a while.
+		bool decommit = arena->decommit_delay_us == 0;
+		if (!decommit) {
+			if (used_pos + arena->decommit_threshold > arena->commit_pos) {
+				arena->excess_unused_us = 0;
+			} else if (arena->excess_unused_us == 0) {
+				arena->excess_unused_us   = time_now_us();
+				arena->excess_unused_pops = 0;
+			} else {
+				arena->excess_unused_pops += 1;
+				if (arena->excess_unused_pops % ARENA_DECOMMIT_CHECK_INTERVAL == 0) {
+					decommit = time_now_us() - arena->excess_unused_us >= arena->decommit_delay_us;
+				}
+			}
+		}
 		
-		mem_decommit(decommit_base, decommit_size);
-		arena->commit_pos = pos_aligned_to_commit_chunks;
+		if (decommit) {
+			_arena_decommit_from(arena, pos_aligned_to_commit_chunks);
+		}
+	}
+}
+
+static void
+arena_decommit_idle(Arena *arena) {
+	u64 pos_aligned_to_commit_chunks = clamp_top(align_forward(arena->pos, ARENA_COMMIT_GRANULARITY), arena->cap);
+	if (pos_aligned_to_commit_chunks + arena->decommit_threshold <= arena->commit_pos) {
+		_arena_decommit_from(arena, pos_aligned_to_commit_chunks);
 	}
 }
 
@@ -266,39 +335,83 @@ arena_end_temp_region(Arena_Restore_Point point) {
 ////////////////////////////////
 //~ Scratch Memory
 
+#if SCRATCH_ARENA_COUNT > 0
+#define SCRATCH_ARENA_ALL_MASK (0xFFFFFFFFu >> (32 - SCRATCH_ARENA_COUNT))
+
+// The index of the arena in scratch_arenas, or -1 if it isn't a scratch arena of this thread.
+static i64
+_scratch_arena_index(Arena *arena) {
+	u64 offset = cast(u64) (cast(uintptr_t) arena - cast(uintptr_t) scratch_arenas);
+	return offset < sizeof(scratch_arenas) ? cast(i64) (offset / sizeof(Arena)) : -1;
+}
+#endif
+
+// Reserves the first arena in `available` that can be reserved. Each arena is only reserved when
+// it's first needed, so short-lived processes and threads that never nest scratch regions don't
+// pay for the others.
+static i64
+_scratch_arena_init_first(u32 available) {
+	i64 result = -1;
+	
+#if SCRATCH_ARENA_COUNT > 0
+	last_alloc_error = Alloc_Error_OUT_OF_MEMORY;
+	for (; available != 0 && result < 0; available &= available - 1) {
+		i64    index = count_trailing_zeros_u32(available);
+		Arena *arena = &scratch_arenas[index];
+		if (arena->ptr == NULL && scratch_arenas_init_errors[index] == Alloc_Error_NONE) {
+			arena_init(arena, .reserve_size = SCRATCH_ARENA_RESERVE_SIZE);
+			scratch_arenas_init_errors[index] = last_alloc_error;
+		}
+		
+		if (arena->ptr != NULL) {
+			result = index;
+		} else {
+			last_alloc_error = scratch_arenas_init_errors[index];
+		}
+	}
+#endif
+	
+	return result;
+}
+
 static Scratch
 scratch_begin(Arena **conflicts, i64 conflict_count) {
 	last_alloc_error = Alloc_Error_NONE;
 	
 	Scratch scratch = {0};
-	i64 index = 0;
 	
 #if SCRATCH_ARENA_COUNT > 0
-	if (scratch_arenas[0].ptr == NULL) { // unlikely()
-		for (int i = 0; i < array_count(scratch_arenas); i += 1) {
-			arena_init(&scratch_arenas[i], .reserve_size = SCRATCH_ARENA_RESERVE_SIZE);
-			scratch_arenas_init_errors[i] = last_alloc_error;
+	// Conflicts are usually not scratch arenas at all, so telling them apart is one comparison
+	// each instead of one per scratch arena.
+	u32 available = SCRATCH_ARENA_ALL_MASK;
+	for (i64 conflict_index = 0; conflict_index < conflict_count; conflict_index += 1) {
+		i64 index = _scratch_arena_index(conflicts[conflict_index]);
+		if (index >= 0) {
+			available &= ~(1u << index);
 		}
 	}
 	
-	for (i64 scratch_arena_index = 0; scratch_arena_index < array_count(scratch_arenas); scratch_arena_index += 1) {
-		bool is_conflicting = false;
-		for (i64 conflict_index = 0; conflict_index < conflict_count; conflict_index += 1) {
-			if (conflicts[conflict_index] == &scratch_arenas[scratch_arena_index]) {
-				is_conflicting = true;
-				break;
-			}
-		}
-		
-		if (!is_conflicting && scratch_arenas[scratch_arena_index].ptr != NULL) {
-			scratch = arena_begin_temp_region(&scratch_arenas[scratch_arena_index]);
-			index = scratch_arena_index;
-			break;
+	i64 scratch_arena_index = -1;
+	if (available != 0) {
+		scratch_arena_index = count_trailing_zeros_u32(available);
+		if (scratch_arenas[scratch_arena_index].ptr == NULL) { // unlikely()
+			scratch_arena_index = _scratch_arena_init_first(available);
 		}
+	} else {
+		last_alloc_error = Alloc_Error_OUT_OF_MEMORY;
+#if AGGRESSIVE_ASSERTS
+		panic("Every scratch arena is a conflict; raise SCRATCH_ARENA_COUNT.");
+#endif
 	}
 	
-	if (scratch.arena->ptr == NULL) {
-		last_alloc_error = scratch_arenas_init_errors[index];
+	if (scratch_arena_index >= 0) {
+		last_alloc_error = Alloc_Error_NONE;
+		scratch.arena = &scratch_arenas[scratch_arena_index];
+		scratch.pos   = scratch.arena->pos;
+#if AGGRESSIVE_ASSERTS
+		scratch_depths[scratch_arena_index] += 1;
+		scratch.depth = scratch_depths[scratch_arena_index];
+#endif
 	}
 #else
 	last_alloc_error = Alloc_Error_OUT_OF_MEMORY;
@@ -309,7 +422,47 @@ scratch_begin(Arena **conflicts, i64 conflict_count) {
 
 static void
 scratch_end(Scratch scratch) {
-	arena_end_temp_region(scratch);
+	if (scratch.arena != NULL) {
+#if AGGRESSIVE_ASSERTS && SCRATCH_ARENA_COUNT > 0
+		i64 scratch_arena_index = _scratch_arena_index(scratch.arena);
+		if (scratch_arena_index < 0) {
+			panic("Not a scratch arena of this thread.");
+		} else if (scratch.depth != scratch_depths[scratch_arena_index]) {
+			panic("Scratch region ended twice, or out of order.");
+		} else {
+			scratch_depths[scratch_arena_index] -= 1;
+		}
+#endif
+		pop_to(scratch.arena, scratch.pos);
+	}
+}
+
+static void
+scratch_arenas_decommit_idle(void) {
+#if SCRATCH_ARENA_COUNT > 0
+	for (i64 index = 0; index < SCRATCH_ARENA_COUNT; index += 1) {
+		if (scratch_arenas[index].ptr != NULL) {
+			arena_decommit_idle(&scratch_arenas[index]);
+		}
+	}
+#endif
+}
+
+static void
+scratch_arenas_fini(void) {
+#if SCRATCH_ARENA_COUNT > 0
+	for (i64 index = 0; index < SCRATCH_ARENA_COUNT; index += 1) {
+		if (scratch_arenas[index].ptr != NULL) {
+			arena_fini(&scratch_arenas[index]);
+		}
+		scratch_arenas_init_errors[index] = Alloc_Error_NONE;
+#if AGGRESSIVE_ASSERTS
+		if (scratch_depths[index] != 0) {
+			panic("Scratch region still open.");
+		}
+#endif
+	}
+#endif
 }
 
 ////////////////////////////////
@@ -398,7 +551,12 @@ push_stringf(Arena *arena, char *fmt, ...) {
 
 static String
 push_stringf_va_list(Arena *arena, char *fmt, va_list args) {
-	i64 len = vsnprintf(0, 0, fmt, args);
+	// The arguments are walked twice, and a va_list can't be reused after vsnprintf() consumed it.
+	va_list args_copy;
+	va_copy(args_copy, args);
+	i64 len = vsnprintf(0, 0, fmt, args_copy);
+	va_end(args_copy);
+	
 	String result = {
 		.data = push_nozero(arena, sizeof(u8) * (len + 1)), // +1 because vsnprintf always null-terminates, even at cost of truncating the string
 		.len  = len,
@@ -450,7 +608,7 @@ strings_concat(Arena *arena, String *strings, i64 string_count) {
 	if (result.data) {
 		i64 offset = 0;
 		for (i64 i = 0; i < string_count; i += 1) {
-			memcpy(result.data + offset, strings[i].data, strings[i].len);
+			if (strings[i].len > 0) memcpy(result.data + offset, strings[i].data, strings[i].len);
 			offset += strings[i].len;
 		}
 	} else {
@@ -493,7 +651,16 @@ string_ends_with(String a, String b) {
 
 static bool
 string_equals(String a, String b) {
-	return (a.len == b.len) && (memcmp(a.data, b.data, a.len) == 0);
+	return (a.len == b.len) && (a.len == 0 || memcmp(a.data, b.data, a.len) == 0);
+}
+
+static int
+string_compare(String a, String b) {
+	int result = memcmp(a.data, b.data, cast(size_t) min(a.len, b.len));
+	if (result == 0) {
+		result = (a.len > b.len) - (a.len < b.len);
+	}
+	return result;
 }
 
 static bool
@@ -516,19 +683,91 @@ string_equals_case_insensitive(String a, String b) {
 static i64
 string_find_first(String s, u8 c) {
 	i64 result = -1;
-	for (i64 i = 0; i < s.len; i += 1) {
-		if (s.data[i] == c) {
-			result = i;
-			break;
+	if (s.len > 0) {
+		// memchr() is vectorized by every C library worth using.
+		u8 *found = memchr(s.data, c, cast(size_t) s.len);
+		if (found != NULL) {
+			result = cast(i64) (found - s.data);
 		}
 	}
 	return result;
 }
 
+// Returns the index of the first occurrence of needle in s, or -1.
+//
+// On x64 this compares 16 candidate positions at a time against the first and the last byte of the
+// needle, and only calls memcmp() on positions where both match. On real text that filters out
+// nearly everything, so it runs close to memory bandwidth.
+static i64
+string_find_substring(String s, String needle) {
+	i64 result = -1;
+	
+	if (needle.len == 0) {
+		result = 0;
+	} else if (needle.len == 1) {
+		result = string_find_first(s, needle.data[0]);
+	} else if (needle.len <= s.len) {
+		i64 last_start = s.len - needle.len;
+		i64 i = 0;
+		
+#if ARCH_X64
+		__m128i first = _mm_set1_epi8(cast(char) needle.data[0]);
+		__m128i last  = _mm_set1_epi8(cast(char) needle.data[needle.len - 1]);
+		
+		for (; i + 16 <= last_start + 1; i += 16) {
+			__m128i block_first = _mm_loadu_si128(cast(__m128i *) (s.data + i));
+			__m128i block_last  = _mm_loadu_si128(cast(__m128i *) (s.data + i + needle.len - 1));
+			
+			__m128i eq_first = _mm_cmpeq_epi8(first, block_first);
+			__m128i eq_last  = _mm_cmpeq_epi8(last,  block_last);
+			
+			u32 mask = cast(u32) _mm_movemask_epi8(_mm_and_si128(eq_first, eq_last));
+			while (mask != 0) {
+				i64 bit = count_trailing_zeros_u32(mask);
+				if (memcmp(s.data + i + bit + 1, needle.data + 1, cast(size_t) (needle.len - 2)) == 0) {
+					result = i + bit;
+					goto done;
+				}
+				mask &= mask - 1;
+			}
+		}
+#endif
+		
+		while (i <= last_start) {
+			u8 *found = memchr(s.data + i, needle.data[0], cast(size_t) (last_start - i + 1));
+			if (found == NULL) break;
+			
+			i = cast(i64) (found - s.data);
+			if (memcmp(s.data + i + 1, needle.data + 1, cast(size_t) (needle.len - 1)) == 0) {
+				result = i;
+				break;
+			}
+			i += 1;
+		}
+	}
+	
+#if ARCH_X64
+	done:;
+#endif
+	
+	return result;
+}
+
 static i64
 string_count_occurrences(String s, u8 c) {
 	i64 result = 0;
-	for (i64 i = 0; i < s.len; i += 1) {
+	i64 i = 0;
+	
+#if ARCH_X64
+	__m128i target = _mm_set1_epi8(cast(char) c);
+	for (; i + 16 <= s.len; i += 16) {
+		__m128i block = _mm_loadu_si128(cast(__m128i *) (s.data + i));
+		u32 mask = cast(u32) _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+		result += count_set_bits_u32(mask);
+	}
+#endif
+	
+	for (; i < s.len; i += 1) {
 		if (s.data[i] == c) {
 			result += 1;
 		}
@@ -576,20 +815,12 @@ string_stop(String s, i64 index) {
 
 static String
 string_skip_chop_whitespace(String s) {
-	for (i64 i = 0; i < s.len; i += 1) {
-		if (!isspace(s.data[i])) {
-			s.data += i;
-			s.len  -= i;
-			break;
-		}
-	}
+	// A string of only whitespace becomes empty.
+	i64 skip = 0;
+	while (skip < s.len && isspace(s.data[skip])) skip += 1;
+	s = string_skip(s, skip);
 	
-	for (i64 i = s.len - 1; i > -1; i -= 1) {
-		if (!isspace(s.data[i])) {
-			s.len = i + 1;
-			break;
-		}
-	}
+	while (s.len > 0 && isspace(s.data[s.len - 1])) s.len -= 1;
 	
 	return s;
 }
@@ -606,6 +837,331 @@ string_chop_past_last_slash(String s) {
 	return s;
 }
 
+//- String conversions
+
+static bool
+string_to_u64(String s, u32 base, u64 *value) {
+	bool ok = s.len > 0 && base >= 2 && base <= 16;
+	
+	u64 result = 0;
+	for (i64 i = 0; ok && i < s.len; i += 1) {
+		u8  c     = s.data[i];
+		u32 digit = 16;
+		if      (c >= '0' && c <= '9') digit = c - '0';
+		else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+		
+		if (digit >= base || result > (UINT64_MAX - digit) / base) {
+			ok = false;
+		} else {
+			result = result * base + digit;
+		}
+	}
+	
+	if (ok) {
+		*value = result;
+	}
+	return ok;
+}
+
+static bool
+string_to_i64(String s, u32 base, i64 *value) {
+	bool negative = s.len > 0 && s.data[0] == '-';
+	if (s.len > 0 && (s.data[0] == '-' || s.data[0] == '+')) {
+		s = string_skip(s, 1);
+	}
+	
+	u64  magnitude = 0;
+	bool ok = string_to_u64(s, base, &magnitude);
+	if (ok) {
+		if (negative && magnitude <= cast(u64) INT64_MAX + 1) {
+			*value = cast(i64) (0 - magnitude);
+		} else if (!negative && magnitude <= INT64_MAX) {
+			*value = cast(i64) magnitude;
+		} else {
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+////////////////////////////////
+//~ Hashing
+
+//- Hashing constants
+
+#define HASH_PRIME32_1 0x9E3779B1U
+#define HASH_PRIME32_2 0x85EBCA77U
+#define HASH_PRIME32_3 0xC2B2AE3DU
+#define HASH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME64_3 0x165667B19E3779F9ULL
+#define HASH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define HASH_STRIPE_LEN         64
+#define HASH_SECRET_LEN         192
+#define HASH_SECRET_CONSUME     8  // Each stripe starts 8 bytes further into the secret.
+#define HASH_STRIPES_PER_BLOCK  ((HASH_SECRET_LEN - HASH_STRIPE_LEN) / HASH_SECRET_CONSUME)
+#define HASH_BLOCK_LEN          (HASH_STRIPE_LEN * HASH_STRIPES_PER_BLOCK)
+
+// Random bytes (from splitmix64) that every stripe is mixed with.
+read_only static u8 hash_secret[HASH_SECRET_LEN] = {
+	0xff, 0x12, 0x49, 0xdc, 0xae, 0xc8, 0xd5, 0x0d, 0x6a, 0xf1, 0x26, 0x72, 0x98, 0x41, 0xde, 0x36,
+	0xbf, 0xb9, 0xa2, 0x82, 0xc9, 0x2f, 0x8d, 0xca, 0xcc, 0xea, 0xc1, 0xc9, 0x93, 0x4c, 0x06, 0x93,
+	0x14, 0x76, 0xab, 0x6c, 0x72, 0xaa, 0xcf, 0xa8, 0x7b, 0xc9, 0x6f, 0x0e, 0x1e, 0xe3, 0x0a, 0x81,
+	0x65, 0x80, 0x81, 0x95, 0x0a, 0xba, 0x8a, 0xc9, 0x07, 0x49, 0x31, 0xd4, 0xaf, 0xf8, 0x26, 0x8f,
+	0x68, 0xd2, 0x3e, 0x4e, 0xc5, 0x8b, 0x21, 0x50, 0xac, 0x06, 0x4d, 0x57, 0xc2, 0x84, 0x21, 0xe7,
+	0xdf, 0x3b, 0x81, 0x29, 0x74, 0x3a, 0x41, 0x99, 0x0f, 0x23, 0x2c, 0xfd, 0xa9, 0xec, 0x7e, 0x5b,
+	0xdd, 0xbf, 0x63, 0xd3, 0x5a, 0x8c, 0x86, 0x11, 0xa2, 0xb7, 0x11, 0xdd, 0x81, 0xdb, 0x8c, 0xca,
+	0x92, 0xc4, 0x86, 0xd8, 0x7e, 0x6d, 0x5e, 0xd3, 0x0c, 0xb5, 0x07, 0x6d, 0x23, 0x6c, 0x02, 0xe8,
+	0xd3, 0x77, 0xb0, 0xa1, 0x59, 0x1a, 0x13, 0xe6, 0x76, 0x03, 0x67, 0x86, 0x94, 0x61, 0xb3, 0x42,
+	0xc7, 0x61, 0x50, 0x9a, 0x72, 0x83, 0x9e, 0xe8, 0x19, 0x09, 0xd1, 0xad, 0xde, 0x29, 0xe4, 0x17,
+	0x24, 0x2f, 0x72, 0xf3, 0x06, 0x8f, 0x64, 0x27, 0x2d, 0x8a, 0x78, 0x30, 0x2e, 0x48, 0xa7, 0x61,
+	0x00, 0xc1, 0x49, 0x17, 0x28, 0xf0, 0xc5, 0x16, 0x3a, 0x45, 0x38, 0x37, 0xfe, 0xb8, 0xbc, 0xa8,
+};
+
+#if !COMPILER_MSVC
+__extension__ typedef unsigned __int128 _Hash_U128;
+#endif
+
+//- Hashing helpers
+
+// Little endian, like every platform dush runs on.
+static u64
+_hash_read_u64(u8 *p) {
+	u64 result = 0;
+	memcpy(&result, p, sizeof(result));
+	return result;
+}
+
+static u32
+_hash_read_u32(u8 *p) {
+	u32 result = 0;
+	memcpy(&result, p, sizeof(result));
+	return result;
+}
+
+static u64
+_hash_rotl64(u64 x, u32 amount) {
+	return (x << amount) | (x >> (64 - amount));
+}
+
+static u64
+_hash_bswap64(u64 x) {
+#if COMPILER_MSVC
+	return _byteswap_uint64(x);
+#else
+	return __builtin_bswap64(x);
+#endif
+}
+
+// The 128-bit product, with its halves xor-ed together.
+static u64
+_hash_mul128_fold64(u64 a, u64 b) {
+#if COMPILER_MSVC && ARCH_X64
+	u64 high = 0;
+	u64 low  = _umul128(a, b, &high);
+	return low ^ high;
+#elif COMPILER_MSVC
+	return (a * b) ^ __umulh(a, b);
+#else
+	_Hash_U128 product = cast(_Hash_U128) a * b;
+	return cast(u64) product ^ cast(u64) (product >> 64);
+#endif
+}
+
+static u64
+_hash_avalanche(u64 h) {
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ULL;
+	h ^= h >> 32;
+	return h;
+}
+
+static u64
+_hash_xxh64_avalanche(u64 h) {
+	h ^= h >> 33;
+	h *= HASH_PRIME64_2;
+	h ^= h >> 29;
+	h *= HASH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+static u64
+_hash_rrmxmx(u64 h, u64 len) {
+	h ^= _hash_rotl64(h, 49) ^ _hash_rotl64(h, 24);
+	h *= 0x9FB21C651E98DF25ULL;
+	h ^= (h >> 35) + len;
+	h *= 0x9FB21C651E98DF25ULL;
+	return h ^ (h >> 28);
+}
+
+static u64
+_hash_mix16(u8 *p, u8 *secret, u64 seed) {
+	u64 low  = _hash_read_u64(p)     ^ (_hash_read_u64(secret)     + seed);
+	u64 high = _hash_read_u64(p + 8) ^ (_hash_read_u64(secret + 8) - seed);
+	return _hash_mul128_fold64(low, high);
+}
+
+static u64
+_hash_short(u8 *p, u64 len, u64 seed) {
+	u8 *secret = hash_secret;
+	u64 result = 0;
+	
+	if (len == 0) {
+		result = _hash_xxh64_avalanche(seed ^ _hash_read_u64(secret + 56) ^ _hash_read_u64(secret + 64));
+	} else if (len <= 3) {
+		u32 combined = (cast(u32) p[0] << 16) | (cast(u32) p[len >> 1] << 24) | cast(u32) p[len - 1] | (cast(u32) len << 8);
+		u64 key = (_hash_read_u32(secret) ^ _hash_read_u32(secret + 4)) + seed;
+		result = _hash_xxh64_avalanche(cast(u64) combined ^ key);
+	} else if (len <= 8) {
+		u64 input = cast(u64) _hash_read_u32(p + len - 4) + (cast(u64) _hash_read_u32(p) << 32);
+		u64 key   = (_hash_read_u64(secret + 8) ^ _hash_read_u64(secret + 16)) - seed;
+		result = _hash_rrmxmx(input ^ key, len);
+	} else if (len <= 16) {
+		u64 low  = _hash_read_u64(p)           ^ ((_hash_read_u64(secret + 24) ^ _hash_read_u64(secret + 32)) + seed);
+		u64 high = _hash_read_u64(p + len - 8) ^ ((_hash_read_u64(secret + 40) ^ _hash_read_u64(secret + 48)) - seed);
+		result = _hash_avalanche(len + _hash_bswap64(low) + high + _hash_mul128_fold64(low, high));
+	} else {
+		// 17 to 128 bytes: 16-byte pieces from both ends, overlapping in the middle.
+		u64 acc    = len * HASH_PRIME64_1;
+		u64 rounds = (len - 1) / 32 + 1;
+		for (u64 i = 0; i < rounds; i += 1) {
+			acc += _hash_mix16(p + 16 * i,             secret + 32 * i,      seed);
+			acc += _hash_mix16(p + len - 16 * (i + 1), secret + 32 * i + 16, seed);
+		}
+		result = _hash_avalanche(acc);
+	}
+	
+	return result;
+}
+
+//- Hashing long inputs
+
+static void
+_hash_accumulate_stripe_scalar(u64 *acc, u8 *p, u8 *secret) {
+	for (i64 i = 0; i < 8; i += 1) {
+		u64 data = _hash_read_u64(p + 8 * i);
+		u64 key  = data ^ _hash_read_u64(secret + 8 * i);
+		acc[i ^ 1] += data;
+		acc[i]     += cast(u64) cast(u32) key * (key >> 32);
+	}
+}
+
+static void
+_hash_scramble_scalar(u64 *acc, u8 *secret) {
+	for (i64 i = 0; i < 8; i += 1) {
+		u64 a = acc[i];
+		a ^= a >> 47;
+		a ^= _hash_read_u64(secret + 8 * i);
+		a *= HASH_PRIME32_1;
+		acc[i] = a;
+	}
+}
+
+#if ARCH_X64
+// The same as the scalar versions, two lanes at a time.
+static void
+_hash_accumulate_stripe_sse2(u64 *acc, u8 *p, u8 *secret) {
+	__m128i *acc_vectors = cast(__m128i *) acc;
+	for (i64 i = 0; i < 4; i += 1) {
+		__m128i data    = _mm_loadu_si128(cast(__m128i *) (p + 16 * i));
+		__m128i key     = _mm_xor_si128(data, _mm_loadu_si128(cast(__m128i *) (secret + 16 * i)));
+		__m128i key_hi  = _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1));
+		__m128i product = _mm_mul_epu32(key, key_hi);
+		__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128i a       = _mm_loadu_si128(&acc_vectors[i]);
+		_mm_storeu_si128(&acc_vectors[i], _mm_add_epi64(a, _mm_add_epi64(product, swapped)));
+	}
+}
+
+static void
+_hash_scramble_sse2(u64 *acc, u8 *secret) {
+	__m128i *acc_vectors = cast(__m128i *) acc;
+	__m128i  prime       = _mm_set1_epi32(cast(int) HASH_PRIME32_1);
+	for (i64 i = 0; i < 4; i += 1) {
+		__m128i a = _mm_loadu_si128(&acc_vectors[i]);
+		a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+		a = _mm_xor_si128(a, _mm_loadu_si128(cast(__m128i *) (secret + 16 * i)));
+		
+		// 64 by 32 bit multiplication, from two 32 by 32 bit ones.
+		__m128i low  = _mm_mul_epu32(a, prime);
+		__m128i high = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+		_mm_storeu_si128(&acc_vectors[i], _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+	}
+}
+#endif
+
+static u64
+_hash_long(u8 *p, u64 len, u64 seed, bool vectorized) {
+	u64 acc[8] = {
+		HASH_PRIME32_3, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_3,
+		HASH_PRIME64_4, HASH_PRIME32_2, HASH_PRIME64_5, HASH_PRIME32_1,
+	};
+	for (i64 i = 0; i < 8; i += 1) {
+		acc[i] ^= seed;
+	}
+	
+	void (*accumulate)(u64 *acc, u8 *p, u8 *secret) = _hash_accumulate_stripe_scalar;
+	void (*scramble)(u64 *acc, u8 *secret)          = _hash_scramble_scalar;
+#if ARCH_X64
+	if (vectorized) {
+		accumulate = _hash_accumulate_stripe_sse2;
+		scramble   = _hash_scramble_sse2;
+	}
+#else
+	(void)vectorized;
+#endif
+	
+	u8 *secret = hash_secret;
+	
+	u64 block_count = (len - 1) / HASH_BLOCK_LEN;
+	for (u64 block = 0; block < block_count; block += 1) {
+		u8 *block_data = p + block * HASH_BLOCK_LEN;
+		for (u64 stripe = 0; stripe < HASH_STRIPES_PER_BLOCK; stripe += 1) {
+			accumulate(acc, block_data + stripe * HASH_STRIPE_LEN, secret + stripe * HASH_SECRET_CONSUME);
+		}
+		scramble(acc, secret + HASH_SECRET_LEN - HASH_STRIPE_LEN);
+	}
+	
+	// The last block is partial. Its last stripe is the one that ends with the input, which
+	// may overlap the stripe before it.
+	u8 *last_block   = p + block_count * HASH_BLOCK_LEN;
+	u64 stripe_count = ((len - 1) - block_count * HASH_BLOCK_LEN) / HASH_STRIPE_LEN;
+	for (u64 stripe = 0; stripe < stripe_count; stripe += 1) {
+		accumulate(acc, last_block + stripe * HASH_STRIPE_LEN, secret + stripe * HASH_SECRET_CONSUME);
+	}
+	accumulate(acc, p + len - HASH_STRIPE_LEN, secret + HASH_SECRET_LEN - HASH_STRIPE_LEN - 7);
+	
+	u64 result = len * HASH_PRIME64_1;
+	for (i64 i = 0; i < 4; i += 1) {
+		u8 *key = secret + 11 + 16 * i;
+		result += _hash_mul128_fold64(acc[2 * i] ^ _hash_read_u64(key), acc[2 * i + 1] ^ _hash_read_u64(key + 8));
+	}
+	return _hash_avalanche(result);
+}
+
+//- Hashing functions
+
+// `vectorized` only exists so that both versions can be compared.
+static u64
+_hash_bytes(String data, u64 seed, bool vectorized) {
+	u64 result = 0;
+	if (data.len <= 128) {
+		result = _hash_short(data.data, cast(u64) data.len, seed);
+	} else {
+		result = _hash_long(data.data, cast(u64) data.len, seed, vectorized);
+	}
+	return result;
+}
+
+static u64
+hash_bytes(String data, u64 seed) {
+	return _hash_bytes(data, seed, true);
+}
+
 ////////////////////////////////
 //~ String Builder
 
@@ -32,6 +32,10 @@
 #include <errno.h>
 #include <time.h>
 
+#if ARCH_X64
+# include <emmintrin.h>
+#endif
+
 #ifdef min
 # undef min
 #endif
@@ -182,6 +186,40 @@ static bool is_power_of_two(u64 i);
 static u64  align_forward(u64 ptr, u64 alignment);
 static u64  round_up_to_multiple_of_u64(u64 n, u64 r);
 static i64  round_up_to_multiple_of_i64(i64 n, i64 r);
+static i64  count_trailing_zeros_u32(u32 n); // n must not be 0
+static i64  count_set_bits_u32(u32 n);
+
+//- Atomics
+
+// Everything is sequentially consistent. The fetch operations return the previous value.
+#if COMPILER_MSVC
+# include <intrin.h>
+# define atomic_load_u32(p)                 cast(u32) _InterlockedOr(cast(volatile long *) (p), 0)
+# define atomic_load_u64(p)                 cast(u64) _InterlockedOr64(cast(volatile __int64 *) (p), 0)
+# define atomic_store_u32(p, v)             (void)_InterlockedExchange(cast(volatile long *) (p), cast(long) (v))
+# define atomic_store_u64(p, v)             (void)_InterlockedExchange64(cast(volatile __int64 *) (p), cast(__int64) (v))
+# define atomic_fetch_add_u32(p, v)         cast(u32) _InterlockedExchangeAdd(cast(volatile long *) (p), cast(long) (v))
+# define atomic_fetch_add_u64(p, v)         cast(u64) _InterlockedExchangeAdd64(cast(volatile __int64 *) (p), cast(__int64) (v))
+# define atomic_compare_exchange_u64(p, expected, desired) \
+	(_InterlockedCompareExchange64(cast(volatile __int64 *) (p), cast(__int64) (desired), cast(__int64) (expected)) == cast(__int64) (expected))
+# define cpu_relax()                        _mm_pause()
+#else
+# define atomic_load_u32(p)                 __atomic_load_n(p, __ATOMIC_SEQ_CST)
+# define atomic_load_u64(p)                 __atomic_load_n(p, __ATOMIC_SEQ_CST)
+# define atomic_store_u32(p, v)             __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+# define atomic_store_u64(p, v)             __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+# define atomic_fetch_add_u32(p, v)         __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+# define atomic_fetch_add_u64(p, v)         __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+# define atomic_compare_exchange_u64(p, expected, desired) _atomic_compare_exchange_u64(p, expected, desired)
+static bool _atomic_compare_exchange_u64(u64 *p, u64 expected, u64 desired);
+# if ARCH_X64
+#  define cpu_relax()                       _mm_pause()
+# elif ARCH_ARM64
+#  define cpu_relax()                       __asm__ __volatile__("yield")
+# else
+#  define cpu_relax()                       ((void)0)
+# endif
+#endif
 
 ////////////////////////////////
 //~ Memory
@@ -224,6 +262,13 @@ static bool  mem_release(void *ptr, u64 size);
 
 static String last_alloc_error_string(void);
 
+////////////////////////////////
+//~ Time
+
+// Microseconds from a monotonic clock, with an unspecified starting point.
+static u64 time_now_us(void);
+static u64 time_now_ns(void); // The same clock, in nanoseconds.
+
 ////////////////////////////////
 //~ Arena
 
@@ -237,6 +282,19 @@ static String last_alloc_error_string(void);
 #define ARENA_DECOMMIT_THRESHOLD megabytes(64)
 #endif
 
+// How long the memory over the threshold has to go unused before a pop gives it back. An arena
+// that grows and shrinks back over and over, like a scratch arena through a script where big and
+// small commands alternate, would otherwise commit and decommit the same memory every time. An
+// arena that isn't popped anymore keeps it until arena_decommit_idle().
+#if !defined(ARENA_DECOMMIT_DELAY_US)
+#define ARENA_DECOMMIT_DELAY_US 2000000
+#endif
+
+// Pops that find that memory unused only read the clock once every this many.
+#if !defined(ARENA_DECOMMIT_CHECK_INTERVAL)
+#define ARENA_DECOMMIT_CHECK_INTERVAL 16
+#endif
+
 #if !defined(DEFAULT_ARENA_RESERVE_SIZE)
 #define DEFAULT_ARENA_RESERVE_SIZE gigabytes(1)
 #endif
@@ -250,6 +308,10 @@ struct Arena {
 	u64  cap;
 	u64  peak;
 	u64  commit_pos;
+	u64  decommit_threshold;
+	u64  decommit_delay_us;
+	u64  excess_unused_us;   // When the memory over the threshold was found unused, or 0 if it's in use.
+	u64  excess_unused_pops; // Pops since then.
 };
 
 typedef struct Arena_Restore_Point Arena_Restore_Point;
@@ -261,12 +323,14 @@ struct Arena_Restore_Point {
 typedef struct Arena_Init_Params Arena_Init_Params;
 struct Arena_Init_Params {
 	u64 reserve_size;
+	u64 decommit_threshold; // How much committed memory over the position a pop can leave.
+	u64 decommit_delay_us;  // 0 gives it back at the first pop that finds it unused.
 };
 
 //- Arena procedures
 
 static bool _arena_init(Arena *arena, Arena_Init_Params params);
-#define arena_init(arena, ...) _arena_init(arena, (Arena_Init_Params){ .reserve_size = DEFAULT_ARENA_RESERVE_SIZE, __VA_ARGS__ })
+#define arena_init(arena, ...) _arena_init(arena, (Arena_Init_Params){ .reserve_size = DEFAULT_ARENA_RESERVE_SIZE, .decommit_threshold = ARENA_DECOMMIT_THRESHOLD, .decommit_delay_us = ARENA_DECOMMIT_DELAY_US, __VA_ARGS__ })
 static bool arena_fini(Arena *arena);
 static void arena_reset(Arena *arena);
 
@@ -280,6 +344,10 @@ static void *push_zero(Arena *arena, u64 size, u64 alignment);
 static void pop_to(Arena *arena, u64 pos);
 static void pop_amount(Arena *arena, u64 amount);
 
+// Gives back the memory over the threshold now, without waiting for the delay. For when the
+// arena won't be used for a while, like before the shell waits for the next line.
+static void arena_decommit_idle(Arena *arena);
+
 static Arena_Restore_Point arena_begin_temp_region(Arena *arena);
 static void arena_end_temp_region(Arena_Restore_Point point);
 
@@ -288,30 +356,60 @@ static void arena_end_temp_region(Arena_Restore_Point point);
 
 //- Scratch memory constants
 
+// At most 32, so that a set of scratch arenas fits in a u32.
 #if !defined(SCRATCH_ARENA_COUNT)
 #define SCRATCH_ARENA_COUNT 2
 #endif
 
+#if SCRATCH_ARENA_COUNT > 32
+# error "SCRATCH_ARENA_COUNT must be at most 32."
+#endif
+
 #if !defined(SCRATCH_ARENA_RESERVE_SIZE)
 #define SCRATCH_ARENA_RESERVE_SIZE gigabytes(8)
 #endif
 
 //- Scratch memory types
 
-typedef Arena_Restore_Point Scratch;
+// Starts like an Arena_Restore_Point. The depth is only tracked with AGGRESSIVE_ASSERTS, which
+// keeps the struct small enough to be returned in registers otherwise.
+typedef struct Scratch Scratch;
+struct Scratch {
+	Arena *arena;
+	u64    pos;
+#if AGGRESSIVE_ASSERTS
+	u32    depth; // How many regions of this arena were open, counting this one.
+#endif
+};
 
 //- Scratch memory variables
 
 #if SCRATCH_ARENA_COUNT > 0
 per_thread Arena scratch_arenas[SCRATCH_ARENA_COUNT];
 per_thread Alloc_Error scratch_arenas_init_errors[SCRATCH_ARENA_COUNT];
+
+// How many regions of each scratch arena are open, to catch regions that are ended twice or
+// out of order.
+# if AGGRESSIVE_ASSERTS
+per_thread u32 scratch_depths[SCRATCH_ARENA_COUNT];
+# endif
 #endif
 
 //- Scratch memory functions
 
+// Returns a region of the first scratch arena that isn't one of the conflicts, which are the
+// arenas the caller is still using (usually the one the result goes to). Regions of the same
+// arena must be ended in the reverse order they were begun.
 static Scratch scratch_begin(Arena **conflicts, i64 conflict_count);
 static void    scratch_end(Scratch scratch);
 
+// arena_decommit_idle() for each scratch arena of the calling thread.
+static void    scratch_arenas_decommit_idle(void);
+
+// Releases the scratch arenas of the calling thread. Threads other than the main one call it
+// before they exit, otherwise their reservations are never given back.
+static void    scratch_arenas_fini(void);
+
 ////////////////////////////////
 //~ Strings and slices
 
@@ -327,9 +425,9 @@ static SliceU8 sliceu8_clone(Arena *arena, SliceU8 s);
 #define string_lit_expand(s)     s, (sizeof(s)-1)
 #define string_expand(s)         cast(int)(s).len, (s).data
 
-#define string_from_lit(s)       string(cast(u8 *)s, sizeof(s)-1)
-#define string_from_cstring(s)   string(cast(u8 *)s, strlen(s))
-#define string_from_lit_const(s)       {sizeof(s)-1, cast(u8 *)s}
+#define string_from_lit(s)       string(cast(u8 *)(s), sizeof(s)-1)
+#define string_from_cstring(s)   string(cast(u8 *)(s), strlen(s))
+#define string_from_lit_const(s)       {sizeof(s)-1, cast(u8 *)(s)}
 
 static String string(u8 *data, i64 len);
 static String push_string(Arena *arena, i64 len);
@@ -344,8 +442,10 @@ static bool string_starts_with(String a, String b);
 static bool string_ends_with(String a, String b);
 static bool string_equals(String a, String b);
 static bool string_equals_case_insensitive(String a, String b);
+static int  string_compare(String a, String b); // Byte-wise, like memcmp; a prefix comes first.
 
 static i64 string_find_first(String s, u8 c);
+static i64 string_find_substring(String s, String needle);
 static i64 string_count_occurrences(String s, u8 c);
 static i64 string_contains(String s, u8 c);
 
@@ -355,6 +455,20 @@ static String string_stop(String s, i64 index);
 static String string_skip_chop_whitespace(String s);
 static String string_chop_past_last_slash(String s);
 
+// The whole string must be a number in the base (2 to 16, no prefix such as "0x"), without
+// overflowing. The i64 version takes an optional leading '-' or '+'.
+static bool string_to_u64(String s, u32 base, u64 *value);
+static bool string_to_i64(String s, u32 base, i64 *value);
+
+////////////////////////////////
+//~ Hashing
+
+// A fast non-cryptographic 64-bit hash built like XXH3: inputs of up to 128 bytes go through a
+// few wide multiplications, longer ones through 8 lanes of accumulators that SSE2 updates two at
+// a time on x64. Good for hash tables and for telling file contents apart, not against anyone
+// who picks the inputs. The values are not the same as XXH3's.
+static u64 hash_bytes(String data, u64 seed);
+
 ////////////////////////////////
 //~ String Builder
 
@@ -6,8 +6,17 @@
 
 static void *
 mem_reserve(u64 size) {
-	void *result = mmap(0, size, 0, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
-	assert(result != NULL);
+	// MAP_NORESERVE: nothing is accounted against the commit limit until it's actually committed,
+	// so the reservations cost nothing but address space.
+	void *result = mmap(0, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (result == MAP_FAILED) {
+		result = NULL;
+		last_alloc_error = Alloc_Error_OUT_OF_MEMORY;
+		
+#if AGGRESSIVE_ASSERTS
+		panic("mmap failed!");
+#endif
+	}
 	
 	return result;
 }
@@ -36,4 +45,21 @@ mem_release(void *ptr, u64 size) {
 	return munmap(ptr, size) != -1;
 }
 
+////////////////////////////////
+//~ Time
+
+static u64
+time_now_us(void) {
+	struct timespec now = {0};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return cast(u64) now.tv_sec * 1000000 + cast(u64) now.tv_nsec / 1000;
+}
+
+static u64
+time_now_ns(void) {
+	struct timespec now = {0};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return cast(u64) now.tv_sec * 1000000000 + cast(u64) now.tv_nsec;
+}
+
 #endif
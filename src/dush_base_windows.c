@@ -94,4 +94,33 @@ mem_release(void *ptr, u64 size) {
 	return VirtualFree(ptr, 0, MEM_RELEASE);
 }
 
+////////////////////////////////
+//~ Time
+
+static u64
+time_now_us(void) {
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	
+	LARGE_INTEGER counter = {0};
+	QueryPerformanceCounter(&counter);
+	return cast(u64) (counter.QuadPart / frequency.QuadPart * 1000000 +
+					  counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
+static u64
+time_now_ns(void) {
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	
+	LARGE_INTEGER counter = {0};
+	QueryPerformanceCounter(&counter);
+	return cast(u64) (counter.QuadPart / frequency.QuadPart * 1000000000 +
+					  counter.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+}
+
 #endif
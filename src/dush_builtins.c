@@ -0,0 +1,2158 @@
+#ifndef DUSH_BUILTINS_C
+#define DUSH_BUILTINS_C
+
+////////////////////////////////
+//~ Builtins
+
+//- Builtin helpers
+
+static Thread_Pool *
+_builtins_pool(Builtins *builtins) {
+	if (!builtins->pool_started) {
+		// If it can't start, the tasks simply run on this thread.
+		thread_pool_init(&builtins->pool, 0);
+		builtins->pool_started = true;
+	}
+	return &builtins->pool;
+}
+
+static Arena *
+_builtins_worker_arena(Builtins *builtins) {
+	Arena *arena = &builtins->worker_arenas[thread_pool_worker_index + 1];
+	if (arena->ptr == NULL) {
+		arena_init(arena);
+	}
+	return arena;
+}
+
+// Only while no task is running.
+static void
+_builtins_reset_worker_arenas(Builtins *builtins) {
+	for (i64 i = 0; i < array_count(builtins->worker_arenas); i += 1) {
+		if (builtins->worker_arenas[i].ptr != NULL) {
+			arena_reset(&builtins->worker_arenas[i]);
+		}
+	}
+}
+
+// Grows a block at the end of the arena, so nothing else may be pushed onto the arena until the
+// block is complete.
+static void
+_builtin_append(Arena *arena, String *block, String s) {
+	if (s.len > 0) {
+		u8 *data = push_nozero(arena, s.len);
+		if (data != NULL) {
+			memcpy(data, s.data, s.len);
+			if (block->data == NULL) {
+				block->data = data;
+			}
+			block->len += s.len;
+		}
+	}
+}
+
+static String
+_builtin_path_join(Arena *arena, String dir, String name) {
+	String result = name;
+	if (dir.len > 0) {
+		bool   has_separator = is_separator(dir.data[dir.len - 1]);
+		String temp[] = {dir, has_separator ? string_from_lit("") : get_separator(), name};
+		result = strings_concat(arena, temp, array_count(temp));
+	}
+	return result;
+}
+
+static void
+_builtin_file_error(char *command, String path) {
+	fprintf(stderr, "%s: %.*s: %.*s\n", command, string_expand(path), string_expand(last_file_error_string()));
+}
+
+typedef void Builtin_File_Proc(void *data, String path);
+typedef bool Builtin_Directory_Proc(void *data, String path);
+
+typedef struct Builtin_Walk Builtin_Walk;
+struct Builtin_Walk {
+	Builtin_File_Proc      *file_proc;
+	Builtin_Directory_Proc *directory_proc; // Optional. Called before the entries of a directory, which are skipped if it returns false.
+	void                   *data;
+	bool                    symlinks;       // Hand symbolic links to the file procedure instead of skipping them.
+};
+
+// Calls the procedures for everything under the directory. Like grep -r, symbolic links are
+// only followed when they are given on the command line, which also keeps links to a parent
+// directory from looping. An empty directory means the current one, whose files are named
+// without a "./" in front. The path only lives until the procedure returns, and nothing may be
+// pushed onto the conflict arena while a directory is walked except by the procedures.
+// Returns false if a directory couldn't be read, after printing why.
+static bool
+_builtin_walk(char *command, Arena *conflict, String dir, Builtin_Walk *walk) {
+	bool ok = true;
+	
+	Scratch scratch = scratch_begin(&conflict, 1);
+	
+	File_Iterator *iterator = file_iterator_begin(scratch.arena, dir, .names_only = true);
+	while (true) {
+		Arena_Restore_Point restore = arena_begin_temp_region(scratch.arena);
+		
+		File_Info info = {0};
+		if (!file_iterator_next(scratch.arena, iterator, &info)) {
+			if (last_file_error != File_Error_NONE) {
+				_builtin_file_error(command, dir.len > 0 ? dir : string_from_lit("."));
+				ok = false;
+			}
+			break;
+		}
+		
+		String path = _builtin_path_join(scratch.arena, dir, info.name);
+		if (info.attributes.flags & File_Flag_IS_SYMLINK) {
+			if (walk->symlinks) {
+				walk->file_proc(walk->data, path);
+			}
+		} else if (info.attributes.flags & File_Flag_IS_DIRECTORY) {
+			if (walk->directory_proc == NULL || walk->directory_proc(walk->data, path)) {
+				ok = _builtin_walk(command, conflict, path, walk) && ok;
+			}
+		} else {
+			walk->file_proc(walk->data, path);
+		}
+		
+		arena_end_temp_region(restore);
+	}
+	file_iterator_end(iterator);
+	
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+//- Builtin functions
+
+static Builtin_Id
+builtin_find(String name) {
+	read_only static String names[Builtin_COUNT] = {
+		[Builtin_ACCOUNTING] = string_from_lit_const("accounting"),
+		[Builtin_BASENAME]   = string_from_lit_const("basename"),
+		[Builtin_BRACKET]    = string_from_lit_const("["),
+		[Builtin_BREAK]      = string_from_lit_const("break"),
+		[Builtin_CD]         = string_from_lit_const("cd"),
+		[Builtin_COLON]      = string_from_lit_const(":"),
+		[Builtin_CONTINUE]   = string_from_lit_const("continue"),
+		[Builtin_CP]         = string_from_lit_const("cp"),
+		[Builtin_DIRNAME]    = string_from_lit_const("dirname"),
+		[Builtin_ECHO]       = string_from_lit_const("echo"),
+		[Builtin_EXIT]       = string_from_lit_const("exit"),
+		[Builtin_EXPORT]     = string_from_lit_const("export"),
+		[Builtin_EXPR]       = string_from_lit_const("expr"),
+		[Builtin_FALSE]      = string_from_lit_const("false"),
+		[Builtin_GREP]       = string_from_lit_const("grep"),
+		[Builtin_HASH_FILES] = string_from_lit_const("hash-files"),
+		[Builtin_HELP]       = string_from_lit_const("help"),
+		[Builtin_HISTORY]    = string_from_lit_const("history"),
+		[Builtin_MV]         = string_from_lit_const("mv"),
+		[Builtin_PWD]        = string_from_lit_const("pwd"),
+		[Builtin_RETURN]     = string_from_lit_const("return"),
+		[Builtin_SET]        = string_from_lit_const("set"),
+		[Builtin_TEST]       = string_from_lit_const("test"),
+		[Builtin_TR]         = string_from_lit_const("tr"),
+		[Builtin_TRUE]       = string_from_lit_const("true"),
+		[Builtin_UNSET]      = string_from_lit_const("unset"),
+		[Builtin_WAIT]       = string_from_lit_const("wait"),
+		[Builtin_WC]         = string_from_lit_const("wc"),
+	};
+	
+	Builtin_Id result = Builtin_NONE;
+	for (Builtin_Id id = Builtin_NONE + 1; id < Builtin_COUNT; id += 1) {
+		if (string_equals(names[id], name)) {
+			result = id;
+			break;
+		}
+	}
+	return result;
+}
+
+static void
+builtins_fini(Builtins *builtins) {
+	if (builtins->pool_started) {
+		thread_pool_fini(&builtins->pool);
+	}
+	for (i64 i = 0; i < array_count(builtins->worker_arenas); i += 1) {
+		if (builtins->worker_arenas[i].ptr != NULL) {
+			arena_fini(&builtins->worker_arenas[i]);
+		}
+	}
+	if (builtins->accounting_arena.ptr != NULL) {
+		arena_fini(&builtins->accounting_arena);
+	}
+	memset(builtins, 0, sizeof(*builtins));
+}
+
+////////////////////////////////
+//~ grep
+
+//- grep constants
+
+// Like GNU grep, a file with a null byte near the start is binary: it's only said whether it
+// matches, since its lines would make no sense on a terminal.
+#define GREP_BINARY_PROBE_SIZE kilobytes(32)
+
+//- grep types
+
+typedef struct Grep_Options Grep_Options;
+struct Grep_Options {
+	String pattern;
+	bool   recursive;
+	bool   line_numbers;
+	bool   files_with_matches;
+	bool   count;
+	bool   show_names;
+};
+
+typedef struct Grep_File Grep_File;
+struct Grep_File {
+	Builtins     *builtins;
+	Grep_Options *options;
+	String        path;
+	String        output;      // In the worker arena of the thread that searched the file.
+	i64           match_count; // Lines that matched.
+	File_Error    error;
+};
+
+// Files of the batch that one worker reads together, and then searches.
+typedef struct Grep_Task Grep_Task;
+struct Grep_Task {
+	Grep_File *files;
+	i64        count;
+};
+
+// The files found so far that haven't been printed yet.
+typedef struct Grep_Run Grep_Run;
+struct Grep_Run {
+	Builtins     *builtins;
+	Thread_Pool  *pool;
+	Grep_Options *options;
+	
+	Arena        *arena;     // Holds the files of the batch, after files_end.
+	u64           files_end;
+	Grep_File    *files;
+	i64           file_count;
+	i64           task_start; // The first file that no task has yet.
+	Task_Group    group;
+	
+	File_Writer   writer;
+	bool          matched;
+	bool          failed;
+};
+
+//- grep helpers
+
+static void
+_grep_search(Arena *arena, Grep_File *file, String text) {
+	Grep_Options *options = file->options;
+	
+	bool binary = string_contains(string_stop(text, GREP_BINARY_PROBE_SIZE), 0);
+	
+	i64 pos           = 0;
+	i64 line_number   = 1;
+	i64 counted_until = 0;
+	while (pos < text.len) {
+		i64 found = string_find_substring(string_skip(text, pos), options->pattern);
+		if (found < 0) break;
+		found += pos;
+		
+		i64 line_start = found;
+		while (line_start > pos && text.data[line_start - 1] != '\n') {
+			line_start -= 1;
+		}
+		i64 line_end = string_find_first(string_skip(text, found), '\n');
+		line_end = line_end >= 0 ? found + line_end : text.len;
+		
+		file->match_count += 1;
+		if (options->files_with_matches || (binary && !options->count)) break;
+		
+		if (!options->count) {
+			if (options->show_names) {
+				_builtin_append(arena, &file->output, file->path);
+				_builtin_append(arena, &file->output, string_from_lit(":"));
+			}
+			if (options->line_numbers) {
+				line_number += string_count_occurrences(string_skip(string_stop(text, line_start), counted_until), '\n');
+				counted_until = line_start;
+				
+				char number[32];
+				int  number_len = snprintf(number, sizeof(number), "%lld:", cast(long long) line_number);
+				_builtin_append(arena, &file->output, string(cast(u8 *) number, number_len));
+			}
+			_builtin_append(arena, &file->output, string(text.data + line_start, line_end - line_start));
+			_builtin_append(arena, &file->output, string_from_lit("\n"));
+		}
+		
+		pos = line_end + 1;
+	}
+	
+	if (options->files_with_matches) {
+		if (file->match_count > 0) {
+			_builtin_append(arena, &file->output, file->path);
+			_builtin_append(arena, &file->output, string_from_lit("\n"));
+		}
+	} else if (options->count) {
+		if (options->show_names) {
+			_builtin_append(arena, &file->output, file->path);
+			_builtin_append(arena, &file->output, string_from_lit(":"));
+		}
+		char number[32];
+		int  number_len = snprintf(number, sizeof(number), "%lld\n", cast(long long) file->match_count);
+		_builtin_append(arena, &file->output, string(cast(u8 *) number, number_len));
+	} else if (binary && file->match_count > 0) {
+		_builtin_append(arena, &file->output, string_from_lit("grep: "));
+		_builtin_append(arena, &file->output, file->path);
+		_builtin_append(arena, &file->output, string_from_lit(": binary file matches\n"));
+	}
+}
+
+static void
+_grep_files_task(void *param) {
+	Grep_Task *task   = cast(Grep_Task *) param;
+	Arena     *output = _builtins_worker_arena(task->files[0].builtins);
+	
+	Scratch scratch = scratch_begin(&output, 1);
+	
+	Read_Files_Item *items = push_array(scratch.arena, Read_Files_Item, task->count);
+	for (i64 i = 0; items != NULL && i < task->count; i += 1) {
+		items[i].file_name = task->files[i].path;
+	}
+	if (items != NULL) {
+		read_files(scratch.arena, items, task->count, .map = true);
+	}
+	
+	for (i64 i = 0; i < task->count; i += 1) {
+		Grep_File *file = &task->files[i];
+		if (items == NULL) {
+			file->error = File_Error_OTHER;
+		} else if (items[i].result.ok) {
+			_grep_search(output, file, string_from_sliceu8(items[i].result.contents));
+			read_file_release(&items[i].result);
+		} else {
+			file->error = items[i].error;
+		}
+	}
+	
+	scratch_end(scratch);
+}
+
+// Hands the files that were found since the last task to a new one.
+static void
+_grep_push_task(Grep_Run *run) {
+	Grep_Task *task = push_array(run->arena, Grep_Task, 1);
+	if (task != NULL) {
+		task->files = run->files + run->task_start;
+		task->count = run->file_count - run->task_start;
+		thread_pool_push(run->pool, &run->group, _grep_files_task, task);
+	} else {
+		for (i64 i = run->task_start; i < run->file_count; i += 1) {
+			run->files[i].error = File_Error_OTHER;
+		}
+	}
+	run->task_start = run->file_count;
+}
+
+// Waits for the files of the batch and prints them in the order they were found.
+static void
+_grep_flush(Grep_Run *run) {
+	if (run->task_start < run->file_count) {
+		_grep_push_task(run);
+	}
+	thread_pool_wait(run->pool, &run->group);
+	
+	for (i64 i = 0; i < run->file_count; i += 1) {
+		Grep_File *file = &run->files[i];
+		if (file->error != File_Error_NONE) {
+			file_writer_flush(&run->writer);
+			last_file_error = file->error;
+			_builtin_file_error("grep", file->path);
+			run->failed = true;
+		} else {
+			file_writer_append(&run->writer, file->output);
+			run->matched = run->matched || file->match_count > 0;
+		}
+	}
+	file_writer_flush(&run->writer);
+	
+	_builtins_reset_worker_arenas(run->builtins);
+	pop_to(run->arena, run->files_end);
+	run->file_count = 0;
+	run->task_start = 0;
+}
+
+static void
+_grep_add_file(void *data, String path) {
+	Grep_Run *run = cast(Grep_Run *) data;
+	
+	if (run->file_count == BUILTIN_BATCH_SIZE) {
+		_grep_flush(run);
+	}
+	
+	Grep_File *file = &run->files[run->file_count];
+	memset(file, 0, sizeof(*file));
+	file->builtins = run->builtins;
+	file->options  = run->options;
+	file->path     = string_clone(run->arena, path);
+	
+	if (file->path.data != NULL) {
+		run->file_count += 1;
+		if (run->file_count - run->task_start == BUILTIN_READ_BATCH_SIZE) {
+			_grep_push_task(run);
+		}
+	} else {
+		last_file_error = File_Error_OTHER;
+		_builtin_file_error("grep", path);
+		run->failed = true;
+	}
+}
+
+//- grep functions
+
+static i32
+builtin_grep(Builtins *builtins, String *argv, i64 argc) {
+	Grep_Options options = {0};
+	
+	i64  arg_index = 0;
+	bool usage_ok  = true;
+	for (; arg_index < argc; arg_index += 1) {
+		String arg = argv[arg_index];
+		if (string_equals(arg, string_from_lit("--"))) {
+			arg_index += 1;
+			break;
+		}
+		if (arg.len < 2 || arg.data[0] != '-') break;
+		
+		for (i64 i = 1; i < arg.len; i += 1) {
+			switch (arg.data[i]) {
+				case 'r': case 'R': options.recursive = true; break;
+				case 'n': options.line_numbers = true; break;
+				case 'l': options.files_with_matches = true; break;
+				case 'c': options.count = true; break;
+				case 'F': break; // The text is always fixed.
+				default: {
+					fprintf(stderr, "grep: unknown option '-%c'\n", arg.data[i]);
+					usage_ok = false;
+				} break;
+			}
+		}
+	}
+	
+	if (arg_index >= argc) {
+		usage_ok = false;
+	}
+	
+	i32 result = 2;
+	if (usage_ok) {
+		options.pattern = argv[arg_index];
+		String *paths      = argv + arg_index + 1;
+		i64     path_count = argc - arg_index - 1;
+		options.show_names = path_count > 1 || options.recursive;
+		
+		Scratch scratch = scratch_begin(0, 0);
+		
+		Grep_Run run = {0};
+		run.builtins = builtins;
+		run.pool     = _builtins_pool(builtins);
+		run.options  = &options;
+		run.arena    = scratch.arena;
+		file_writer_init(&run.writer, file_standard_output(), push_sliceu8(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE));
+		run.files     = push_array(scratch.arena, Grep_File, BUILTIN_BATCH_SIZE);
+		run.files_end = scratch.arena->pos;
+		
+		Builtin_Walk walk = {_grep_add_file, NULL, &run, false};
+		
+		if (run.files == NULL || run.writer.data == NULL) {
+			fprintf(stderr, "grep: %.*s\n", string_expand(last_alloc_error_string()));
+			run.failed = true;
+		} else if (path_count == 0) {
+			if (options.recursive) {
+				if (!_builtin_walk("grep", run.arena, string_from_lit(""), &walk)) {
+					run.failed = true;
+				}
+			} else {
+				fprintf(stderr, "grep: reading the standard input is not supported; give a path or -r\n");
+				run.failed = true;
+			}
+		} else {
+			for (i64 i = 0; i < path_count; i += 1) {
+				File_Attributes attributes = {0};
+				if (!file_attributes(paths[i], &attributes)) {
+					_builtin_file_error("grep", paths[i]);
+					run.failed = true;
+				} else if (attributes.flags & File_Flag_IS_DIRECTORY) {
+					if (options.recursive) {
+						if (!_builtin_walk("grep", run.arena, paths[i], &walk)) {
+							run.failed = true;
+						}
+					} else {
+						last_file_error = File_Error_IS_DIRECTORY;
+						_builtin_file_error("grep", paths[i]);
+						run.failed = true;
+					}
+				} else {
+					_grep_add_file(&run, paths[i]);
+				}
+			}
+		}
+		
+		_grep_flush(&run);
+		
+		scratch_end(scratch);
+		
+		result = run.failed ? 2 : run.matched ? 0 : 1;
+	} else {
+		fprintf(stderr, "Usage: grep [-rnlc] text [path...]\n");
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ hash-files
+
+//- hash-files constants
+
+// Followed by the time the run that wrote the cache started.
+#define HASH_CACHE_HEADER "dush-hash-cache 1 "
+
+//- hash-files types
+
+typedef struct Hash_Cache_Entry Hash_Cache_Entry;
+struct Hash_Cache_Entry {
+	String path; // Empty slots have a NULL path.
+	u64    size;
+	i64    last_modified;
+	u64    hash;
+};
+
+// The hashes of the files of the last run that used the cache file, by path. Read-only while
+// files are hashed, so that every worker can look into it.
+typedef struct Hash_Cache Hash_Cache;
+struct Hash_Cache {
+	Hash_Cache_Entry *slots;
+	u64               slot_mask;
+	
+	// A file modified at or after this time could have changed again within the same second
+	// after it was hashed, without its attributes showing it, so its entry isn't trusted.
+	i64               started_at;
+};
+
+typedef struct Hash_File Hash_File;
+struct Hash_File {
+	Hash_Cache *cache;
+	String      path;
+	u64         size;
+	i64         last_modified;
+	u64         hash;
+	File_Error  error;
+	bool        cached;
+};
+
+// Files of the batch that one worker hashes: the ones whose hash isn't in the cache are read
+// together.
+typedef struct Hash_Task Hash_Task;
+struct Hash_Task {
+	Hash_File *files;
+	i64        count;
+};
+
+typedef struct Hash_Run Hash_Run;
+struct Hash_Run {
+	Thread_Pool *pool;
+	Hash_Cache  *cache;
+	
+	Arena       *arena;     // Holds the files of the batch, after files_end.
+	u64          files_end;
+	Hash_File   *files;
+	i64          file_count;
+	i64          task_start; // The first file that no task has yet.
+	Task_Group   group;
+	
+	File_Writer  writer;
+	File_Writer  cache_writer; // Writes the new cache file, if there is one.
+	bool         failed;
+};
+
+//- hash-files helpers
+
+static Hash_Cache_Entry *
+_hash_cache_find(Hash_Cache *cache, String path) {
+	Hash_Cache_Entry *result = NULL;
+	if (cache->slots != NULL) {
+		for (u64 i = hash_bytes(path, 0) & cache->slot_mask; cache->slots[i].path.data != NULL; i = (i + 1) & cache->slot_mask) {
+			if (string_equals(cache->slots[i].path, path)) {
+				result = &cache->slots[i];
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+// The entries point into the contents of the file, which stay on the arena. A cache file that
+// can't be read or parsed is the same as no cache at all: everything is hashed again.
+static void
+_hash_cache_load(Arena *arena, Hash_Cache *cache, String file_name) {
+	memset(cache, 0, sizeof(*cache));
+	
+	Read_File_Result read = read_file(arena, file_name);
+	String text = string_from_sliceu8(read.contents);
+	
+	i64 header_end = string_find_first(text, '\n');
+	String header  = string_stop(text, header_end);
+	String prefix  = string_from_lit(HASH_CACHE_HEADER);
+	if (read.ok && header_end >= 0 && string_starts_with(header, prefix) &&
+		string_to_i64(string_skip(header, prefix.len), 10, &cache->started_at)) {
+		
+		text = string_skip(text, header_end + 1);
+		
+		u64 slot_count = 16;
+		while (slot_count < 2 * cast(u64) string_count_occurrences(text, '\n')) {
+			slot_count *= 2;
+		}
+		cache->slots     = push_array(arena, Hash_Cache_Entry, slot_count);
+		cache->slot_mask = slot_count - 1;
+		
+		while (cache->slots != NULL && text.len > 0) {
+			i64 line_end = string_find_first(text, '\n');
+			if (line_end < 0) break;
+			String line = string_stop(text, line_end);
+			text = string_skip(text, line_end + 1);
+			
+			// <hash> <size> <last modified> <path>
+			Hash_Cache_Entry entry = {0};
+			String fields[3] = {0};
+			bool ok = true;
+			for (i64 i = 0; ok && i < array_count(fields); i += 1) {
+				i64 space = string_find_first(line, ' ');
+				ok = space > 0;
+				fields[i] = string_stop(line, space);
+				line = string_skip(line, space + 1);
+			}
+			ok = ok && string_to_u64(fields[0], 16, &entry.hash) && string_to_u64(fields[1], 10, &entry.size) &&
+				string_to_i64(fields[2], 10, &entry.last_modified) && line.len > 0;
+			
+			if (ok) {
+				entry.path = line;
+				u64 i = hash_bytes(entry.path, 0) & cache->slot_mask;
+				while (cache->slots[i].path.data != NULL && !string_equals(cache->slots[i].path, entry.path)) {
+					i = (i + 1) & cache->slot_mask;
+				}
+				cache->slots[i] = entry;
+			}
+		}
+	}
+}
+
+static void
+_hash_files_task(void *param) {
+	Hash_Task *task = cast(Hash_Task *) param;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	Read_Files_Item *items      = push_array(scratch.arena, Read_Files_Item, task->count);
+	Hash_File      **to_read    = push_array(scratch.arena, Hash_File *, task->count);
+	i64              read_count = 0;
+	for (i64 i = 0; i < task->count; i += 1) {
+		Hash_File  *file  = &task->files[i];
+		Hash_Cache *cache = file->cache;
+		
+		File_Attributes attributes = {0};
+		if (items == NULL || to_read == NULL) {
+			file->error = File_Error_OTHER;
+		} else if (!file_attributes(file->path, &attributes)) {
+			file->error = last_file_error;
+		} else if (attributes.flags & File_Flag_IS_DIRECTORY) {
+			file->error = File_Error_IS_DIRECTORY;
+		} else {
+			file->size          = attributes.size;
+			file->last_modified = attributes.last_modified;
+			
+			Hash_Cache_Entry *entry = _hash_cache_find(cache, file->path);
+			if (entry != NULL && entry->size == file->size && entry->last_modified == file->last_modified &&
+				file->last_modified < cache->started_at) {
+				file->hash   = entry->hash;
+				file->cached = true;
+			} else {
+				items[read_count].file_name = file->path;
+				to_read[read_count] = file;
+				read_count += 1;
+			}
+		}
+	}
+	
+	read_files(scratch.arena, items, read_count, .map = true);
+	for (i64 i = 0; i < read_count; i += 1) {
+		if (items[i].result.ok) {
+			to_read[i]->hash = hash_bytes(string_from_sliceu8(items[i].result.contents), 0);
+			read_file_release(&items[i].result);
+		} else {
+			to_read[i]->error = items[i].error;
+		}
+	}
+	
+	scratch_end(scratch);
+}
+
+// Hands the files that were found since the last task to a new one.
+static void
+_hash_push_task(Hash_Run *run) {
+	Hash_Task *task = push_array(run->arena, Hash_Task, 1);
+	if (task != NULL) {
+		task->files = run->files + run->task_start;
+		task->count = run->file_count - run->task_start;
+		thread_pool_push(run->pool, &run->group, _hash_files_task, task);
+	} else {
+		for (i64 i = run->task_start; i < run->file_count; i += 1) {
+			run->files[i].error = File_Error_OTHER;
+		}
+	}
+	run->task_start = run->file_count;
+}
+
+// Waits for the files of the batch and prints them in the order they were found.
+static void
+_hash_flush(Hash_Run *run) {
+	if (run->task_start < run->file_count) {
+		_hash_push_task(run);
+	}
+	thread_pool_wait(run->pool, &run->group);
+	
+	for (i64 i = 0; i < run->file_count; i += 1) {
+		Hash_File *file = &run->files[i];
+		if (file->error != File_Error_NONE) {
+			file_writer_flush(&run->writer);
+			last_file_error = file->error;
+			_builtin_file_error("hash-files", file->path);
+			run->failed = true;
+		} else {
+			char line[128];
+			int  line_len = snprintf(line, sizeof(line), "%016llx  ", cast(unsigned long long) file->hash);
+			file_writer_append(&run->writer, string(cast(u8 *) line, line_len));
+			file_writer_append(&run->writer, file->path);
+			file_writer_append(&run->writer, string_from_lit("\n"));
+			
+			if (run->cache_writer.data != NULL && !string_contains(file->path, '\n')) {
+				line_len = snprintf(line, sizeof(line), "%016llx %llu %lld ", cast(unsigned long long) file->hash,
+									cast(unsigned long long) file->size, cast(long long) file->last_modified);
+				file_writer_append(&run->cache_writer, string(cast(u8 *) line, line_len));
+				file_writer_append(&run->cache_writer, file->path);
+				file_writer_append(&run->cache_writer, string_from_lit("\n"));
+			}
+		}
+	}
+	file_writer_flush(&run->writer);
+	
+	pop_to(run->arena, run->files_end);
+	run->file_count = 0;
+	run->task_start = 0;
+}
+
+static void
+_hash_add_file(void *data, String path) {
+	Hash_Run *run = cast(Hash_Run *) data;
+	
+	if (run->file_count == BUILTIN_BATCH_SIZE) {
+		_hash_flush(run);
+	}
+	
+	Hash_File *file = &run->files[run->file_count];
+	memset(file, 0, sizeof(*file));
+	file->cache = run->cache;
+	file->path  = string_clone(run->arena, path);
+	
+	if (file->path.data != NULL) {
+		run->file_count += 1;
+		if (run->file_count - run->task_start == BUILTIN_READ_BATCH_SIZE) {
+			_hash_push_task(run);
+		}
+	} else {
+		last_file_error = File_Error_OTHER;
+		_builtin_file_error("hash-files", path);
+		run->failed = true;
+	}
+}
+
+//- hash-files functions
+
+static i32
+builtin_hash_files(Builtins *builtins, String *argv, i64 argc) {
+	bool   recursive  = false;
+	String cache_name = {0};
+	
+	i64  arg_index = 0;
+	bool usage_ok  = true;
+	for (; arg_index < argc; arg_index += 1) {
+		String arg = argv[arg_index];
+		if (string_equals(arg, string_from_lit("--"))) {
+			arg_index += 1;
+			break;
+		}
+		if (arg.len < 2 || arg.data[0] != '-') break;
+		
+		bool takes_cache_name = false;
+		for (i64 i = 1; i < arg.len; i += 1) {
+			switch (arg.data[i]) {
+				case 'r': recursive = true; break;
+				case 'c': takes_cache_name = true; break;
+				default: {
+					fprintf(stderr, "hash-files: unknown option '-%c'\n", arg.data[i]);
+					usage_ok = false;
+				} break;
+			}
+		}
+		if (takes_cache_name) {
+			if (arg_index + 1 < argc) {
+				arg_index += 1;
+				cache_name = argv[arg_index];
+			} else {
+				usage_ok = false;
+			}
+		}
+	}
+	
+	if (arg_index >= argc) {
+		usage_ok = false;
+	}
+	
+	i32 result = 1;
+	if (usage_ok) {
+		String *paths      = argv + arg_index;
+		i64     path_count = argc - arg_index;
+		i64     started_at = cast(i64) time(NULL);
+		
+		Scratch scratch = scratch_begin(0, 0);
+		Scratch cache_scratch = scratch_begin(&scratch.arena, 1);
+		
+		Hash_Cache cache = {0};
+		File_Handle cache_file = {0};
+		String cache_temp_name = {0};
+		if (cache_name.len > 0) {
+			_hash_cache_load(cache_scratch.arena, &cache, cache_name);
+			
+			// Written next to the old one and renamed over it at the end, so that it's never
+			// seen half written.
+			String temp[] = {cache_name, string_from_lit(".tmp")};
+			cache_temp_name = strings_concat(cache_scratch.arena, temp, array_count(temp));
+			cache_file = file_open(cache_temp_name, File_Open_WRITE|File_Open_CREATE|File_Open_TRUNCATE);
+			if (cache_file.value == 0) {
+				_builtin_file_error("hash-files", cache_temp_name);
+			}
+		}
+		
+		Hash_Run run = {0};
+		run.pool  = _builtins_pool(builtins);
+		run.cache = &cache;
+		run.arena = scratch.arena;
+		file_writer_init(&run.writer, file_standard_output(), push_sliceu8(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE));
+		if (cache_file.value != 0) {
+			file_writer_init(&run.cache_writer, cache_file, push_sliceu8(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE));
+			String header = push_stringf(scratch.arena, HASH_CACHE_HEADER "%lld\n", cast(long long) started_at);
+			file_writer_append(&run.cache_writer, header);
+		}
+		run.files     = push_array(scratch.arena, Hash_File, BUILTIN_BATCH_SIZE);
+		run.files_end = scratch.arena->pos;
+		
+		Builtin_Walk walk = {_hash_add_file, NULL, &run, false};
+		
+		if (run.files == NULL || run.writer.data == NULL || (cache_file.value != 0 && run.cache_writer.data == NULL)) {
+			fprintf(stderr, "hash-files: %.*s\n", string_expand(last_alloc_error_string()));
+			run.failed = true;
+		} else {
+			for (i64 i = 0; i < path_count; i += 1) {
+				File_Attributes attributes = {0};
+				if (recursive && file_attributes(paths[i], &attributes) && (attributes.flags & File_Flag_IS_DIRECTORY)) {
+					if (!_builtin_walk("hash-files", run.arena, paths[i], &walk)) {
+						run.failed = true;
+					}
+				} else {
+					_hash_add_file(&run, paths[i]);
+				}
+			}
+		}
+		
+		_hash_flush(&run);
+		
+		if (cache_file.value != 0) {
+			bool written = run.cache_writer.data != NULL && file_writer_flush(&run.cache_writer);
+			file_close(cache_file);
+			if (!written || !file_rename(cache_temp_name, cache_name)) {
+				_builtin_file_error("hash-files", cache_name);
+				run.failed = true;
+			}
+		}
+		
+		scratch_end(cache_scratch);
+		scratch_end(scratch);
+		
+		result = run.failed ? 1 : 0;
+	} else {
+		fprintf(stderr, "Usage: hash-files [-r] [-c cache file] path...\n");
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ cp and mv
+
+//- cp and mv types
+
+typedef struct Copy_File Copy_File;
+struct Copy_File {
+	String     from;
+	String     to;
+	bool       move;    // Delete the source once it's copied, to move it to another volume.
+	File_Error error;
+	bool       deleted; // The error happened while deleting the source.
+};
+
+typedef struct Copy_Run Copy_Run;
+struct Copy_Run {
+	char        *command;
+	Thread_Pool *pool;
+	bool         move;
+	
+	// The directory being copied: whatever is found under from_root goes to the same place
+	// under to_root.
+	String       from_root;
+	String       to_root;
+	
+	Arena       *arena;     // Holds the files of the batch, after files_end.
+	u64          files_end;
+	Copy_File   *files;
+	i64          file_count;
+	Task_Group   group;
+	bool         failed;
+};
+
+//- cp and mv helpers
+
+// Without separators at the end, so that path_base() finds the name.
+static String
+_copy_trim_path(String path) {
+	while (path.len > 1 && is_separator(path.data[path.len - 1])) {
+		path.len -= 1;
+	}
+	return path;
+}
+
+static void
+_copy_error(Copy_Run *run, String from, String to) {
+	fprintf(stderr, "%s: %.*s -> %.*s: %.*s\n", run->command, string_expand(from), string_expand(to),
+			string_expand(last_file_error_string()));
+	run->failed = true;
+}
+
+static void
+_copy_file_task(void *param) {
+	Copy_File *file = cast(Copy_File *) param;
+	if (!file_copy(file->from, file->to)) {
+		file->error = last_file_error;
+	} else if (file->move && !file_delete(file->from)) {
+		file->error   = last_file_error;
+		file->deleted = true;
+	}
+}
+
+// Waits for the files of the batch and prints their errors in the order the files were found.
+static void
+_copy_flush(Copy_Run *run) {
+	thread_pool_wait(run->pool, &run->group);
+	
+	for (i64 i = 0; i < run->file_count; i += 1) {
+		Copy_File *file = &run->files[i];
+		if (file->error != File_Error_NONE) {
+			last_file_error = file->error;
+			if (file->deleted) {
+				_builtin_file_error(run->command, file->from);
+				run->failed = true;
+			} else {
+				_copy_error(run, file->from, file->to);
+			}
+		}
+	}
+	
+	pop_to(run->arena, run->files_end);
+	run->file_count = 0;
+}
+
+static void
+_copy_push(Copy_Run *run, String from, String to) {
+	if (run->file_count == BUILTIN_BATCH_SIZE) {
+		_copy_flush(run);
+	}
+	
+	Copy_File *file = &run->files[run->file_count];
+	memset(file, 0, sizeof(*file));
+	file->from = string_clone(run->arena, from);
+	file->to   = string_clone(run->arena, to);
+	file->move = run->move;
+	
+	if (file->from.data != NULL && file->to.data != NULL) {
+		run->file_count += 1;
+		thread_pool_push(run->pool, &run->group, _copy_file_task, file);
+	} else {
+		last_file_error = File_Error_OTHER;
+		_copy_error(run, from, to);
+	}
+}
+
+// Where a path found under from_root goes.
+static String
+_copy_destination(Arena *arena, Copy_Run *run, String path) {
+	String relative = string_skip(path, run->from_root.len);
+	while (relative.len > 0 && is_separator(relative.data[0])) {
+		relative = string_skip(relative, 1);
+	}
+	return _builtin_path_join(arena, run->to_root, relative);
+}
+
+static void
+_copy_add_file(void *data, String path) {
+	Copy_Run *run = cast(Copy_Run *) data;
+	
+	Scratch scratch = scratch_begin(&run->arena, 1);
+	_copy_push(run, path, _copy_destination(scratch.arena, run, path));
+	scratch_end(scratch);
+}
+
+// Directories are made as they're found, before any of the files in them are handed to the
+// workers. One that's already there is merged into.
+static bool
+_copy_make_directory(Copy_Run *run, String from, String to) {
+	bool ok = directory_create(to);
+	if (!ok && last_file_error == File_Error_EXISTS) {
+		File_Attributes attributes = {0};
+		ok = file_attributes(to, &attributes) && (attributes.flags & File_Flag_IS_DIRECTORY);
+		if (!ok) {
+			last_file_error = File_Error_EXISTS;
+		}
+	}
+	if (!ok) {
+		_copy_error(run, from, to);
+	}
+	return ok;
+}
+
+static bool
+_copy_add_directory(void *data, String path) {
+	Copy_Run *run = cast(Copy_Run *) data;
+	
+	Scratch scratch = scratch_begin(&run->arena, 1);
+	bool ok = _copy_make_directory(run, path, _copy_destination(scratch.arena, run, path));
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static void
+_copy_path(Copy_Run *run, String from, String to, bool recursive) {
+	File_Attributes attributes = {0};
+	if (!file_attributes(from, &attributes)) {
+		_builtin_file_error(run->command, from);
+		run->failed = true;
+	} else if (!(attributes.flags & File_Flag_IS_DIRECTORY)) {
+		_copy_push(run, from, to);
+	} else if (!recursive) {
+		fprintf(stderr, "%s: %.*s: is a directory; use -r to copy it\n", run->command, string_expand(from));
+		run->failed = true;
+	} else if (string_starts_with(to, from) && (to.len == from.len || is_separator(to.data[from.len]))) {
+		fprintf(stderr, "%s: %.*s: cannot copy a directory into itself\n", run->command, string_expand(from));
+		run->failed = true;
+	} else if (_copy_make_directory(run, from, to)) {
+		run->from_root = from;
+		run->to_root   = to;
+		
+		Builtin_Walk walk = {_copy_add_file, _copy_add_directory, run, true};
+		if (!_builtin_walk(run->command, run->arena, from, &walk)) {
+			run->failed = true;
+		}
+	}
+}
+
+// Deletes the directories left under a moved directory, deepest first. Anything else still in
+// them makes the deletion fail, which is printed.
+static bool
+_copy_delete_directories(Copy_Run *run, String dir) {
+	bool ok = true;
+	
+	Scratch scratch = scratch_begin(&run->arena, 1);
+	File_Iterator *iterator = file_iterator_begin(scratch.arena, dir, .names_only = true);
+	File_Info info = {0};
+	while (file_iterator_next(scratch.arena, iterator, &info)) {
+		if ((info.attributes.flags & File_Flag_IS_DIRECTORY) && !(info.attributes.flags & File_Flag_IS_SYMLINK)) {
+			ok = _copy_delete_directories(run, _builtin_path_join(scratch.arena, dir, info.name)) && ok;
+		}
+	}
+	file_iterator_end(iterator);
+	scratch_end(scratch);
+	
+	if (ok && !directory_delete(dir)) {
+		_builtin_file_error(run->command, dir);
+		ok = false;
+	}
+	return ok;
+}
+
+static i32
+_copy_main(Builtins *builtins, char *command, String *argv, i64 argc, bool move) {
+	bool recursive = false;
+	
+	i64  arg_index = 0;
+	bool usage_ok  = true;
+	for (; arg_index < argc; arg_index += 1) {
+		String arg = argv[arg_index];
+		if (string_equals(arg, string_from_lit("--"))) {
+			arg_index += 1;
+			break;
+		}
+		if (arg.len < 2 || arg.data[0] != '-') break;
+		
+		for (i64 i = 1; i < arg.len; i += 1) {
+			if (!move && (arg.data[i] == 'r' || arg.data[i] == 'R')) {
+				recursive = true;
+			} else {
+				fprintf(stderr, "%s: unknown option '-%c'\n", command, arg.data[i]);
+				usage_ok = false;
+			}
+		}
+	}
+	
+	if (argc - arg_index < 2) {
+		usage_ok = false;
+	}
+	
+	i32 result = 1;
+	if (usage_ok) {
+		String *sources      = argv + arg_index;
+		i64     source_count = argc - arg_index - 1;
+		String  destination  = argv[argc - 1];
+		
+		File_Attributes attributes = {0};
+		bool into_directory = file_attributes(destination, &attributes) && (attributes.flags & File_Flag_IS_DIRECTORY);
+		
+		Scratch scratch = scratch_begin(0, 0);
+		
+		Copy_Run run = {0};
+		run.command   = command;
+		run.pool      = _builtins_pool(builtins);
+		run.move      = move;
+		run.arena     = scratch.arena;
+		run.files     = push_array(scratch.arena, Copy_File, BUILTIN_BATCH_SIZE);
+		run.files_end = scratch.arena->pos;
+		
+		if (run.files == NULL) {
+			fprintf(stderr, "%s: %.*s\n", command, string_expand(last_alloc_error_string()));
+			run.failed = true;
+		} else if (source_count > 1 && !into_directory) {
+			fprintf(stderr, "%s: %.*s: is not a directory\n", command, string_expand(destination));
+			run.failed = true;
+		} else {
+			for (i64 i = 0; i < source_count; i += 1) {
+				Scratch temp = scratch_begin(&scratch.arena, 1);
+				
+				String from = _copy_trim_path(sources[i]);
+				String to   = into_directory ? _builtin_path_join(temp.arena, destination, path_base(from)) : destination;
+				
+				if (!move) {
+					_copy_path(&run, from, to, recursive);
+				} else if (!file_rename(from, to)) {
+					if (last_file_error == File_Error_NOT_SAME_VOLUME) {
+						// Copied and then deleted, file by file, and the directories once they
+						// are empty. Nothing is deleted from a directory that can't be copied.
+						bool failed = run.failed;
+						run.failed = false;
+						
+						bool is_directory = file_attributes(from, &attributes) && (attributes.flags & File_Flag_IS_DIRECTORY);
+						_copy_path(&run, from, to, true);
+						_copy_flush(&run);
+						if (!run.failed && is_directory && !_copy_delete_directories(&run, from)) {
+							run.failed = true;
+						}
+						
+						run.failed = run.failed || failed;
+					} else {
+						_copy_error(&run, from, to);
+					}
+				}
+				
+				scratch_end(temp);
+			}
+		}
+		
+		_copy_flush(&run);
+		
+		scratch_end(scratch);
+		
+		result = run.failed ? 1 : 0;
+	} else if (move) {
+		fprintf(stderr, "Usage: mv source... destination\n");
+	} else {
+		fprintf(stderr, "Usage: cp [-r] source... destination\n");
+	}
+	
+	return result;
+}
+
+//- cp and mv functions
+
+static i32
+builtin_cp(Builtins *builtins, String *argv, i64 argc) {
+	return _copy_main(builtins, "cp", argv, argc, false);
+}
+
+static i32
+builtin_mv(Builtins *builtins, String *argv, i64 argc) {
+	return _copy_main(builtins, "mv", argv, argc, true);
+}
+
+////////////////////////////////
+//~ time and accounting
+
+//- time and accounting helpers
+
+static void
+_usage_add(Process_Usage *total, Process_Usage usage) {
+	total->wall_us      += usage.wall_us;
+	total->user_us      += usage.user_us;
+	total->system_us    += usage.system_us;
+	total->max_rss_kb    = max(total->max_rss_kb, usage.max_rss_kb);
+	total->minor_faults += usage.minor_faults;
+	total->major_faults += usage.major_faults;
+}
+
+static int
+_usage_compare_wall(const void *a, const void *b) {
+	u64 x = (*cast(Command_Usage **) a)->total.wall_us;
+	u64 y = (*cast(Command_Usage **) b)->total.wall_us;
+	return (x < y) - (x > y);
+}
+
+static void
+_usage_print_row(FILE *file, String name, i64 count, Process_Usage usage) {
+	fprintf(file, "%-20.*s %6lld %10.3f %10.3f %10.3f %10.1f %10llu %8llu\n", string_expand(name), cast(long long) count,
+			cast(double) usage.wall_us / 1e6, cast(double) usage.user_us / 1e6, cast(double) usage.system_us / 1e6,
+			cast(double) usage.max_rss_kb / 1024.0, cast(unsigned long long) usage.minor_faults,
+			cast(unsigned long long) usage.major_faults);
+}
+
+//- time and accounting functions
+
+static void
+builtins_account(Builtins *builtins, String command, Process_Usage usage) {
+	if (builtins->accounting) {
+		if (builtins->accounting_arena.ptr == NULL) {
+			arena_init(&builtins->accounting_arena);
+		}
+		
+		// By the name of the program rather than the path it was run by.
+		String name = path_base(command);
+		
+		Command_Usage *account = builtins->first_usage;
+		while (account != NULL && !string_equals(account->name, name)) {
+			account = account->next;
+		}
+		if (account == NULL && builtins->accounting_arena.ptr != NULL) {
+			account = push_type(&builtins->accounting_arena, Command_Usage);
+			if (account != NULL) {
+				account->name = string_clone(&builtins->accounting_arena, name);
+				queue_push(builtins->first_usage, builtins->last_usage, account);
+			}
+		}
+		
+		if (account != NULL) {
+			account->count += 1;
+			_usage_add(&account->total, usage);
+		}
+	}
+}
+
+static void
+builtins_print_accounting(Builtins *builtins, FILE *file) {
+	Scratch scratch = scratch_begin(0, 0);
+	
+	i64 count = 0;
+	for (Command_Usage *account = builtins->first_usage; account != NULL; account = account->next) {
+		count += 1;
+	}
+	
+	Command_Usage **sorted = push_array(scratch.arena, Command_Usage *, count);
+	if (sorted != NULL) {
+		i64 i = 0;
+		for (Command_Usage *account = builtins->first_usage; account != NULL; account = account->next) {
+			sorted[i] = account;
+			i += 1;
+		}
+		qsort(sorted, count, sizeof(Command_Usage *), _usage_compare_wall);
+		
+		fprintf(file, "%-20s %6s %10s %10s %10s %10s %10s %8s\n", "command", "runs", "wall (s)", "user (s)", "sys (s)",
+				"rss (MB)", "minflt", "majflt");
+		
+		i64 total_count = 0;
+		Process_Usage total = {0};
+		for (i = 0; i < count; i += 1) {
+			_usage_print_row(file, sorted[i]->name, sorted[i]->count, sorted[i]->total);
+			total_count += sorted[i]->count;
+			_usage_add(&total, sorted[i]->total);
+		}
+		_usage_print_row(file, string_from_lit("total"), total_count, total);
+	}
+	
+	scratch_end(scratch);
+}
+
+static Process_Usage
+builtin_time_begin(void) {
+	Process_Usage begin = process_usage_self();
+	begin.wall_us = time_now_us();
+	return begin;
+}
+
+static void
+builtin_time_end(Process_Usage begin, bool ran_process) {
+	Process_Usage self = process_usage_self();
+	
+	Process_Usage usage = {0};
+	usage.wall_us      = time_now_us() - begin.wall_us;
+	usage.user_us      = self.user_us - begin.user_us;
+	usage.system_us    = self.system_us - begin.system_us;
+	usage.max_rss_kb   = self.max_rss_kb;
+	usage.minor_faults = self.minor_faults - begin.minor_faults;
+	usage.major_faults = self.major_faults - begin.major_faults;
+	
+	// What the shell did to start and wait for the process is counted too, like in other shells.
+	if (ran_process) {
+		u64 wall_us = usage.wall_us;
+		_usage_add(&usage, last_process_usage);
+		usage.wall_us    = wall_us;
+		usage.max_rss_kb = last_process_usage.max_rss_kb;
+	}
+	
+	fprintf(stderr, "\nreal\t%.3fs\nuser\t%.3fs\nsys\t%.3fs\nrss\t%.1f MB\nfaults\t%llu minor, %llu major\n",
+			cast(double) usage.wall_us / 1e6, cast(double) usage.user_us / 1e6, cast(double) usage.system_us / 1e6,
+			cast(double) usage.max_rss_kb / 1024.0, cast(unsigned long long) usage.minor_faults,
+			cast(unsigned long long) usage.major_faults);
+}
+
+static i32
+builtin_accounting(Builtins *builtins, String *argv, i64 argc) {
+	i32 result = 0;
+	if (argc == 0) {
+		builtins_print_accounting(builtins, stdout);
+	} else if (argc == 1 && string_equals(argv[0], string_from_lit("on"))) {
+		builtins->accounting = true;
+	} else if (argc == 1 && string_equals(argv[0], string_from_lit("off"))) {
+		builtins->accounting = false;
+	} else if (argc == 1 && string_equals(argv[0], string_from_lit("reset"))) {
+		builtins->first_usage = NULL;
+		builtins->last_usage  = NULL;
+		if (builtins->accounting_arena.ptr != NULL) {
+			arena_reset(&builtins->accounting_arena);
+		}
+	} else {
+		fprintf(stderr, "Usage: accounting [on|off|reset]\n");
+		result = 1;
+	}
+	return result;
+}
+
+////////////////////////////////
+//~ test
+
+//- test helpers
+
+// 0 if the test is true, 1 if it is false, 2 if it can't be evaluated.
+static i32
+_test_unary(String op, String operand) {
+	i32 result = 2;
+	
+	if (string_equals(op, string_from_lit("-n"))) {
+		result = operand.len > 0 ? 0 : 1;
+	} else if (string_equals(op, string_from_lit("-z"))) {
+		result = operand.len == 0 ? 0 : 1;
+	} else if (op.len == 2 && op.data[0] == '-' && string_contains(string_from_lit("efds"), op.data[1])) {
+		File_Attributes attributes = {0};
+		bool exists       = file_attributes(operand, &attributes);
+		bool is_directory = attributes.flags & File_Flag_IS_DIRECTORY;
+		switch (op.data[1]) {
+			case 'e': result = exists ? 0 : 1; break;
+			case 'f': result = exists && !is_directory ? 0 : 1; break;
+			case 'd': result = exists && is_directory ? 0 : 1; break;
+			case 's': result = exists && attributes.size > 0 ? 0 : 1; break;
+		}
+	} else {
+		fprintf(stderr, "test: unknown operator '%.*s'\n", string_expand(op));
+	}
+	
+	return result;
+}
+
+read_only static String test_integer_ops[] = {
+	string_from_lit_const("-eq"), string_from_lit_const("-ne"), string_from_lit_const("-lt"),
+	string_from_lit_const("-le"), string_from_lit_const("-gt"), string_from_lit_const("-ge"),
+};
+
+static i32
+_test_binary(String left, String op, String right) {
+	i32 result = 2;
+	
+	if (string_equals(op, string_from_lit("=")) || string_equals(op, string_from_lit("=="))) {
+		result = string_equals(left, right) ? 0 : 1;
+	} else if (string_equals(op, string_from_lit("!="))) {
+		result = string_equals(left, right) ? 1 : 0;
+	} else {
+		i64 index = -1;
+		for (i64 i = 0; i < array_count(test_integer_ops); i += 1) {
+			if (string_equals(op, test_integer_ops[i])) index = i;
+		}
+		
+		i64 a = 0;
+		i64 b = 0;
+		if (index < 0) {
+			fprintf(stderr, "test: unknown operator '%.*s'\n", string_expand(op));
+		} else if (!string_to_i64(string_skip_chop_whitespace(left), 10, &a) ||
+				   !string_to_i64(string_skip_chop_whitespace(right), 10, &b)) {
+			fprintf(stderr, "test: '%.*s' needs numbers\n", string_expand(op));
+		} else {
+			bool holds = false;
+			switch (index) {
+				case 0: holds = a == b; break;
+				case 1: holds = a != b; break;
+				case 2: holds = a <  b; break;
+				case 3: holds = a <= b; break;
+				case 4: holds = a >  b; break;
+				case 5: holds = a >= b; break;
+			}
+			result = holds ? 0 : 1;
+		}
+	}
+	
+	return result;
+}
+
+//- test functions
+
+static i32
+builtin_test(String *argv, i64 argc, bool bracket) {
+	i32 result = 2;
+	
+	if (bracket && (argc == 0 || !string_equals(argv[argc - 1], string_from_lit("]")))) {
+		fprintf(stderr, "[: missing ']'\n");
+	} else {
+		if (bracket) argc -= 1;
+		
+		// A leading '!' negates the rest, whose meaning depends on how many arguments it has,
+		// like in POSIX.
+		bool negate = argc > 1 && string_equals(argv[0], string_from_lit("!"));
+		if (negate) {
+			argv += 1;
+			argc -= 1;
+		}
+		
+		switch (argc) {
+			case 0: result = 1; break;
+			case 1: result = argv[0].len > 0 ? 0 : 1; break;
+			case 2: result = _test_unary(argv[0], argv[1]); break;
+			case 3: result = _test_binary(argv[0], argv[1], argv[2]); break;
+			default: {
+				fprintf(stderr, "test: too many arguments\n");
+			} break;
+		}
+		
+		if (negate && result != 2) {
+			result = !result;
+		}
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ basename and dirname
+
+//- basename and dirname helpers
+
+// Without the separators at the end, unless there is nothing but separators.
+static String
+_builtin_chop_separators(String path) {
+	while (path.len > 1 && is_separator(path.data[path.len - 1])) {
+		path.len -= 1;
+	}
+	return path;
+}
+
+//- basename and dirname functions
+
+static i32
+builtin_basename(String *argv, i64 argc) {
+	i32 result = 0;
+	
+	if (argc < 1 || argc > 2) {
+		fprintf(stderr, "basename: expected a path and an optional suffix\n");
+		result = 1;
+	} else {
+		String path = _builtin_chop_separators(argv[0]);
+		String base = path.len == 1 && is_separator(path.data[0]) ? path : path_base(path);
+		if (argc == 2 && argv[1].len < base.len && string_ends_with(base, argv[1])) {
+			base = string_chop(base, argv[1].len);
+		}
+		printf("%.*s\n", string_expand(base));
+	}
+	
+	return result;
+}
+
+static i32
+builtin_dirname(String *argv, i64 argc) {
+	i32 result = 0;
+	
+	if (argc < 1) {
+		fprintf(stderr, "dirname: expected a path\n");
+		result = 1;
+	}
+	
+	for (i64 i = 0; i < argc; i += 1) {
+		String path      = _builtin_chop_separators(argv[i]);
+		i64    separator = path_last_separator(path);
+		String dir       = separator < 0 ? string_from_lit(".") : _builtin_chop_separators(string_stop(path, separator));
+		printf("%.*s\n", string_expand(dir));
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ expr
+
+//- expr types
+
+// Arguments are read from left to right by recursive descent; every value is a string, and
+// the ones that look like integers are integers.
+typedef struct Expr_Parser Expr_Parser;
+struct Expr_Parser {
+	Arena  *arena;
+	String *argv;
+	i64     argc;
+	i64     at;
+	bool    failed;
+};
+
+//- expr helpers
+
+static String _expr_parse_or(Expr_Parser *p);
+
+static void
+_expr_fail(Expr_Parser *p, char *message) {
+	if (!p->failed) {
+		fprintf(stderr, "expr: %s\n", message);
+		p->failed = true;
+	}
+}
+
+static bool
+_expr_next_is(Expr_Parser *p, char *op) {
+	return p->at < p->argc && string_equals(p->argv[p->at], string_from_cstring(op));
+}
+
+static String
+_expr_take(Expr_Parser *p) {
+	String result = {0};
+	if (p->at < p->argc) {
+		result = p->argv[p->at];
+		p->at += 1;
+	} else {
+		_expr_fail(p, "missing argument");
+	}
+	return result;
+}
+
+static String
+_expr_number(Expr_Parser *p, i64 value) {
+	return push_stringf(p->arena, "%lld", cast(long long) value);
+}
+
+static bool
+_expr_is_null(String value) {
+	return value.len == 0 || string_equals(value, string_from_lit("0"));
+}
+
+// The length of the regular expression atom at re[at]: a byte, a '.', a bracket expression or
+// an escaped byte.
+static i64
+_expr_atom_len(String re, i64 at) {
+	i64 result = 1;
+	
+	if (re.data[at] == '\\' && at + 1 < re.len) {
+		result = 2;
+	} else if (re.data[at] == '[') {
+		i64 i = at + 1;
+		if (i < re.len && re.data[i] == '^') i += 1;
+		if (i < re.len && re.data[i] == ']') i += 1;
+		while (i < re.len && re.data[i] != ']') {
+			// Classes like [:digit:] have a ']' of their own.
+			if (re.data[i] == '[' && i + 1 < re.len && re.data[i + 1] == ':') {
+				i64 close = string_find_first(string_skip(re, i + 2), ']');
+				i += close >= 0 ? close + 3 : 1;
+			} else {
+				i += 1;
+			}
+		}
+		result = i < re.len ? i - at + 1 : 1;
+	}
+	
+	return result;
+}
+
+read_only static struct { String name; int (*proc)(int); } expr_classes[] = {
+	{string_from_lit_const("alnum"), isalnum}, {string_from_lit_const("alpha"), isalpha},
+	{string_from_lit_const("digit"), isdigit}, {string_from_lit_const("lower"), islower},
+	{string_from_lit_const("upper"), isupper}, {string_from_lit_const("space"), isspace},
+	{string_from_lit_const("punct"), ispunct}, {string_from_lit_const("xdigit"), isxdigit},
+};
+
+static bool
+_expr_bracket_matches(String bracket, u8 c) {
+	// Without the brackets.
+	String items  = string(bracket.data + 1, bracket.len - 2);
+	bool   negate = items.len > 0 && items.data[0] == '^';
+	if (negate) items = string_skip(items, 1);
+	
+	bool found = false;
+	for (i64 i = 0; i < items.len && !found; i += 1) {
+		u8 first = items.data[i];
+		if (first == '[' && i + 1 < items.len && items.data[i + 1] == ':') {
+			i64    close = string_find_first(string_skip(items, i + 2), ':');
+			String name  = string(items.data + i + 2, max(0, close));
+			for (i64 j = 0; j < array_count(expr_classes); j += 1) {
+				if (string_equals(name, expr_classes[j].name)) found = expr_classes[j].proc(c) != 0;
+			}
+			i += close >= 0 ? close + 3 : 1;
+		} else if (i + 2 < items.len && items.data[i + 1] == '-') {
+			found = c >= first && c <= items.data[i + 2];
+			i += 2;
+		} else {
+			found = c == first;
+		}
+	}
+	
+	return found != negate;
+}
+
+static bool
+_expr_atom_matches(String re, i64 at, i64 len, u8 c) {
+	bool result = false;
+	if (len == 2) {
+		result = c == re.data[at + 1];
+	} else if (re.data[at] == '[' && len > 1) {
+		result = _expr_bracket_matches(string(re.data + at, len), c);
+	} else {
+		result = re.data[at] == '.' || c == re.data[at];
+	}
+	return result;
+}
+
+// A backtracking matcher for the basic regular expressions that expr is used with: atoms with
+// an optional '*', one \(group\), and a '$' at the end. Returns where the match of re[ri...]
+// at s[si...] ends, or -1.
+static i64
+_expr_match_here(String re, i64 ri, String s, i64 si, i64 *group) {
+	i64 result = -1;
+	
+	if (ri == re.len) {
+		result = si;
+	} else if (re.data[ri] == '$' && ri + 1 == re.len) {
+		result = si == s.len ? si : -1;
+	} else if (re.data[ri] == '\\' && ri + 1 < re.len && (re.data[ri + 1] == '(' || re.data[ri + 1] == ')')) {
+		// Every match goes through both ends of the group, so the last match sets both.
+		group[re.data[ri + 1] == ')'] = si;
+		result = _expr_match_here(re, ri + 2, s, si, group);
+	} else {
+		i64 len = _expr_atom_len(re, ri);
+		if (ri + len < re.len && re.data[ri + len] == '*') {
+			i64 count = 0;
+			while (si + count < s.len && _expr_atom_matches(re, ri, len, s.data[si + count])) {
+				count += 1;
+			}
+			for (; count >= 0 && result < 0; count -= 1) {
+				result = _expr_match_here(re, ri + len + 1, s, si + count, group);
+			}
+		} else if (si < s.len && _expr_atom_matches(re, ri, len, s.data[si])) {
+			result = _expr_match_here(re, ri + len, s, si + 1, group);
+		}
+	}
+	
+	return result;
+}
+
+// string : regex, which is anchored at the start. The text of the group if there is one,
+// otherwise how many bytes matched.
+static String
+_expr_match(Expr_Parser *p, String s, String re) {
+	if (re.len > 0 && re.data[0] == '^') re = string_skip(re, 1);
+	
+	i64 group[2] = {-1, -1};
+	i64 end = _expr_match_here(re, 0, s, 0, group);
+	
+	String result = {0};
+	if (string_find_substring(re, string_from_lit("\\(")) >= 0) {
+		result = end >= 0 && group[0] >= 0 && group[1] >= group[0] ? string(s.data + group[0], group[1] - group[0]) : string_from_lit("");
+	} else {
+		result = _expr_number(p, max(0, end));
+	}
+	return result;
+}
+
+static String
+_expr_parse_primary(Expr_Parser *p) {
+	String result = {0};
+	
+	if (_expr_next_is(p, "(")) {
+		p->at += 1;
+		result = _expr_parse_or(p);
+		if (!_expr_next_is(p, ")")) {
+			_expr_fail(p, "missing ')'");
+		}
+		p->at += 1;
+	} else if (_expr_next_is(p, "length") && p->at + 1 < p->argc) {
+		p->at += 1;
+		result = _expr_number(p, _expr_take(p).len);
+	} else if (_expr_next_is(p, "match") && p->at + 2 < p->argc) {
+		p->at += 1;
+		String s  = _expr_take(p);
+		String re = _expr_take(p);
+		result = _expr_match(p, s, re);
+	} else if (_expr_next_is(p, "index") && p->at + 2 < p->argc) {
+		// The position of the first byte of s that is in the set, from 1, or 0.
+		p->at += 1;
+		String s   = _expr_take(p);
+		String set = _expr_take(p);
+		i64 position = 0;
+		for (i64 i = 0; i < s.len && position == 0; i += 1) {
+			if (string_contains(set, s.data[i])) position = i + 1;
+		}
+		result = _expr_number(p, position);
+	} else if (_expr_next_is(p, "substr") && p->at + 3 < p->argc) {
+		p->at += 1;
+		String s        = _expr_take(p);
+		String position = _expr_take(p);
+		String length   = _expr_take(p);
+		i64 from  = 0;
+		i64 count = 0;
+		if (!string_to_i64(position, 10, &from) || !string_to_i64(length, 10, &count)) {
+			_expr_fail(p, "non-integer argument");
+		} else if (from < 1 || from > s.len || count <= 0) {
+			result = string_from_lit("");
+		} else {
+			result = string(s.data + from - 1, min(count, s.len - from + 1));
+		}
+	} else {
+		// A '+' in front makes the next argument a string, even if it is a keyword.
+		if (_expr_next_is(p, "+")) p->at += 1;
+		result = _expr_take(p);
+	}
+	
+	return result;
+}
+
+static String
+_expr_parse_match(Expr_Parser *p) {
+	String result = _expr_parse_primary(p);
+	while (!p->failed && _expr_next_is(p, ":")) {
+		p->at += 1;
+		result = _expr_match(p, result, _expr_parse_primary(p));
+	}
+	return result;
+}
+
+// Integer operators, from the least to the most tightly binding.
+read_only static char *expr_integer_ops[][3] = {
+	{"+", "-", NULL},
+	{"*", "/", "%"},
+};
+
+static String
+_expr_parse_integer(Expr_Parser *p, i64 level) {
+	String result = level < array_count(expr_integer_ops) ? _expr_parse_integer(p, level + 1) : _expr_parse_match(p);
+	
+	while (!p->failed && level < array_count(expr_integer_ops)) {
+		char *op = NULL;
+		for (i64 i = 0; i < 3 && expr_integer_ops[level][i] != NULL; i += 1) {
+			if (_expr_next_is(p, expr_integer_ops[level][i])) op = expr_integer_ops[level][i];
+		}
+		if (op == NULL) break;
+		p->at += 1;
+		
+		String right = _expr_parse_integer(p, level + 1);
+		i64 a = 0;
+		i64 b = 0;
+		if (p->failed) {
+			break;
+		} else if (!string_to_i64(result, 10, &a) || !string_to_i64(right, 10, &b)) {
+			_expr_fail(p, "non-integer argument");
+		} else if ((op[0] == '/' || op[0] == '%') && b == 0) {
+			_expr_fail(p, "division by zero");
+		} else {
+			// Wrap around on overflow, like arithmetic in scripts.
+			u64 x = cast(u64) a;
+			u64 y = cast(u64) b;
+			i64 value = 0;
+			switch (op[0]) {
+				case '+': value = cast(i64) (x + y); break;
+				case '-': value = cast(i64) (x - y); break;
+				case '*': value = cast(i64) (x * y); break;
+				case '/': value = b == -1 ? cast(i64) (0 - x) : a / b; break;
+				case '%': value = b == -1 ? 0 : a % b; break;
+			}
+			result = _expr_number(p, value);
+		}
+	}
+	
+	return result;
+}
+
+read_only static String expr_compare_ops[] = {
+	string_from_lit_const("="), string_from_lit_const("!="), string_from_lit_const("<"),
+	string_from_lit_const("<="), string_from_lit_const(">"), string_from_lit_const(">="),
+};
+
+static String
+_expr_parse_compare(Expr_Parser *p) {
+	String result = _expr_parse_integer(p, 0);
+	
+	while (!p->failed && p->at < p->argc) {
+		i64 op = -1;
+		for (i64 i = 0; i < array_count(expr_compare_ops); i += 1) {
+			if (string_equals(p->argv[p->at], expr_compare_ops[i])) op = i;
+		}
+		if (op < 0) break;
+		p->at += 1;
+		
+		// As integers if both are, otherwise as strings.
+		String right = _expr_parse_integer(p, 0);
+		i64 a = 0;
+		i64 b = 0;
+		i64 order = 0;
+		if (string_to_i64(result, 10, &a) && string_to_i64(right, 10, &b)) {
+			order = (a > b) - (a < b);
+		} else {
+			i64 common = min(result.len, right.len);
+			order = common > 0 ? memcmp(result.data, right.data, common) : 0;
+			if (order == 0) order = (result.len > right.len) - (result.len < right.len);
+		}
+		
+		bool holds = false;
+		switch (op) {
+			case 0: holds = order == 0; break;
+			case 1: holds = order != 0; break;
+			case 2: holds = order <  0; break;
+			case 3: holds = order <= 0; break;
+			case 4: holds = order >  0; break;
+			case 5: holds = order >= 0; break;
+		}
+		result = holds ? string_from_lit("1") : string_from_lit("0");
+	}
+	
+	return result;
+}
+
+static String
+_expr_parse_and(Expr_Parser *p) {
+	String result = _expr_parse_compare(p);
+	while (!p->failed && _expr_next_is(p, "&")) {
+		p->at += 1;
+		String right = _expr_parse_compare(p);
+		if (_expr_is_null(result) || _expr_is_null(right)) {
+			result = string_from_lit("0");
+		}
+	}
+	return result;
+}
+
+static String
+_expr_parse_or(Expr_Parser *p) {
+	String result = _expr_parse_and(p);
+	while (!p->failed && _expr_next_is(p, "|")) {
+		p->at += 1;
+		String right = _expr_parse_and(p);
+		if (_expr_is_null(result)) {
+			result = _expr_is_null(right) ? string_from_lit("0") : right;
+		}
+	}
+	return result;
+}
+
+//- expr functions
+
+static i32
+builtin_expr(String *argv, i64 argc) {
+	i32 result = 2;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	Expr_Parser parser = {scratch.arena, argv, argc, 0, false};
+	String value = _expr_parse_or(&parser);
+	if (!parser.failed && parser.at < argc) {
+		_expr_fail(&parser, "syntax error");
+	}
+	
+	if (!parser.failed) {
+		printf("%.*s\n", string_expand(value));
+		result = _expr_is_null(value) ? 1 : 0;
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+////////////////////////////////
+//~ wc
+
+//- wc types
+
+typedef struct Wc_Counts Wc_Counts;
+struct Wc_Counts {
+	i64  counts[3]; // Lines, words and bytes.
+	bool in_word;   // Where the last chunk ended.
+};
+
+//- wc helpers
+
+static void
+_wc_count(Wc_Counts *counts, String data) {
+	i64  lines   = 0;
+	i64  words   = 0;
+	bool in_word = counts->in_word;
+	for (i64 i = 0; i < data.len; i += 1) {
+		u8   c     = data.data[i];
+		bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+		lines  += c == '\n';
+		words  += !space && !in_word;
+		in_word = !space;
+	}
+	
+	counts->counts[0] += lines;
+	counts->counts[1] += words;
+	counts->counts[2] += data.len;
+	counts->in_word    = in_word;
+}
+
+static void
+_wc_print(Wc_Counts *counts, bool *show, i64 shown, String name) {
+	bool first = true;
+	for (i64 i = 0; i < 3; i += 1) {
+		if (show[i]) {
+			// A count alone isn't padded, so that it can be used as a number.
+			printf(shown > 1 ? "%s%7lld" : "%s%lld", first ? "" : " ", cast(long long) counts->counts[i]);
+			first = false;
+		}
+	}
+	if (name.len > 0) {
+		printf(" %.*s", string_expand(name));
+	}
+	printf("\n");
+}
+
+//- wc functions
+
+static i32
+builtin_wc(String *argv, i64 argc) {
+	i32 result = 0;
+	
+	bool show[3] = {0};
+	i64  first   = 0;
+	for (; first < argc && argv[first].len > 1 && argv[first].data[0] == '-'; first += 1) {
+		for (i64 j = 1; j < argv[first].len; j += 1) {
+			switch (argv[first].data[j]) {
+				case 'l': show[0] = true; break;
+				case 'w': show[1] = true; break;
+				case 'c':
+				case 'm': show[2] = true; break;
+				default: {
+					fprintf(stderr, "wc: unknown option '-%c'\n", argv[first].data[j]);
+					result = 2;
+				} break;
+			}
+		}
+	}
+	if (!show[0] && !show[1] && !show[2]) {
+		show[0] = show[1] = show[2] = true;
+	}
+	i64 shown = show[0] + show[1] + show[2];
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	if (result == 0 && first == argc) {
+		// Without files, the standard input.
+		Wc_Counts counts = {0};
+		u8 *buffer = push_nozero(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE);
+		for (size_t len = 0; buffer != NULL && (len = fread(buffer, 1, BUILTIN_OUTPUT_BUFFER_SIZE, stdin)) > 0;) {
+			_wc_count(&counts, string(buffer, len));
+		}
+		clearerr(stdin);
+		_wc_print(&counts, show, shown, string_from_lit(""));
+	} else if (result == 0) {
+		Wc_Counts total = {0};
+		for (i64 i = first; i < argc; i += 1) {
+			Arena_Restore_Point restore = arena_begin_temp_region(scratch.arena);
+			
+			Read_File_Result file = read_file(scratch.arena, argv[i]);
+			if (file.ok) {
+				Wc_Counts counts = {0};
+				_wc_count(&counts, string(file.contents.data, file.contents.len));
+				_wc_print(&counts, show, shown, argv[i]);
+				for (i64 j = 0; j < 3; j += 1) {
+					total.counts[j] += counts.counts[j];
+				}
+				read_file_release(&file);
+			} else {
+				_builtin_file_error("wc", argv[i]);
+				result = 1;
+			}
+			
+			arena_end_temp_region(restore);
+		}
+		
+		if (argc - first > 1) {
+			_wc_print(&total, show, shown, string_from_lit("total"));
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+////////////////////////////////
+//~ tr
+
+//- tr helpers
+
+// The bytes of a set, with ranges like a-z, classes like [:upper:] and escapes like \n written
+// out, in order. Returns how many there are, at most 256 since more are never needed.
+static i64
+_tr_expand_set(String set, u8 *out) {
+	i64 len = 0;
+	
+	for (i64 i = 0; i < set.len && len < 256; i += 1) {
+		u8 c = set.data[i];
+		
+		if (c == '[' && i + 1 < set.len && set.data[i + 1] == ':') {
+			i64 close = string_find_first(string_skip(set, i + 2), ':');
+			if (close >= 0) {
+				String name = string(set.data + i + 2, close);
+				for (i64 j = 0; j < array_count(expr_classes); j += 1) {
+					if (string_equals(name, expr_classes[j].name)) {
+						for (i32 b = 0; b < 256 && len < 256; b += 1) {
+							if (expr_classes[j].proc(b)) {
+								out[len] = cast(u8) b;
+								len += 1;
+							}
+						}
+					}
+				}
+				i += close + 3;
+				continue;
+			}
+		}
+		
+		if (c == '\\' && i + 1 < set.len) {
+			i += 1;
+			switch (set.data[i]) {
+				case 'n': c = '\n'; break;
+				case 't': c = '\t'; break;
+				case 'r': c = '\r'; break;
+				default:  c = set.data[i]; break;
+			}
+		}
+		
+		if (i + 2 < set.len && set.data[i + 1] == '-') {
+			u8 last = set.data[i + 2];
+			for (i32 b = c; b <= last && len < 256; b += 1) {
+				out[len] = cast(u8) b;
+				len += 1;
+			}
+			i += 2;
+		} else {
+			out[len] = c;
+			len += 1;
+		}
+	}
+	
+	return len;
+}
+
+//- tr functions
+
+static i32
+builtin_tr(String *argv, i64 argc) {
+	i32 result = 0;
+	
+	bool delete  = false;
+	bool squeeze = false;
+	i64  first   = 0;
+	for (; first < argc && argv[first].len > 1 && argv[first].data[0] == '-'; first += 1) {
+		for (i64 j = 1; j < argv[first].len; j += 1) {
+			if      (argv[first].data[j] == 'd') delete  = true;
+			else if (argv[first].data[j] == 's') squeeze = true;
+			else result = 2;
+		}
+	}
+	argv += first;
+	argc -= first;
+	
+	// What each byte becomes, or -1 if it is deleted, and which bytes are squeezed.
+	i32  map[256];
+	bool squeezed[256] = {0};
+	u8   set1[256];
+	u8   set2[256];
+	i64  len1 = argc > 0 ? _tr_expand_set(argv[0], set1) : 0;
+	i64  len2 = argc > 1 ? _tr_expand_set(argv[1], set2) : 0;
+	
+	i64 needed = delete ? (squeeze ? 2 : 1) : (squeeze ? 1 : 2);
+	if (result != 0 || argc < needed || argc > 2 || (!delete && argc == 2 && len2 == 0)) {
+		fprintf(stderr, "tr: expected [-d] [-s] set1 [set2]\n");
+		result = 2;
+	} else {
+		for (i32 i = 0; i < 256; i += 1) {
+			map[i] = i;
+		}
+		for (i64 i = 0; i < len1; i += 1) {
+			// set2 is as long as set1, repeating its last byte.
+			map[set1[i]] = delete ? -1 : argc == 2 ? set2[min(i, len2 - 1)] : set1[i];
+		}
+		
+		u8  *squeeze_set = delete || argc == 2 ? set2 : set1;
+		i64  squeeze_len = delete || argc == 2 ? len2 : len1;
+		for (i64 i = 0; squeeze && i < squeeze_len; i += 1) {
+			squeezed[squeeze_set[i]] = true;
+		}
+		
+		Scratch scratch = scratch_begin(0, 0);
+		u8 *in  = push_nozero(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE);
+		u8 *out = push_nozero(scratch.arena, BUILTIN_OUTPUT_BUFFER_SIZE);
+		i32 last = -1;
+		for (size_t len = 0; in != NULL && out != NULL && (len = fread(in, 1, BUILTIN_OUTPUT_BUFFER_SIZE, stdin)) > 0;) {
+			size_t out_len = 0;
+			for (size_t i = 0; i < len; i += 1) {
+				i32 c = map[in[i]];
+				if (c >= 0 && !(c == last && squeezed[c])) {
+					out[out_len] = cast(u8) c;
+					out_len += 1;
+					last = c;
+				}
+			}
+			fwrite(out, 1, out_len, stdout);
+		}
+		clearerr(stdin);
+		scratch_end(scratch);
+	}
+	
+	return result;
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef DUSH_BUILTINS_H
+#define DUSH_BUILTINS_H
+
+////////////////////////////////
+//~ Builtins
+
+// Commands that run inside the shell instead of in a process of their own. Each builtin takes
+// its arguments without the command name, prints its output and errors itself, and returns
+// the exit status.
+
+//- Builtin constants
+
+// How many files a builtin that works on many files hands to the workers before it waits for
+// them and prints what they found. Bounds the memory that results take, and keeps the output
+// in the order the files were found.
+#if !defined(BUILTIN_BATCH_SIZE)
+#define BUILTIN_BATCH_SIZE 1024
+#endif
+
+// How many files a task reads together with read_files(), out of the batch. Enough for the
+// system calls of reading them to be batched too, and few enough for the tasks to still be
+// spread over the workers.
+#if !defined(BUILTIN_READ_BATCH_SIZE)
+#define BUILTIN_READ_BATCH_SIZE 32
+#endif
+
+#if !defined(BUILTIN_OUTPUT_BUFFER_SIZE)
+#define BUILTIN_OUTPUT_BUFFER_SIZE kilobytes(64)
+#endif
+
+//- Builtin types
+
+// What a command name refers to. Scripts look the names of their commands up once, when they
+// are parsed, instead of comparing them with every builtin's each time the command runs.
+typedef u8 Builtin_Id;
+enum {
+	Builtin_NONE, // A function, a process or a script.
+	Builtin_ACCOUNTING,
+	Builtin_BASENAME,
+	Builtin_BRACKET, // [
+	Builtin_BREAK,
+	Builtin_CD,
+	Builtin_COLON,   // :
+	Builtin_CONTINUE,
+	Builtin_CP,
+	Builtin_DIRNAME,
+	Builtin_ECHO,
+	Builtin_EXIT,
+	Builtin_EXPORT,
+	Builtin_EXPR,
+	Builtin_FALSE,
+	Builtin_GREP,
+	Builtin_HASH_FILES,
+	Builtin_HELP,
+	Builtin_HISTORY,
+	Builtin_MV,
+	Builtin_PWD,
+	Builtin_RETURN,
+	Builtin_SET,
+	Builtin_TEST,
+	Builtin_TR,
+	Builtin_TRUE,
+	Builtin_UNSET,
+	Builtin_WAIT,
+	Builtin_WC,
+	Builtin_COUNT,
+};
+
+// What the processes run under one command name used, while accounting is on.
+typedef struct Command_Usage Command_Usage;
+struct Command_Usage {
+	Command_Usage *next;
+	String         name;
+	i64            count;
+	Process_Usage  total; // Except max_rss_kb, which is the largest of them.
+};
+
+// What builtins share between invocations. The worker threads are only started by the first
+// builtin that needs them.
+typedef struct Builtins Builtins;
+struct Builtins {
+	Thread_Pool pool;
+	bool        pool_started;
+	
+	// Each thread's own arena for results that must outlive a task, indexed by
+	// thread_pool_worker_index + 1 (so 0 is the thread that waits for the tasks).
+	Arena worker_arenas[THREAD_POOL_MAX_WORKERS + 1];
+	
+	// Per-command accounting, turned on by DUSH_ACCOUNTING or "accounting on".
+	bool           accounting;
+	Arena          accounting_arena;
+	Command_Usage *first_usage;
+	Command_Usage *last_usage;
+};
+
+//- Builtin functions
+
+// Builtin_NONE if the name is not a builtin's.
+static Builtin_Id builtin_find(String name);
+
+static void builtins_fini(Builtins *builtins);
+
+// Adds what a process used to the account of its command, if accounting is on.
+static void builtins_account(Builtins *builtins, String command, Process_Usage usage);
+static void builtins_print_accounting(Builtins *builtins, FILE *file);
+
+// time command...
+// The shell runs the command like it was typed alone, between these two. Prints what it used
+// to the standard error: the process it started if there was one, otherwise the shell itself.
+static Process_Usage builtin_time_begin(void);
+static void          builtin_time_end(Process_Usage begin, bool ran_process);
+
+// accounting [on|off|reset]
+// Turns the accounting of the processes that commands start on or off, forgets what was
+// accounted so far, or without arguments prints it as a table, the most expensive first.
+static i32 builtin_accounting(Builtins *builtins, String *argv, i64 argc);
+
+// grep [-r] [-n] [-l] [-c] text [path...]
+// Prints the lines that contain the text, which is matched as it is (there are no regular
+// expressions). Returns 0 if a line matched, 1 if none did, 2 on errors.
+static i32 builtin_grep(Builtins *builtins, String *argv, i64 argc);
+
+// hash-files [-r] [-c cache file] path...
+// Prints a 64-bit hash of the contents of each file (see hash_bytes()), like sha256sum does.
+// With a cache file, files whose size and modification time are the same as in the last run
+// that used it are not read again. Returns 0, or 1 if a file couldn't be hashed.
+static i32 builtin_hash_files(Builtins *builtins, String *argv, i64 argc);
+
+// cp [-r] source... destination
+// Copies files, and directories with -r, into the destination directory or onto the
+// destination. The files of a directory are copied by the workers while the directory is still
+// being walked. Symbolic links inside a directory are copied as the files they point to. Returns
+// 0, or 1 if anything couldn't be copied.
+static i32 builtin_cp(Builtins *builtins, String *argv, i64 argc);
+
+// mv source... destination
+// Renames files and directories. Across volumes they are copied like cp -r does, and the
+// sources deleted once they are. Returns 0, or 1 if anything couldn't be moved.
+static i32 builtin_mv(Builtins *builtins, String *argv, i64 argc);
+
+// test expression, [ expression ]
+// Checks strings (-n, -z, =, !=), integers (-eq, -ne, -lt, -le, -gt, -ge) or files (-e, -f, -d,
+// -s), with an optional '!' in front. Returns 0 if the expression holds, 1 if it doesn't, 2 if
+// it can't be evaluated. With `bracket` set the last argument must be "]".
+static i32 builtin_test(String *argv, i64 argc, bool bracket);
+
+// Builtins that scripts would otherwise start a process for, often once per loop iteration.
+
+// basename path [suffix]
+// Prints the last component of the path, without the suffix if it ends with it. Returns 0, or
+// 1 without a path.
+static i32 builtin_basename(String *argv, i64 argc);
+
+// dirname path...
+// Prints each path without its last component, or "." if it has only one. Returns 0, or 1
+// without a path.
+static i32 builtin_dirname(String *argv, i64 argc);
+
+// expr expression
+// Prints the value of the expression, whose operators and operands are separate arguments:
+// | & = != < <= > >= + - * / % and string : regex, with parentheses, and length s, substr s
+// position length, index s bytes and match s regex. The regular expressions are basic ones,
+// anchored at the start, with . [] * one \(group\) and $. Returns 0 if the value is neither
+// empty nor 0, 1 if it is, 2 on errors.
+static i32 builtin_expr(String *argv, i64 argc);
+
+// wc [-l] [-w] [-c] [file...]
+// Prints how many lines, words and bytes the files have, or the standard input if there are
+// none. Returns 0, or 1 if a file couldn't be read.
+static i32 builtin_wc(String *argv, i64 argc);
+
+// tr [-d] [-s] set1 [set2]
+// Copies the standard input to the standard output with the bytes of set1 replaced by those of
+// set2, or deleted with -d, and with runs of the same byte of the last set squeezed into one
+// with -s. Sets can have ranges like a-z, classes like [:upper:], and \n \t \r. Returns 0, or
+// 2 if the sets are wrong.
+static i32 builtin_tr(String *argv, i64 argc);
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef DUSH_COMPLETE_C
+#define DUSH_COMPLETE_C
+
+////////////////////////////////
+//~ Completion
+
+//- Completion helpers
+
+static int
+_complete_compare_names(const void *a, const void *b) {
+	return string_compare(*cast(String *) a, *cast(String *) b);
+}
+
+static bool
+_complete_is_executable(File_Info *info) {
+	bool result = false;
+	if (!(info->attributes.flags & File_Flag_IS_DIRECTORY)) {
+#if OS_WINDOWS
+		String extensions[] = {
+			string_from_lit(".exe"), string_from_lit(".com"), string_from_lit(".bat"), string_from_lit(".cmd"),
+		};
+		for (i64 i = 0; i < array_count(extensions) && !result; i += 1) {
+			String name_extension = string_skip(info->name, info->name.len - extensions[i].len);
+			result = info->name.len > extensions[i].len && string_equals_case_insensitive(name_extension, extensions[i]);
+		}
+#else
+		result = (info->attributes.access & Access_Flag_EXECUTE) != 0;
+#endif
+	}
+	return result;
+}
+
+// Fills in the longest common prefix of the candidates, which must be sorted: it's enough to
+// compare the first and the last one.
+static void
+_complete_set_common(Completion *completion) {
+	if (completion->count > 0) {
+		String first = completion->candidates[0];
+		String last  = completion->candidates[completion->count - 1];
+		i64 len = 0;
+		while (len < first.len && len < last.len && first.data[len] == last.data[len]) len += 1;
+		completion->common = string_stop(first, len);
+	}
+}
+
+static void
+_completion_dir_list(Completion_Index *index, Completion_Dir *dir) {
+	arena_reset(&dir->arena);
+	dir->names = NULL;
+	dir->name_count = 0;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// The attributes are needed to tell executables apart, so this can't be a names-only listing.
+	File_Info_List executables = {0};
+	File_Iterator *iterator = file_iterator_begin(scratch.arena, dir->path);
+	File_Info info = {0};
+	while (file_iterator_next(scratch.arena, iterator, &info)) {
+		if (_complete_is_executable(&info)) {
+			file_info_list_push(scratch.arena, &executables, info);
+		}
+	}
+	file_iterator_end(iterator);
+	
+	i64     count = 0;
+	String *names = push_array(&dir->arena, String, executables.count);
+	if (names != NULL) {
+		for (File_Info_Node *node = executables.first; node != NULL; node = node->next) {
+			String name = string_clone(&dir->arena, node->info.name);
+			if (name.data != NULL) {
+				names[count] = name;
+				count += 1;
+			}
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	qsort(names, cast(size_t) count, sizeof(String), _complete_compare_names);
+	dir->names      = names;
+	dir->name_count = count;
+	dir->listed     = true;
+	dir->listed_at  = time(NULL);
+	index->dirs_listed += 1;
+}
+
+static void
+_completion_index_merge(Completion_Index *index) {
+	arena_reset(&index->names_arena);
+	index->names = NULL;
+	index->name_count = 0;
+	
+	i64 total = index->extra_name_count;
+	for (i64 i = 0; i < index->dir_count; i += 1) {
+		total += index->dirs[i].name_count;
+	}
+	
+	String *names = push_array(&index->names_arena, String, total);
+	if (names != NULL) {
+		i64 count = 0;
+		for (i64 i = 0; i < index->extra_name_count; i += 1) {
+			names[count] = index->extra_names[i];
+			count += 1;
+		}
+		for (i64 i = 0; i < index->dir_count; i += 1) {
+			memcpy(names + count, index->dirs[i].names, index->dirs[i].name_count * sizeof(String));
+			count += index->dirs[i].name_count;
+		}
+		
+		qsort(names, cast(size_t) count, sizeof(String), _complete_compare_names);
+		
+		// The same name in more than one directory is a single command.
+		i64 unique = 0;
+		for (i64 i = 0; i < count; i += 1) {
+			if (unique == 0 || !string_equals(names[unique - 1], names[i])) {
+				names[unique] = names[i];
+				unique += 1;
+			}
+		}
+		
+		index->names      = names;
+		index->name_count = unique;
+	}
+	
+	index->merges += 1;
+}
+
+//- Completion functions
+
+static void
+completion_index_init(Completion_Index *index, Path_Cache *path_cache, String *extra_names, i64 extra_name_count) {
+	memset(index, 0, sizeof(Completion_Index));
+	index->path_cache       = path_cache;
+	index->extra_names      = extra_names;
+	index->extra_name_count = extra_name_count;
+}
+
+static void
+completion_index_fini(Completion_Index *index) {
+	for (i64 i = 0; i < index->dir_count; i += 1) {
+		arena_fini(&index->dirs[i].arena);
+	}
+	if (index->arena.ptr != NULL)       arena_fini(&index->arena);
+	if (index->names_arena.ptr != NULL) arena_fini(&index->names_arena);
+	memset(index, 0, sizeof(Completion_Index));
+}
+
+static void
+completion_index_update(Completion_Index *index) {
+	// The arenas are only reserved when the index is first needed.
+	if (!index->initialized) {
+		index->initialized = ((index->arena.ptr != NULL || arena_init(&index->arena)) &&
+							  (index->names_arena.ptr != NULL || arena_init(&index->names_arena)));
+		if (!index->initialized) return;
+	}
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	bool changed = false;
+	
+	// A different PATH means starting over. The shell keeps the cache up to date with its PATH,
+	// so it's the PATH of the cache that tells.
+	Path_Cache *cache = index->path_cache;
+	if (index->names == NULL || !string_equals(cache->system_path, index->system_path)) {
+		for (i64 i = 0; i < index->dir_count; i += 1) {
+			arena_fini(&index->dirs[i].arena);
+		}
+		arena_reset(&index->arena);
+		index->dirs = NULL;
+		index->dir_count = 0;
+		
+		index->system_path = string_clone(&index->arena, cache->system_path);
+		
+		index->dirs = push_array(&index->arena, Completion_Dir, cache->count);
+		if (index->dirs != NULL) {
+			for (i64 i = 0; i < cache->count; i += 1) {
+				// The paths of the cache go away with the next PATH, before the index sees it.
+				String entry = string_clone(&index->arena, cache->entries[i].dir.path);
+				
+				// Empty entries would mean the current directory, which is not where commands
+				// are looked up. Directories listed twice are only looked at once.
+				bool skip = entry.len == 0;
+				for (i64 j = 0; j < index->dir_count && !skip; j += 1) {
+					skip = string_equals(index->dirs[j].path, entry);
+				}
+				
+				if (!skip) {
+					Completion_Dir *dir = &index->dirs[index->dir_count];
+					if (arena_init(&dir->arena, .reserve_size = COMPLETION_DIR_RESERVE_SIZE)) {
+						dir->path = entry;
+						index->dir_count += 1;
+					}
+				}
+			}
+		}
+		
+		changed = true;
+	}
+	
+	for (i64 i = 0; i < index->dir_count; i += 1) {
+		Completion_Dir *dir = &index->dirs[i];
+		
+		File_Attributes attributes = {0};
+		if (!file_attributes(dir->path, &attributes)) {
+			// Missing directories are common in the PATH. Look again next time, in case they appear.
+			attributes.last_modified = 0;
+		}
+		
+		// Modification times only have a resolution of a second, so a directory that changed
+		// in the same second it was listed might have changed again after the listing.
+		bool stale = !dir->listed || attributes.last_modified != dir->last_modified ||
+			attributes.last_modified >= dir->listed_at;
+		if (stale) {
+			dir->last_modified = attributes.last_modified;
+			if (attributes.last_modified != 0) {
+				_completion_dir_list(index, dir);
+			} else {
+				arena_reset(&dir->arena);
+				dir->names = NULL;
+				dir->name_count = 0;
+				dir->listed = true;
+				dir->listed_at = time(NULL);
+			}
+			changed = true;
+		}
+	}
+	
+	if (changed) {
+		_completion_index_merge(index);
+	}
+	
+	scratch_end(scratch);
+}
+
+static Completion
+complete_command(Completion_Index *index, Arena *arena, String prefix) {
+	Completion result = {0};
+	result.is_command = true;
+	
+	// Find the first name that is not less than the prefix; every match comes right after it.
+	i64 low  = 0;
+	i64 high = index->name_count;
+	while (low < high) {
+		i64 mid = low + (high - low) / 2;
+		if (string_compare(index->names[mid], prefix) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	
+	i64 end = low;
+	while (end < index->name_count && string_starts_with(index->names[end], prefix)) end += 1;
+	
+	result.count = end - low;
+	result.candidates = push_array(arena, String, result.count);
+	if (result.candidates != NULL) {
+		memcpy(result.candidates, index->names + low, result.count * sizeof(String));
+		_complete_set_common(&result);
+	} else {
+		result.count = 0;
+	}
+	
+	return result;
+}
+
+static Completion
+complete_path(Arena *arena, String word) {
+	Completion result = {0};
+	
+	i64    base_start = max(path_last_separator(word), 0);
+	String directory  = string_stop(word, base_start);
+	String base       = string_skip(word, base_start);
+	
+	// Hidden files are only offered when asked for.
+	bool match_hidden = base.len > 0 && base.data[0] == '.';
+	
+	File_Info_List matches = {0};
+	Scratch scratch = scratch_begin(&arena, 1);
+	{
+		File_Iterator *iterator = file_iterator_begin(scratch.arena, directory.len > 0 ? directory : string_from_lit("."), .names_only = true);
+		File_Info info = {0};
+		while (file_iterator_next(scratch.arena, iterator, &info)) {
+			if (string_starts_with(info.name, base) && (match_hidden || info.name.data[0] != '.')) {
+				String temp[] = {directory, info.name, (info.attributes.flags & File_Flag_IS_DIRECTORY) ? get_separator() : string_from_lit("")};
+				info.name = strings_concat(arena, temp, array_count(temp));
+				file_info_list_push(scratch.arena, &matches, info);
+			}
+		}
+		file_iterator_end(iterator);
+		
+		result.candidates = push_array(arena, String, matches.count);
+		if (result.candidates != NULL) {
+			for (File_Info_Node *node = matches.first; node != NULL; node = node->next) {
+				result.candidates[result.count] = node->info.name;
+				result.count += 1;
+			}
+		}
+	}
+	scratch_end(scratch);
+	
+	qsort(result.candidates, cast(size_t) result.count, sizeof(String), _complete_compare_names);
+	_complete_set_common(&result);
+	result.display_skip = directory.len;
+	
+	return result;
+}
+
+static Completion
+complete_line(Completion_Index *index, Arena *arena, String line, i64 cursor) {
+	i64 word_start = cursor;
+	while (word_start > 0 && !isspace(line.data[word_start - 1])) word_start -= 1;
+	
+	bool is_first_word = true;
+	for (i64 i = 0; i < word_start && is_first_word; i += 1) {
+		is_first_word = isspace(line.data[i]) != 0;
+	}
+	
+	String word = string(line.data + word_start, cursor - word_start);
+	
+	bool has_separator = false;
+	for (i64 i = 0; i < word.len && !has_separator; i += 1) {
+		has_separator = is_separator(word.data[i]);
+	}
+	
+	Completion result = {0};
+	if (is_first_word && !has_separator) {
+		if (index != NULL) {
+			completion_index_update(index);
+			result = complete_command(index, arena, word);
+		}
+	} else {
+		result = complete_path(arena, word);
+	}
+	result.word_start = word_start;
+	
+	return result;
+}
+
+#endif
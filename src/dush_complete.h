@@ -0,0 +1,91 @@
+#ifndef DUSH_COMPLETE_H
+#define DUSH_COMPLETE_H
+
+////////////////////////////////
+//~ Completion
+
+//- Completion constants
+
+#if !defined(COMPLETION_DIR_RESERVE_SIZE)
+#define COMPLETION_DIR_RESERVE_SIZE megabytes(64)
+#endif
+
+//- Completion types
+
+// The executables found in one directory of the PATH, sorted.
+typedef struct Completion_Dir Completion_Dir;
+struct Completion_Dir {
+	Arena   arena; // Holds the names. Reset every time the directory is listed again.
+	String  path;
+	String *names;
+	i64     name_count;
+	
+	bool    listed;
+	time_t  last_modified;
+	time_t  listed_at;
+};
+
+// Every command that can be typed as the first word of a line: the executables in the PATH
+// plus a fixed set of names (the builtins), merged into a single sorted array so that finding
+// the commands that start with a prefix is a binary search.
+//
+// The directories are the ones of a Path_Cache, which splits the PATH for the commands that are
+// run as well. Updating is incremental: every PATH directory is stat'ed and only the ones whose
+// modification time changed are listed again. The merged array is only rebuilt when something
+// changed.
+typedef struct Completion_Index Completion_Index;
+struct Completion_Index {
+	Arena   arena;        // The directories and the PATH they came from.
+	Arena   names_arena;  // Holds nothing but the merged array.
+	String  system_path;
+	Path_Cache *path_cache;
+	
+	Completion_Dir *dirs;
+	i64     dir_count;
+	
+	String *extra_names;
+	i64     extra_name_count;
+	
+	String *names;
+	i64     name_count;
+	bool    initialized;
+	
+	// Statistics
+	u64 dirs_listed;
+	u64 merges;
+};
+
+// The candidates for the word that ends at the cursor. Each candidate replaces the whole word.
+typedef struct Completion Completion;
+struct Completion {
+	i64     word_start;
+	String *candidates; // Sorted
+	i64     count;
+	String  common;     // The longest prefix shared by every candidate.
+	i64     display_skip; // How much of each candidate is the directory part, when completing paths.
+	bool    is_command;
+};
+
+//- Completion functions
+
+// Only remembers the cache and the extra names; nothing is allocated until the first update.
+// Both must stay valid as long as the index is used.
+static void       completion_index_init(Completion_Index *index, Path_Cache *path_cache, String *extra_names, i64 extra_name_count);
+static void       completion_index_fini(Completion_Index *index);
+
+// Picks up changes to the PATH of the cache, which the caller keeps up to date, and to the
+// directories in it.
+static void       completion_index_update(Completion_Index *index);
+
+// Commands starting with the prefix. The strings point into the index and are valid until the
+// next update.
+static Completion complete_command(Completion_Index *index, Arena *arena, String prefix);
+
+// Files and directories starting with the last component of `word`. Directories end with a separator.
+static Completion complete_path(Arena *arena, String word);
+
+// Completes the word that ends at the cursor: a command if it is the first word of the line and
+// it doesn't contain a separator, a path otherwise. The index can be NULL.
+static Completion complete_line(Completion_Index *index, Arena *arena, String line, i64 cursor);
+
+#endif
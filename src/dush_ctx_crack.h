@@ -46,6 +46,15 @@
 # error Compiler is not supported. _MSC_VER, __clang__, __GNUC__, or __GNUG__ must be defined.
 #endif
 
+////////////////////////////////
+//~ Context Crack: Architecture
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(_M_X64) || defined(_M_AMD64)
+# define ARCH_X64 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+# define ARCH_ARM64 1
+#endif
+
 ////////////////////////////////
 //~ Context Crack: Preprocessor
 
@@ -85,6 +94,12 @@
 #if !defined(OS_MAC)
 # define OS_MAC 0
 #endif
+#if !defined(ARCH_X64)
+# define ARCH_X64 0
+#endif
+#if !defined(ARCH_ARM64)
+# define ARCH_ARM64 0
+#endif
 
 ////////////////////////////////
 //~ Context Crack: Build params
@@ -0,0 +1,806 @@
+#ifndef DUSH_EXPAND_C
+#define DUSH_EXPAND_C
+
+////////////////////////////////
+//~ Glob matching
+
+static Glob_Pattern
+glob_compile(Arena *arena, String pattern) {
+	Glob_Pattern result = {0};
+	
+	result.match_hidden = pattern.len > 0 && pattern.data[0] == '.';
+	
+	// There can't be more segments than stars + 1.
+	i64 segment_cap = string_count_occurrences(pattern, '*') + 1;
+	result.segments = push_array(arena, Glob_Segment, segment_cap);
+	
+	// Unescaped text is never longer than the pattern, so each segment can be written in place
+	// into a single copy.
+	u8 *text = push_nozero(arena, pattern.len + 1);
+	u8 *any  = push_zero(arena, pattern.len + 1);
+	
+	if (result.segments != NULL && text != NULL && any != NULL) {
+		i64  text_len      = 0;
+		i64  seg_start     = 0;
+		bool seg_has_any   = false;
+		bool last_was_star = false;
+		
+		for (i64 i = 0; i <= pattern.len; i += 1) {
+			bool at_end = i == pattern.len;
+			u8   c      = at_end ? 0 : pattern.data[i];
+			
+			if (at_end || c == '*') {
+				if (text_len > seg_start) {
+					Glob_Segment *segment = &result.segments[result.segment_count];
+					segment->text = string(text + seg_start, text_len - seg_start);
+					segment->any  = seg_has_any ? any + seg_start : NULL;
+					result.segment_count += 1;
+					result.min_len += segment->text.len;
+				}
+				
+				seg_start   = text_len;
+				seg_has_any = false;
+				if (!at_end) last_was_star = true;
+			} else {
+				if (c == '\\' && i + 1 < pattern.len) {
+					i += 1;
+					c = pattern.data[i];
+				} else if (c == '?') {
+					any[text_len] = 1;
+					seg_has_any   = true;
+				}
+				
+				text[text_len] = c;
+				text_len += 1;
+				last_was_star = false;
+			}
+		}
+		
+		result.anchored_start = !(pattern.len > 0 && pattern.data[0] == '*');
+		result.anchored_end   = !last_was_star;
+	} else {
+		assert(last_alloc_error);
+		memset(&result, 0, sizeof(result));
+	}
+	
+	return result;
+}
+
+static bool
+_glob_segment_matches_at(Glob_Segment *segment, String name, i64 at) {
+	bool result = false;
+	if (at + segment->text.len <= name.len) {
+		if (segment->any == NULL) {
+			result = memcmp(name.data + at, segment->text.data, segment->text.len) == 0;
+		} else {
+			result = true;
+			for (i64 i = 0; i < segment->text.len; i += 1) {
+				if (!segment->any[i] && segment->text.data[i] != name.data[at + i]) {
+					result = false;
+					break;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+// Returns the index of the first match of the segment in name[from..to), or -1.
+static i64
+_glob_segment_find(Glob_Segment *segment, String name, i64 from, i64 to) {
+	i64 result = -1;
+	
+	i64 last_start = to - segment->text.len;
+	if (segment->any == NULL && segment->text.len > 0) {
+		// Use memchr() on the first byte, which is vectorized by every libc we care about.
+		u8 first = segment->text.data[0];
+		i64 at = from;
+		while (at <= last_start) {
+			u8 *found = memchr(name.data + at, first, cast(size_t) (last_start - at + 1));
+			if (found == NULL) break;
+			
+			at = cast(i64) (found - name.data);
+			if (memcmp(name.data + at, segment->text.data, segment->text.len) == 0) {
+				result = at;
+				break;
+			}
+			at += 1;
+		}
+	} else {
+		for (i64 at = from; at <= last_start; at += 1) {
+			if (_glob_segment_matches_at(segment, name, at)) {
+				result = at;
+				break;
+			}
+		}
+	}
+	
+	return result;
+}
+
+static bool
+glob_match(Glob_Pattern *pattern, String name) {
+	bool result = false;
+	
+	if (name.len >= pattern->min_len &&
+		(pattern->match_hidden || name.len == 0 || name.data[0] != '.')) {
+		i64 first = 0;
+		i64 last  = pattern->segment_count;
+		i64 lo    = 0;
+		i64 hi    = name.len;
+		
+		result = true;
+		
+		if (pattern->anchored_start && pattern->anchored_end && pattern->segment_count <= 1) {
+			// No stars at all: the whole name must match.
+			result = name.len == pattern->min_len &&
+				(pattern->segment_count == 0 || _glob_segment_matches_at(&pattern->segments[0], name, 0));
+			first = last;
+		} else {
+			if (pattern->anchored_start && first < last) {
+				result = _glob_segment_matches_at(&pattern->segments[first], name, 0);
+				lo     = pattern->segments[first].text.len;
+				first += 1;
+			}
+			
+			if (result && pattern->anchored_end && first < last) {
+				Glob_Segment *segment = &pattern->segments[last - 1];
+				hi     = name.len - segment->text.len;
+				result = hi >= lo && _glob_segment_matches_at(segment, name, hi);
+				last  -= 1;
+			}
+		}
+		
+		// Every segment in between can go anywhere, so the leftmost match is always the best one.
+		for (i64 i = first; result && i < last; i += 1) {
+			i64 at = _glob_segment_find(&pattern->segments[i], name, lo, hi);
+			if (at < 0) {
+				result = false;
+			} else {
+				lo = at + pattern->segments[i].text.len;
+			}
+		}
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ Command line expansion
+
+//- Expansion types
+
+// Where expanded bytes go. When data is NULL, only the length is computed: this is how
+// the first pass sizes the output block.
+typedef struct Expand_Sink Expand_Sink;
+struct Expand_Sink {
+	u8  *data;
+	i64  len;
+};
+
+typedef struct Expand_Dir_Listing Expand_Dir_Listing;
+struct Expand_Dir_Listing {
+	Expand_Dir_Listing *next;
+	String  path;
+	String *names;
+	i64     count;
+};
+
+typedef struct Expand_Glob Expand_Glob;
+struct Expand_Glob {
+	Expand_Glob *next;
+	i64     word_start;
+	String  directory;   // As typed, including the trailing separator. Empty for the current directory.
+	String *matches;
+	i64     match_count;
+	i64     match_bytes; // Not counting null terminators.
+};
+
+typedef struct Expand_Context Expand_Context;
+struct Expand_Context {
+	Arena *arena;                   // Temporary memory, gone after the expansion.
+	Expand_Dir_Listing *listings;   // Directory listings are read once per command.
+	Expand_Glob *first_glob;
+	Expand_Glob *last_glob;
+};
+
+//- Expansion helpers
+
+static void
+_expand_emit(Expand_Sink *sink, String s, bool escape_wildcards) {
+	if (!escape_wildcards) {
+		if (sink->data != NULL && s.len > 0) {
+			memcpy(sink->data + sink->len, s.data, s.len);
+		}
+		sink->len += s.len;
+	} else {
+		for (i64 i = 0; i < s.len; i += 1) {
+			u8 c = s.data[i];
+			if (c == '*' || c == '?' || c == '\\') {
+				if (sink->data != NULL) sink->data[sink->len] = '\\';
+				sink->len += 1;
+			}
+			if (sink->data != NULL) sink->data[sink->len] = c;
+			sink->len += 1;
+		}
+	}
+}
+
+static i64
+_expand_skip_whitespace(String line, i64 cursor) {
+	while (cursor < line.len && isspace(line.data[cursor])) {
+		cursor += 1;
+	}
+	return cursor;
+}
+
+static bool
+_expand_is_name_char(u8 c, bool first) {
+	return c == '_' || isalpha(c) || (!first && isdigit(c));
+}
+
+// In double quotes, a backslash only escapes these.
+static bool
+_expand_is_escapable_in_quotes(u8 c) {
+	return c == '$' || c == '`' || c == '"' || c == '\\' || c == '\n';
+}
+
+// s starts with a '$'. Returns how many bytes make up the variable reference, or 0 if
+// it is not a reference (in that case the '$' is taken literally).
+static i64
+_expand_variable_reference(String s, String *name) {
+	i64 result = 0;
+	
+	if (s.len >= 2) {
+		if (s.data[1] == '{') {
+			i64 close = string_find_first(string_skip(s, 2), '}');
+			if (close > 0) {
+				*name  = string(s.data + 2, close);
+				result = close + 3;
+			}
+		} else if (_expand_is_name_char(s.data[1], true)) {
+			i64 end = 2;
+			while (end < s.len && _expand_is_name_char(s.data[end], false)) {
+				end += 1;
+			}
+			*name  = string(s.data + 1, end - 1);
+			result = end;
+		}
+	}
+	
+	return result;
+}
+
+static String
+_expand_lookup_variable(String name) {
+	String result = {0};
+	
+	// getenv() wants a null-terminated name. Names are short, so don't bother with an arena.
+	char name_nt[256];
+	if (name.len < array_count(name_nt)) {
+		memcpy(name_nt, name.data, name.len);
+		name_nt[name.len] = 0;
+		
+		char *value = getenv(name_nt);
+		if (value != NULL) {
+			result = string_from_cstring(value);
+		}
+	}
+	
+	return result;
+}
+
+// Scans the word starting at *cursor, emitting its expansion into the sink, and moves the
+// cursor past it. Returns true if the word contains unquoted wildcards.
+//
+// With escape_wildcards set, the output is a pattern for glob_compile(): wildcards that were
+// quoted or came from a variable are escaped.
+static bool
+_expand_scan_word(String line, i64 *cursor, Expand_Sink *sink, bool escape_wildcards) {
+	bool has_wildcards = false;
+	u8   quote = 0;
+	
+	i64 i = *cursor;
+	while (i < line.len) {
+		u8 c = line.data[i];
+		
+		if (quote == 0 && isspace(c)) {
+			break;
+		}
+		
+		if (c == '\\' && quote != '\'' && i + 1 < line.len &&
+			(quote == 0 || _expand_is_escapable_in_quotes(line.data[i + 1]))) {
+			// The byte after a backslash is quoted, and a newline after it is removed.
+			if (line.data[i + 1] != '\n') {
+				_expand_emit(sink, string(&line.data[i + 1], 1), escape_wildcards);
+			}
+			i += 2;
+		} else if (quote == 0 && (c == '\'' || c == '"')) {
+			quote = c;
+			i += 1;
+		} else if (quote != 0 && c == quote) {
+			quote = 0;
+			i += 1;
+		} else if (c == '$' && quote != '\'') {
+			String name = {0};
+			i64 consumed = _expand_variable_reference(string_skip(line, i), &name);
+			if (consumed > 0) {
+				_expand_emit(sink, _expand_lookup_variable(name), escape_wildcards);
+				i += consumed;
+			} else {
+				_expand_emit(sink, string(&line.data[i], 1), escape_wildcards);
+				i += 1;
+			}
+		} else if (quote == 0 && (c == '*' || c == '?')) {
+			has_wildcards = true;
+			_expand_emit(sink, string(&line.data[i], 1), false);
+			i += 1;
+		} else {
+			_expand_emit(sink, string(&line.data[i], 1), escape_wildcards);
+			i += 1;
+		}
+	}
+	
+	*cursor = i;
+	return has_wildcards;
+}
+
+static String
+_expand_unescape(Arena *arena, String pattern) {
+	String result = push_string(arena, pattern.len);
+	if (result.data != NULL) {
+		i64 len = 0;
+		for (i64 i = 0; i < pattern.len; i += 1) {
+			if (pattern.data[i] == '\\' && i + 1 < pattern.len) {
+				i += 1;
+			}
+			result.data[len] = pattern.data[i];
+			len += 1;
+		}
+		result.len = len;
+	}
+	return result;
+}
+
+static int
+_expand_compare_names(const void *a, const void *b) {
+	return string_compare(*cast(String *) a, *cast(String *) b);
+}
+
+static Expand_Dir_Listing *
+_expand_list_directory(Expand_Context *context, String directory) {
+	Expand_Dir_Listing *listing = NULL;
+	for (Expand_Dir_Listing *it = context->listings; it != NULL; it = it->next) {
+		if (string_equals(it->path, directory)) {
+			listing = it;
+			break;
+		}
+	}
+	
+	if (listing == NULL) {
+		listing = push_type(context->arena, Expand_Dir_Listing);
+		if (listing != NULL) {
+			listing->path = directory;
+			
+			String iterator_path = directory.len > 0 ? directory : string_from_lit("./");
+			
+			File_Info_List list = {0};
+			File_Iterator *iterator = file_iterator_begin(context->arena, iterator_path, .names_only = true);
+			{
+				File_Info info = {0};
+				while (file_iterator_next(context->arena, iterator, &info)) {
+					file_info_list_push(context->arena, &list, info);
+				}
+			}
+			file_iterator_end(iterator);
+			
+			listing->names = push_array(context->arena, String, list.count);
+			if (listing->names != NULL) {
+				for (File_Info_Node *node = list.first; node != NULL; node = node->next) {
+					listing->names[listing->count] = node->info.name;
+					listing->count += 1;
+				}
+			}
+			
+			stack_push(context->listings, listing);
+		}
+	}
+	
+	return listing;
+}
+
+// Fills in the directory and the matches of the glob from the pattern.
+static void
+_expand_glob_pattern(Expand_Context *context, Expand_Glob *glob, String pattern) {
+	// Split the pattern after the last separator. Wildcards before it are not supported.
+	i64  base_start = 0;
+	bool directory_has_wildcards = false;
+	bool seen_wildcards = false;
+	for (i64 i = 0; i < pattern.len; i += 1) {
+		u8 c = pattern.data[i];
+		if (c == '\\' && i + 1 < pattern.len) {
+			i += 1;
+			c = pattern.data[i];
+		} else if (c == '*' || c == '?') {
+			seen_wildcards = true;
+			continue;
+		}
+		
+		if (is_separator(c)) {
+			base_start = i + 1;
+			directory_has_wildcards = seen_wildcards;
+		}
+	}
+	
+	if (!directory_has_wildcards) {
+		glob->directory = _expand_unescape(context->arena, string_stop(pattern, base_start));
+		
+		Glob_Pattern compiled = glob_compile(context->arena, string_skip(pattern, base_start));
+		Expand_Dir_Listing *listing = _expand_list_directory(context, glob->directory);
+		
+		if (listing != NULL && listing->count > 0) {
+			glob->matches = push_array(context->arena, String, listing->count);
+			if (glob->matches != NULL) {
+				for (i64 i = 0; i < listing->count; i += 1) {
+					if (glob_match(&compiled, listing->names[i])) {
+						glob->matches[glob->match_count] = listing->names[i];
+						glob->match_count += 1;
+						glob->match_bytes += glob->directory.len + listing->names[i].len;
+					}
+				}
+				
+				qsort(glob->matches, cast(size_t) glob->match_count, sizeof(String), _expand_compare_names);
+			}
+		}
+	}
+}
+
+// Expands the wildcards of the word at word_start. The glob is always queued, even if nothing
+// matched, so that the second pass can walk the queue in lockstep with the words.
+static void
+_expand_glob(Expand_Context *context, String line, i64 word_start) {
+	Expand_Glob *glob = push_type(context->arena, Expand_Glob);
+	if (glob != NULL) {
+		glob->word_start = word_start;
+		
+		Expand_Sink measure = {0};
+		i64 cursor = word_start;
+		_expand_scan_word(line, &cursor, &measure, true);
+		
+		Expand_Sink pattern_sink = { .data = push_nozero(context->arena, measure.len + 1) };
+		if (pattern_sink.data != NULL) {
+			cursor = word_start;
+			_expand_scan_word(line, &cursor, &pattern_sink, true);
+			_expand_glob_pattern(context, glob, string(pattern_sink.data, pattern_sink.len));
+		}
+		
+		queue_push(context->first_glob, context->last_glob, glob);
+	}
+}
+
+//- Expansion functions
+
+static Expanded_Command
+expand_command_line(Arena *arena, String line) {
+	Expanded_Command result = {0};
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	Expand_Context context = { .arena = scratch.arena };
+	
+	//- Pass 1: count arguments and bytes, and resolve wildcards.
+	i64 argc       = 0;
+	i64 byte_count = 0;
+	for (i64 cursor = _expand_skip_whitespace(line, 0); cursor < line.len; cursor = _expand_skip_whitespace(line, cursor)) {
+		i64 word_start = cursor;
+		
+		Expand_Sink measure = {0};
+		bool has_wildcards = _expand_scan_word(line, &cursor, &measure, false);
+		
+		if (has_wildcards) {
+			_expand_glob(&context, line, word_start);
+			
+			Expand_Glob *glob = context.last_glob;
+			if (glob != NULL && glob->word_start == word_start && glob->match_count > 0) {
+				argc       += glob->match_count;
+				byte_count += glob->match_bytes + glob->match_count;
+				continue;
+			}
+		}
+		
+		argc       += 1;
+		byte_count += measure.len + 1;
+	}
+	
+	//- Pass 2: write everything into a single block.
+	if (argc > 0) {
+		u64 argv_size = cast(u64) argc * sizeof(String);
+		u8 *block = push_nozero_aligned(arena, argv_size + cast(u64) byte_count, alignof(String));
+		
+		if (block != NULL) {
+			String *argv = cast(String *) block;
+			Expand_Sink sink = { .data = block + argv_size };
+			
+			Expand_Glob *glob = context.first_glob;
+			i64 arg_index = 0;
+			for (i64 cursor = _expand_skip_whitespace(line, 0); cursor < line.len; cursor = _expand_skip_whitespace(line, cursor)) {
+				if (glob != NULL && glob->word_start == cursor) {
+					Expand_Glob *this_glob = glob;
+					glob = glob->next;
+					
+					if (this_glob->match_count > 0) {
+						Expand_Sink skip = {0};
+						_expand_scan_word(line, &cursor, &skip, false);
+						
+						for (i64 i = 0; i < this_glob->match_count; i += 1) {
+							i64 start = sink.len;
+							_expand_emit(&sink, this_glob->directory, false);
+							_expand_emit(&sink, this_glob->matches[i], false);
+							argv[arg_index] = string(sink.data + start, sink.len - start);
+							arg_index += 1;
+							
+							sink.data[sink.len] = 0;
+							sink.len += 1;
+						}
+						continue;
+					}
+				}
+				
+				i64 start = sink.len;
+				_expand_scan_word(line, &cursor, &sink, false);
+				argv[arg_index] = string(sink.data + start, sink.len - start);
+				arg_index += 1;
+				
+				sink.data[sink.len] = 0;
+				sink.len += 1;
+			}
+			
+			assert(arg_index == argc && sink.len == byte_count);
+			
+			result.argv = argv;
+			result.argc = argc;
+		} else {
+			assert(last_alloc_error);
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+static Expanded_Command
+expand_glob(Arena *arena, String pattern) {
+	Expanded_Command result = {0};
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	Expand_Context context = { .arena = scratch.arena };
+	
+	Expand_Glob glob = {0};
+	_expand_glob_pattern(&context, &glob, pattern);
+	
+	if (glob.match_count > 0) {
+		u64 argv_size = cast(u64) glob.match_count * sizeof(String);
+		u8 *block = push_nozero_aligned(arena, argv_size + cast(u64) (glob.match_bytes + glob.match_count), alignof(String));
+		
+		if (block != NULL) {
+			String *argv = cast(String *) block;
+			Expand_Sink sink = { .data = block + argv_size };
+			
+			for (i64 i = 0; i < glob.match_count; i += 1) {
+				i64 start = sink.len;
+				_expand_emit(&sink, glob.directory, false);
+				_expand_emit(&sink, glob.matches[i], false);
+				argv[i] = string(sink.data + start, sink.len - start);
+				
+				sink.data[sink.len] = 0;
+				sink.len += 1;
+			}
+			
+			result.argv = argv;
+			result.argc = glob.match_count;
+		} else {
+			assert(last_alloc_error);
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+////////////////////////////////
+//~ Variables
+
+static void
+variables_fini(Variables *variables) {
+	if (variables->arena.ptr != NULL) {
+		arena_fini(&variables->arena);
+	}
+	memset(variables, 0, sizeof(Variables));
+}
+
+// The slot of the variable, or the empty slot where it would go.
+static Variable *
+_variables_find(Variables *variables, String name, u64 hash) {
+	Variable *result = NULL;
+	for (u64 i = hash & variables->slot_mask; ; i = (i + 1) & variables->slot_mask) {
+		Variable *slot = &variables->slots[i];
+		if (slot->name.data == NULL || (slot->hash == hash && string_equals(slot->name, name))) {
+			result = slot;
+			break;
+		}
+	}
+	return result;
+}
+
+// The slot of the variable in the first of the tables that has one, which hides those in the
+// others. NULL if none has.
+static Variable *
+_variables_find_visible(Variables *variables, String name, u64 hash) {
+	Variable *result = NULL;
+	for (Variables *it = variables; it != NULL && result == NULL; it = it->parent) {
+		Variable *variable = it->slots != NULL ? _variables_find(it, name, hash) : NULL;
+		if (variable != NULL && variable->name.data != NULL) {
+			result = variable;
+		}
+	}
+	return result;
+}
+
+// Keeps the table at most half full.
+static bool
+_variables_grow(Variables *variables) {
+	bool ok = true;
+	
+	if (variables->slots == NULL || cast(u64) (variables->count + 1) * 2 > variables->slot_mask + 1) {
+		if (variables->arena.ptr == NULL) {
+			ok = arena_init(&variables->arena);
+		}
+		
+		u64       slot_count = variables->slots == NULL ? 64 : (variables->slot_mask + 1) * 2;
+		Variable *slots      = ok ? push_array(&variables->arena, Variable, slot_count) : NULL;
+		ok = slots != NULL;
+		
+		if (ok) {
+			Variables grown = *variables;
+			grown.slots     = slots;
+			grown.slot_mask = slot_count - 1;
+			
+			for (u64 i = 0; variables->slots != NULL && i <= variables->slot_mask; i += 1) {
+				Variable *variable = &variables->slots[i];
+				if (variable->name.data != NULL) {
+					*_variables_find(&grown, variable->name, variable->hash) = *variable;
+				}
+			}
+			
+			variables->slots     = grown.slots;
+			variables->slot_mask = grown.slot_mask;
+		}
+	}
+	
+	return ok;
+}
+
+static bool
+variables_get(Variables *variables, String name, String *value) {
+	bool result = false;
+	
+	Variable *variable = _variables_find_visible(variables, name, hash_bytes(name, 0));
+	if (variable != NULL && variable->set) {
+		*value = variable->value;
+		result = true;
+	}
+	
+	return result;
+}
+
+static bool
+variables_set(Variables *variables, String name, String value) {
+	bool ok = _variables_grow(variables);
+	
+	if (ok) {
+		u64       hash     = hash_bytes(name, 0);
+		Variable *variable = _variables_find(variables, name, hash);
+		
+		if (variable->name.data == NULL) {
+			Variable *hidden = _variables_find_visible(variables->parent, name, hash);
+			variable->name     = string_clone(&variables->arena, name);
+			variable->hash     = hash;
+			variable->exported = hidden != NULL && hidden->exported;
+			ok = variable->name.data != NULL || name.len == 0;
+			if (ok) variables->count += 1;
+		}
+		
+		if (ok && value.len > variable->cap) {
+			i64 cap = max(value.len, variable->cap * 2);
+			u8 *data = push_nozero(&variables->arena, cap);
+			ok = data != NULL;
+			if (ok) {
+				variable->value.data = data;
+				variable->cap        = cap;
+			}
+		}
+		
+		if (ok) {
+			// The new value may be a slice of the old one. An empty one may have no data.
+			if (value.len > 0) memmove(variable->value.data, value.data, value.len);
+			variable->value.len = value.len;
+			variable->set       = true;
+		}
+	}
+	
+	return ok;
+}
+
+static void
+variables_unset(Variables *variables, String name) {
+	if (variables->parent != NULL) {
+		// The slot hides the variable of the parent.
+		variables_set(variables, name, string_from_lit(""));
+	}
+	
+	if (variables->slots != NULL) {
+		Variable *variable = _variables_find(variables, name, hash_bytes(name, 0));
+		variable->set       = false;
+		variable->value.len = 0;
+	}
+}
+
+static bool
+variables_export(Variables *variables, String name, bool exported) {
+	// The slot goes in this table, with the value the variable has for it.
+	String value = {0};
+	bool   set   = variables_get(variables, name, &value);
+	bool   ok    = variables_set(variables, name, value);
+	if (ok) {
+		Variable *variable = _variables_find(variables, name, hash_bytes(name, 0));
+		variable->exported = exported;
+		variable->set      = set;
+	}
+	return ok;
+}
+
+static bool
+variables_exported(Variables *variables, String name) {
+	Variable *variable = _variables_find_visible(variables, name, hash_bytes(name, 0));
+	return variable != NULL && variable->exported;
+}
+
+static i64
+variables_environment(Arena *arena, Variables *variables, String **env) {
+	i64 count = 0;
+	
+	i64 cap = 0;
+	for (Variables *it = variables; it != NULL; it = it->parent) {
+		cap += it->count;
+	}
+	
+	String *result = push_array(arena, String, cap);
+	for (Variables *it = variables; result != NULL && it != NULL; it = it->parent) {
+		for (u64 i = 0; it->slots != NULL && i <= it->slot_mask; i += 1) {
+			Variable *variable = &it->slots[i];
+			bool visible = variable->name.data != NULL && variable->set &&
+				_variables_find_visible(variables, variable->name, variable->hash) == variable;
+			if (visible && (variable->exported || _expand_lookup_variable(variable->name).data != NULL)) {
+				String value  = variable->value.len > 0 ? variable->value : string_from_lit("");
+				String temp[] = {variable->name, string_from_lit("="), value};
+				result[count] = strings_concat(arena, temp, array_count(temp));
+				count += 1;
+			}
+		}
+	}
+	
+	*env = result;
+	return count;
+}
+
+static String
+variables_lookup(Variables *variables, String name) {
+	String result = {0};
+	if (!variables_get(variables, name, &result)) {
+		result = _expand_lookup_variable(name);
+	}
+	return result;
+}
+
+#endif
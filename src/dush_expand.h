@@ -0,0 +1,117 @@
+#ifndef DUSH_EXPAND_H
+#define DUSH_EXPAND_H
+
+////////////////////////////////
+//~ Glob matching
+
+//- Glob types
+
+// A glob pattern split at every '*'. Matching a name means finding every segment, in order,
+// without overlaps; the first and last segments are anchored to the start and end of the
+// name unless the pattern starts or ends with a '*'.
+typedef struct Glob_Segment Glob_Segment;
+struct Glob_Segment {
+	String  text;
+	u8     *any; // any[i] != 0 if text.data[i] is a '?' wildcard. NULL if the segment has none.
+};
+
+typedef struct Glob_Pattern Glob_Pattern;
+struct Glob_Pattern {
+	Glob_Segment *segments;
+	i64  segment_count;
+	i64  min_len;
+	bool anchored_start;
+	bool anchored_end;
+	bool match_hidden; // Names starting with '.' only match if the pattern does too.
+};
+
+//- Glob functions
+
+// The pattern uses '\' to escape '*', '?' and '\' itself. This escaping is only used internally
+// by the expansion engine; it is not part of the command line syntax.
+static Glob_Pattern glob_compile(Arena *arena, String pattern);
+static bool         glob_match(Glob_Pattern *pattern, String name);
+
+////////////////////////////////
+//~ Command line expansion
+
+//- Expansion types
+
+// All the arguments live in a single block pushed onto the arena: the String array first,
+// then the bytes. Each argument is followed by a null terminator that is not counted in
+// its length, so that argv[i].data can be handed directly to the OS.
+typedef struct Expanded_Command Expanded_Command;
+struct Expanded_Command {
+	String *argv;
+	i64     argc;
+};
+
+//- Expansion functions
+
+// Splits the line into words and expands $NAME and ${NAME} variables and '*' and '?' wildcards.
+//
+// Words are separated by whitespace. Text inside "..." is kept in a single word and variables
+// are still expanded; text inside '...' is copied as it is. Wildcards are only expanded when
+// they are not quoted, and only in the last component of a path (e.g. "src/*.c" but not
+// "*/main.c"). A pattern that matches nothing is kept as it was typed.
+static Expanded_Command expand_command_line(Arena *arena, String line);
+
+// The files that match a pattern escaped like for glob_compile(), sorted, with the directory
+// part of the pattern in front of each. Nothing if no file matches.
+static Expanded_Command expand_glob(Arena *arena, String pattern);
+
+////////////////////////////////
+//~ Variables
+
+//- Variable types
+
+// Shell variables, set by scripts and at the prompt. They hide environment variables with the
+// same name, and processes don't see them unless they are exported, or have the name of one.
+typedef struct Variable Variable;
+struct Variable {
+	String name;
+	String value;
+	i64    cap;  // What value.data has room for, so most assignments don't allocate.
+	u64    hash;
+	bool   set;  // Unset variables keep their slot.
+	bool   exported;
+};
+
+// An open addressing table. Nothing is ever freed until variables_fini(): a value that outgrows
+// its room gets twice as much, so a variable that is assigned in a loop settles quickly.
+typedef struct Variables Variables;
+struct Variables {
+	Arena     arena;
+	Variable *slots;
+	u64       slot_mask; // slot count - 1; the table is empty while slots is NULL.
+	i64       count;
+	
+	// Where the names that have no slot here are looked up, so a scope can see the variables of
+	// another one without copying them, and without changing them: unsetting one of them leaves
+	// an unset slot here.
+	Variables *parent;
+};
+
+//- Variable functions
+
+static void   variables_fini(Variables *variables);
+
+static bool   variables_get(Variables *variables, String name, String *value);
+static bool   variables_set(Variables *variables, String name, String value);
+static void   variables_unset(Variables *variables, String name);
+
+// Marks the variable, set or not yet, to be put in the environment of processes, or no longer.
+// A variable of a scope that hides an exported one of its parent is exported too.
+static bool   variables_export(Variables *variables, String name, bool exported);
+static bool   variables_exported(Variables *variables, String name);
+
+// The exported variables that are set, as NAME=value strings for the environment of a process:
+// the ones marked by variables_export(), and the ones with the name of an environment variable,
+// which they replace. Returns how many there are in *env.
+static i64    variables_environment(Arena *arena, Variables *variables, String **env);
+
+// The shell variable, or else the environment variable, with that name; empty if neither is set.
+// `variables` can be NULL.
+static String variables_lookup(Variables *variables, String name);
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef DUSH_HISTORY_C
+#define DUSH_HISTORY_C
+
+////////////////////////////////
+//~ Command history
+
+//- History record format
+
+// Every record is a header followed by the text of the line, with no terminator. The magic
+// number lets a reader resynchronize after a record that was only partially written (e.g.
+// because dush was killed in the middle of a write).
+#define HISTORY_RECORD_MAGIC 0x31524844 // "DHR1"
+
+typedef struct History_Record_Header History_Record_Header;
+struct History_Record_Header {
+	u32 magic;
+	u32 len;
+	u32 checksum;
+};
+
+static u32
+_history_checksum(String s) {
+	// FNV-1a
+	u32 hash = 2166136261u;
+	for (i64 i = 0; i < s.len; i += 1) {
+		hash ^= s.data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+//- History functions
+
+static bool
+history_init(History *history, String file_name) {
+	memset(history, 0, sizeof(History));
+	
+	bool ok = false;
+	if (arena_init(&history->index_arena)) {
+		history->entries = cast(History_Entry *) history->index_arena.ptr;
+		history->file    = file_open(file_name, File_Open_READ|File_Open_APPEND|File_Open_CREATE);
+		if (history->file.value != 0) {
+			history_refresh(history);
+			ok = true;
+		}
+	}
+	
+	return ok;
+}
+
+static void
+history_fini(History *history) {
+	file_unmap(history->mapping);
+	file_close(history->file);
+	arena_fini(&history->index_arena);
+	memset(history, 0, sizeof(History));
+}
+
+static void
+history_append(History *history, String line) {
+	if (history->file.value != 0 && line.len > 0 && line.len <= cast(i64) UINT32_MAX) {
+		Scratch scratch = scratch_begin(0, 0);
+		
+		History_Record_Header header = {
+			.magic    = HISTORY_RECORD_MAGIC,
+			.len      = cast(u32) line.len,
+			.checksum = _history_checksum(line),
+		};
+		
+		// The record must go out in a single write, or records of different instances could
+		// end up interleaved.
+		String record = push_string(scratch.arena, sizeof(header) + line.len);
+		if (record.data != NULL) {
+			memcpy(record.data, &header, sizeof(header));
+			memcpy(record.data + sizeof(header), line.data, line.len);
+			file_write(history->file, record);
+		}
+		
+		scratch_end(scratch);
+	}
+}
+
+static void
+history_refresh(History *history) {
+	if (history->file.value != 0) {
+		u64 size = file_size(history->file);
+		if (size > cast(u64) history->mapping.len) {
+			file_unmap(history->mapping);
+			history->mapping = file_map(history->file, size);
+			if (history->mapping.data == NULL) {
+				// The entries point into the mapping, so they are useless without it. Start over
+				// on the next refresh.
+				history->entry_count  = 0;
+				history->indexed_size = 0;
+				pop_to(&history->index_arena, 0);
+			}
+		}
+		
+		String magic = string(cast(u8 *) &(u32){HISTORY_RECORD_MAGIC}, sizeof(u32));
+		
+		u8  *data = history->mapping.data;
+		u64  size_mapped = cast(u64) history->mapping.len;
+		u64  at = history->indexed_size;
+		while (at + sizeof(History_Record_Header) <= size_mapped) {
+			History_Record_Header header = {0};
+			memcpy(&header, data + at, sizeof(header));
+			
+			u64 text_offset = at + sizeof(header);
+			bool complete = header.magic == HISTORY_RECORD_MAGIC && text_offset + header.len <= size_mapped;
+			if (complete) {
+				String text = string(data + text_offset, header.len);
+				if (header.checksum == _history_checksum(text)) {
+					History_Entry *entry = push_type(&history->index_arena, History_Entry);
+					if (entry == NULL) break;
+					
+					entry->offset = text_offset;
+					entry->len    = header.len;
+					history->entry_count += 1;
+				}
+				
+				at = text_offset + header.len;
+			} else {
+				// Either garbage or a record that is still being written. If there is another
+				// record after this point, skip to it; otherwise wait for more data.
+				String rest = string(data + at + 1, cast(i64) (size_mapped - at - 1));
+				i64 next = string_find_substring(rest, magic);
+				if (next < 0) break;
+				
+				at = at + 1 + cast(u64) next;
+			}
+		}
+		
+		history->indexed_size = at;
+	}
+}
+
+static String
+history_get(History *history, i64 index) {
+	String result = {0};
+	if (index >= 0 && index < history->entry_count) {
+		History_Entry *entry = &history->entries[index];
+		result = string(history->mapping.data + entry->offset, cast(i64) entry->len);
+	}
+	return result;
+}
+
+// Returns the index of the last entry that starts at or before `offset`.
+static i64
+_history_entry_at(History *history, u64 offset, i64 lo) {
+	i64 hi = history->entry_count - 1;
+	while (lo < hi) {
+		i64 mid = lo + (hi - lo + 1) / 2;
+		if (history->entries[mid].offset <= offset) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+static i64
+history_search(History *history, String text, i64 from) {
+	i64 result = -1;
+	
+	if (from >= 0 && from < history->entry_count) {
+		if (text.len == 0) {
+			result = from;
+		} else {
+			// Search the whole mapping in one go instead of entry by entry: there is only one
+			// call to the substring search for every hit, and none for every miss. Hits that
+			// fall across record boundaries are discarded.
+			u64 at = history->entries[from].offset;
+			while (at < history->indexed_size) {
+				String haystack = string(history->mapping.data + at, cast(i64) (history->indexed_size - at));
+				i64 found = string_find_substring(haystack, text);
+				if (found < 0) break;
+				
+				u64 position = at + cast(u64) found;
+				i64 index = _history_entry_at(history, position, from);
+				
+				History_Entry *entry = &history->entries[index];
+				if (position >= entry->offset && position + text.len <= entry->offset + entry->len) {
+					result = index;
+					break;
+				}
+				
+				at = position + 1;
+			}
+		}
+	}
+	
+	return result;
+}
+
+#endif
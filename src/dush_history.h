@@ -0,0 +1,50 @@
+#ifndef DUSH_HISTORY_H
+#define DUSH_HISTORY_H
+
+////////////////////////////////
+//~ Command history
+
+//- History constants
+
+#if !defined(HISTORY_FILE_NAME)
+#define HISTORY_FILE_NAME ".dush_history"
+#endif
+
+//- History types
+
+// The history file is an append-only log of records, each one written with a single append so
+// that many dush instances can share the same file. The file is memory-mapped and an index of
+// the records is kept in memory; entries are never copied out of the mapping.
+typedef struct History_Entry History_Entry;
+struct History_Entry {
+	u64 offset; // Of the text, in the file.
+	u64 len;
+};
+
+typedef struct History History;
+struct History {
+	Arena          index_arena; // Holds nothing but the entries, so they stay contiguous.
+	History_Entry *entries;
+	i64            entry_count;
+	
+	File_Handle file;
+	SliceU8     mapping;
+	u64         indexed_size; // How much of the file has been turned into entries.
+};
+
+//- History functions
+
+static bool   history_init(History *history, String file_name);
+static void   history_fini(History *history);
+
+static void   history_append(History *history, String line);
+
+// Picks up records appended by other instances since the last call.
+static void   history_refresh(History *history);
+
+static String history_get(History *history, i64 index);
+
+// Returns the index of the first entry at or after `from` that contains the text, or -1.
+static i64    history_search(History *history, String text, i64 from);
+
+#endif
@@ -0,0 +1,746 @@
+#ifndef DUSH_LINE_EDITOR_C
+#define DUSH_LINE_EDITOR_C
+
+////////////////////////////////
+//~ Line editor
+
+//- Line editor helpers
+
+static bool
+_line_editor_is_continuation(u8 c) {
+	return (c & 0xC0) == 0x80;
+}
+
+// How many columns the bytes take on the screen.
+static i64
+_line_editor_columns(u8 *data, i64 from, i64 to) {
+	i64 result = 0;
+	for (i64 i = from; i < to; i += 1) {
+		if (!_line_editor_is_continuation(data[i])) {
+			result += 1;
+		}
+	}
+	return result;
+}
+
+// How many columns the last line of the prompt takes, leaving out escape sequences.
+static i64
+_line_editor_prompt_columns(String prompt) {
+	i64 result = 0;
+	for (i64 i = 0; i < prompt.len; i += 1) {
+		u8 c = prompt.data[i];
+		if (c == '\n' || c == '\r') {
+			result = 0;
+		} else if (c == 0x1B) {
+			// "ESC [ <params> <final>", or ESC and a single character.
+			i += 1;
+			if (i < prompt.len && prompt.data[i] == '[') {
+				i += 1;
+				while (i < prompt.len && !(prompt.data[i] >= 0x40 && prompt.data[i] <= 0x7E)) i += 1;
+			}
+		} else if (c >= 0x20 && !_line_editor_is_continuation(c)) {
+			result += 1;
+		}
+	}
+	return result;
+}
+
+static i64
+_line_editor_prev_char(Line_Editor *editor, i64 at) {
+	if (at > 0) at -= 1;
+	while (at > 0 && _line_editor_is_continuation(editor->buffer[at])) {
+		at -= 1;
+	}
+	return at;
+}
+
+static i64
+_line_editor_next_char(Line_Editor *editor, i64 at) {
+	if (at < editor->len) at += 1;
+	while (at < editor->len && _line_editor_is_continuation(editor->buffer[at])) {
+		at += 1;
+	}
+	return at;
+}
+
+//- Line editor output
+
+static void
+_line_editor_flush(Line_Editor *editor) {
+	if (editor->output_len > 0) {
+		i64 written = print_unbuffered(string(editor->output, editor->output_len));
+		editor->bytes_written += cast(u64) written;
+		editor->writes += 1;
+		editor->output_len = 0;
+	}
+}
+
+static void
+_line_editor_emit(Line_Editor *editor, String s) {
+	while (s.len > 0) {
+		if (editor->output_len == array_count(editor->output)) {
+			_line_editor_flush(editor);
+		}
+		
+		i64 to_copy = min(s.len, array_count(editor->output) - editor->output_len);
+		memcpy(editor->output + editor->output_len, s.data, to_copy);
+		editor->output_len += to_copy;
+		s = string_skip(s, to_copy);
+	}
+}
+
+// Cost in bytes of a CSI sequence with a single numeric parameter; the parameter is left
+// out when it is 1, since that is the default.
+static i64
+_line_editor_csi_cost(i64 n) {
+	i64 digits = 0;
+	if (n != 1) {
+		for (i64 m = n; m > 0; m /= 10) digits += 1;
+	}
+	return 3 + digits;
+}
+
+static void
+_line_editor_emit_csi(Line_Editor *editor, i64 n, u8 final) {
+	u8 sequence[32];
+	int len = 0;
+	if (n != 1) {
+		len = snprintf(cast(char *) sequence, sizeof(sequence), "\x1b[%lld%c", cast(long long) n, final);
+	} else {
+		len = snprintf(cast(char *) sequence, sizeof(sequence), "\x1b[%c", final);
+	}
+	_line_editor_emit(editor, string(sequence, len));
+}
+
+// How many bytes _line_editor_move() would emit.
+static i64
+_line_editor_move_cost(u8 *content, i64 from, i64 to) {
+	i64 result = 0;
+	if (to < from) {
+		i64 columns = _line_editor_columns(content, to, from);
+		result = min(columns, _line_editor_csi_cost(columns));
+	} else if (to > from) {
+		i64 columns = _line_editor_columns(content, from, to);
+		result = min(to - from, _line_editor_csi_cost(columns));
+	}
+	return result;
+}
+
+// Moves the terminal cursor between two byte offsets of `content`, which must be what the
+// terminal shows in that range. Picks whatever takes the fewest bytes: backspaces or a CSI
+// sequence to go left, reprinting the characters or a CSI sequence to go right.
+static void
+_line_editor_move(Line_Editor *editor, u8 *content, i64 from, i64 to) {
+	if (to < from) {
+		i64 columns = _line_editor_columns(content, to, from);
+		if (columns <= _line_editor_csi_cost(columns)) {
+			for (i64 i = 0; i < columns; i += 1) {
+				_line_editor_emit(editor, string_from_lit("\b"));
+			}
+		} else {
+			_line_editor_emit_csi(editor, columns, 'D');
+		}
+	} else if (to > from) {
+		i64 columns = _line_editor_columns(content, from, to);
+		if (to - from <= _line_editor_csi_cost(columns)) {
+			_line_editor_emit(editor, string(content + from, to - from));
+		} else {
+			_line_editor_emit_csi(editor, columns, 'C');
+		}
+	}
+}
+
+//- Line editor rows
+
+// Where byte offset `at` of `content` is on the screen. See Line_Editor.
+static i64
+_line_editor_position(Line_Editor *editor, u8 *content, i64 at) {
+	return editor->prompt_columns + _line_editor_columns(content, 0, at);
+}
+
+// Moves the terminal cursor between two positions, which can be on different rows.
+static void
+_line_editor_move_rows(Line_Editor *editor, i64 from, i64 to) {
+	i64 from_row    = from / editor->columns;
+	i64 to_row      = to / editor->columns;
+	i64 from_column = from % editor->columns;
+	i64 to_column   = to % editor->columns;
+	
+	if (to_row < from_row) {
+		_line_editor_emit_csi(editor, from_row - to_row, 'A');
+	} else if (to_row > from_row) {
+		_line_editor_emit_csi(editor, to_row - from_row, 'B');
+	}
+	
+	if (to_column < from_column) {
+		if (to_column == 0) {
+			_line_editor_emit(editor, string_from_lit("\r"));
+		} else {
+			_line_editor_emit_csi(editor, from_column - to_column, 'D');
+		}
+	} else if (to_column > from_column) {
+		_line_editor_emit_csi(editor, to_column - from_column, 'C');
+	}
+}
+
+// After printing up to the right edge, terminals leave the cursor on the last column until the
+// next character. Going to the next row right away keeps the cursor where the positions say.
+static void
+_line_editor_wrap_at_edge(Line_Editor *editor, i64 position) {
+	if (position > 0 && position % editor->columns == 0) {
+		_line_editor_emit(editor, string_from_lit("\n"));
+	}
+}
+
+// Brings a line that takes more than one row up to date: everything after the part that didn't
+// change is printed again, and whatever the old line had past its end is erased.
+static void
+_line_editor_refresh_rows(Line_Editor *editor) {
+	u8 *buffer = editor->buffer;
+	u8 *shown  = editor->shown;
+	i64 len       = editor->len;
+	i64 shown_len = editor->shown_len;
+	i64 common    = min(len, shown_len);
+	
+	i64 prefix = 0;
+	while (prefix < common && buffer[prefix] == shown[prefix]) prefix += 1;
+	while (prefix > 0 && ((prefix < len       && _line_editor_is_continuation(buffer[prefix])) ||
+						  (prefix < shown_len && _line_editor_is_continuation(shown[prefix])))) {
+		prefix -= 1;
+	}
+	
+	i64 end = _line_editor_position(editor, buffer, len);
+	if (prefix == len && prefix == shown_len) {
+		_line_editor_move_rows(editor, _line_editor_position(editor, shown, editor->shown_cursor), _line_editor_position(editor, buffer, editor->cursor));
+	} else {
+		_line_editor_move_rows(editor, _line_editor_position(editor, shown, editor->shown_cursor), _line_editor_position(editor, shown, prefix));
+		
+		if (len > prefix) {
+			_line_editor_emit(editor, string(buffer + prefix, len - prefix));
+			_line_editor_wrap_at_edge(editor, end);
+		}
+		if (_line_editor_position(editor, shown, shown_len) > end) {
+			_line_editor_emit(editor, string_from_lit("\x1b[J"));
+		}
+		
+		_line_editor_move_rows(editor, end, _line_editor_position(editor, buffer, editor->cursor));
+	}
+}
+
+// Moves below the line, e.g. to print something else.
+static void
+_line_editor_leave(Line_Editor *editor) {
+	i64 end = _line_editor_position(editor, editor->shown, editor->shown_len);
+	_line_editor_move_rows(editor, _line_editor_position(editor, editor->shown, editor->shown_cursor), end);
+	
+	// A line that ends at the right edge already went to the next row.
+	if (end == 0 || end % editor->columns != 0) {
+		// Output post-processing is still on, so this becomes "\r\n".
+		_line_editor_emit(editor, string_from_lit("\n"));
+	}
+}
+
+//- Line editor refresh
+
+// A way to turn what is shown into the current line: everything between a common prefix and
+// a common suffix is replaced. Either everything after the prefix is reprinted, or only the
+// middle is, using the terminal's insert/delete character sequences to shift the suffix.
+typedef struct Line_Editor_Diff Line_Editor_Diff;
+struct Line_Editor_Diff {
+	i64  prefix;
+	i64  suffix;
+	bool reprint;
+	i64  cost;
+};
+
+static Line_Editor_Diff
+_line_editor_diff(Line_Editor *editor, bool prefix_first) {
+	Line_Editor_Diff diff = {0};
+	
+	u8 *buffer = editor->buffer;
+	u8 *shown  = editor->shown;
+	i64 len       = editor->len;
+	i64 shown_len = editor->shown_len;
+	i64 common    = min(len, shown_len);
+	
+	// When the prefix and the suffix could overlap (e.g. "ab" -> "abab") there is more than one
+	// way to split the line, so the caller tries both.
+	if (prefix_first) {
+		while (diff.prefix < common && buffer[diff.prefix] == shown[diff.prefix]) diff.prefix += 1;
+		while (diff.suffix < common - diff.prefix && buffer[len - 1 - diff.suffix] == shown[shown_len - 1 - diff.suffix]) diff.suffix += 1;
+	} else {
+		while (diff.suffix < common && buffer[len - 1 - diff.suffix] == shown[shown_len - 1 - diff.suffix]) diff.suffix += 1;
+		while (diff.prefix < common - diff.suffix && buffer[diff.prefix] == shown[diff.prefix]) diff.prefix += 1;
+	}
+	
+	// Don't split code points.
+	while (diff.prefix > 0 && ((diff.prefix < len       && _line_editor_is_continuation(buffer[diff.prefix])) ||
+							   (diff.prefix < shown_len && _line_editor_is_continuation(shown[diff.prefix])))) {
+		diff.prefix -= 1;
+	}
+	while (diff.suffix > 0 && (_line_editor_is_continuation(buffer[len - diff.suffix]) ||
+							   _line_editor_is_continuation(shown[shown_len - diff.suffix]))) {
+		diff.suffix -= 1;
+	}
+	
+	i64 old_columns = _line_editor_columns(shown, diff.prefix, shown_len - diff.suffix);
+	i64 new_columns = _line_editor_columns(buffer, diff.prefix, len - diff.suffix);
+	i64 new_middle_len = len - diff.suffix - diff.prefix;
+	
+	// When the line gets shorter by a single column, " \b" is cheaper than erasing to the end.
+	i64 cleared_columns = _line_editor_columns(shown, 0, shown_len) - _line_editor_columns(buffer, 0, len);
+	i64 clear_cost = cleared_columns <= 0 ? 0 : cleared_columns == 1 ? 2 : 3;
+	
+	i64 start_cost   = _line_editor_move_cost(shown, editor->shown_cursor, diff.prefix);
+	i64 reprint_cost = (len - diff.prefix) + clear_cost + _line_editor_move_cost(buffer, len, editor->cursor);
+	i64 edit_cost    = new_middle_len + _line_editor_move_cost(buffer, diff.prefix + new_middle_len, editor->cursor);
+	if (old_columns != new_columns) {
+		edit_cost += _line_editor_csi_cost(old_columns > new_columns ? old_columns - new_columns : new_columns - old_columns);
+	}
+	
+	diff.reprint = diff.suffix == 0 || reprint_cost <= edit_cost;
+	diff.cost    = start_cost + (diff.reprint ? reprint_cost : edit_cost);
+	return diff;
+}
+
+// Brings the terminal up to date with the line, then flushes.
+static void
+_line_editor_refresh(Line_Editor *editor) {
+	u8 *buffer = editor->buffer;
+	u8 *shown  = editor->shown;
+	i64 len       = editor->len;
+	i64 shown_len = editor->shown_len;
+	
+	i64 longest = max(_line_editor_columns(buffer, 0, len), _line_editor_columns(shown, 0, shown_len));
+	if (editor->prompt_columns + longest >= editor->columns) {
+		_line_editor_refresh_rows(editor);
+		
+		memcpy(editor->shown, buffer, len);
+		editor->shown_len = len;
+	} else if (len == shown_len && memcmp(buffer, shown, len) == 0) {
+		_line_editor_move(editor, buffer, editor->shown_cursor, editor->cursor);
+	} else {
+		Line_Editor_Diff diff = _line_editor_diff(editor, true);
+		Line_Editor_Diff other = _line_editor_diff(editor, false);
+		if (other.cost < diff.cost) {
+			diff = other;
+		}
+		
+		i64 old_columns = _line_editor_columns(shown, diff.prefix, shown_len - diff.suffix);
+		i64 new_columns = _line_editor_columns(buffer, diff.prefix, len - diff.suffix);
+		String new_middle = string(buffer + diff.prefix, len - diff.suffix - diff.prefix);
+		
+		// Moving left costs the same either way. Moving right only goes through the prefix,
+		// which is the same on the screen and in the buffer.
+		_line_editor_move(editor, shown, editor->shown_cursor, diff.prefix);
+		
+		i64 screen_cursor = 0;
+		if (diff.reprint) {
+			_line_editor_emit(editor, string(buffer + diff.prefix, len - diff.prefix));
+			
+			i64 cleared_columns = _line_editor_columns(shown, 0, shown_len) - _line_editor_columns(buffer, 0, len);
+			if (cleared_columns == 1) {
+				_line_editor_emit(editor, string_from_lit(" \b"));
+			} else if (cleared_columns > 0) {
+				_line_editor_emit(editor, string_from_lit("\x1b[K"));
+			}
+			screen_cursor = len;
+		} else {
+			if (new_columns > old_columns) {
+				_line_editor_emit_csi(editor, new_columns - old_columns, '@');
+			}
+			_line_editor_emit(editor, new_middle);
+			if (old_columns > new_columns) {
+				_line_editor_emit_csi(editor, old_columns - new_columns, 'P');
+			}
+			screen_cursor = diff.prefix + new_middle.len;
+		}
+		
+		_line_editor_move(editor, buffer, screen_cursor, editor->cursor);
+		
+		memcpy(editor->shown, buffer, len);
+		editor->shown_len = len;
+	}
+	
+	editor->shown_cursor = editor->cursor;
+	_line_editor_flush(editor);
+}
+
+//- Line editor editing
+
+static bool
+_line_editor_reserve(Line_Editor *editor, Arena *arena, i64 needed) {
+	bool ok = needed <= editor->cap;
+	if (!ok) {
+		i64 new_cap = max(editor->cap * 2, needed);
+		u8 *new_buffer = push_nozero(arena, new_cap);
+		u8 *new_shown  = push_nozero(arena, new_cap);
+		if (new_buffer != NULL && new_shown != NULL) {
+			memcpy(new_buffer, editor->buffer, editor->len);
+			memcpy(new_shown,  editor->shown,  editor->shown_len);
+			editor->buffer = new_buffer;
+			editor->shown  = new_shown;
+			editor->cap    = new_cap;
+			ok = true;
+		}
+	}
+	return ok;
+}
+
+static void
+_line_editor_insert(Line_Editor *editor, Arena *arena, String s) {
+	if (_line_editor_reserve(editor, arena, editor->len + s.len)) {
+		memmove(editor->buffer + editor->cursor + s.len, editor->buffer + editor->cursor, editor->len - editor->cursor);
+		memcpy(editor->buffer + editor->cursor, s.data, s.len);
+		editor->len    += s.len;
+		editor->cursor += s.len;
+	}
+}
+
+static void
+_line_editor_delete(Line_Editor *editor, i64 from, i64 to) {
+	if (to > from) {
+		memmove(editor->buffer + from, editor->buffer + to, editor->len - to);
+		editor->len -= to - from;
+		editor->cursor = from;
+	}
+}
+
+static void
+_line_editor_set(Line_Editor *editor, Arena *arena, String s) {
+	if (_line_editor_reserve(editor, arena, s.len)) {
+		memcpy(editor->buffer, s.data, s.len);
+		editor->len    = s.len;
+		editor->cursor = s.len;
+	}
+}
+
+static void
+_line_editor_history_move(Line_Editor *editor, Arena *arena, i64 direction) {
+	History *history = editor->history;
+	if (history != NULL) {
+		if (editor->history_index < 0) {
+			if (direction > 0) return;
+			
+			// Only look for entries added by other instances when the user starts going back.
+			history_refresh(history);
+			editor->draft = string_clone(arena, string(editor->buffer, editor->len));
+			editor->history_index = history->entry_count;
+		}
+		
+		i64 index = editor->history_index + direction;
+		if (index >= 0 && index < history->entry_count) {
+			editor->history_index = index;
+			_line_editor_set(editor, arena, history_get(history, index));
+		} else if (index >= history->entry_count) {
+			editor->history_index = -1;
+			_line_editor_set(editor, arena, editor->draft);
+		}
+	}
+}
+
+//- Line editor prompt
+
+// Prints the prompt where the cursor is. The whole line is printed again by the next refresh.
+static void
+_line_editor_emit_prompt(Line_Editor *editor) {
+	_line_editor_emit(editor, editor->prompt_text);
+	editor->prompt_columns = _line_editor_prompt_columns(editor->prompt_text);
+	_line_editor_wrap_at_edge(editor, editor->prompt_columns);
+	editor->shown_len = editor->shown_cursor = 0;
+}
+
+// Prints the prompt and the line again, e.g. because the prompt changed or the terminal was
+// resized. The start of the prompt's last line is found with the width it was printed for.
+static void
+_line_editor_redraw(Line_Editor *editor) {
+	i64 rows = _line_editor_position(editor, editor->shown, editor->shown_cursor) / editor->columns;
+	if (rows > 0) {
+		_line_editor_emit_csi(editor, rows, 'A');
+	}
+	_line_editor_emit(editor, string_from_lit("\r"));
+	
+	editor->columns = console_columns();
+	_line_editor_emit_prompt(editor);
+	_line_editor_emit(editor, string_from_lit("\x1b[J"));
+	_line_editor_refresh(editor);
+}
+
+// Redraws the prompt if it changed since it was printed, e.g. because a segment computed in the
+// background is ready.
+static void
+_line_editor_update_prompt(Line_Editor *editor, Arena *arena) {
+	String text = {0};
+	if (editor->prompt != NULL && prompt_poll(editor->prompt, arena, &text)) {
+		editor->prompt_text = text;
+		_line_editor_redraw(editor);
+	}
+}
+
+//- Line editor completion
+
+// Prints the candidates in columns under the line, sorted top to bottom, then the prompt again.
+static void
+_line_editor_list(Line_Editor *editor, Completion *completion) {
+	i64 listed = min(completion->count, LINE_EDITOR_MAX_LISTED);
+	
+	i64 width = 0;
+	for (i64 i = 0; i < listed; i += 1) {
+		String display = string_skip(completion->candidates[i], completion->display_skip);
+		width = max(width, _line_editor_columns(display.data, 0, display.len));
+	}
+	width += 2;
+	
+	i64 per_row = max(editor->columns / width, 1);
+	i64 rows    = (listed + per_row - 1) / per_row;
+	
+	_line_editor_leave(editor);
+	
+	for (i64 row = 0; row < rows; row += 1) {
+		for (i64 column = 0; column < per_row; column += 1) {
+			i64 i = column * rows + row;
+			if (i >= listed) break;
+			
+			String display = string_skip(completion->candidates[i], completion->display_skip);
+			_line_editor_emit(editor, display);
+			
+			bool last_in_row = column == per_row - 1 || i + rows >= listed;
+			if (!last_in_row) {
+				for (i64 pad = _line_editor_columns(display.data, 0, display.len); pad < width; pad += 1) {
+					_line_editor_emit(editor, string_from_lit(" "));
+				}
+			}
+		}
+		_line_editor_emit(editor, string_from_lit("\n"));
+	}
+	
+	if (listed < completion->count) {
+		u8 more[64];
+		int len = snprintf(cast(char *) more, sizeof(more), "(%lld more)\n", cast(long long) (completion->count - listed));
+		_line_editor_emit(editor, string(more, len));
+	}
+	
+	_line_editor_emit_prompt(editor);
+}
+
+static void
+_line_editor_complete(Line_Editor *editor, Arena *arena) {
+	Completion completion = complete_line(editor->completion, arena, string(editor->buffer, editor->len), editor->cursor);
+	String word = string(editor->buffer + completion.word_start, editor->cursor - completion.word_start);
+	
+	if (completion.count == 1) {
+		// Finish the word, unless it's a directory that can be completed further.
+		String candidate = completion.candidates[0];
+		bool is_directory = candidate.len > 0 && is_separator(candidate.data[candidate.len - 1]) && !completion.is_command;
+		
+		_line_editor_delete(editor, completion.word_start, editor->cursor);
+		_line_editor_insert(editor, arena, candidate);
+		if (!is_directory) {
+			_line_editor_insert(editor, arena, string_from_lit(" "));
+		}
+	} else if (completion.count > 1 && completion.common.len > word.len) {
+		_line_editor_delete(editor, completion.word_start, editor->cursor);
+		_line_editor_insert(editor, arena, completion.common);
+	} else if (completion.count > 1 && editor->last_was_tab) {
+		_line_editor_list(editor, &completion);
+	} else {
+		_line_editor_emit(editor, string_from_lit("\a"));
+	}
+}
+
+//- Line editor functions
+
+static void
+line_editor_init(Line_Editor *editor, History *history, Completion_Index *completion, Prompt *prompt) {
+	memset(editor, 0, sizeof(Line_Editor));
+	editor->history    = history;
+	editor->completion = completion;
+	editor->prompt     = prompt;
+}
+
+static String
+line_editor_read(Line_Editor *editor, Arena *arena, String prompt) {
+	String result = {0};
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	
+	editor->buffer = NULL;
+	editor->shown  = NULL;
+	editor->len = editor->cap = editor->cursor = 0;
+	editor->shown_len = editor->shown_cursor = 0;
+	editor->draft = string_from_lit("");
+	editor->history_index = -1;
+	editor->eof = false;
+	editor->interrupted = false;
+	editor->last_was_tab = false;
+	editor->prompt_text = prompt;
+	_line_editor_reserve(editor, scratch.arena, 256);
+	
+	if (console_enter_raw_mode()) {
+		editor->columns = console_columns();
+		_line_editor_emit_prompt(editor);
+		_line_editor_flush(editor);
+		
+		// Keys typed after the last Enter are still in the input buffer.
+		u8  *input = editor->input;
+		bool done  = false;
+		bool read_more = editor->input_len == 0;
+		while (!done) {
+			if (read_more) {
+				Console_Waker waker = editor->prompt != NULL ? editor->prompt->waker : (Console_Waker){0};
+				i64 nread = console_read_or_wake(input + editor->input_len, array_count(editor->input) - editor->input_len, waker);
+				if (nread == CONSOLE_WOKEN) {
+					_line_editor_update_prompt(editor, scratch.arena);
+					continue;
+				}
+				if (nread == CONSOLE_RESIZED) {
+					// Only a new width changes where the rows break.
+					if (console_columns() != editor->columns) {
+						_line_editor_redraw(editor);
+					}
+					continue;
+				}
+				if (nread <= 0) {
+					editor->eof = true;
+					break;
+				}
+				editor->input_len += nread;
+			}
+			read_more = true;
+			
+			i64 input_len = editor->input_len;
+			
+			// Handle every key in the batch (more than one when pasting or typing fast), then
+			// redraw once.
+			i64 at = 0;
+			while (at < input_len && !done) {
+				u8  c = input[at];
+				i64 consumed = 1;
+				
+				if (c == '\r' || c == '\n') {
+					done = true;
+				} else if (c == 0x03) { // Ctrl+C: abandon the line
+					editor->cursor = editor->len;
+					_line_editor_refresh(editor);
+					_line_editor_emit(editor, string_from_lit("^C\n"));
+					editor->len = editor->cursor = 0;
+					editor->shown_len = editor->shown_cursor = 0;
+					editor->interrupted = true;
+					done = true;
+				} else if (c == 0x04) { // Ctrl+D
+					if (editor->len == 0) {
+						editor->eof = true;
+						done = true;
+					} else {
+						_line_editor_delete(editor, editor->cursor, _line_editor_next_char(editor, editor->cursor));
+					}
+				} else if (c == 0x7F || c == 0x08) { // Backspace
+					_line_editor_delete(editor, _line_editor_prev_char(editor, editor->cursor), editor->cursor);
+				} else if (c == 0x01) { // Ctrl+A
+					editor->cursor = 0;
+				} else if (c == 0x05) { // Ctrl+E
+					editor->cursor = editor->len;
+				} else if (c == 0x02) { // Ctrl+B
+					editor->cursor = _line_editor_prev_char(editor, editor->cursor);
+				} else if (c == 0x06) { // Ctrl+F
+					editor->cursor = _line_editor_next_char(editor, editor->cursor);
+				} else if (c == 0x0B) { // Ctrl+K
+					editor->len = editor->cursor;
+				} else if (c == 0x15) { // Ctrl+U
+					_line_editor_delete(editor, 0, editor->cursor);
+				} else if (c == 0x17) { // Ctrl+W
+					i64 from = editor->cursor;
+					while (from > 0 && isspace(editor->buffer[from - 1])) from -= 1;
+					while (from > 0 && !isspace(editor->buffer[from - 1])) from -= 1;
+					_line_editor_delete(editor, from, editor->cursor);
+				} else if (c == 0x10) { // Ctrl+P
+					_line_editor_history_move(editor, scratch.arena, -1);
+				} else if (c == 0x0E) { // Ctrl+N
+					_line_editor_history_move(editor, scratch.arena, +1);
+				} else if (c == 0x1B) {
+					// Escape sequences: "ESC [ <params> <final>" or "ESC O <final>". If the
+					// sequence was split between reads, wait for the rest of it. An Escape that
+					// doesn't start one is only the Escape key, which does nothing.
+					i64 end = at + 1;
+					String params = {0};
+					bool is_sequence = end < input_len && (input[end] == '[' || input[end] == 'O');
+					if (is_sequence) {
+						end += 1;
+						params.data = input + end;
+						while (end < input_len && (isdigit(input[end]) || input[end] == ';')) end += 1;
+						params.len = end - (params.data - input);
+					}
+					
+					if (!is_sequence) {
+						consumed = 1;
+					} else if (end >= input_len) {
+						// Incomplete. Wait for the rest, unless there's no room for it.
+						consumed = input_len < array_count(editor->input) ? 0 : input_len - at;
+					} else {
+						u8 final = input[end];
+						consumed = end - at + 1;
+						
+						if (final == 'A') {
+							_line_editor_history_move(editor, scratch.arena, -1);
+						} else if (final == 'B') {
+							_line_editor_history_move(editor, scratch.arena, +1);
+						} else if (final == 'C') {
+							editor->cursor = _line_editor_next_char(editor, editor->cursor);
+						} else if (final == 'D') {
+							editor->cursor = _line_editor_prev_char(editor, editor->cursor);
+						} else if (final == 'H' || (final == '~' && (string_equals(params, string_from_lit("1")) ||
+																	 string_equals(params, string_from_lit("7"))))) {
+							editor->cursor = 0;
+						} else if (final == 'F' || (final == '~' && (string_equals(params, string_from_lit("4")) ||
+																	 string_equals(params, string_from_lit("8"))))) {
+							editor->cursor = editor->len;
+						} else if (final == '~' && string_equals(params, string_from_lit("3"))) {
+							_line_editor_delete(editor, editor->cursor, _line_editor_next_char(editor, editor->cursor));
+						}
+					}
+				} else if (c == '\t') {
+					_line_editor_complete(editor, scratch.arena);
+				} else if (c >= 0x20) {
+					// Insert the whole run of printable bytes at once.
+					i64 end = at + 1;
+					while (end < input_len && input[end] >= 0x20 && input[end] != 0x7F) end += 1;
+					consumed = end - at;
+					_line_editor_insert(editor, scratch.arena, string(input + at, consumed));
+				}
+				
+				if (consumed == 0) break;
+				at += consumed;
+				editor->last_was_tab = c == '\t';
+			}
+			
+			memmove(input, input + at, input_len - at);
+			editor->input_len = input_len - at;
+			
+			if (done) {
+				editor->cursor = editor->len;
+			}
+			_line_editor_refresh(editor);
+		}
+		
+		if (!editor->interrupted) {
+			_line_editor_leave(editor);
+		}
+		_line_editor_flush(editor);
+		console_leave_raw_mode();
+	} else {
+		editor->unavailable = true;
+	}
+	
+	result = string_clone(arena, string(editor->buffer, editor->len));
+	
+	editor->buffer = NULL;
+	editor->shown  = NULL;
+	editor->draft  = string_from_lit("");
+	editor->prompt_text = string_from_lit("");
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef DUSH_LINE_EDITOR_H
+#define DUSH_LINE_EDITOR_H
+
+////////////////////////////////
+//~ Line editor
+
+//- Line editor constants
+
+#if !defined(LINE_EDITOR_OUTPUT_CAP)
+#define LINE_EDITOR_OUTPUT_CAP kilobytes(4)
+#endif
+
+// Past this many completion candidates, only the first ones are listed.
+#if !defined(LINE_EDITOR_MAX_LISTED)
+#define LINE_EDITOR_MAX_LISTED 256
+#endif
+
+//- Line editor types
+
+// Edits a line in raw mode, after printing the prompt.
+//
+// The editor remembers what the terminal shows and, after every batch of input, emits only
+// the escape sequences and characters needed to turn that into the current line, all in a
+// single write. While the line fits in the prompt's row, typing at the end of the line costs
+// one byte per key, and inserting or deleting in the middle uses the terminal's insert/delete
+// character sequences instead of reprinting the rest of the line.
+//
+// If the prompt was printed before all of its segments were ready, it is redrawn as soon as
+// they are, without waiting for a key press.
+//
+// Tab completes the word before the cursor. When there is more than one candidate it completes
+// as much as they have in common; a second Tab lists them and prints the prompt again.
+//
+// Lines that don't fit in the rest of the prompt's row wrap onto the rows below it, and the
+// editor moves the cursor up and down between them. The width of the terminal is queried again
+// when it is resized. Every code point is assumed to take one column.
+typedef struct Line_Editor Line_Editor;
+struct Line_Editor {
+	History          *history;
+	Completion_Index *completion;
+	Prompt           *prompt;
+	
+	String prompt_text;
+	
+	// Width of the terminal, and how many columns the last line of the prompt takes. Positions
+	// on the screen count columns from the start of that line, so the row is position / columns.
+	i64 columns;
+	i64 prompt_columns;
+	
+	// The line being edited. The cursor is a byte offset.
+	u8  *buffer;
+	i64  len;
+	i64  cap;
+	i64  cursor;
+	
+	// What the terminal shows after the prompt, and where its cursor is.
+	u8  *shown;
+	i64  shown_len;
+	i64  shown_cursor;
+	
+	// The line that was being typed before moving through the history.
+	String draft;
+	i64    history_index;
+	
+	// Input that was read but not handled yet, e.g. keys typed after Enter.
+	u8  input[256];
+	i64 input_len;
+	
+	u8  output[LINE_EDITOR_OUTPUT_CAP];
+	i64 output_len;
+	
+	bool last_was_tab;
+	bool eof;
+	bool interrupted; // Ctrl+C abandoned the line.
+	bool unavailable; // The terminal can't be put in raw mode.
+	
+	// Statistics
+	u64 bytes_written;
+	u64 writes;
+};
+
+//- Line editor functions
+
+// The history, the completion index and the prompt can be NULL.
+static void   line_editor_init(Line_Editor *editor, History *history, Completion_Index *completion, Prompt *prompt);
+
+// Reads a line. Sets editor->eof if the user asked to quit (Ctrl+D on an empty line) or
+// the input was closed, editor->interrupted if Ctrl+C abandoned it, and editor->unavailable if the terminal doesn't support raw mode.
+// Nothing is printed if the terminal doesn't support raw mode, not even the prompt.
+static String line_editor_read(Line_Editor *editor, Arena *arena, String prompt);
+
+#endif
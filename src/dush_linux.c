@@ -9,11 +9,16 @@
 static void
 INT_handler(int sig) {
 	(void)sig;
+	ctrl_c_pressed = 1;
 }
 
 static void
 init_ctrl_c_handler(void) {
-	signal(SIGINT, INT_handler);
+	static bool installed = false;
+	if (!installed) {
+		signal(SIGINT, INT_handler);
+		installed = true;
+	}
 }
 
 ////////////////////////////////
@@ -85,17 +90,84 @@ get_current_directory(Arena *arena) {
 
 static String
 get_system_path(Arena *arena) {
-	unimplemented();
+	String result = {0};
 	
-	(void)arena;
-	return string_from_lit("");
+	char *path = getenv("PATH");
+	if (path != NULL) {
+		result = string_clone(arena, string_from_cstring(path));
+	}
+	
+	return result;
+}
+
+// Searches the PATH like execvp() does, for an executable regular file. Gives up on empty entries,
+// which are the current directory and so can't be remembered. Sets `missing` when it looked
+// everywhere execvp() would and there was no file by that name, so that starting it would fail.
+static String
+find_executable(Arena *arena, Path_Cache *cache, String command, bool *missing) {
+	String result = {0};
+	*missing = false;
+	
+	if (command.len > 0 && !string_contains(command, '/')) {
+		Trace_Span span = trace_begin("find in path", command);
+		
+		// Without a PATH, execvp() has a default one.
+		bool searched = cache->count > 0;
+		for (i64 i = 0; i < cache->count; i += 1) {
+			if (cache->entries[i].dir.path.len == 0) {
+				searched = false;
+				break;
+			}
+			
+			Directory_Handle dir = path_cache_directory(cache, i);
+			if (file_is_executable_in(dir, command)) {
+				String temp[] = {dir.path, string_from_lit("/"), command};
+				result = strings_concat(arena, temp, array_count(temp));
+				break;
+			}
+			
+			// What to say about a file that's there but can't be run is left to execvp().
+			if (last_file_error != File_Error_NOT_EXISTS) searched = false;
+		}
+		*missing = searched && result.len == 0;
+		
+		trace_end(span);
+	}
+	
+	return result;
+}
+
+static String
+get_home_directory(Arena *arena) {
+	String result = {0};
+	
+	char *home = getenv("HOME");
+	if (home != NULL) {
+		result = string_clone(arena, string_from_cstring(home));
+	}
+	
+	return result;
 }
 
 ////////////////////////////////
 //~ Other
 
-static void
+static bool
+set_environment_variable(String name, String value) {
+	Scratch scratch = scratch_begin(0, 0);
+	
+	char *name_nt  = cstring_from_string(scratch.arena, name);
+	char *value_nt = cstring_from_string(scratch.arena, value);
+	bool  ok = name_nt != NULL && value_nt != NULL && setenv(name_nt, value_nt, 1) == 0;
+	
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
 set_current_directory(String dir) {
+	bool ok = false;
 	Scratch scratch = scratch_begin(0, 0);
 	
 	char *dir_nt = cstring_from_string(scratch.arena, dir);
@@ -105,14 +177,18 @@ set_current_directory(String dir) {
 			// about what can go wrong.
 			fprintf(stderr, "Could not change directory to '%s': %s.\n",
 					dir_nt, strerror(errno));
+		} else {
+			ok = true;
 		}
 	} else {
 		errno = ENOMEM;
-		fprintf(stderr, "Could not change directory to '%s': %s.\n",
-				dir_nt, strerror(errno));
+		fprintf(stderr, "Could not change directory to '%.*s': %s.\n",
+				string_expand(dir), strerror(errno));
 	}
 	
 	scratch_end(scratch);
+	
+	return ok;
 }
 
 #endif
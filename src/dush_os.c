@@ -79,13 +79,118 @@ path_base(String path) {
 	return base;
 }
 
+static String
+path_list_next(String *list) {
+	String result = {0};
+	if (list->data != NULL) {
+		i64 split_index = string_find_first(*list, get_path_list_separator());
+		if (split_index >= 0) {
+			result = string_stop(*list, split_index);
+			*list  = string_skip(*list, split_index + 1);
+		} else {
+			result = *list;
+			*list  = (String){0};
+		}
+		
+		// Keep empty entries distinguishable from the end of the list.
+		if (result.data == NULL) result.data = cast(u8 *) "";
+	}
+	return result;
+}
+
 ////////////////////////////////
 //~ Basic file management
 
+// For the files whose size doesn't say how much there is to read: pipes and devices have none,
+// and the files of /proc say they are empty. Reads through `stream` if it isn't NULL, and
+// through `file` otherwise, in chunks pushed one after the other so that the contents stay in
+// one piece; what the last chunk didn't need is given back.
 static Read_File_Result
-read_file(Arena *arena, String file_name) {
-	last_file_error = File_Error_NONE;
+_read_file_in_chunks(Arena *arena, File_Handle file, FILE *stream) {
+	Read_File_Result result = {0};
 	
+	u64 start = arena_pos(*arena);
+	u8 *data  = NULL;
+	i64 len   = 0;
+	while (!result.ok) {
+		u8 *chunk = push_nozero(arena, READ_FILE_CHUNK_SIZE);
+		if (chunk == NULL) {
+			assert(last_alloc_error);
+			break;
+		}
+		if (data == NULL) data = chunk;
+		assert(chunk == data + len);
+		
+		i64 read_amount = 0;
+		if (stream != NULL) {
+			read_amount = cast(i64) fread(chunk, sizeof(u8), READ_FILE_CHUNK_SIZE, stream);
+			if (ferror(stream)) {
+				last_file_error = errno == EISDIR ? File_Error_IS_DIRECTORY : File_Error_READ_FAILED;
+				read_amount = -1;
+			}
+		} else {
+			read_amount = file_read(file, chunk, READ_FILE_CHUNK_SIZE);
+		}
+		if (read_amount < 0) break;
+		
+		// Both only read less than they were asked for at the end of the file.
+		len += read_amount;
+		result.ok = read_amount < cast(i64) READ_FILE_CHUNK_SIZE;
+	}
+	
+	if (result.ok && len > 0) {
+		pop_to(arena, start + cast(u64) len);
+		result.contents.data = data;
+		result.contents.len  = len;
+	} else {
+		pop_to(arena, start);
+	}
+	
+	return result;
+}
+
+// Opens the file only once and reads it straight into its final place, or maps it.
+static Read_File_Result
+_read_file_through_handle(Arena *arena, String file_name) {
+	Read_File_Result result = {0};
+	
+	File_Handle file = file_open(file_name, File_Open_READ);
+	if (file.value != 0) {
+		u64 size = file_size(file);
+		if (last_file_error == File_Error_NONE && size == 0) {
+			result = _read_file_in_chunks(arena, file, NULL);
+		} else if (last_file_error == File_Error_NONE) {
+			if (size >= READ_FILE_MAP_MIN_SIZE) {
+				result.contents = file_map(file, size);
+				result.mapped   = result.contents.data != NULL;
+				result.ok       = result.mapped;
+			}
+			
+			// Also the fallback for files that can't be mapped.
+			if (!result.ok) {
+				last_file_error = File_Error_NONE;
+				result.contents.len  = cast(i64) size;
+				result.contents.data = push_nozero(arena, size);
+				if (size == 0 || result.contents.data != NULL) {
+					i64 read_amount = file_read(file, result.contents.data, result.contents.len);
+					if (read_amount >= 0) {
+						// The file might have shrunk since its size was taken.
+						result.contents.len = read_amount;
+						result.ok = true;
+					}
+				} else {
+					assert(last_alloc_error);
+				}
+			}
+		}
+		file_close(file);
+	}
+	
+	return result;
+}
+
+static Read_File_Result
+_read_file_through_stdio(Arena *arena, String file_name) {
 	Read_File_Result result = {0};
 	
 	Scratch scratch = scratch_begin(&arena, 1);
@@ -96,7 +201,11 @@ read_file(Arena *arena, String file_name) {
 		if (handle) {
 			errno = 0;
 			size_t size = fsize(handle);
-			if (errno == 0) {
+			if ((errno == 0 && size == 0) || errno == ESPIPE) {
+				// A pipe can't be seeked, and the files of /proc say they are empty.
+				clearerr(handle);
+				result = _read_file_in_chunks(arena, (File_Handle){0}, handle);
+			} else if (errno == 0) {
 				result.contents.len  = size;
 				result.contents.data = push_nozero(arena, size * sizeof(u8));
 				if (size == 0 || result.contents.data) {
@@ -130,12 +239,60 @@ read_file(Arena *arena, String file_name) {
 	return result;
 }
 
+static Read_File_Result
+_read_file(Arena *arena, String file_name, Read_File_Params params) {
+	last_file_error = File_Error_NONE;
+	
+	Trace_Span span = trace_begin("read_file", file_name);
+	
+	Read_File_Result result = {0};
+	if (params.map) {
+		result = _read_file_through_handle(arena, file_name);
+	} else {
+		result = _read_file_through_stdio(arena, file_name);
+	}
+	
+	trace_end(span);
+	return result;
+}
+
+static void
+read_file_release(Read_File_Result *result) {
+	if (result->mapped) {
+		file_unmap(result->contents);
+	}
+	memset(result, 0, sizeof(*result));
+}
+
+static void
+_read_files(Arena *arena, Read_Files_Item *items, i64 count, Read_File_Params params) {
+	Trace_Span span = trace_begin("read_files", string_from_lit(""));
+	
+	for (i64 i = _read_files_batched(arena, items, count, params); i < count; i += 1) {
+		items[i].result = _read_file(arena, items[i].file_name, params);
+		items[i].error  = last_file_error;
+	}
+	
+	trace_end(span);
+}
+
 static String
 last_file_error_string(void) {
 	read_only static String strings[] = {
 		string_from_lit_const(""),
 		string_from_lit_const("The file already exists."),
 		string_from_lit_const("The file does not exist."),
+		string_from_lit_const("The file cannot be opened."),
+		string_from_lit_const("The file cannot be seeked."),
+		string_from_lit_const("The file cannot be read."),
+		string_from_lit_const("The file cannot be written."),
+		string_from_lit_const("Access is denied."),
+		string_from_lit_const("The file handle is invalid."),
+		string_from_lit_const("The file is a directory."),
+		string_from_lit_const("The offset is not valid."),
+		string_from_lit_const("The files are on different volumes."),
+		string_from_lit_const("Both are the same file."),
+		string_from_lit_const("The file cannot be accessed for an unspecified reason."),
 	};
 	
 	String result = string_from_lit("(unknown)");
@@ -145,6 +302,54 @@ last_file_error_string(void) {
 	return result;
 }
 
+//- File writer
+
+static void
+file_writer_init(File_Writer *writer, File_Handle file, SliceU8 backing) {
+	memset(writer, 0, sizeof(*writer));
+	writer->file = file;
+	writer->data = backing.data;
+	writer->cap  = backing.len;
+}
+
+static bool
+_file_writer_write(File_Writer *writer, String s) {
+	while (!writer->failed && s.len > 0) {
+		i64 written = file_write(writer->file, s);
+		if (written > 0) {
+			s = string_skip(s, written);
+		} else {
+			writer->failed = true;
+		}
+	}
+	return !writer->failed;
+}
+
+static void
+file_writer_append(File_Writer *writer, String s) {
+	// An empty piece may have no data to copy from.
+	if (s.len == 0) return;
+	
+	if (writer->len + s.len > writer->cap) {
+		file_writer_flush(writer);
+	}
+	
+	if (s.len > writer->cap) {
+		// Copying it would only take more time.
+		_file_writer_write(writer, s);
+	} else if (!writer->failed) {
+		memcpy(writer->data + writer->len, s.data, s.len);
+		writer->len += s.len;
+	}
+}
+
+static bool
+file_writer_flush(File_Writer *writer) {
+	_file_writer_write(writer, string(writer->data, writer->len));
+	writer->len = 0;
+	return !writer->failed;
+}
+
 ////////////////////////////////
 //~ File system introspection
 
@@ -181,6 +386,100 @@ file_info_list_from_path(Arena *arena, String path) {
 	return list;
 }
 
+////////////////////////////////
+//~ PATH cache
+
+static void
+_path_cache_close(Path_Cache *cache) {
+	for (i64 i = 0; i < cache->count; i += 1) {
+		if (cache->entries[i].opened) directory_close(&cache->entries[i].dir);
+	}
+	cache->entries     = NULL;
+	cache->count       = 0;
+	cache->system_path = (String){0};
+	if (cache->arena.ptr != NULL) pop_to(&cache->arena, 0);
+}
+
+static time_t
+_path_cache_last_modified(String path) {
+	File_Attributes attributes = {0};
+	if (!file_attributes(path, &attributes)) {
+		// Missing directories are common in the PATH.
+		attributes.last_modified = 0;
+	}
+	return attributes.last_modified;
+}
+
+static bool
+path_cache_update(Path_Cache *cache, String system_path) {
+	u64  now_us  = time_now_us();
+	bool changed = !string_equals(system_path, cache->system_path);
+	if (changed) {
+		_path_cache_close(cache);
+		cache->generation += 1;
+		cache->checked_us  = now_us;
+		
+		i64 count = 0;
+		for (String list = system_path, loc = path_list_next(&list); loc.data != NULL; loc = path_list_next(&list)) {
+			count += 1;
+		}
+		
+		// Without the memory for it, the cache is empty, and the PATH looks empty.
+		bool ok = cache->arena.ptr != NULL || arena_init(&cache->arena);
+		Path_Cache_Entry *entries = ok ? push_array(&cache->arena, Path_Cache_Entry, count) : NULL;
+		if (entries != NULL) {
+			cache->system_path = string_clone(&cache->arena, system_path);
+			
+			i64 i = 0;
+			for (String loc = path_list_next(&system_path); loc.data != NULL; loc = path_list_next(&system_path)) {
+				entries[i].dir.path = string_clone(&cache->arena, loc);
+				i += 1;
+			}
+			cache->entries = entries;
+			cache->count   = count;
+		}
+	} else if (now_us - cache->checked_us > PATH_CACHE_CHECK_INTERVAL_US) {
+		cache->checked_us = now_us;
+		
+		// Modification times only have a resolution of a second, so a directory that changed in
+		// the same second it was opened might have been replaced after.
+		for (i64 i = 0; i < cache->count; i += 1) {
+			Path_Cache_Entry *entry = &cache->entries[i];
+			if (entry->opened) {
+				time_t last_modified = _path_cache_last_modified(entry->dir.path);
+				if (last_modified != entry->last_modified || last_modified >= entry->opened_at) {
+					String path = entry->dir.path;
+					directory_close(&entry->dir);
+					entry->dir.path = path;
+					entry->opened   = false;
+					cache->generation += 1;
+				}
+			}
+		}
+	}
+	
+	return changed;
+}
+
+static Directory_Handle
+path_cache_directory(Path_Cache *cache, i64 index) {
+	Path_Cache_Entry *entry = &cache->entries[index];
+	if (!entry->opened) {
+		entry->opened_at     = time(NULL);
+		entry->last_modified = _path_cache_last_modified(entry->dir.path);
+		entry->dir           = directory_open(entry->dir.path);
+		entry->opened        = true;
+	}
+	return entry->dir;
+}
+
+static void
+path_cache_fini(Path_Cache *cache) {
+	_path_cache_close(cache);
+	if (cache->arena.ptr != NULL) arena_fini(&cache->arena);
+	memset(cache, 0, sizeof(Path_Cache));
+}
+
 ////////////////////////////////
 //~ Process creation
 
@@ -203,4 +502,66 @@ last_process_error_string(void) {
 	return result;
 }
 
+// The name is what comes before the first '='. Windows has entries for the current directory of
+// each drive, like "=C:=C:\\", whose name starts with one.
+static String
+_process_env_name(String entry) {
+	i64 equals = entry.len > 0 ? string_find_first(string_skip(entry, 1), '=') : -1;
+	return equals >= 0 ? string_stop(entry, equals + 1) : entry;
+}
+
+static bool
+_process_env_replaces(String *env, i64 env_count, String entry) {
+	bool result = false;
+	String name = _process_env_name(entry);
+	for (i64 i = 0; i < env_count && !result; i += 1) {
+#if OS_WINDOWS
+		// Windows doesn't tell the case of names apart.
+		result = string_equals_case_insensitive(_process_env_name(env[i]), name);
+#else
+		result = string_equals(_process_env_name(env[i]), name);
+#endif
+	}
+	return result;
+}
+
+static bool
+process_group_add(Process_Group *group, Process process, u64 tag) {
+	bool ok = group->arena.ptr != NULL || arena_init(&group->arena);
+	
+	// Slots don't move, since the OS may know them by their index.
+	i64 index = -1;
+	for (i64 i = 0; ok && i < group->cap; i += 1) {
+		if (group->processes[i].pid == 0) {
+			index = i;
+			break;
+		}
+	}
+	if (ok && index < 0) {
+		i64      cap       = max(16, group->cap * 2);
+		Process *processes = push_array(&group->arena, Process, cap);
+		u64     *tags      = push_array(&group->arena, u64, cap);
+		ok = processes != NULL && tags != NULL;
+		if (ok) {
+			if (group->cap > 0) {
+				memcpy(processes, group->processes, cast(u64) group->cap * sizeof(Process));
+				memcpy(tags, group->tags, cast(u64) group->cap * sizeof(u64));
+			}
+			group->processes = processes;
+			group->tags      = tags;
+			index      = group->cap;
+			group->cap = cap;
+		}
+	}
+	
+	if (ok) {
+		group->processes[index] = process;
+		group->tags[index]      = tag;
+		group->count += 1;
+		_process_group_watch(group, index);
+	}
+	
+	return ok;
+}
+
 #endif
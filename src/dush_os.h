@@ -9,6 +9,45 @@
 // Returns how many characters were printed.
 static i64 print_unbuffered(String s);
 
+// True if both the input and the output are a terminal.
+static bool console_is_interactive(void);
+
+// In raw mode the input is not echoed nor buffered in lines, and every key press is delivered
+// as soon as it happens; escape sequences are enabled on the output.
+static bool console_enter_raw_mode(void);
+static void console_leave_raw_mode(void);
+
+// Blocks until some input is available and reads as much as fits in the buffer.
+// Returns 0 on end of input and -1 on errors.
+static i64  console_read(u8 *buffer, i64 cap);
+
+// Width of the terminal in columns, or 80 if it can't be known.
+static i64  console_columns(void);
+
+//- Console wake-ups
+
+#define CONSOLE_WOKEN   (-2)
+#define CONSOLE_RESIZED (-3)
+
+// Lets another thread interrupt console_read_or_wake(), e.g. when something that is shown
+// next to the input needs to be redrawn.
+typedef struct Console_Waker Console_Waker;
+struct Console_Waker {
+	u64 value; // 0 means no waker.
+};
+
+static Console_Waker console_waker_create(void);
+static void console_waker_destroy(Console_Waker waker);
+
+// Can be called from any thread. Wake-ups that happen while nobody is reading are not lost:
+// the next read returns CONSOLE_WOKEN right away.
+static void console_wake(Console_Waker waker);
+
+// Like console_read(), but returns CONSOLE_WOKEN without reading anything if the waker was
+// signaled first, and CONSOLE_RESIZED if the terminal changed size since raw mode was entered
+// or since the last time it was returned. The waker can be empty.
+static i64  console_read_or_wake(u8 *buffer, i64 cap, Console_Waker waker);
+
 ////////////////////////////////
 //~ Path manipulation
 
@@ -17,6 +56,8 @@ static i64 print_unbuffered(String s);
 static String get_separator(void); // '\' on Windows, '/' on Linux
 static bool   is_separator(u8 c);  // '\' and '/' on Windows, '/' on Linux
 
+static u8     get_path_list_separator(void); // ';' on Windows, ':' on Linux, as in the PATH variable
+
 static bool   path_is_abs(String path);
 
 //- Platform-independent functions
@@ -31,6 +72,11 @@ static i64    path_last_separator(String path); // Index of the last separator
 
 static String path_base(String path);
 
+// Removes the first entry from a list such as the PATH variable and returns it. Returns an
+// empty string with a NULL data pointer once the list is over; empty entries are returned as
+// they are.
+static String path_list_next(String *list);
+
 ////////////////////////////////
 //~ Basic file management
 
@@ -40,10 +86,12 @@ typedef enum Access_Flags {
 	Access_Flag_READ   = (1<<0),
 	Access_Flag_WRITE  = (1<<1),
 	Access_Flag_SHARED = (1<<2),
+	Access_Flag_EXECUTE = (1<<3), // Linux only; on Windows executables are told apart by their extension.
 } Access_Flags;
 
 typedef enum File_Flags {
 	File_Flag_IS_DIRECTORY = (1<<0),
+	File_Flag_IS_SYMLINK   = (1<<1), // Set by file iterators for the entry itself, not its target. On Windows, any reparse point.
 } File_Flags;
 
 typedef enum File_Error {
@@ -58,24 +106,129 @@ typedef enum File_Error {
 	File_Error_INVALID_HANDLE,
 	File_Error_IS_DIRECTORY,
 	File_Error_INVALID_OFFSET,
+	File_Error_NOT_SAME_VOLUME,
+	File_Error_SAME_FILE,
 	File_Error_OTHER,
 } File_Error;
 
+typedef enum File_Open_Flags {
+	File_Open_READ   = (1<<0),
+	File_Open_WRITE  = (1<<1),
+	File_Open_APPEND = (1<<2), // Every write goes to the end of the file, even with other processes writing to it.
+	File_Open_CREATE = (1<<3), // Create the file if it doesn't exist.
+	File_Open_TRUNCATE = (1<<4), // Empty the file if it exists.
+} File_Open_Flags;
+
+// A value of 0 means no file.
+typedef struct File_Handle File_Handle;
+struct File_Handle {
+	u64 value;
+};
+
 typedef struct Read_File_Result Read_File_Result;
 struct Read_File_Result {
 	SliceU8 contents;
 	bool    ok;
+	bool    mapped; // The contents are a mapping of the file rather than a copy on the arena.
+};
+
+typedef struct Read_File_Params Read_File_Params;
+struct Read_File_Params {
+	// Map files of at least READ_FILE_MAP_MIN_SIZE bytes instead of copying them onto the arena;
+	// smaller ones are cheaper to read than to map. Mapped contents must be given back with
+	// read_file_release(), and fault on access if the file is truncated in the meantime.
+	bool map;
+};
+
+// One of the files read_files() reads.
+typedef struct Read_Files_Item Read_Files_Item;
+struct Read_Files_Item {
+	String           file_name;
+	Read_File_Result result; // What read_file() would return for it,
+	File_Error       error;  // and what last_file_error would be after it.
+};
+
+// Writes through a buffer, so that many small pieces of output cost one system call.
+typedef struct File_Writer File_Writer;
+struct File_Writer {
+	File_Handle file;
+	u8  *data;
+	i64  len;
+	i64  cap;
+	bool failed; // A write failed: whatever comes after it is dropped.
 };
 
+//- File constants
+
+#if !defined(READ_FILE_MAP_MIN_SIZE)
+#define READ_FILE_MAP_MIN_SIZE kilobytes(64)
+#endif
+
+// How much more of a file whose size isn't known is read at a time.
+#if !defined(READ_FILE_CHUNK_SIZE)
+#define READ_FILE_CHUNK_SIZE kilobytes(64)
+#endif
+
 //- File global variables
 
 per_thread File_Error last_file_error;
 
 //- File functions
 
-static Read_File_Result read_file(Arena *arena, String file_name);
+static Read_File_Result _read_file(Arena *arena, String file_name, Read_File_Params params);
+#define read_file(arena, file_name, ...) _read_file(arena, file_name, (Read_File_Params){ .map = false, __VA_ARGS__ })
+static void read_file_release(Read_File_Result *result); // Only needed for mapped contents.
+static Read_File_Result _read_file_in_chunks(Arena *arena, File_Handle file, FILE *stream); // For read_file() and read_files().
+
+// Reads the files like read_file() reads each of them, with as few system calls as the OS
+// allows. On Linux they are opened and read through io_uring: the opens of many files go in one
+// submission, their sizes are taken with fstat(), and then their reads and closes go in another
+// submission. Where io_uring
+// can't be used (kernels before 5.6, or where it's disabled, like in many containers), and on
+// Windows, it's read_file() for each of them.
+static void _read_files(Arena *arena, Read_Files_Item *items, i64 count, Read_File_Params params);
+#define read_files(arena, items, count, ...) _read_files(arena, items, count, (Read_File_Params){ .map = false, __VA_ARGS__ })
 static String last_file_error_string(void);
 
+// Nothing is written until the backing buffer is full or the writer is flushed.
+static void file_writer_init(File_Writer *writer, File_Handle file, SliceU8 backing);
+static void file_writer_append(File_Writer *writer, String s);
+static bool file_writer_flush(File_Writer *writer);
+
+//- File handle platform-specific functions
+
+static File_Handle file_open(String file_name, File_Open_Flags flags);
+static void        file_close(File_Handle file);
+// 0 for pipes and devices, which have no size, like for empty files.
+static u64         file_size(File_Handle file);
+
+// Belongs to the process: don't close it.
+static File_Handle file_standard_output(void);
+
+// Reads until the buffer is full or the file is over. Returns how many bytes were read, or -1.
+static i64         file_read(File_Handle file, u8 *buffer, i64 len);
+
+// With File_Open_APPEND, data is written with a single call so it can't be interleaved with
+// writes of other processes appending to the same file. Returns how many bytes were written.
+static i64         file_write(File_Handle file, String data);
+
+// Maps the first `size` bytes of the file as read-only memory.
+static SliceU8     file_map(File_Handle file, u64 size);
+static void        file_unmap(SliceU8 mapping);
+
+//- File management platform-specific functions
+
+// Replaces the destination if it exists. Both must be on the same volume.
+static bool        file_rename(String from, String to);
+
+// Replaces the destination if it exists, and gives a new one the permissions of the source.
+// Where the file system can, the copy shares the blocks of the source until either changes.
+static bool        file_copy(String from, String to);
+static bool        file_delete(String file_name);
+
+static bool        directory_create(String path);
+static bool        directory_delete(String path); // Only if it's empty.
+
 ////////////////////////////////
 //~ File system introspection
 
@@ -114,16 +267,105 @@ struct File_Iterator {
 	u8 opaque[1024];
 };
 
+// A directory kept open so that files can be looked up in it by name without its path being
+// walked again for each one: on Linux an O_PATH descriptor, which reads nothing. Windows can't
+// look up names relative to a handle, so there it's only the path.
+typedef struct Directory_Handle Directory_Handle;
+struct Directory_Handle {
+	u64        value; // 0 if it couldn't be opened,
+	File_Error error; // and why.
+	String     path;  // As it was opened. Not copied.
+};
+
+typedef struct File_Iterator_Params File_Iterator_Params;
+struct File_Iterator_Params {
+	// When set, only File_Info.name and File_Flag_IS_DIRECTORY are filled in. On Linux this
+	// avoids a stat() for every entry, which dominates the cost of listing big directories.
+	bool names_only;
+};
+
 //- File system introspection functions
 
+// Follows symbolic links. Returns false and sets last_file_error if the file can't be queried.
+static bool file_attributes(String file_name, File_Attributes *attributes);
+
+// Only whether the file is there and, in `flags` if it's not NULL, whether it's a directory. For
+// lookups that try many names, where file_attributes() would get the rest for nothing: on Linux
+// it's a statx() that asks for the type alone. Returns false and sets last_file_error like
+// file_attributes().
+static bool file_exists(String file_name, File_Flags *flags);
+
+// Whether the file is a regular file that this process may run. If it's false, last_file_error
+// is File_Error_NOT_EXISTS when there is no such file at all. On Windows, any file that isn't
+// a directory.
+static bool file_is_executable(String file_name);
+
+// The path has to stay valid while the directory is open. A directory that can't be opened can
+// still be passed to the functions below, which fail with the error it had.
+static Directory_Handle directory_open(String path);
+static void             directory_close(Directory_Handle *dir);
+
+// Like file_exists() and file_is_executable(), for a file name relative to the directory.
+static bool file_exists_in(Directory_Handle dir, String file_name, File_Flags *flags);
+static bool file_is_executable_in(Directory_Handle dir, String file_name);
+
 static void file_info_list_push(Arena *arena, File_Info_List *list, File_Info info);
 
 // Note: The memory pushed onto `arena` in this procedure must stay valid througout
 // the whole file iteration.
-static File_Iterator *file_iterator_begin(Arena *arena, String path);
+static File_Iterator *_file_iterator_begin(Arena *arena, String path, File_Iterator_Params params);
+#define file_iterator_begin(arena, path, ...) _file_iterator_begin(arena, path, (File_Iterator_Params){ .names_only = false, __VA_ARGS__ })
 static bool file_iterator_next(Arena *arena, File_Iterator *iterator, File_Info *info);
 static void file_iterator_end(File_Iterator *iterator);
 
+////////////////////////////////
+//~ PATH cache
+
+//- PATH cache constants
+
+// How often the directories of the PATH that are open are checked. A directory that is made,
+// removed or replaced under its name is seen at most this long after.
+#if !defined(PATH_CACHE_CHECK_INTERVAL_US)
+#define PATH_CACHE_CHECK_INTERVAL_US 1000000
+#endif
+
+//- PATH cache types
+
+typedef struct Path_Cache_Entry Path_Cache_Entry;
+struct Path_Cache_Entry {
+	Directory_Handle dir;           // Its path is empty for an empty entry of the PATH.
+	bool             opened;
+	time_t           last_modified; // When it was opened, or 0 if it wasn't there.
+	time_t           opened_at;
+};
+
+// The directories of the PATH, each opened the first time something is looked for in it, so that
+// finding commands and scripts looks their names up in the directories instead of walking the
+// full path of every candidate. Built again when the PATH changes. Every
+// PATH_CACHE_CHECK_INTERVAL_US, the directories whose modification time changed since they
+// were opened are closed, to be opened again when they are needed: that's one stat() for each
+// open directory, where opening them all again would be an open() and a close().
+//
+// What was found through the cache may be gone once `generation` changes, which it does when
+// the PATH changes or a directory is closed to be opened again.
+typedef struct Path_Cache Path_Cache;
+struct Path_Cache {
+	Arena             arena;
+	String            system_path; // A copy of the PATH it's for.
+	u64               generation;
+	u64               checked_us;
+	Path_Cache_Entry *entries;     // In the order of the PATH.
+	i64               count;
+};
+
+//- PATH cache functions
+
+// Makes the cache match the PATH, which is passed in as it is now. Returns whether the PATH
+// changed since the last time.
+static bool path_cache_update(Path_Cache *cache, String system_path);
+static Directory_Handle path_cache_directory(Path_Cache *cache, i64 index); // Opens it the first time.
+static void path_cache_fini(Path_Cache *cache);
+
 ////////////////////////////////
 //~ Process creation
 
@@ -138,13 +380,156 @@ typedef enum Process_Error {
 	Process_Error_COUNT,
 } Process_Error;
 
+// What a process used from when it was started until it was waited for.
+typedef struct Process_Usage Process_Usage;
+struct Process_Usage {
+	u64 wall_us;
+	u64 user_us;
+	u64 system_us;
+	u64 max_rss_kb;   // The most memory it had resident at once.
+	u64 minor_faults; // Page faults served from memory. On Windows, all page faults.
+	u64 major_faults; // Page faults that had to wait for the disk. Always 0 on Windows.
+};
+
+typedef struct Process_Params Process_Params;
+struct Process_Params {
+	// NAME=value strings the process gets in its environment on top of the one of the shell,
+	// where they replace the variables with the same name. Of two with the same name, the later
+	// one wins.
+	String *env;
+	i64     env_count;
+};
+
 //- Process creation global variables
 
 per_thread Process_Error last_process_error;
+per_thread i32           last_process_exit_code; // Of the last process that ran; 128 + the signal number if it was killed by one.
+per_thread Process_Usage last_process_usage;     // Of the last process that ran.
 
 //- Process creation functions
 
-static bool   start_process_sync(String command_line, String working_dir);
+// Runs the executable, or if it is empty the file the OS finds for argv[0], with the arguments
+// as they are, and waits for it to exit. The OS looks in the PATH of `env` if it has one.
+static bool   _start_process_sync(String *argv, i64 argc, String working_dir, String executable, Process_Params params);
+#define start_process_sync(argv, argc, working_dir, executable, ...) _start_process_sync(argv, argc, working_dir, executable, (Process_Params){ .env = NULL, __VA_ARGS__ })
 static String last_process_error_string(void);
 
+// Whether one of the strings of `env` has the name of the NAME=value entry. For the platform code.
+static bool   _process_env_replaces(String *env, i64 env_count, String entry);
+
+// What the shell itself used so far, all of its threads together. wall_us is left at 0.
+static Process_Usage process_usage_self(void);
+
+//- Background processes
+
+// A process that runs while the shell goes on, until a Process_Group it is in sees it exit.
+typedef struct Process Process;
+struct Process {
+	i64 pid;
+	i64 handle;   // A pidfd on Linux, or -1 if the kernel has none; the process handle on Windows.
+	u64 start_us;
+};
+
+// Processes that are waited for together, from a single thread, however many there are. On
+// Linux their pidfds are in an epoll set, so that a wait is one system call; on Windows their
+// handles are waited on 64 at a time.
+typedef struct Process_Group Process_Group;
+struct Process_Group {
+	Arena    arena;      // The slots, which outgrow it by being copied.
+	Process *processes;  // Slots whose pid is 0 are free.
+	u64     *tags;
+	i64      cap;
+	i64      count;      // Of the processes in it.
+	i64      unpolled;   // Of those without a pidfd, which only wait4() can wait for.
+	i64      poll;       // The epoll instance on Linux, once there is one.
+};
+
+// Like start_process_sync(), but returns as soon as the process started. Ctrl+C doesn't reach
+// the process.
+static bool _start_process_async(String *argv, i64 argc, String working_dir, String executable, Process *process, Process_Params params);
+#define start_process_async(argv, argc, working_dir, executable, process, ...) _start_process_async(argv, argc, working_dir, executable, process, (Process_Params){ .env = NULL, __VA_ARGS__ })
+
+// The tag is what process_group_wait() returns when the process exits.
+static bool process_group_add(Process_Group *group, Process process, u64 tag);
+
+// Waits for a process of the group to exit, removes it, and returns true with its tag, and with
+// last_process_exit_code and last_process_usage set. Without `block`, only takes a process that
+// already exited. Returns false if none did, if the group is empty, or if a signal interrupted
+// the wait (like Ctrl+C does).
+static bool process_group_wait(Process_Group *group, bool block, u64 *tag);
+
+// The processes that are still running are left running.
+static void process_group_fini(Process_Group *group);
+
+// Waits for a process that isn't in a group to exit, and closes its handle. Sets
+// last_process_exit_code and last_process_usage like process_group_wait().
+static void process_wait(Process process);
+
+//- Output capture
+
+// Sends what the shell writes to its standard output, and what the processes it starts write
+// to theirs, to a file in memory until the capture ends. Captures nest.
+typedef struct Output_Capture Output_Capture;
+struct Output_Capture {
+	File_Handle file;
+	u64         saved[2]; // What the standard output was before.
+};
+
+static bool   output_capture_begin(Output_Capture *capture);
+
+// Ends the capture and returns everything that was written during it.
+static String output_capture_end(Arena *arena, Output_Capture *capture);
+
+////////////////////////////////
+//~ Threads
+
+//- Thread types
+
+typedef void Thread_Proc(void *param);
+
+// Must stay at the same address until the thread is joined.
+typedef struct Thread Thread;
+struct Thread {
+	Thread_Proc *proc;
+	void        *param;
+	u64          handle;
+};
+
+typedef struct Mutex Mutex;
+struct Mutex {
+	u8 opaque[64];
+};
+
+typedef struct Condition_Variable Condition_Variable;
+struct Condition_Variable {
+	u8 opaque[64];
+};
+
+//- Thread functions
+
+static bool thread_start(Thread *thread, Thread_Proc *proc, void *param);
+static void thread_join(Thread *thread);
+
+static void mutex_init(Mutex *mutex);
+static void mutex_fini(Mutex *mutex);
+static void mutex_lock(Mutex *mutex);
+static void mutex_unlock(Mutex *mutex);
+
+static void condition_variable_init(Condition_Variable *cv);
+static void condition_variable_fini(Condition_Variable *cv);
+static void condition_variable_broadcast(Condition_Variable *cv);
+
+// Must be called with the mutex locked. Returns false if the timeout expired; a negative timeout
+// waits forever. Like every condition variable it can return early, so check the condition again.
+static bool condition_variable_wait(Condition_Variable *cv, Mutex *mutex, i64 timeout_us);
+
+// Sleeps while *address is `expected`, until futex_wake_one() or futex_wake_all() is called on the
+// address or the timeout expires (a negative timeout waits forever). Can also return for no reason,
+// so check the value again.
+static void futex_wait(u32 *address, u32 expected, i64 timeout_us);
+static void futex_wake_one(u32 *address);
+static void futex_wake_all(u32 *address);
+
+static i64  get_processor_count(void);
+
 #endif
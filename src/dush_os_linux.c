@@ -35,6 +35,192 @@ print_unbuffered(String s) {
 	return written;
 }
 
+//- Raw mode
+
+#include <termios.h>
+
+per_thread struct termios linux_console_saved_mode;
+per_thread bool           linux_console_is_raw;
+
+static bool
+console_is_interactive(void) {
+	return isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+}
+
+#include <fcntl.h>
+#include <signal.h>
+
+// SIGWINCH writes a byte to this pipe, so that console_read_or_wake() can poll for it like for
+// any other input, without a window between checking a flag and blocking.
+static int linux_console_resize_pipe[2] = {-1, -1};
+
+static void
+_console_WINCH_handler(int sig) {
+	(void)sig;
+	int saved_errno = errno;
+	ssize_t nwrite = write(linux_console_resize_pipe[1], "", 1);
+	(void)nwrite; // A full pipe already says that the size changed.
+	errno = saved_errno;
+}
+
+static void
+_console_drain_resizes(void) {
+	if (linux_console_resize_pipe[0] >= 0) {
+		u8 discarded[64];
+		while (read(linux_console_resize_pipe[0], discarded, sizeof(discarded)) > 0) {}
+	}
+}
+
+static bool
+console_enter_raw_mode(void) {
+	static bool resize_handler_installed = false;
+	if (!resize_handler_installed) {
+		if (pipe(linux_console_resize_pipe) == 0) {
+			for (i64 i = 0; i < 2; i += 1) {
+				fcntl(linux_console_resize_pipe[i], F_SETFD, FD_CLOEXEC);
+				fcntl(linux_console_resize_pipe[i], F_SETFL, O_NONBLOCK);
+			}
+			
+			struct sigaction action = {0};
+			action.sa_handler = _console_WINCH_handler;
+			action.sa_flags   = SA_RESTART;
+			sigemptyset(&action.sa_mask);
+			sigaction(SIGWINCH, &action, NULL);
+		}
+		resize_handler_installed = true;
+	}
+	
+	// Only resizes that happen while editing matter; the width is queried again anyway.
+	_console_drain_resizes();
+	
+	bool ok = linux_console_is_raw;
+	if (!ok && tcgetattr(STDIN_FILENO, &linux_console_saved_mode) == 0) {
+		struct termios raw = linux_console_saved_mode;
+		
+		// Like cfmakeraw(), but output post-processing is left on so that whatever else is
+		// printed while in raw mode still gets '\n' translated to "\r\n".
+		raw.c_iflag &= ~cast(tcflag_t) (IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL|IXON);
+		raw.c_lflag &= ~cast(tcflag_t) (ECHO|ECHONL|ICANON|ISIG|IEXTEN);
+		raw.c_cflag |= CS8;
+		raw.c_cc[VMIN]  = 1;
+		raw.c_cc[VTIME] = 0;
+		
+		if (tcsetattr(STDIN_FILENO, TCSADRAIN, &raw) == 0) {
+			linux_console_is_raw = true;
+			ok = true;
+		}
+	}
+	return ok;
+}
+
+static void
+console_leave_raw_mode(void) {
+	if (linux_console_is_raw) {
+		tcsetattr(STDIN_FILENO, TCSADRAIN, &linux_console_saved_mode);
+		linux_console_is_raw = false;
+	}
+}
+
+static i64
+console_read(u8 *buffer, i64 cap) {
+	i64 result = -1;
+	
+	while (true) {
+		ssize_t nread = read(STDIN_FILENO, buffer, cast(size_t) cap);
+		if (nread >= 0) {
+			result = nread;
+			break;
+		} else if (errno != EINTR) {
+			break;
+		}
+	}
+	
+	return result;
+}
+
+#include <sys/ioctl.h>
+
+static i64
+console_columns(void) {
+	i64 result = 80;
+	struct winsize size = {0};
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+		result = size.ws_col;
+	}
+	return result;
+}
+
+//- Console wake-ups
+
+#include <poll.h>
+#include <sys/eventfd.h>
+
+static Console_Waker
+console_waker_create(void) {
+	Console_Waker result = {0};
+	int fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	if (fd >= 0) {
+		result.value = cast(u64) fd + 1;
+	}
+	return result;
+}
+
+static void
+console_waker_destroy(Console_Waker waker) {
+	if (waker.value != 0) {
+		close(cast(int) (waker.value - 1));
+	}
+}
+
+static void
+console_wake(Console_Waker waker) {
+	if (waker.value != 0) {
+		u64 one = 1;
+		ssize_t nwrite = write(cast(int) (waker.value - 1), &one, sizeof(one));
+		(void)nwrite; // Only fails if the counter is about to overflow, which still means "woken".
+	}
+}
+
+static i64
+console_read_or_wake(u8 *buffer, i64 cap, Console_Waker waker) {
+	i64 result = -1;
+	
+	// poll() skips negative descriptors, so a missing waker or resize pipe is never ready.
+	int waker_fd  = waker.value != 0 ? cast(int) (waker.value - 1) : -1;
+	int resize_fd = linux_console_is_raw ? linux_console_resize_pipe[0] : -1;
+	while (true) {
+		struct pollfd fds[3] = {
+			{ .fd = STDIN_FILENO, .events = POLLIN },
+			{ .fd = waker_fd,     .events = POLLIN },
+			{ .fd = resize_fd,    .events = POLLIN },
+		};
+		if (poll(fds, 3, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		
+		// Input first: if more than one is ready, the others are still pending for the next call.
+		if (fds[0].revents != 0) {
+			result = console_read(buffer, cap);
+			break;
+		}
+		if (fds[1].revents != 0) {
+			u64 count = 0;
+			ssize_t nread = read(waker_fd, &count, sizeof(count));
+			(void)nread;
+			result = CONSOLE_WOKEN;
+			break;
+		}
+		if (fds[2].revents != 0) {
+			_console_drain_resizes();
+			result = CONSOLE_RESIZED;
+			break;
+		}
+	}
+	
+	return result;
+}
+
 ////////////////////////////////
 //~ Path manipulation
 
@@ -48,47 +234,1573 @@ is_separator(u8 c) {
 	return c == '/';
 }
 
+static bool
+path_is_abs(String path) {
+	return path.len > 0 && path.data[0] == '/';
+}
+
+static u8
+get_path_list_separator(void) {
+	return ':';
+}
+
 ////////////////////////////////
-//~ File system introspection
+//~ Basic file management
 
-static File_Iterator *
-file_iterator_begin(Arena *arena, String path) {
-	unimplemented();
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+
+//- File helpers
+
+static File_Error
+_file_error_from_errno(int error) {
+	File_Error result = File_Error_OTHER;
+	switch (error) {
+		case 0:       result = File_Error_NONE; break;
+		case EEXIST:  result = File_Error_EXISTS; break;
+		case ENOENT:  result = File_Error_NOT_EXISTS; break;
+		case ENOTDIR: result = File_Error_NOT_EXISTS; break;
+		case EACCES:  result = File_Error_ACCESS_DENIED; break;
+		case EPERM:   result = File_Error_ACCESS_DENIED; break;
+		case EBADF:   result = File_Error_INVALID_HANDLE; break;
+		case EISDIR:  result = File_Error_IS_DIRECTORY; break;
+		case EXDEV:   result = File_Error_NOT_SAME_VOLUME; break;
+	}
+	return result;
+}
+
+//- File handle functions
+
+// Handles hold the descriptor plus one, so that 0 can mean no file while descriptor 0 is one.
+static int
+_linux_fd(u64 value) {
+	return cast(int) value - 1;
+}
+
+static File_Handle
+file_open(String file_name, File_Open_Flags flags) {
+	last_file_error = File_Error_NONE;
+	
+	File_Handle result = {0};
 	
-	(void)arena;
-	(void)path;
-	return 0;
+	int oflags = O_CLOEXEC;
+	if ((flags & File_Open_READ) && (flags & (File_Open_WRITE|File_Open_APPEND))) {
+		oflags |= O_RDWR;
+	} else if (flags & (File_Open_WRITE|File_Open_APPEND)) {
+		oflags |= O_WRONLY;
+	} else {
+		oflags |= O_RDONLY;
+	}
+	if (flags & File_Open_APPEND) oflags |= O_APPEND;
+	if (flags & File_Open_CREATE) oflags |= O_CREAT;
+	if (flags & File_Open_TRUNCATE) oflags |= O_TRUNC;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		int fd = open(file_name_nt, oflags, 0644);
+		if (fd >= 0) {
+			result.value = cast(u64) fd + 1;
+		} else {
+			last_file_error = errno == ENOENT ? File_Error_NOT_EXISTS : File_Error_OPEN_FAILED;
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return result;
 }
 
-static bool
-file_iterator_next(Arena *arena, File_Iterator *iterator, File_Info *info) {
-	unimplemented();
+static void
+file_close(File_Handle file) {
+	if (file.value != 0) {
+		close(_linux_fd(file.value));
+	}
+}
+
+static u64
+file_size(File_Handle file) {
+	last_file_error = File_Error_NONE;
+	
+	u64 result = 0;
+	struct stat st = {0};
+	if (file.value != 0 && fstat(_linux_fd(file.value), &st) == 0) {
+		result = S_ISREG(st.st_mode) ? cast(u64) st.st_size : 0;
+	} else {
+		last_file_error = File_Error_INVALID_HANDLE;
+	}
+	return result;
+}
+
+static File_Handle
+file_standard_output(void) {
+	File_Handle result = {cast(u64) STDOUT_FILENO + 1};
+	return result;
+}
+
+static i64
+file_read(File_Handle file, u8 *buffer, i64 len) {
+	last_file_error = File_Error_NONE;
+	
+	i64 total = 0;
+	if (file.value != 0) {
+		while (total < len) {
+			ssize_t nread = read(_linux_fd(file.value), buffer + total, cast(size_t) (len - total));
+			if (nread > 0) {
+				total += nread;
+			} else if (nread == 0) {
+				break;
+			} else if (errno != EINTR) {
+				last_file_error = errno == EISDIR ? File_Error_IS_DIRECTORY : File_Error_READ_FAILED;
+				total = -1;
+				break;
+			}
+		}
+	} else {
+		last_file_error = File_Error_INVALID_HANDLE;
+		total = -1;
+	}
+	return total;
+}
+
+static i64
+file_write(File_Handle file, String data) {
+	last_file_error = File_Error_NONE;
+	
+	i64 written = 0;
+	if (file.value != 0 && data.len > 0) {
+		ssize_t nwrite = write(_linux_fd(file.value), data.data, cast(size_t) data.len);
+		if (nwrite >= 0) {
+			written = nwrite;
+		} else {
+			last_file_error = File_Error_WRITE_FAILED;
+		}
+	}
+	return written;
+}
+
+static SliceU8
+file_map(File_Handle file, u64 size) {
+	last_file_error = File_Error_NONE;
 	
-	(void)arena;
-	(void)iterator;
-	(void)info;
-	return 0;
+	SliceU8 result = {0};
+	if (file.value != 0 && size > 0) {
+		void *data = mmap(0, size, PROT_READ, MAP_SHARED, _linux_fd(file.value), 0);
+		if (data != MAP_FAILED) {
+			result = make_sliceu8(data, cast(i64) size);
+		} else {
+			last_file_error = File_Error_READ_FAILED;
+		}
+	}
+	return result;
 }
 
 static void
-file_iterator_end(File_Iterator *iterator) {
-	unimplemented();
+file_unmap(SliceU8 mapping) {
+	if (mapping.data != NULL) {
+		munmap(mapping.data, cast(size_t) mapping.len);
+	}
+}
+
+//- File management functions
+
+static bool
+file_rename(String from, String to) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *from_nt = cstring_from_string(scratch.arena, from);
+	char *to_nt   = cstring_from_string(scratch.arena, to);
+	if (from_nt != NULL && to_nt != NULL) {
+		if (rename(from_nt, to_nt) == 0) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
 	
-	(void)iterator;
+	return ok;
 }
 
-////////////////////////////////
-//~ Process creation
+// Copies `size` bytes of `in` to `out` with copy_file_range(), which leaves the copying to the
+// file system (a server-side copy over NFS, for example) and otherwise to the kernel. Falls back
+// to reading and writing where it isn't supported, like across file systems on older kernels.
+static bool
+_file_copy_contents(int in, int out, i64 size) {
+	bool ok = true;
+	bool kernel_copy = size > 0; // Files that say they are empty, like most in /proc, are read to the end instead.
+	
+#if defined(SYS_copy_file_range)
+	// Stops at the size the file had when it was opened, which saves small files the call that
+	// finds the end.
+	for (i64 left = size; left > 0;) {
+		long copied = syscall(SYS_copy_file_range, in, NULL, out, NULL, cast(size_t) min(left, cast(i64) gigabytes(1)), 0u);
+		if (copied == 0) break;
+		if (copied < 0) {
+			if (errno == EINTR) continue;
+			// Only the first call can fail this way, before anything was copied.
+			if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+				kernel_copy = false;
+			} else {
+				last_file_error = _file_error_from_errno(errno);
+				ok = false;
+			}
+			break;
+		}
+		left -= copied;
+	}
+#else
+	kernel_copy = false;
+#endif
+	
+	if (ok && !kernel_copy) {
+		Scratch scratch = scratch_begin(0, 0);
+		i64 cap    = kilobytes(128);
+		u8 *buffer = push_nozero(scratch.arena, cap);
+		ok = buffer != NULL;
+		while (ok) {
+			ssize_t nread = read(in, buffer, cast(size_t) cap);
+			if (nread == 0) break;
+			if (nread < 0) {
+				if (errno == EINTR) continue;
+				last_file_error = File_Error_READ_FAILED;
+				ok = false;
+				break;
+			}
+			for (ssize_t written = 0; ok && written < nread;) {
+				ssize_t nwrite = write(out, buffer + written, cast(size_t) (nread - written));
+				if (nwrite > 0) {
+					written += nwrite;
+				} else if (errno != EINTR) {
+					last_file_error = File_Error_WRITE_FAILED;
+					ok = false;
+				}
+			}
+		}
+		scratch_end(scratch);
+	}
+	
+	return ok;
+}
 
-//- Process creation functions
+static bool
+file_copy(String from, String to) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *from_nt = cstring_from_string(scratch.arena, from);
+	char *to_nt   = cstring_from_string(scratch.arena, to);
+	if (from_nt != NULL && to_nt != NULL) {
+		struct stat from_st = {0};
+		struct stat to_st   = {0};
+		
+		int in = open(from_nt, O_RDONLY|O_CLOEXEC);
+		if (in < 0 || fstat(in, &from_st) != 0) {
+			last_file_error = _file_error_from_errno(errno);
+		} else if (S_ISDIR(from_st.st_mode)) {
+			last_file_error = File_Error_IS_DIRECTORY;
+		} else {
+			bool copy = false;
+			int  out  = open(to_nt, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, from_st.st_mode & 0777);
+			if (out >= 0) {
+				copy = true;
+			} else if (errno == EEXIST) {
+				// Not truncated on open: it could be the source itself.
+				out = open(to_nt, O_WRONLY|O_CLOEXEC);
+				if (out < 0 || fstat(out, &to_st) != 0) {
+					last_file_error = _file_error_from_errno(errno);
+				} else if (to_st.st_dev == from_st.st_dev && to_st.st_ino == from_st.st_ino) {
+					last_file_error = File_Error_SAME_FILE;
+				} else if (ftruncate(out, 0) != 0) {
+					last_file_error = File_Error_WRITE_FAILED;
+				} else {
+					copy = true;
+				}
+			} else {
+				last_file_error = _file_error_from_errno(errno);
+			}
+			
+			if (copy) {
+				// A reflink only works within a file system that supports them (Btrfs, XFS, ...).
+				ok = ioctl(out, FICLONE, in) == 0 || _file_copy_contents(in, out, cast(i64) from_st.st_size);
+			}
+			if (out >= 0) close(out);
+		}
+		if (in >= 0) close(in);
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+file_delete(String file_name) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		if (unlink(file_name_nt) == 0) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+directory_create(String path) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *path_nt = cstring_from_string(scratch.arena, path);
+	if (path_nt != NULL) {
+		if (mkdir(path_nt, 0777) == 0) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+directory_delete(String path) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *path_nt = cstring_from_string(scratch.arena, path);
+	if (path_nt != NULL) {
+		if (rmdir(path_nt) == 0) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+//- Batched reads
+
+#include <linux/io_uring.h>
+
+// An io_uring, set up without liburing. Each thread sets one up the first time it reads files in
+// a batch, and keeps it until it ends.
+typedef struct Linux_Ring Linux_Ring;
+struct Linux_Ring {
+	int  fd;
+	u32  entries;
+	u32  queued; // Entries written since the last submission.
+	
+	u8  *sq_map;
+	u64  sq_map_size;
+	u8  *cq_map;
+	u64  cq_map_size;
+	struct io_uring_sqe *sqes;
+	u64  sqes_size;
+	
+	u32 *sq_tail;
+	u32 *sq_mask;
+	u32 *sq_array;
+	u32 *cq_head;
+	u32 *cq_tail;
+	u32 *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+// The most files whose opens go in one submission.
+#define LINUX_RING_MAX_FILES 128
+
+// A read takes a 32-bit length, and the kernel reads less than 2GB at a time anyway. Bigger
+// files are read with file_read().
+#define LINUX_RING_MAX_READ gigabytes(1)
+
+// 1 once a ring was set up and the kernel has the operations read_files() needs, -1 once it's
+// known that it doesn't or that io_uring is disabled, 0 until then.
+static i32 _linux_ring_support;
+
+per_thread Linux_Ring linux_thread_ring;
+
+// Also for a ring that was never set up, which is all zeroes.
+static void
+_linux_ring_fini(Linux_Ring *ring) {
+	if (ring->sqes != NULL)                           munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_map != NULL && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+	if (ring->sq_map != NULL)                         munmap(ring->sq_map, ring->sq_map_size);
+	if (ring->entries != 0)                           close(ring->fd);
+	memset(ring, 0, sizeof(*ring));
+}
+
+static u8 *
+_linux_ring_map(int fd, u64 size, u64 offset) {
+	void *result = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, cast(off_t) offset);
+	return result != MAP_FAILED ? cast(u8 *) result : NULL;
+}
 
 static bool
-start_process_sync(String command_line, String working_dir) {
-	unimplemented();
+_linux_ring_init(Linux_Ring *ring, u32 entries) {
+	memset(ring, 0, sizeof(*ring));
+	
+	struct io_uring_params params = {0};
+	ring->fd = cast(int) syscall(__NR_io_uring_setup, entries, &params);
+	bool ok = ring->fd >= 0;
+	if (!ok && (errno == ENOSYS || errno == EPERM)) {
+		atomic_store_u32(cast(u32 *) &_linux_ring_support, cast(u32) -1);
+	}
+	
+	if (ok) {
+		ring->entries     = params.sq_entries;
+		ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+		ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		ring->sqes_size   = params.sq_entries * sizeof(struct io_uring_sqe);
+		
+		// Since 5.4 both rings are in one mapping.
+		if (params.features & IORING_FEAT_SINGLE_MMAP) {
+			ring->sq_map_size = max(ring->sq_map_size, ring->cq_map_size);
+			ring->sq_map      = _linux_ring_map(ring->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+			ring->cq_map      = ring->sq_map;
+		} else {
+			ring->sq_map = _linux_ring_map(ring->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+			ring->cq_map = _linux_ring_map(ring->fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+		}
+		ring->sqes = cast(struct io_uring_sqe *) _linux_ring_map(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+		ok = ring->sq_map != NULL && ring->cq_map != NULL && ring->sqes != NULL;
+	}
+	
+	if (ok) {
+		ring->sq_tail  = cast(u32 *) (ring->sq_map + params.sq_off.tail);
+		ring->sq_mask  = cast(u32 *) (ring->sq_map + params.sq_off.ring_mask);
+		ring->sq_array = cast(u32 *) (ring->sq_map + params.sq_off.array);
+		ring->cq_head  = cast(u32 *) (ring->cq_map + params.cq_off.head);
+		ring->cq_tail  = cast(u32 *) (ring->cq_map + params.cq_off.tail);
+		ring->cq_mask  = cast(u32 *) (ring->cq_map + params.cq_off.ring_mask);
+		ring->cqes     = cast(struct io_uring_cqe *) (ring->cq_map + params.cq_off.cqes);
+	}
+	
+	// The first ring asks the kernel whether it has the operations, which came after io_uring.
+	if (ok && atomic_load_u32(cast(u32 *) &_linux_ring_support) == 0) {
+		u64 probe_size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+		struct io_uring_probe *probe = calloc(1, probe_size);
+		
+		bool supported = probe != NULL &&
+			syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0;
+		u8 needed[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE};
+		for (i64 i = 0; supported && i < array_count(needed); i += 1) {
+			supported = needed[i] <= probe->last_op && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+		}
+		free(probe);
+		
+		atomic_store_u32(cast(u32 *) &_linux_ring_support, cast(u32) (supported ? 1 : -1));
+	}
+	ok = ok && atomic_load_u32(cast(u32 *) &_linux_ring_support) == 1;
+	
+	if (!ok) _linux_ring_fini(ring);
+	return ok;
+}
+
+// The next free submission entry, cleared.
+static struct io_uring_sqe *
+_linux_ring_push(Linux_Ring *ring, u8 opcode, int fd, u64 user_data) {
+	u32 index = (*ring->sq_tail + ring->queued) & *ring->sq_mask;
+	ring->sq_array[index] = index;
+	ring->queued += 1;
+	
+	struct io_uring_sqe *result = &ring->sqes[index];
+	memset(result, 0, sizeof(*result));
+	result->opcode    = opcode;
+	result->fd        = fd;
+	result->user_data = user_data;
+	return result;
+}
+
+// Submits what was pushed and waits until all of it completed. The kernel can take fewer entries
+// than it's given, and then it doesn't wait: the rest is given to it again, until it takes none,
+// and then the ones it didn't take are dropped. Returns how many it took, which are the first
+// ones pushed. Only called when every completion before was taken.
+static u32
+_linux_ring_submit_and_wait(Linux_Ring *ring) {
+	u32 count = ring->queued;
+	ring->queued = 0;
+	__atomic_store_n(ring->sq_tail, *ring->sq_tail + count, __ATOMIC_RELEASE);
+	
+	u32 submitted = 0;
+	while (submitted < count) {
+		long taken = syscall(__NR_io_uring_enter, ring->fd, count - submitted, count, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (taken > 0) {
+			submitted += cast(u32) taken;
+		} else if (taken == 0 || errno != EINTR) {
+			// Nothing reads the submission queue outside of io_uring_enter().
+			__atomic_store_n(ring->sq_tail, *ring->sq_tail - (count - submitted), __ATOMIC_RELEASE);
+			break;
+		}
+	}
+	
+	// When a signal interrupts the wait, the kernel still says what it took, so the completions
+	// are counted rather than trusted to be there.
+	while (__atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - *ring->cq_head < submitted) {
+		long waited = syscall(__NR_io_uring_enter, ring->fd, 0, submitted, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (waited < 0 && errno != EINTR) {
+			// Only a ring that is set up wrong can fail to wait.
+			panic(errno);
+			break;
+		}
+	}
+	
+	return submitted;
+}
+
+// Takes the next completion, and returns its user_data. Only called for completions that were
+// waited for.
+static u64
+_linux_ring_pop(Linux_Ring *ring, i32 *res) {
+	u32 head = *ring->cq_head;
+	struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+	u64 result = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+	return result;
+}
+
+// Reads the files in groups of up to LINUX_RING_MAX_FILES, in two submissions each: the opens of
+// the group, then the reads and closes. The sizes are taken with fstat() in between, since the
+// ring hands every statx to a kernel thread, which takes longer than the system call. Returns how
+// many of the files it read, which is 0 if there is no io_uring to do it with.
+static i64
+_read_files_batched(Arena *arena, Read_Files_Item *items, i64 count, Read_File_Params params) {
+	i64 result = 0;
+	
+	// One file is cheaper to read with read_file() than through the ring.
+	bool ok = count > 1 && atomic_load_u32(cast(u32 *) &_linux_ring_support) != cast(u32) -1;
+	
+	Linux_Ring *ring = &linux_thread_ring;
+	if (ok && ring->entries == 0) {
+		ok = _linux_ring_init(ring, 2 * LINUX_RING_MAX_FILES);
+	}
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	i64 group_cap = ok ? ring->entries / 2 : 0;
+	int *fds = push_array(scratch.arena, int, group_cap);
+	ok = ok && fds != NULL;
+	
+	for (i64 first = 0; ok && first < count; first += group_cap) {
+		Read_Files_Item *group = items + first;
+		i64 group_count = min(count - first, group_cap);
+		
+		u64 group_pos = arena_pos(*arena);
+		u64 names_pos = arena_pos(*scratch.arena);
+		for (i64 i = 0; i < group_count; i += 1) {
+			memset(&group[i].result, 0, sizeof(group[i].result));
+			group[i].error = File_Error_NONE;
+			fds[i] = -1;
+			
+			char *name_nt = cstring_from_string(scratch.arena, group[i].file_name);
+			if (name_nt != NULL) {
+				struct io_uring_sqe *open = _linux_ring_push(ring, IORING_OP_OPENAT, AT_FDCWD, cast(u64) i);
+				open->addr       = cast(u64) name_nt;
+				open->open_flags = O_RDONLY|O_CLOEXEC;
+			} else {
+				group[i].error = File_Error_OTHER;
+			}
+		}
+		
+		u32 expected  = ring->queued;
+		u32 submitted = _linux_ring_submit_and_wait(ring);
+		ok = submitted == expected;
+		for (u32 i = 0; i < submitted; i += 1) {
+			i32 res       = 0;
+			u64 user_data = _linux_ring_pop(ring, &res);
+			if (res >= 0) {
+				fds[user_data] = res;
+			} else {
+				// Like file_open() says it.
+				group[user_data].error = res == -ENOENT ? File_Error_NOT_EXISTS : File_Error_OPEN_FAILED;
+			}
+		}
+		pop_to(scratch.arena, names_pos);
+		
+		// The reads go straight into the arena, except for big files that are mapped. Every file
+		// that was opened is closed by the ring, after its read if there is one.
+		for (i64 i = 0; ok && i < group_count; i += 1) {
+			Read_Files_Item *item = &group[i];
+			if (fds[i] < 0) continue;
+			
+			struct stat st = {0};
+			u64  size = 0;
+			bool read = false;
+			if (fstat(fds[i], &st) != 0) {
+				item->error = File_Error_SEEK_FAILED;
+			} else if (S_ISDIR(st.st_mode)) {
+				item->error = File_Error_IS_DIRECTORY;
+			} else {
+				size = cast(u64) st.st_size;
+				if (params.map && S_ISREG(st.st_mode) && size >= READ_FILE_MAP_MIN_SIZE) {
+					File_Handle file = {cast(u64) fds[i] + 1};
+					item->result.contents = file_map(file, size);
+					item->result.mapped   = item->result.contents.data != NULL;
+					item->result.ok       = item->result.mapped;
+				}
+				
+				// Also the fallback for files that can't be mapped. The size of what isn't a
+				// regular file says nothing, and the files of /proc say they are empty.
+				if (!S_ISREG(st.st_mode) || size == 0) {
+					File_Handle file = {cast(u64) fds[i] + 1};
+					item->result = _read_file_in_chunks(arena, file, NULL);
+					item->error  = last_file_error;
+				} else if (!item->result.ok) {
+					item->result.contents.data = push_nozero(arena, size);
+					item->result.contents.len  = cast(i64) size;
+					if (item->result.contents.data == NULL) {
+						assert(last_alloc_error);
+						item->error = File_Error_OTHER;
+					} else if (size <= LINUX_RING_MAX_READ) {
+						read = true;
+					} else {
+						File_Handle file = {cast(u64) fds[i] + 1};
+						i64 len = file_read(file, item->result.contents.data, cast(i64) size);
+						item->result.contents.len = max(len, 0);
+						item->result.ok = len >= 0;
+						item->error     = last_file_error;
+					}
+				}
+			}
+			
+			if (read) {
+				// Hard-linked so that the close still happens if the read fails.
+				struct io_uring_sqe *sqe = _linux_ring_push(ring, IORING_OP_READ, fds[i], cast(u64) i * 2);
+				sqe->addr   = cast(u64) item->result.contents.data;
+				sqe->len    = cast(u32) size;
+				sqe->flags |= IOSQE_IO_HARDLINK;
+			}
+			_linux_ring_push(ring, IORING_OP_CLOSE, fds[i], cast(u64) i * 2 + 1);
+		}
+		
+		expected  = ring->queued;
+		submitted = ok ? _linux_ring_submit_and_wait(ring) : 0;
+		ok = ok && submitted == expected;
+		for (u32 i = 0; i < submitted; i += 1) {
+			i32 res       = 0;
+			u64 user_data = _linux_ring_pop(ring, &res);
+			Read_Files_Item *item = &group[user_data / 2];
+			if (user_data % 2 == 1) {
+				fds[user_data / 2] = -1;
+			} else {
+				if (res >= 0 && cast(i64) res < item->result.contents.len) {
+					// A read can stop short of what it was asked for, and by now the ring has
+					// closed the file, so it's read again up to its end. That's also where it
+					// stops if the file shrank since its size was taken.
+					File_Handle file = file_open(item->file_name, File_Open_READ);
+					i64 len = file.value != 0 ? file_read(file, item->result.contents.data, item->result.contents.len) : -1;
+					if (file.value != 0) file_close(file);
+					item->result.contents.len = max(len, 0);
+					item->result.ok = len >= 0;
+					item->error     = last_file_error;
+				} else if (res >= 0) {
+					item->result.ok = true;
+				} else {
+					item->error = File_Error_READ_FAILED;
+				}
+			}
+		}
+		
+		if (ok) {
+			result = first + group_count;
+		} else {
+			// The files the ring didn't close are closed here, and the group is left to
+			// read_file() like the ones after it, with what was read of it given back.
+			for (i64 i = 0; i < group_count; i += 1) {
+				if (fds[i] >= 0) close(fds[i]);
+				read_file_release(&group[i].result);
+			}
+			pop_to(arena, group_pos);
+		}
+	}
+	
+	scratch_end(scratch);
 	
-	(void)command_line;
-	(void)working_dir;
-	return 0;
+	return result;
+}
+
+////////////////////////////////
+//~ File system introspection
+
+#include <dirent.h>
+#include <linux/stat.h>
+
+//- File system introspection types
+
+typedef struct Linux_File_Find_Data Linux_File_Find_Data;
+struct Linux_File_Find_Data {
+	DIR *handle;
+	int  last_error;
+	bool names_only;
+};
+
+static_assert(sizeof(Linux_File_Find_Data) <= sizeof(File_Iterator), "Linux_File_Find_Data doesn't fit in File_Iterator");
+
+//- File system introspection functions
+
+static File_Attributes
+_file_attributes_from_stat(struct stat *st) {
+	File_Attributes attributes = {0};
+	if (S_ISDIR(st->st_mode)) {
+		attributes.flags |= File_Flag_IS_DIRECTORY;
+	}
+	
+	attributes.access = Access_Flag_READ;
+	if ((st->st_mode & S_IWUSR) != 0) {
+		attributes.access |= Access_Flag_WRITE;
+	}
+	if ((st->st_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) != 0) {
+		attributes.access |= Access_Flag_EXECUTE;
+	}
+	
+	attributes.size          = cast(u64) st->st_size;
+	attributes.created       = st->st_ctime; // There is no creation time in struct stat, this is the last status change.
+	attributes.last_modified = st->st_mtime;
+	return attributes;
+}
+
+static bool
+file_attributes(String file_name, File_Attributes *attributes) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		struct stat st = {0};
+		if (stat(file_name_nt, &st) == 0) {
+			*attributes = _file_attributes_from_stat(&st);
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+// Set once statx() turned out to be missing, which it is before Linux 4.11.
+static bool _linux_statx_missing;
+
+// glibc only declares it with _GNU_SOURCE.
+#if !defined(O_PATH)
+#define O_PATH 010000000
+#endif
+
+// Asks only for what's in `mask`, though stx_mode is the only field to look at after it.
+static bool
+_linux_statx(int dir_fd, char *file_name_nt, u32 mask, struct statx *stx) {
+	bool ok = false;
+	if (!_linux_statx_missing) {
+		ok = syscall(__NR_statx, dir_fd, file_name_nt, 0, mask, stx) == 0;
+		if (!ok && errno == ENOSYS) _linux_statx_missing = true;
+	}
+	if (_linux_statx_missing) {
+		struct stat st = {0};
+		ok = fstatat(dir_fd, file_name_nt, &st, 0) == 0;
+		stx->stx_mode = cast(u16) st.st_mode;
+	}
+	return ok;
+}
+
+static bool
+_file_exists_at(int dir_fd, String file_name, File_Flags *flags) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		struct statx stx = {0};
+		if (_linux_statx(dir_fd, file_name_nt, STATX_TYPE, &stx)) {
+			if (flags != NULL) *flags = S_ISDIR(stx.stx_mode) ? File_Flag_IS_DIRECTORY : 0;
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+_file_is_executable_at(int dir_fd, String file_name) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		// The mode rules out most files without asking the kernel about permissions, which
+		// depend on who the process runs as.
+		struct statx stx = {0};
+		if (!_linux_statx(dir_fd, file_name_nt, STATX_TYPE|STATX_MODE, &stx)) {
+			last_file_error = _file_error_from_errno(errno);
+		} else if (S_ISDIR(stx.stx_mode)) {
+			last_file_error = File_Error_IS_DIRECTORY;
+		} else if (!S_ISREG(stx.stx_mode) || (stx.stx_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) == 0 ||
+				   faccessat(dir_fd, file_name_nt, X_OK, AT_EACCESS) != 0) {
+			last_file_error = File_Error_ACCESS_DENIED;
+		} else {
+			ok = true;
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+file_exists(String file_name, File_Flags *flags) {
+	return _file_exists_at(AT_FDCWD, file_name, flags);
+}
+
+static bool
+file_is_executable(String file_name) {
+	return _file_is_executable_at(AT_FDCWD, file_name);
+}
+
+static Directory_Handle
+directory_open(String path) {
+	last_file_error = File_Error_NONE;
+	
+	Directory_Handle result = {0};
+	result.path = path;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *path_nt = cstring_from_string(scratch.arena, path);
+	if (path_nt != NULL) {
+		int fd = open(path_nt, O_PATH|O_DIRECTORY|O_CLOEXEC);
+		if (fd >= 0) {
+			result.value = cast(u64) fd + 1;
+		} else {
+			last_file_error = _file_error_from_errno(errno);
+		}
+	} else {
+		assert(last_alloc_error);
+		last_file_error = File_Error_OTHER;
+	}
+	scratch_end(scratch);
+	
+	result.error = last_file_error;
+	return result;
+}
+
+static void
+directory_close(Directory_Handle *dir) {
+	if (dir->value != 0) {
+		close(_linux_fd(dir->value));
+	}
+	memset(dir, 0, sizeof(*dir));
+}
+
+static bool
+file_exists_in(Directory_Handle dir, String file_name, File_Flags *flags) {
+	bool ok = false;
+	if (dir.value != 0) {
+		ok = _file_exists_at(_linux_fd(dir.value), file_name, flags);
+	} else {
+		last_file_error = dir.error;
+	}
+	return ok;
+}
+
+static bool
+file_is_executable_in(Directory_Handle dir, String file_name) {
+	bool ok = false;
+	if (dir.value != 0) {
+		ok = _file_is_executable_at(_linux_fd(dir.value), file_name);
+	} else {
+		last_file_error = dir.error;
+	}
+	return ok;
+}
+
+static File_Iterator *
+_file_iterator_begin(Arena *arena, String path, File_Iterator_Params params) {
+	last_alloc_error = Alloc_Error_NONE;
+	last_file_error = File_Error_NONE;
+	
+	Linux_File_Find_Data *find_data = push_type(arena, Linux_File_Find_Data);
+	File_Iterator *iterator = cast(File_Iterator *) find_data;
+	
+	if (iterator != NULL) {
+		find_data->names_only = params.names_only;
+		
+		path = string_skip_chop_whitespace(path);
+		if (path.len == 0) {
+			path = string_from_lit(".");
+		}
+		
+		Scratch scratch = scratch_begin(&arena, 1);
+		char *path_nt = cstring_from_string(scratch.arena, path);
+		if (path_nt != NULL) {
+			find_data->handle = opendir(path_nt);
+			if (find_data->handle == NULL) {
+				// For now simply store the error. Later, in file_iterator_next(), the global error
+				// variable is set.
+				find_data->last_error = errno;
+			}
+		}
+		scratch_end(scratch);
+	} else {
+		assert(last_alloc_error);
+	}
+	
+	return iterator;
+}
+
+static bool
+file_iterator_next(Arena *arena, File_Iterator *iterator, File_Info *info) {
+	last_file_error = File_Error_NONE;
+	bool success = false;
+	
+	Linux_File_Find_Data *find_data = cast(Linux_File_Find_Data *) iterator;
+	if (find_data != NULL && find_data->handle != NULL) {
+		struct dirent *entry = NULL;
+		while (true) {
+			errno = 0;
+			entry = readdir(find_data->handle);
+			if (entry == NULL) {
+				// NULL with errno untouched simply means there are no more files in the directory.
+				last_file_error = _file_error_from_errno(errno);
+				break;
+			}
+			
+			// Skip . and .. which are the current and parent directories.
+			if (entry->d_name[0] == '.' && (entry->d_name[1] == 0 ||
+											(entry->d_name[1] == '.' && entry->d_name[2] == 0))) {
+				continue;
+			} else {
+				break;
+			}
+		}
+		
+		if (entry != NULL) {
+			File_Info result = {0};
+			result.name = string_clone(arena, string_from_cstring(entry->d_name));
+			
+			bool need_stat = !find_data->names_only || entry->d_type == DT_UNKNOWN;
+			if (need_stat) {
+				struct stat st = {0};
+				if (fstatat(dirfd(find_data->handle), entry->d_name, &st, 0) == 0) {
+					result.attributes = _file_attributes_from_stat(&st);
+				} else if (entry->d_type == DT_DIR) {
+					// Probabily a dangling entry or a permission problem: keep what readdir told us.
+					result.attributes.flags |= File_Flag_IS_DIRECTORY;
+				}
+			} else if (entry->d_type == DT_DIR) {
+				result.attributes.flags |= File_Flag_IS_DIRECTORY;
+			}
+			if (entry->d_type == DT_LNK) {
+				result.attributes.flags |= File_Flag_IS_SYMLINK;
+			}
+			
+			if (result.name.data != NULL) {
+				*info = result;
+				success = true;
+			} else {
+				assert(last_alloc_error);
+			}
+		}
+	} else if (find_data != NULL) {
+		last_file_error = _file_error_from_errno(find_data->last_error);
+	}
+	
+	return success;
+}
+
+static void
+file_iterator_end(File_Iterator *iterator) {
+	Linux_File_Find_Data *find_data = cast(Linux_File_Find_Data *) iterator;
+	if (find_data != NULL && find_data->handle != NULL) {
+		closedir(find_data->handle);
+		find_data->handle = NULL;
+	}
+}
+
+////////////////////////////////
+//~ Process creation
+
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <signal.h>
+
+// POSIX has it, but the headers only declare it with _GNU_SOURCE.
+extern char **environ;
+
+//- Process creation helpers
+
+static u64
+_process_us_from_timeval(struct timeval tv) {
+	return cast(u64) tv.tv_sec * 1000000 + cast(u64) tv.tv_usec;
+}
+
+static Process_Usage
+_process_usage_from_rusage(struct rusage *ru) {
+	Process_Usage usage = {0};
+	usage.user_us      = _process_us_from_timeval(ru->ru_utime);
+	usage.system_us    = _process_us_from_timeval(ru->ru_stime);
+	usage.max_rss_kb   = cast(u64) ru->ru_maxrss;
+	usage.minor_faults = cast(u64) ru->ru_minflt;
+	usage.major_faults = cast(u64) ru->ru_majflt;
+	return usage;
+}
+
+// The arguments null-terminated for exec, in an array that ends with a NULL pointer.
+static char **
+_process_argv_nt(Arena *arena, String *args, i64 argc) {
+	char **argv = push_array(arena, char *, argc + 1);
+	for (i64 i = 0; argv != NULL && i < argc; i += 1) {
+		argv[i] = cstring_from_string(arena, args[i]);
+		if (argv[i] == NULL) argv = NULL;
+	}
+	return argv;
+}
+
+// The environment of the shell without the variables `env` replaces, followed by `env`, for
+// exec. NULL if there's nothing to replace, since then the child keeps the shell's.
+static char **
+_process_envp_nt(Arena *arena, String *env, i64 env_count) {
+	char **envp = NULL;
+	if (env_count > 0) {
+		i64 count = 0;
+		while (environ[count] != NULL) count += 1;
+		
+		envp = push_array(arena, char *, count + env_count + 1);
+		i64 used = 0;
+		for (i64 i = 0; envp != NULL && i < count; i += 1) {
+			if (!_process_env_replaces(env, env_count, string_from_cstring(environ[i]))) {
+				envp[used] = environ[i];
+				used += 1;
+			}
+		}
+		for (i64 i = 0; envp != NULL && i < env_count; i += 1) {
+			// Of two with the same name, the later one wins.
+			if (!_process_env_replaces(env + i + 1, env_count - i - 1, env[i])) {
+				envp[used] = cstring_from_string(arena, env[i]);
+				if (envp[used] == NULL) envp = NULL;
+				else                    used += 1;
+			}
+		}
+		if (envp != NULL) envp[used] = NULL;
+	}
+	return envp;
+}
+
+// Starts the process. Returns its pid, or -1 with last_process_error set. Like POSIX shells do
+// with asynchronous commands, a background process ignores Ctrl+C, which is meant for the
+// command in the foreground. If `envp` isn't NULL, it's the whole environment of the process, and
+// the PATH in it is the one execvp() looks in.
+static pid_t
+_process_spawn(char **argv, char **envp, char *working_dir_nt, char *executable_nt, bool background) {
+	pid_t result = -1;
+	
+	// If exec fails, the child reports errno through this pipe; if it succeeds, the pipe is
+	// closed by FD_CLOEXEC and the parent reads nothing.
+	int error_pipe[2];
+	if (pipe(error_pipe) == 0) {
+		fcntl(error_pipe[0], F_SETFD, FD_CLOEXEC);
+		fcntl(error_pipe[1], F_SETFD, FD_CLOEXEC);
+		
+		Trace_Span spawn_span = trace_begin("spawn", string_from_cstring(argv[0]));
+		
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(error_pipe[0]);
+			
+			if (background) signal(SIGINT, SIG_IGN);
+			if (envp != NULL) environ = envp;
+			
+			int error = 0;
+			if (chdir(working_dir_nt) != 0) {
+				error = errno;
+			} else {
+				if (executable_nt != NULL) {
+					execv(executable_nt, argv);
+				} else {
+					execvp(argv[0], argv);
+				}
+				error = errno;
+			}
+			
+			ssize_t nwrite = write(error_pipe[1], &error, sizeof(error));
+			(void)nwrite;
+			_exit(127);
+		}
+		
+		close(error_pipe[1]);
+		
+		if (pid > 0) {
+			int     error = 0;
+			ssize_t nread = 0;
+			do {
+				nread = read(error_pipe[0], &error, sizeof(error));
+			} while (nread < 0 && errno == EINTR);
+			
+			// The pipe closes when the exec succeeds, so that's where starting ends.
+			trace_end(spawn_span);
+			
+			if (nread == sizeof(error)) {
+				// The child exits right after reporting.
+				while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {}
+				
+				switch (error) {
+					case ENOENT:  last_process_error = Process_Error_FILE_NOT_FOUND; break;
+					case ENOTDIR: last_process_error = Process_Error_FILE_NOT_FOUND; break;
+					
+					// The file exists but can't be executed as it is; let the caller decide what
+					// to do with it based on its extension.
+					case ENOEXEC: last_process_error = Process_Error_BAD_EXE_FORMAT; break;
+					case EACCES:  last_process_error = Process_Error_BAD_EXE_FORMAT; break;
+					
+					case EINVAL:  last_process_error = Process_Error_INVALID_PARAM; break;
+					default:      last_process_error = Process_Error_OTHER; break;
+				}
+			} else {
+				result = pid;
+			}
+		} else {
+			trace_end(spawn_span);
+			last_process_error = Process_Error_OTHER;
+		}
+		
+		close(error_pipe[0]);
+	} else {
+		last_process_error = Process_Error_OTHER;
+	}
+	
+	return result;
+}
+
+static void
+_process_set_exit(int status, struct rusage *ru, u64 start_us) {
+	if (WIFEXITED(status)) {
+		last_process_exit_code = WEXITSTATUS(status);
+	} else if (WIFSIGNALED(status)) {
+		last_process_exit_code = 128 + WTERMSIG(status);
+	}
+	last_process_usage = _process_usage_from_rusage(ru);
+	last_process_usage.wall_us = time_now_us() - start_us;
+}
+
+// Adds the process in the slot to the epoll set, which is only made for the first one: most
+// shells never start a background process.
+static void
+_process_group_watch(Process_Group *group, i64 index) {
+	Process *process = &group->processes[index];
+	
+	bool ok = process->handle >= 0;
+	if (ok && group->poll == 0) {
+		int poll_fd = epoll_create1(EPOLL_CLOEXEC);
+		ok = poll_fd > 0;
+		if (ok) group->poll = poll_fd;
+	}
+	if (ok) {
+		struct epoll_event event = {0};
+		event.events   = EPOLLIN;
+		event.data.u64 = cast(u64) index;
+		ok = epoll_ctl(cast(int) group->poll, EPOLL_CTL_ADD, cast(int) process->handle, &event) == 0;
+	}
+	
+	// wait4() can wait for it, only not together with the others.
+	if (!ok) {
+		if (process->handle >= 0) close(cast(int) process->handle);
+		process->handle = -1;
+		group->unpolled += 1;
+	}
+}
+
+//- Process creation functions
+
+static bool
+_start_process_sync(String *args, i64 argc, String working_dir, String executable, Process_Params params) {
+	last_process_error = Process_Error_NONE;
+	
+	bool success = false;
+	Scratch scratch = scratch_begin(0, 0);
+	
+	char **argv = _process_argv_nt(scratch.arena, args, argc);
+	char  *working_dir_nt = cstring_from_string(scratch.arena, working_dir);
+	char  *executable_nt  = executable.len > 0 ? cstring_from_string(scratch.arena, executable) : NULL;
+	char **envp = _process_envp_nt(scratch.arena, params.env, params.env_count);
+	if (argv != NULL && argv[0] != NULL && working_dir_nt != NULL && (envp != NULL || params.env_count == 0)) {
+		u64   start_us = time_now_us();
+		pid_t pid      = _process_spawn(argv, envp, working_dir_nt, executable_nt, false);
+		if (pid > 0) {
+			Trace_Span wait_span = trace_begin("wait", string_from_cstring(argv[0]));
+			int status = 0;
+			struct rusage ru = {0};
+			while (wait4(pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+			trace_end(wait_span);
+			
+			_process_set_exit(status, &ru, start_us);
+			success = true;
+		}
+	} else if (argv != NULL && argv[0] == NULL) {
+		last_process_error = Process_Error_INVALID_PARAM;
+	} else {
+		assert(last_alloc_error);
+		last_process_error = Process_Error_OTHER;
+	}
+	
+	scratch_end(scratch);
+	return success;
+}
+
+static bool
+_start_process_async(String *args, i64 argc, String working_dir, String executable, Process *process, Process_Params params) {
+	last_process_error = Process_Error_NONE;
+	
+	bool success = false;
+	Scratch scratch = scratch_begin(0, 0);
+	
+	char **argv = _process_argv_nt(scratch.arena, args, argc);
+	char  *working_dir_nt = cstring_from_string(scratch.arena, working_dir);
+	char  *executable_nt  = executable.len > 0 ? cstring_from_string(scratch.arena, executable) : NULL;
+	char **envp = _process_envp_nt(scratch.arena, params.env, params.env_count);
+	if (argv != NULL && argv[0] != NULL && working_dir_nt != NULL && (envp != NULL || params.env_count == 0)) {
+		u64   start_us = time_now_us();
+		pid_t pid      = _process_spawn(argv, envp, working_dir_nt, executable_nt, true);
+		if (pid > 0) {
+			// pidfds are always close-on-exec. Linux has them since 5.3.
+			process->pid      = pid;
+			process->handle   = -1;
+			process->start_us = start_us;
+#if defined(SYS_pidfd_open)
+			process->handle   = syscall(SYS_pidfd_open, pid, 0);
+#endif
+			success = true;
+		}
+	} else if (argv != NULL && argv[0] == NULL) {
+		last_process_error = Process_Error_INVALID_PARAM;
+	} else {
+		assert(last_alloc_error);
+		last_process_error = Process_Error_OTHER;
+	}
+	
+	scratch_end(scratch);
+	return success;
+}
+
+static bool
+process_group_wait(Process_Group *group, bool block, u64 *tag) {
+	bool result = false;
+	
+	i64 index  = -1;
+	int status = 0;
+	struct rusage ru = {0};
+	if (group->count > 0 && group->unpolled == 0) {
+		// A pidfd becomes readable when its process exits.
+		struct epoll_event event = {0};
+		if (epoll_wait(cast(int) group->poll, &event, 1, block ? -1 : 0) == 1) {
+			index = cast(i64) event.data.u64;
+			while (wait4(cast(pid_t) group->processes[index].pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+		}
+	} else if (group->count > 0) {
+		// The children of the shell that aren't in the group are passed over: they are the ones
+		// other threads wait for as soon as they start, and end first.
+		bool waiting = true;
+		while (waiting) {
+			pid_t pid = wait4(-1, &status, block ? 0 : WNOHANG, &ru);
+			for (i64 i = 0; pid > 0 && i < group->cap; i += 1) {
+				if (group->processes[i].pid == pid) {
+					index = i;
+					break;
+				}
+			}
+			
+			if (pid < 0 && errno == ECHILD) {
+				// Something else waited for the processes of the group, and took their status.
+				// They ended, so they are taken out one by one, as if they weren't found.
+				for (i64 i = 0; index < 0 && i < group->cap; i += 1) {
+					if (group->processes[i].pid != 0) index = i;
+				}
+				status = 127 << 8;
+			}
+			
+			// Without `block`, none has ended yet; a signal also stops the wait.
+			waiting = pid > 0 && index < 0;
+		}
+	}
+	
+	if (index >= 0) {
+		Process *process = &group->processes[index];
+		_process_set_exit(status, &ru, process->start_us);
+		
+		// Closing the pidfd also takes it out of the epoll set.
+		if (process->handle >= 0) {
+			close(cast(int) process->handle);
+		} else {
+			group->unpolled -= 1;
+		}
+		process->pid = 0;
+		group->count -= 1;
+		
+		*tag   = group->tags[index];
+		result = true;
+	}
+	
+	return result;
+}
+
+static void
+process_group_fini(Process_Group *group) {
+	for (i64 i = 0; i < group->cap; i += 1) {
+		if (group->processes[i].pid != 0 && group->processes[i].handle >= 0) {
+			close(cast(int) group->processes[i].handle);
+		}
+	}
+	if (group->poll != 0)         close(cast(int) group->poll);
+	if (group->arena.ptr != NULL) arena_fini(&group->arena);
+	memset(group, 0, sizeof(Process_Group));
+}
+
+static void
+process_wait(Process process) {
+	int status = 0;
+	struct rusage ru = {0};
+	while (wait4(cast(pid_t) process.pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+	_process_set_exit(status, &ru, process.start_us);
+	
+	if (process.handle >= 0) close(cast(int) process.handle);
+}
+
+static Process_Usage
+process_usage_self(void) {
+	struct rusage ru = {0};
+	getrusage(RUSAGE_SELF, &ru);
+	return _process_usage_from_rusage(&ru);
+}
+
+//- Output capture
+
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+static bool
+output_capture_begin(Output_Capture *capture) {
+	memset(capture, 0, sizeof(Output_Capture));
+	fflush(stdout);
+	
+	// Only the standard output is inherited by processes, not the file itself.
+	int fd = cast(int) syscall(SYS_memfd_create, "dush-capture", MFD_CLOEXEC);
+	if (fd < 0) {
+		// Older kernels: an unlinked temporary file does the same.
+		char name[] = "/tmp/dush-capture-XXXXXX";
+		fd = mkstemp(name);
+		if (fd >= 0) {
+			unlink(name);
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+		}
+	}
+	
+	int saved = fd >= 0 ? fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3) : -1;
+	bool ok = saved >= 0 && dup2(fd, STDOUT_FILENO) >= 0;
+	if (ok) {
+		capture->file.value = cast(u64) fd + 1;
+		capture->saved[0]   = cast(u64) saved;
+	} else {
+		if (saved >= 0) close(saved);
+		if (fd >= 0)    close(fd);
+	}
+	
+	return ok;
+}
+
+static String
+output_capture_end(Arena *arena, Output_Capture *capture) {
+	String result = {0};
+	fflush(stdout);
+	
+	int fd = _linux_fd(capture->file.value);
+	dup2(cast(int) capture->saved[0], STDOUT_FILENO);
+	close(cast(int) capture->saved[0]);
+	
+	off_t size = lseek(fd, 0, SEEK_END);
+	if (size > 0) {
+		u8 *data = push_nozero(arena, cast(u64) size + 1);
+		if (data != NULL) {
+			i64 len = 0;
+			while (len < size) {
+				ssize_t nread = pread(fd, data + len, cast(size_t) (size - len), len);
+				if (nread < 0 && errno == EINTR) continue;
+				if (nread <= 0) break;
+				len += nread;
+			}
+			data[len] = 0;
+			result = string(data, len);
+		}
+	}
+	close(fd);
+	
+	memset(capture, 0, sizeof(Output_Capture));
+	return result;
+}
+
+////////////////////////////////
+//~ Threads
+
+#include <pthread.h>
+
+static_assert(sizeof(pthread_mutex_t) <= sizeof(Mutex), "pthread_mutex_t doesn't fit in Mutex");
+static_assert(sizeof(pthread_cond_t) <= sizeof(Condition_Variable), "pthread_cond_t doesn't fit in Condition_Variable");
+
+//- Thread functions
+
+static void *
+_thread_entry(void *param) {
+	Thread *thread = cast(Thread *) param;
+	thread->proc(thread->param);
+	_linux_ring_fini(&linux_thread_ring);
+	return NULL;
+}
+
+static bool
+thread_start(Thread *thread, Thread_Proc *proc, void *param) {
+	thread->proc   = proc;
+	thread->param  = param;
+	thread->handle = 0;
+	
+	pthread_t handle = 0;
+	bool ok = pthread_create(&handle, NULL, _thread_entry, thread) == 0;
+	if (ok) {
+		thread->handle = cast(u64) handle;
+	}
+	return ok;
+}
+
+static void
+thread_join(Thread *thread) {
+	if (thread->handle != 0) {
+		pthread_join(cast(pthread_t) thread->handle, NULL);
+		thread->handle = 0;
+	}
+}
+
+static void
+mutex_init(Mutex *mutex) {
+	pthread_mutex_init(cast(pthread_mutex_t *) mutex, NULL);
+}
+
+static void
+mutex_fini(Mutex *mutex) {
+	pthread_mutex_destroy(cast(pthread_mutex_t *) mutex);
+}
+
+static void
+mutex_lock(Mutex *mutex) {
+	pthread_mutex_lock(cast(pthread_mutex_t *) mutex);
+}
+
+static void
+mutex_unlock(Mutex *mutex) {
+	pthread_mutex_unlock(cast(pthread_mutex_t *) mutex);
+}
+
+static void
+condition_variable_init(Condition_Variable *cv) {
+	// Timeouts are measured on the monotonic clock, so changing the system time doesn't affect them.
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(cast(pthread_cond_t *) cv, &attributes);
+	pthread_condattr_destroy(&attributes);
+}
+
+static void
+condition_variable_fini(Condition_Variable *cv) {
+	pthread_cond_destroy(cast(pthread_cond_t *) cv);
+}
+
+static void
+condition_variable_broadcast(Condition_Variable *cv) {
+	pthread_cond_broadcast(cast(pthread_cond_t *) cv);
+}
+
+static bool
+condition_variable_wait(Condition_Variable *cv, Mutex *mutex, i64 timeout_us) {
+	bool result = true;
+	if (timeout_us < 0) {
+		pthread_cond_wait(cast(pthread_cond_t *) cv, cast(pthread_mutex_t *) mutex);
+	} else {
+		struct timespec deadline = {0};
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec  += timeout_us / 1000000;
+		deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec  += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+		result = pthread_cond_timedwait(cast(pthread_cond_t *) cv, cast(pthread_mutex_t *) mutex, &deadline) != ETIMEDOUT;
+	}
+	return result;
+}
+
+//- Futex
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+static void
+futex_wait(u32 *address, u32 expected, i64 timeout_us) {
+	struct timespec timeout = {0};
+	timeout.tv_sec  = timeout_us / 1000000;
+	timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+	syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, timeout_us >= 0 ? &timeout : NULL, NULL, 0);
+}
+
+static void
+futex_wake_one(u32 *address) {
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void
+futex_wake_all(u32 *address) {
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+static i64
+get_processor_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? cast(i64) count : 1;
 }
 
 #endif
@@ -31,6 +31,133 @@ print_unbuffered(String s) {
 	return written;
 }
 
+//- Raw mode
+
+per_thread DWORD win32_console_saved_input_mode;
+per_thread DWORD win32_console_saved_output_mode;
+per_thread bool  win32_console_is_raw;
+
+static bool
+console_is_interactive(void) {
+	DWORD mode = 0;
+	return (GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &mode) &&
+			GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &mode));
+}
+
+static bool
+console_enter_raw_mode(void) {
+	bool ok = win32_console_is_raw;
+	if (!ok) {
+		HANDLE hstdin  = GetStdHandle(STD_INPUT_HANDLE);
+		HANDLE hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
+		if (GetConsoleMode(hstdin, &win32_console_saved_input_mode) &&
+			GetConsoleMode(hstdout, &win32_console_saved_output_mode)) {
+			// With ENABLE_VIRTUAL_TERMINAL_INPUT, arrows and the like arrive as the same escape
+			// sequences a Linux terminal would send. ENABLE_WINDOW_INPUT reports resizes as
+			// input events.
+			DWORD input_mode  = ENABLE_VIRTUAL_TERMINAL_INPUT|ENABLE_WINDOW_INPUT;
+			DWORD output_mode = win32_console_saved_output_mode|ENABLE_PROCESSED_OUTPUT|ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+			
+			if (SetConsoleMode(hstdin, input_mode) && SetConsoleMode(hstdout, output_mode)) {
+				win32_console_is_raw = true;
+				ok = true;
+			} else {
+				SetConsoleMode(hstdin, win32_console_saved_input_mode);
+			}
+		}
+	}
+	return ok;
+}
+
+static void
+console_leave_raw_mode(void) {
+	if (win32_console_is_raw) {
+		SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE),  win32_console_saved_input_mode);
+		SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), win32_console_saved_output_mode);
+		win32_console_is_raw = false;
+	}
+}
+
+static i64
+console_read(u8 *buffer, i64 cap) {
+	i64 result = -1;
+	
+	DWORD nread = 0;
+	if (ReadFile(GetStdHandle(STD_INPUT_HANDLE), buffer, cast(DWORD) cap, &nread, NULL)) {
+		result = cast(i64) nread;
+	} else if (GetLastError() == ERROR_BROKEN_PIPE) {
+		result = 0;
+	}
+	
+	return result;
+}
+
+static i64
+console_columns(void) {
+	i64 result = 80;
+	CONSOLE_SCREEN_BUFFER_INFO info = {0};
+	if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+		result = info.srWindow.Right - info.srWindow.Left + 1;
+	}
+	return result;
+}
+
+//- Console wake-ups
+
+static Console_Waker
+console_waker_create(void) {
+	Console_Waker result = {0};
+	HANDLE event = CreateEventA(NULL, FALSE, FALSE, NULL); // Auto-reset
+	if (event != NULL) {
+		result.value = cast(u64) event;
+	}
+	return result;
+}
+
+static void
+console_waker_destroy(Console_Waker waker) {
+	if (waker.value != 0) {
+		CloseHandle(cast(HANDLE) waker.value);
+	}
+}
+
+static void
+console_wake(Console_Waker waker) {
+	if (waker.value != 0) {
+		SetEvent(cast(HANDLE) waker.value);
+	}
+}
+
+static i64
+console_read_or_wake(u8 *buffer, i64 cap, Console_Waker waker) {
+	i64 result = -1;
+	
+	if (waker.value == 0 && !win32_console_is_raw) {
+		result = console_read(buffer, cap);
+	} else {
+		// The console input handle is signaled when there are input events, which ReadFile then reads.
+		HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+		HANDLE handles[2] = {hstdin, cast(HANDLE) waker.value};
+		DWORD  wait_status = WaitForMultipleObjects(waker.value != 0 ? 2 : 1, handles, FALSE, INFINITE);
+		if (wait_status == WAIT_OBJECT_0) {
+			// ReadFile would skip a resize event, so take it off the queue first.
+			INPUT_RECORD record = {0};
+			DWORD count = 0;
+			if (win32_console_is_raw && PeekConsoleInputA(hstdin, &record, 1, &count) && count == 1 &&
+				record.EventType == WINDOW_BUFFER_SIZE_EVENT) {
+				ReadConsoleInputA(hstdin, &record, 1, &count);
+				result = CONSOLE_RESIZED;
+			} else {
+				result = console_read(buffer, cap);
+			}
+		} else if (wait_status == WAIT_OBJECT_0 + 1) {
+			result = CONSOLE_WOKEN;
+		}
+	}
+	
+	return result;
+}
+
 ////////////////////////////////
 //~ Path navigation
 
@@ -44,6 +171,11 @@ is_separator(u8 c) {
 	return c == '\\' || c == '/';
 }
 
+static u8
+get_path_list_separator(void) {
+	return ';';
+}
+
 static bool
 path_is_reserved_name(String path) {
 	read_only static String reserved_names[] = {
@@ -86,6 +218,296 @@ path_is_abs(String path) {
 ////////////////////////////////
 //~ Basic file management
 
+//- File handle functions
+
+static File_Handle
+file_open(String file_name, File_Open_Flags flags) {
+	last_file_error = File_Error_NONE;
+	
+	File_Handle result = {0};
+	
+	DWORD access = 0;
+	if (flags & File_Open_READ)   access |= GENERIC_READ;
+	if (flags & File_Open_WRITE)  access |= GENERIC_WRITE;
+	if (flags & File_Open_APPEND) access |= FILE_APPEND_DATA; // Without FILE_WRITE_DATA, every write goes to the end.
+	
+	DWORD share = FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE;
+	DWORD creation = OPEN_EXISTING;
+	if ((flags & File_Open_CREATE) && (flags & File_Open_TRUNCATE)) {
+		creation = CREATE_ALWAYS;
+	} else if (flags & File_Open_CREATE) {
+		creation = OPEN_ALWAYS;
+	} else if (flags & File_Open_TRUNCATE) {
+		creation = TRUNCATE_EXISTING;
+	}
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		HANDLE handle = CreateFileA(file_name_nt, access, share, NULL, creation, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (handle != INVALID_HANDLE_VALUE) {
+			result.value = cast(u64) handle;
+		} else {
+			int last_error = GetLastError();
+			last_file_error = (last_error == ERROR_FILE_NOT_FOUND || last_error == ERROR_PATH_NOT_FOUND) ? File_Error_NOT_EXISTS : File_Error_OPEN_FAILED;
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return result;
+}
+
+static void
+file_close(File_Handle file) {
+	if (file.value != 0) {
+		CloseHandle(cast(HANDLE) file.value);
+	}
+}
+
+static u64
+file_size(File_Handle file) {
+	last_file_error = File_Error_NONE;
+	
+	u64 result = 0;
+	LARGE_INTEGER size = {0};
+	if (file.value != 0 && GetFileType(cast(HANDLE) file.value) != FILE_TYPE_DISK) {
+		result = 0;
+	} else if (file.value != 0 && GetFileSizeEx(cast(HANDLE) file.value, &size)) {
+		result = cast(u64) size.QuadPart;
+	} else {
+		last_file_error = File_Error_INVALID_HANDLE;
+	}
+	return result;
+}
+
+static File_Handle
+file_standard_output(void) {
+	File_Handle result = {0};
+	HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (handle != NULL && handle != INVALID_HANDLE_VALUE) {
+		result.value = cast(u64) handle;
+	}
+	return result;
+}
+
+static i64
+file_read(File_Handle file, u8 *buffer, i64 len) {
+	last_file_error = File_Error_NONE;
+	
+	i64 total = 0;
+	if (file.value != 0) {
+		while (total < len) {
+			DWORD chunk = cast(DWORD) min(len - total, 0x40000000);
+			DWORD nread = 0;
+			if (!ReadFile(cast(HANDLE) file.value, buffer + total, chunk, &nread, NULL)) {
+				last_file_error = GetLastError() == ERROR_ACCESS_DENIED ? File_Error_ACCESS_DENIED : File_Error_READ_FAILED;
+				total = -1;
+				break;
+			}
+			if (nread == 0) break;
+			total += nread;
+		}
+	} else {
+		last_file_error = File_Error_INVALID_HANDLE;
+		total = -1;
+	}
+	return total;
+}
+
+static i64
+file_write(File_Handle file, String data) {
+	last_file_error = File_Error_NONE;
+	
+	i64 written = 0;
+	if (file.value != 0 && data.len > 0) {
+		DWORD nwrite = 0;
+		if (WriteFile(cast(HANDLE) file.value, data.data, cast(DWORD) data.len, &nwrite, NULL)) {
+			written = cast(i64) nwrite;
+		} else {
+			last_file_error = File_Error_WRITE_FAILED;
+		}
+	}
+	return written;
+}
+
+static SliceU8
+file_map(File_Handle file, u64 size) {
+	last_file_error = File_Error_NONE;
+	
+	SliceU8 result = {0};
+	if (file.value != 0 && size > 0) {
+		HANDLE mapping = CreateFileMappingA(cast(HANDLE) file.value, NULL, PAGE_READONLY,
+											cast(DWORD) (size >> 32), cast(DWORD) size, NULL);
+		if (mapping != NULL) {
+			void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, cast(SIZE_T) size);
+			if (data != NULL) {
+				result = make_sliceu8(data, cast(i64) size);
+			} else {
+				last_file_error = File_Error_READ_FAILED;
+			}
+			
+			// The view keeps the mapping alive.
+			CloseHandle(mapping);
+		} else {
+			last_file_error = File_Error_READ_FAILED;
+		}
+	}
+	return result;
+}
+
+static void
+file_unmap(SliceU8 mapping) {
+	if (mapping.data != NULL) {
+		UnmapViewOfFile(mapping.data);
+	}
+}
+
+//- File management functions
+
+static bool
+file_rename(String from, String to) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *from_nt = cstring_from_string(scratch.arena, from);
+	char *to_nt   = cstring_from_string(scratch.arena, to);
+	if (from_nt != NULL && to_nt != NULL) {
+		if (MoveFileExA(from_nt, to_nt, MOVEFILE_REPLACE_EXISTING)) {
+			ok = true;
+		} else {
+			DWORD error = GetLastError();
+			switch (error) {
+				case ERROR_FILE_NOT_FOUND: case ERROR_PATH_NOT_FOUND: last_file_error = File_Error_NOT_EXISTS; break;
+				case ERROR_ACCESS_DENIED:                             last_file_error = File_Error_ACCESS_DENIED; break;
+				case ERROR_NOT_SAME_DEVICE:                           last_file_error = File_Error_NOT_SAME_VOLUME; break;
+				default:                                              last_file_error = File_Error_OTHER; break;
+			}
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static File_Error
+_file_error_from_win32(DWORD error) {
+	File_Error result = File_Error_OTHER;
+	switch (error) {
+		case ERROR_SUCCESS:         result = File_Error_NONE; break;
+		case ERROR_FILE_EXISTS:     result = File_Error_EXISTS; break;
+		case ERROR_ALREADY_EXISTS:  result = File_Error_EXISTS; break;
+		case ERROR_FILE_NOT_FOUND:  result = File_Error_NOT_EXISTS; break;
+		case ERROR_PATH_NOT_FOUND:  result = File_Error_NOT_EXISTS; break;
+		case ERROR_ACCESS_DENIED:   result = File_Error_ACCESS_DENIED; break;
+		case ERROR_NOT_SAME_DEVICE: result = File_Error_NOT_SAME_VOLUME; break;
+	}
+	return result;
+}
+
+static bool
+file_copy(String from, String to) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *from_nt = cstring_from_string(scratch.arena, from);
+	char *to_nt   = cstring_from_string(scratch.arena, to);
+	if (from_nt != NULL && to_nt != NULL) {
+		// Clones blocks on ReFS and copies on the server for network shares by itself.
+		if (CopyFileA(from_nt, to_nt, FALSE)) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_win32(GetLastError());
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+file_delete(String file_name) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		if (DeleteFileA(file_name_nt)) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_win32(GetLastError());
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+directory_create(String path) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *path_nt = cstring_from_string(scratch.arena, path);
+	if (path_nt != NULL) {
+		if (CreateDirectoryA(path_nt, NULL)) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_win32(GetLastError());
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+directory_delete(String path) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *path_nt = cstring_from_string(scratch.arena, path);
+	if (path_nt != NULL) {
+		if (RemoveDirectoryA(path_nt)) {
+			ok = true;
+		} else {
+			last_file_error = _file_error_from_win32(GetLastError());
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+//- Batched reads
+
+// Windows has nothing that opens and reads many files in one call, so read_files() reads them
+// one by one.
+static i64
+_read_files_batched(Arena *arena, Read_Files_Item *items, i64 count, Read_File_Params params) {
+	(void)arena;
+	(void)items;
+	(void)count;
+	(void)params;
+	return 0;
+}
+
 ////////////////////////////////
 //~ File system introspection
 
@@ -118,7 +540,10 @@ static File_Flags
 _file_flags_from_attributes(u32 attributes) {
 	File_Flags flags = 0;
 	if ((attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
-		flags &= File_Flag_IS_DIRECTORY;
+		flags |= File_Flag_IS_DIRECTORY;
+	}
+	if ((attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+		flags |= File_Flag_IS_SYMLINK;
 	}
 	return flags;
 }
@@ -133,8 +558,131 @@ _file_access_flags_from_attributes(u32 attributes) {
 	return flags;
 }
 
+// Converts a FILETIME (100ns intervals since 1601) into seconds since the Unix epoch.
+static time_t
+_time_from_file_time(FILETIME file_time) {
+	u64 intervals = (cast(u64) file_time.dwHighDateTime << 32) | cast(u64) file_time.dwLowDateTime;
+	return cast(time_t) ((intervals - 116444736000000000ULL) / 10000000ULL);
+}
+
+static bool
+file_attributes(String file_name, File_Attributes *attributes) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		WIN32_FILE_ATTRIBUTE_DATA data = {0};
+		if (GetFileAttributesExA(file_name_nt, GetFileExInfoStandard, &data)) {
+			attributes->flags         = _file_flags_from_attributes(data.dwFileAttributes);
+			attributes->access        = _file_access_flags_from_attributes(data.dwFileAttributes);
+			attributes->size          = (cast(u64) data.nFileSizeHigh << 32) | cast(u64) data.nFileSizeLow;
+			attributes->created       = _time_from_file_time(data.ftCreationTime);
+			attributes->last_modified = _time_from_file_time(data.ftLastWriteTime);
+			ok = true;
+		} else {
+			DWORD error = GetLastError();
+			last_file_error = (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) ? File_Error_NOT_EXISTS : File_Error_OTHER;
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+file_exists(String file_name, File_Flags *flags) {
+	last_file_error = File_Error_NONE;
+	bool ok = false;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	char *file_name_nt = cstring_from_string(scratch.arena, file_name);
+	if (file_name_nt != NULL) {
+		DWORD attributes = GetFileAttributesA(file_name_nt);
+		if (attributes != INVALID_FILE_ATTRIBUTES) {
+			if (flags != NULL) *flags = _file_flags_from_attributes(attributes);
+			ok = true;
+		} else {
+			DWORD error = GetLastError();
+			last_file_error = (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) ? File_Error_NOT_EXISTS : File_Error_OTHER;
+		}
+	} else {
+		assert(last_alloc_error);
+	}
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
+file_is_executable(String file_name) {
+	File_Flags flags = 0;
+	bool ok = file_exists(file_name, &flags);
+	if (ok && (flags & File_Flag_IS_DIRECTORY)) {
+		last_file_error = File_Error_IS_DIRECTORY;
+		ok = false;
+	}
+	return ok;
+}
+
+static Directory_Handle
+directory_open(String path) {
+	Directory_Handle result = {0};
+	result.path = path;
+	
+	File_Flags flags = 0;
+	if (file_exists(path, &flags)) {
+		if (flags & File_Flag_IS_DIRECTORY) {
+			result.value = 1;
+		} else {
+			last_file_error = File_Error_NOT_EXISTS;
+		}
+	}
+	
+	result.error = last_file_error;
+	return result;
+}
+
+static void
+directory_close(Directory_Handle *dir) {
+	memset(dir, 0, sizeof(*dir));
+}
+
+static bool
+file_exists_in(Directory_Handle dir, String file_name, File_Flags *flags) {
+	bool ok = false;
+	if (dir.value != 0) {
+		Scratch scratch = scratch_begin(0, 0);
+		String temp[] = {dir.path, string_from_lit("\\"), file_name};
+		ok = file_exists(strings_concat(scratch.arena, temp, array_count(temp)), flags);
+		scratch_end(scratch);
+	} else {
+		last_file_error = dir.error;
+	}
+	return ok;
+}
+
+static bool
+file_is_executable_in(Directory_Handle dir, String file_name) {
+	bool ok = false;
+	if (dir.value != 0) {
+		Scratch scratch = scratch_begin(0, 0);
+		String temp[] = {dir.path, string_from_lit("\\"), file_name};
+		ok = file_is_executable(strings_concat(scratch.arena, temp, array_count(temp)));
+		scratch_end(scratch);
+	} else {
+		last_file_error = dir.error;
+	}
+	return ok;
+}
+
 static File_Iterator *
-file_iterator_begin(Arena *arena, String path) {
+_file_iterator_begin(Arena *arena, String path, File_Iterator_Params params) {
+	(void)params; // FindNextFile returns all the attributes at no extra cost.
+	
 	last_alloc_error = Alloc_Error_NONE;
 	last_file_error = File_Error_NONE;
 	
@@ -276,23 +824,241 @@ file_iterator_end(File_Iterator *iterator) {
 ////////////////////////////////
 //~ Process creation
 
+#include <psapi.h>
+#include <io.h>
+#pragma comment(lib, "psapi.lib")
+
+// How many output captures are going on. Processes only inherit handles during one.
+static i32 _output_capture_depth;
+
+//- Process creation helpers
+
+static u64
+_process_us_from_filetime(FILETIME time) {
+	// In units of 100 ns.
+	return ((cast(u64) time.dwHighDateTime << 32) | cast(u64) time.dwLowDateTime) / 10;
+}
+
+// Everything but the wall time, which the process times don't tell for the shell itself.
+static Process_Usage
+_process_usage_from_handle(HANDLE process) {
+	Process_Usage usage = {0};
+	
+	FILETIME creation = {0}, exit = {0}, kernel = {0}, user = {0};
+	if (GetProcessTimes(process, &creation, &exit, &kernel, &user)) {
+		usage.user_us   = _process_us_from_filetime(user);
+		usage.system_us = _process_us_from_filetime(kernel);
+	}
+	
+	PROCESS_MEMORY_COUNTERS counters = {0};
+	if (GetProcessMemoryInfo(process, &counters, sizeof(counters))) {
+		usage.max_rss_kb   = cast(u64) counters.PeakWorkingSetSize / 1024;
+		usage.minor_faults = cast(u64) counters.PageFaultCount;
+	}
+	
+	return usage;
+}
+
+// The environment of the shell without the variables `env` replaces, followed by `env`, as the
+// block of null-terminated strings CreateProcess takes. NULL if there's nothing to replace, since
+// then the process inherits the shell's.
+static char *
+_process_environment_nt(Arena *arena, String *env, i64 env_count, bool *ok) {
+	u8 *result = NULL;
+	*ok = true;
+	if (env_count > 0) {
+		char *strings = GetEnvironmentStringsA();
+		*ok = strings != NULL;
+		
+		i64 cap = 1;
+		for (char *at = strings; *ok && *at != 0; at += strlen(at) + 1) {
+			cap += cast(i64) strlen(at) + 1;
+		}
+		for (i64 i = 0; i < env_count; i += 1) {
+			cap += env[i].len + 1;
+		}
+		
+		if (*ok) result = push_nozero(arena, cast(u64) cap);
+		if (result != NULL) {
+			i64 len = 0;
+			for (char *at = strings; *at != 0; at += strlen(at) + 1) {
+				String entry = string_from_cstring(at);
+				if (!_process_env_replaces(env, env_count, entry)) {
+					memcpy(result + len, entry.data, entry.len + 1);
+					len += entry.len + 1;
+				}
+			}
+			for (i64 i = 0; i < env_count; i += 1) {
+				// Of two with the same name, the later one wins.
+				if (!_process_env_replaces(env + i + 1, env_count - i - 1, env[i])) {
+					if (env[i].len > 0) memcpy(result + len, env[i].data, env[i].len);
+					len += env[i].len;
+					result[len++] = 0;
+				}
+			}
+			// An empty block still needs two nulls.
+			if (len == 0) result[len++] = 0;
+			result[len] = 0;
+		}
+		*ok = *ok && result != NULL;
+		
+		if (strings != NULL) FreeEnvironmentStringsA(strings);
+	}
+	return cast(char *) result;
+}
+
+// Starts the process, with last_process_error set if it can't. A background process is in a
+// process group of its own, so that Ctrl+C only goes to the command in the foreground. If
+// `environment_nt` isn't NULL, it's the whole environment of the process.
+static bool
+_process_create(char *command_line_nt, char *environment_nt, char *working_dir_nt, char *executable_nt, bool background, PROCESS_INFORMATION *pi) {
+	STARTUPINFO si = {0};
+	si.cb = sizeof(si);
+	
+	// While the output is captured the process must write into the capture, which it only can if
+	// it inherits it.
+	BOOL inherit = _output_capture_depth > 0;
+	if (inherit) {
+		si.dwFlags    = STARTF_USESTDHANDLES;
+		si.hStdInput  = GetStdHandle(STD_INPUT_HANDLE);
+		si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+		si.hStdError  = GetStdHandle(STD_ERROR_HANDLE);
+	}
+	
+	Trace_Span spawn_span = trace_begin("spawn", string_from_cstring(command_line_nt));
+	DWORD flags   = background ? CREATE_NEW_PROCESS_GROUP : 0;
+	BOOL  created = CreateProcessA(executable_nt, command_line_nt, NULL, NULL, inherit, flags, environment_nt, working_dir_nt, &si, pi);
+	trace_end(spawn_span);
+	
+	if (!created) {
+		int last_error = GetLastError();
+		
+		if (last_error == ERROR_INVALID_PARAMETER) {
+			last_process_error = Process_Error_INVALID_PARAM;
+			
+#if AGGRESSIVE_ASSERTS
+			panic();
+#endif
+		} else if (last_error == ERROR_FILE_NOT_FOUND) {
+			last_process_error = Process_Error_FILE_NOT_FOUND;
+		} else if (last_error == ERROR_BAD_EXE_FORMAT) {
+			last_process_error = Process_Error_BAD_EXE_FORMAT;
+		} else {
+			// The system could fail to start a process for many reasons outside our control,
+			// so it doesn't make sense to assert() that there were no errors and kill
+			// the shell even when the failure is the user's or the os's fault.
+			
+			last_process_error = Process_Error_OTHER;
+		}
+	}
+	
+	return created;
+}
+
+// Once the process exited.
+static void
+_process_set_exit(HANDLE process, u64 start_us) {
+	DWORD exit_code = 0;
+	if (GetExitCodeProcess(process, &exit_code)) {
+		last_process_exit_code = cast(i32) exit_code;
+	} else {
+		int last_error = GetLastError();
+		(void)last_error;
+		
+#if AGGRESSIVE_ASSERTS
+		panic();
+#endif
+	}
+	
+	last_process_usage = _process_usage_from_handle(process);
+	last_process_usage.wall_us = time_now_us() - start_us;
+}
+
+// The handles are gathered when they are waited for.
+static void
+_process_group_watch(Process_Group *group, i64 index) {
+	(void)group;
+	(void)index;
+}
+
+// The command line CreateProcess takes, quoted so that the process gets the same arguments back
+// when it splits it the way the C runtime and CommandLineToArgvW do: arguments with blanks or
+// quotes, and empty ones, are put in quotes, with the quotes in them and the backslashes before
+// those escaped.
+static char *
+_process_command_line_nt(Arena *arena, String *argv, i64 argc) {
+	i64 cap = 1;
+	for (i64 i = 0; i < argc; i += 1) {
+		cap += argv[i].len * 2 + 3;
+	}
+	
+	u8 *result = push_nozero(arena, cast(u64) cap);
+	if (result != NULL) {
+		i64 len = 0;
+		for (i64 i = 0; i < argc; i += 1) {
+			String arg = argv[i];
+			bool quote = arg.len == 0;
+			for (i64 j = 0; j < arg.len && !quote; j += 1) {
+				quote = arg.data[j] == ' ' || arg.data[j] == '\t' || arg.data[j] == '\n' || arg.data[j] == '\v' || arg.data[j] == '"';
+			}
+			
+			if (i > 0) result[len++] = ' ';
+			if (!quote) {
+				memcpy(result + len, arg.data, arg.len);
+				len += arg.len;
+			} else {
+				result[len++] = '"';
+				i64 backslashes = 0;
+				for (i64 j = 0; j < arg.len; j += 1) {
+					if (arg.data[j] == '\\') {
+						backslashes += 1;
+					} else {
+						// Backslashes only escape when a quote follows them.
+						if (arg.data[j] == '"') {
+							for (i64 k = 0; k < backslashes + 1; k += 1) result[len++] = '\\';
+						}
+						backslashes = 0;
+					}
+					result[len++] = arg.data[j];
+				}
+				// The backslashes before the closing quote are doubled too.
+				for (i64 k = 0; k < backslashes; k += 1) result[len++] = '\\';
+				result[len++] = '"';
+			}
+		}
+		result[len] = 0;
+	}
+	
+	return cast(char *) result;
+}
+
+//- Process creation functions
+
 static bool
-start_process_sync(String command_line, String working_dir) {
+_start_process_sync(String *argv, i64 argc, String working_dir, String executable, Process_Params params) {
 	last_process_error = Process_Error_NONE;
 	
 	bool success = false;
 	Scratch scratch = scratch_begin(0, 0);
 	
-	char *command_line_nt = cstring_from_string(scratch.arena, command_line);
+	char *command_line_nt = _process_command_line_nt(scratch.arena, argv, argc);
 	char *working_dir_nt  = cstring_from_string(scratch.arena, working_dir);
-	if (command_line_nt && working_dir_nt) {
-		STARTUPINFO si = {0};
+	char *executable_nt   = executable.len > 0 ? cstring_from_string(scratch.arena, executable) : NULL;
+	bool  environment_ok  = false;
+	char *environment_nt  = _process_environment_nt(scratch.arena, params.env, params.env_count, &environment_ok);
+	if (argc == 0) {
+		last_process_error = Process_Error_INVALID_PARAM;
+	} else if (command_line_nt && working_dir_nt && environment_ok) {
+		u64 start_us = time_now_us();
+		
 		PROCESS_INFORMATION pi = {0};
-		if (CreateProcessA(NULL, command_line_nt, NULL, NULL, FALSE, 0, NULL, working_dir_nt, &si, &pi)) {
-			bool  terminated  = false;
+		if (_process_create(command_line_nt, environment_nt, working_dir_nt, executable_nt, false, &pi)) {
+			Trace_Span wait_span = trace_begin("wait", argv[0]);
 			DWORD wait_status = WaitForSingleObject(pi.hProcess, INFINITE);
+			trace_end(wait_span);
 			if (wait_status == WAIT_OBJECT_0) {
-				terminated = true;
+				_process_set_exit(pi.hProcess, start_us);
+				success = true;
 			} else if (wait_status == WAIT_FAILED) {
 				int last_error = GetLastError();
 				(void)last_error;
@@ -304,43 +1070,8 @@ start_process_sync(String command_line, String working_dir) {
 				panic();
 			}
 			
-			do {
-				DWORD exit_code = 0;
-				if (GetExitCodeProcess(pi.hProcess, &exit_code)) {
-					terminated = exit_code != STILL_ACTIVE;
-					success    = true;
-				} else {
-					int last_error = GetLastError();
-					(void)last_error;
-					
-#if AGGRESSIVE_ASSERTS
-					panic();
-#endif
-				}
-			} while (!terminated);
-			
 			CloseHandle(pi.hProcess);
 			CloseHandle(pi.hThread);
-		} else {
-			int last_error = GetLastError();
-			
-			if (last_error == ERROR_INVALID_PARAMETER) {
-				last_process_error = Process_Error_INVALID_PARAM;
-				
-#if AGGRESSIVE_ASSERTS
-				panic();
-#endif
-			} else if (last_error == ERROR_FILE_NOT_FOUND) {
-				last_process_error = Process_Error_FILE_NOT_FOUND;
-			} else if (last_error == ERROR_BAD_EXE_FORMAT) {
-				last_process_error = Process_Error_BAD_EXE_FORMAT;
-			} else {
-				// The system could fail to start a process for many reasons outside our control,
-				// so it doesn't make sense to assert() that there were no errors and kill
-				// the shell even when the failure is the user's or the os's fault.
-				
-				last_process_error = Process_Error_OTHER;
-			}
 		}
 	}
 	
@@ -348,4 +1079,293 @@ start_process_sync(String command_line, String working_dir) {
 	return success;
 }
 
+static bool
+_start_process_async(String *argv, i64 argc, String working_dir, String executable, Process *process, Process_Params params) {
+	last_process_error = Process_Error_NONE;
+	
+	bool success = false;
+	Scratch scratch = scratch_begin(0, 0);
+	
+	char *command_line_nt = _process_command_line_nt(scratch.arena, argv, argc);
+	char *working_dir_nt  = cstring_from_string(scratch.arena, working_dir);
+	char *executable_nt   = executable.len > 0 ? cstring_from_string(scratch.arena, executable) : NULL;
+	bool  environment_ok  = false;
+	char *environment_nt  = _process_environment_nt(scratch.arena, params.env, params.env_count, &environment_ok);
+	if (argc == 0) {
+		last_process_error = Process_Error_INVALID_PARAM;
+	} else if (command_line_nt && working_dir_nt && environment_ok) {
+		u64 start_us = time_now_us();
+		
+		PROCESS_INFORMATION pi = {0};
+		if (_process_create(command_line_nt, environment_nt, working_dir_nt, executable_nt, true, &pi)) {
+			CloseHandle(pi.hThread);
+			process->pid      = pi.dwProcessId;
+			process->handle   = cast(i64) pi.hProcess;
+			process->start_us = start_us;
+			success = true;
+		}
+	}
+	
+	scratch_end(scratch);
+	return success;
+}
+
+static bool
+process_group_wait(Process_Group *group, bool block, u64 *tag) {
+	bool result = false;
+	
+	// No single wait can take more than 64 handles. With more processes than that, the groups of
+	// 64 are looked at in turn, with a short sleep between the rounds.
+	bool   single = group->count <= MAXIMUM_WAIT_OBJECTS;
+	i64    index  = -1;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	i64    indices[MAXIMUM_WAIT_OBJECTS];
+	while (group->count > 0 && index < 0) {
+		DWORD count = 0;
+		for (i64 i = 0; i < group->cap && index < 0; i += 1) {
+			if (group->processes[i].pid != 0) {
+				handles[count] = cast(HANDLE) group->processes[i].handle;
+				indices[count] = i;
+				count += 1;
+			}
+			
+			if (count > 0 && (count == MAXIMUM_WAIT_OBJECTS || i == group->cap - 1)) {
+				DWORD waited = WaitForMultipleObjects(count, handles, FALSE, block && single ? INFINITE : 0);
+				if (waited < WAIT_OBJECT_0 + count) {
+					index = indices[waited - WAIT_OBJECT_0];
+				}
+				count = 0;
+			}
+		}
+		
+		if (index < 0) {
+			if (!block || single) break;
+			Sleep(1);
+		}
+	}
+	
+	if (index >= 0) {
+		Process *process = &group->processes[index];
+		_process_set_exit(cast(HANDLE) process->handle, process->start_us);
+		CloseHandle(cast(HANDLE) process->handle);
+		process->pid = 0;
+		group->count -= 1;
+		
+		*tag   = group->tags[index];
+		result = true;
+	}
+	
+	return result;
+}
+
+static void
+process_group_fini(Process_Group *group) {
+	for (i64 i = 0; i < group->cap; i += 1) {
+		if (group->processes[i].pid != 0) {
+			CloseHandle(cast(HANDLE) group->processes[i].handle);
+		}
+	}
+	if (group->arena.ptr != NULL) arena_fini(&group->arena);
+	memset(group, 0, sizeof(Process_Group));
+}
+
+static void
+process_wait(Process process) {
+	WaitForSingleObject(cast(HANDLE) process.handle, INFINITE);
+	_process_set_exit(cast(HANDLE) process.handle, process.start_us);
+	CloseHandle(cast(HANDLE) process.handle);
+}
+
+static Process_Usage
+process_usage_self(void) {
+	return _process_usage_from_handle(GetCurrentProcess());
+}
+
+//- Output capture
+
+static bool
+output_capture_begin(Output_Capture *capture) {
+	memset(capture, 0, sizeof(Output_Capture));
+	fflush(stdout);
+	
+	// The file is inherited by the processes started while it's the standard output, and goes
+	// away when the last handle to it is closed.
+	bool ok = false;
+	char dir[MAX_PATH + 1];
+	char name[MAX_PATH + 1];
+	if (GetTempPathA(sizeof(dir), dir) > 0 && GetTempFileNameA(dir, "dsh", 0, name) != 0) {
+		SECURITY_ATTRIBUTES security = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+		HANDLE handle = CreateFileA(name, GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+									&security, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY|FILE_FLAG_DELETE_ON_CLOSE, NULL);
+		
+		// The C runtime writes to its own descriptor, which has to point at a handle of its own.
+		HANDLE crt_handle = INVALID_HANDLE_VALUE;
+		int    crt_fd     = -1;
+		int    saved_fd   = -1;
+		if (handle != INVALID_HANDLE_VALUE &&
+			DuplicateHandle(GetCurrentProcess(), handle, GetCurrentProcess(), &crt_handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+			crt_fd = _open_osfhandle(cast(intptr_t) crt_handle, 0);
+		}
+		if (crt_fd >= 0) {
+			saved_fd = _dup(_fileno(stdout));
+		}
+		
+		ok = saved_fd >= 0 && _dup2(crt_fd, _fileno(stdout)) == 0;
+		if (ok) {
+			capture->file.value = cast(u64) handle;
+			capture->saved[0]   = cast(u64) saved_fd;
+			capture->saved[1]   = cast(u64) GetStdHandle(STD_OUTPUT_HANDLE);
+			SetStdHandle(STD_OUTPUT_HANDLE, handle);
+			_output_capture_depth += 1;
+		} else {
+			if (saved_fd >= 0) _close(saved_fd);
+			if (crt_fd >= 0) {
+				_close(crt_fd);
+			} else if (crt_handle != INVALID_HANDLE_VALUE) {
+				CloseHandle(crt_handle);
+			}
+			if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+		}
+	}
+	
+	return ok;
+}
+
+static String
+output_capture_end(Arena *arena, Output_Capture *capture) {
+	String result = {0};
+	fflush(stdout);
+	
+	HANDLE handle = cast(HANDLE) capture->file.value;
+	int    saved  = cast(int) capture->saved[0];
+	_dup2(saved, _fileno(stdout));
+	_close(saved);
+	SetStdHandle(STD_OUTPUT_HANDLE, cast(HANDLE) capture->saved[1]);
+	_output_capture_depth -= 1;
+	
+	LARGE_INTEGER size = {0};
+	if (GetFileSizeEx(handle, &size) && size.QuadPart > 0 && size.QuadPart < UINT32_MAX) {
+		u8 *data = push_nozero(arena, cast(u64) size.QuadPart + 1);
+		LARGE_INTEGER start = {0};
+		if (data != NULL && SetFilePointerEx(handle, start, NULL, FILE_BEGIN)) {
+			DWORD nread = 0;
+			if (!ReadFile(handle, data, cast(DWORD) size.QuadPart, &nread, NULL)) {
+				nread = 0;
+			}
+			data[nread] = 0;
+			result = string(data, nread);
+		}
+	}
+	CloseHandle(handle);
+	
+	memset(capture, 0, sizeof(Output_Capture));
+	return result;
+}
+
+////////////////////////////////
+//~ Threads
+
+static_assert(sizeof(SRWLOCK) <= sizeof(Mutex), "SRWLOCK doesn't fit in Mutex");
+static_assert(sizeof(CONDITION_VARIABLE) <= sizeof(Condition_Variable), "CONDITION_VARIABLE doesn't fit in Condition_Variable");
+
+//- Thread functions
+
+static DWORD WINAPI
+_thread_entry(void *param) {
+	Thread *thread = cast(Thread *) param;
+	thread->proc(thread->param);
+	return 0;
+}
+
+static bool
+thread_start(Thread *thread, Thread_Proc *proc, void *param) {
+	thread->proc   = proc;
+	thread->param  = param;
+	thread->handle = 0;
+	
+	HANDLE handle = CreateThread(NULL, 0, _thread_entry, thread, 0, NULL);
+	if (handle != NULL) {
+		thread->handle = cast(u64) handle;
+	}
+	return handle != NULL;
+}
+
+static void
+thread_join(Thread *thread) {
+	if (thread->handle != 0) {
+		WaitForSingleObject(cast(HANDLE) thread->handle, INFINITE);
+		CloseHandle(cast(HANDLE) thread->handle);
+		thread->handle = 0;
+	}
+}
+
+static void
+mutex_init(Mutex *mutex) {
+	InitializeSRWLock(cast(SRWLOCK *) mutex);
+}
+
+static void
+mutex_fini(Mutex *mutex) {
+	(void)mutex; // SRW locks don't need to be destroyed.
+}
+
+static void
+mutex_lock(Mutex *mutex) {
+	AcquireSRWLockExclusive(cast(SRWLOCK *) mutex);
+}
+
+static void
+mutex_unlock(Mutex *mutex) {
+	ReleaseSRWLockExclusive(cast(SRWLOCK *) mutex);
+}
+
+static void
+condition_variable_init(Condition_Variable *cv) {
+	InitializeConditionVariable(cast(CONDITION_VARIABLE *) cv);
+}
+
+static void
+condition_variable_fini(Condition_Variable *cv) {
+	(void)cv;
+}
+
+static void
+condition_variable_broadcast(Condition_Variable *cv) {
+	WakeAllConditionVariable(cast(CONDITION_VARIABLE *) cv);
+}
+
+static bool
+condition_variable_wait(Condition_Variable *cv, Mutex *mutex, i64 timeout_us) {
+	DWORD timeout_ms = timeout_us < 0 ? INFINITE : cast(DWORD) ((timeout_us + 999) / 1000);
+	bool  result = SleepConditionVariableSRW(cast(CONDITION_VARIABLE *) cv, cast(SRWLOCK *) mutex, timeout_ms, 0);
+	return result || GetLastError() != ERROR_TIMEOUT;
+}
+
+//- Futex
+
+#pragma comment(lib, "synchronization.lib")
+
+static void
+futex_wait(u32 *address, u32 expected, i64 timeout_us) {
+	DWORD timeout_ms = timeout_us >= 0 ? cast(DWORD) ((timeout_us + 999) / 1000) : INFINITE;
+	WaitOnAddress(address, &expected, sizeof(u32), timeout_ms);
+}
+
+static void
+futex_wake_one(u32 *address) {
+	WakeByAddressSingle(address);
+}
+
+static void
+futex_wake_all(u32 *address) {
+	WakeByAddressAll(address);
+}
+
+static i64
+get_processor_count(void) {
+	SYSTEM_INFO info = {0};
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? cast(i64) info.dwNumberOfProcessors : 1;
+}
+
 #endif
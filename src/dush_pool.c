@@ -0,0 +1,232 @@
+#ifndef DUSH_POOL_C
+#define DUSH_POOL_C
+
+////////////////////////////////
+//~ Thread pool
+
+//- Thread pool queue
+
+// A bounded multi-producer multi-consumer queue, after Dmitry Vyukov's. Producers and consumers
+// claim a position with a compare-exchange and then only touch their own cell, so they never
+// wait for each other.
+
+static bool
+_thread_pool_enqueue(Thread_Pool *pool, Task task) {
+	bool ok = false;
+	
+	u64 pos = atomic_load_u64(&pool->enqueue_pos);
+	while (true) {
+		Thread_Pool_Cell *cell = &pool->cells[pos & (THREAD_POOL_QUEUE_CAP - 1)];
+		u64 sequence = atomic_load_u64(&cell->sequence);
+		i64 diff = cast(i64) (sequence - pos);
+		
+		if (diff == 0) {
+			if (atomic_compare_exchange_u64(&pool->enqueue_pos, pos, pos + 1)) {
+				cell->task = task;
+				atomic_store_u64(&cell->sequence, pos + 1);
+				ok = true;
+				break;
+			}
+			pos = atomic_load_u64(&pool->enqueue_pos);
+		} else if (diff < 0) {
+			break; // Full
+		} else {
+			pos = atomic_load_u64(&pool->enqueue_pos);
+		}
+	}
+	
+	return ok;
+}
+
+static bool
+_thread_pool_dequeue(Thread_Pool *pool, Task *task) {
+	bool ok = false;
+	
+	u64 pos = atomic_load_u64(&pool->dequeue_pos);
+	while (true) {
+		Thread_Pool_Cell *cell = &pool->cells[pos & (THREAD_POOL_QUEUE_CAP - 1)];
+		u64 sequence = atomic_load_u64(&cell->sequence);
+		i64 diff = cast(i64) (sequence - (pos + 1));
+		
+		if (diff == 0) {
+			if (atomic_compare_exchange_u64(&pool->dequeue_pos, pos, pos + 1)) {
+				*task = cell->task;
+				atomic_store_u64(&cell->sequence, pos + THREAD_POOL_QUEUE_CAP);
+				ok = true;
+				break;
+			}
+			pos = atomic_load_u64(&pool->dequeue_pos);
+		} else if (diff < 0) {
+			break; // Empty
+		} else {
+			pos = atomic_load_u64(&pool->dequeue_pos);
+		}
+	}
+	
+	return ok;
+}
+
+//- Thread pool helpers
+
+static void
+_thread_pool_run(Task task) {
+	Trace_Span span = trace_begin("task", string_from_lit(""));
+	task.proc(task.param);
+	trace_end(span);
+	
+	if (task.group != NULL) {
+		u32 previous = atomic_fetch_add_u32(&task.group->pending, cast(u32) -1);
+		if (previous == 1) {
+			futex_wake_all(&task.group->pending);
+		}
+	}
+}
+
+static void
+_thread_pool_worker_proc(void *param) {
+	Thread_Pool_Worker *worker = cast(Thread_Pool_Worker *) param;
+	Thread_Pool        *pool   = worker->pool;
+	
+	thread_pool_worker_index = worker->index;
+	
+	char name[TRACE_THREAD_NAME_CAP];
+	int  name_len = snprintf(name, sizeof(name), "worker %lld", cast(long long) worker->index);
+	trace_set_thread_name(string(cast(u8 *) name, name_len));
+	
+	i64 idle_spins = 0;
+	while (true) {
+		Task task = {0};
+		if (_thread_pool_dequeue(pool, &task)) {
+			_thread_pool_run(task);
+			idle_spins = 0;
+			continue;
+		}
+		
+		if (atomic_load_u32(&pool->quit)) break;
+		
+		if (idle_spins < THREAD_POOL_SPIN_COUNT) {
+			cpu_relax();
+			idle_spins += 1;
+			continue;
+		}
+		
+		// Announce the sleep before the last look at the queue: a push either sees the sleeper
+		// and bumps wake_count, or happened before and its task is found here.
+		atomic_fetch_add_u32(&pool->sleeping, 1);
+		u32 seen = atomic_load_u32(&pool->wake_count);
+		if (_thread_pool_dequeue(pool, &task)) {
+			atomic_fetch_add_u32(&pool->sleeping, cast(u32) -1);
+			_thread_pool_run(task);
+			idle_spins = 0;
+			continue;
+		}
+		if (!atomic_load_u32(&pool->quit)) {
+			futex_wait(&pool->wake_count, seen, -1);
+		}
+		atomic_fetch_add_u32(&pool->sleeping, cast(u32) -1);
+		idle_spins = 0;
+	}
+	
+	scratch_arenas_fini();
+}
+
+//- Thread pool functions
+
+static bool
+thread_pool_init(Thread_Pool *pool, i64 worker_count) {
+	memset(pool, 0, sizeof(Thread_Pool));
+	
+	if (worker_count <= 0) {
+		worker_count = get_processor_count();
+	}
+	worker_count = clamp(1, worker_count, THREAD_POOL_MAX_WORKERS);
+	
+	bool ok = arena_init(&pool->arena, .reserve_size = THREAD_POOL_QUEUE_CAP * sizeof(Thread_Pool_Cell));
+	if (ok) {
+		pool->cells = push_array(&pool->arena, Thread_Pool_Cell, THREAD_POOL_QUEUE_CAP);
+		ok = pool->cells != NULL;
+	}
+	
+	if (ok) {
+		for (u64 i = 0; i < THREAD_POOL_QUEUE_CAP; i += 1) {
+			pool->cells[i].sequence = i;
+		}
+		
+		for (i64 i = 0; i < worker_count; i += 1) {
+			Thread_Pool_Worker *worker = &pool->workers[i];
+			worker->pool  = pool;
+			worker->index = i;
+			if (!thread_start(&worker->thread, _thread_pool_worker_proc, worker)) {
+				break;
+			}
+			pool->worker_count += 1;
+		}
+		
+		// Fewer workers than asked for still make a working pool.
+		ok = pool->worker_count > 0;
+	}
+	
+	if (!ok) {
+		thread_pool_fini(pool);
+	}
+	
+	return ok;
+}
+
+static void
+thread_pool_fini(Thread_Pool *pool) {
+	atomic_store_u32(&pool->quit, 1);
+	atomic_fetch_add_u32(&pool->wake_count, 1);
+	futex_wake_all(&pool->wake_count);
+	
+	for (i64 i = 0; i < pool->worker_count; i += 1) {
+		thread_join(&pool->workers[i].thread);
+	}
+	
+	// Without workers nothing else runs what's left.
+	Task task = {0};
+	while (pool->cells != NULL && _thread_pool_dequeue(pool, &task)) {
+		_thread_pool_run(task);
+	}
+	
+	if (pool->arena.ptr != NULL) {
+		arena_fini(&pool->arena);
+	}
+	memset(pool, 0, sizeof(Thread_Pool));
+}
+
+static void
+thread_pool_push(Thread_Pool *pool, Task_Group *group, Task_Proc *proc, void *param) {
+	Task task = {proc, param, group};
+	
+	if (group != NULL) {
+		atomic_fetch_add_u32(&group->pending, 1);
+	}
+	
+	if (pool->worker_count > 0 && _thread_pool_enqueue(pool, task)) {
+		if (atomic_load_u32(&pool->sleeping) > 0) {
+			atomic_fetch_add_u32(&pool->wake_count, 1);
+			futex_wake_one(&pool->wake_count);
+		}
+	} else {
+		atomic_fetch_add_u64(&pool->tasks_run_inline, 1);
+		_thread_pool_run(task);
+	}
+}
+
+static void
+thread_pool_wait(Thread_Pool *pool, Task_Group *group) {
+	while (true) {
+		u32 pending = atomic_load_u32(&group->pending);
+		if (pending == 0) break;
+		
+		Task task = {0};
+		if (pool->worker_count > 0 && _thread_pool_dequeue(pool, &task)) {
+			_thread_pool_run(task);
+		} else {
+			futex_wait(&group->pending, pending, -1);
+		}
+	}
+}
+
+#endif
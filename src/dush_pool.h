@@ -0,0 +1,111 @@
+#ifndef DUSH_POOL_H
+#define DUSH_POOL_H
+
+////////////////////////////////
+//~ Thread pool
+
+// A fixed set of worker threads that take tasks from a shared queue. Builtins that walk
+// directories, hash or search files split their work into tasks and wait for them with a group.
+//
+// Workers are ordinary threads as far as the rest of the code is concerned: they have their own
+// scratch arenas and last_*_error variables, which are per_thread, and release the arenas when
+// the pool is finished.
+
+//- Thread pool constants
+
+// Must be a power of two. When the queue is full, thread_pool_push() runs the task right away.
+#if !defined(THREAD_POOL_QUEUE_CAP)
+#define THREAD_POOL_QUEUE_CAP 4096
+#endif
+
+#if !defined(THREAD_POOL_MAX_WORKERS)
+#define THREAD_POOL_MAX_WORKERS 64
+#endif
+
+// How many times an idle worker looks at the queue before it goes to sleep.
+#if !defined(THREAD_POOL_SPIN_COUNT)
+#define THREAD_POOL_SPIN_COUNT 512
+#endif
+
+//- Thread pool types
+
+typedef void Task_Proc(void *param);
+
+// Counts the tasks pushed with it that haven't finished yet. Starts zeroed.
+typedef struct Task_Group Task_Group;
+struct Task_Group {
+	u32 pending;
+};
+
+typedef struct Task Task;
+struct Task {
+	Task_Proc  *proc;
+	void       *param;
+	Task_Group *group;
+};
+
+// A slot of the queue. The sequence says whether the slot is ready to be written or read, and
+// for which lap around the queue.
+typedef struct Thread_Pool_Cell Thread_Pool_Cell;
+struct Thread_Pool_Cell {
+	u64  sequence;
+	Task task;
+};
+
+typedef struct Thread_Pool Thread_Pool;
+
+typedef struct Thread_Pool_Worker Thread_Pool_Worker;
+struct Thread_Pool_Worker {
+	Thread       thread;
+	Thread_Pool *pool;
+	i64          index;
+};
+
+struct Thread_Pool {
+	Arena             arena; // Holds the cells.
+	Thread_Pool_Cell *cells;
+	
+	// Where the next task is written and read. Each on its own cache line, because producers
+	// and consumers hammer them from different cores.
+	u8  pad0[64];
+	u64 enqueue_pos;
+	u8  pad1[64];
+	u64 dequeue_pos;
+	u8  pad2[64];
+	
+	// Idle workers sleep on wake_count, which is bumped every time a task is pushed while
+	// any of them is sleeping.
+	u32 wake_count;
+	u32 sleeping;
+	u32 quit;
+	
+	Thread_Pool_Worker workers[THREAD_POOL_MAX_WORKERS];
+	i64                worker_count;
+	
+	// Statistics
+	u64 tasks_run_inline; // Because the queue was full. Tasks push too, so it's atomic.
+};
+
+//- Thread pool variables
+
+// The index of the worker running on this thread, or -1 on threads that aren't workers. Useful
+// to give each worker its own slice of some shared state.
+per_thread i64 thread_pool_worker_index = -1;
+
+//- Thread pool functions
+
+// A worker count of 0 or less means one per processor.
+static bool thread_pool_init(Thread_Pool *pool, i64 worker_count);
+
+// Runs what's left in the queue, then stops the workers and releases everything they reserved.
+static void thread_pool_fini(Thread_Pool *pool);
+
+// The group can be NULL if nobody waits for the task. A pool that isn't running, e.g. because
+// thread_pool_init() failed, runs the task right away.
+static void thread_pool_push(Thread_Pool *pool, Task_Group *group, Task_Proc *proc, void *param);
+
+// Returns when every task of the group finished. Runs tasks from the queue while it waits, so
+// tasks can push and wait for tasks of their own.
+static void thread_pool_wait(Thread_Pool *pool, Task_Group *group);
+
+#endif
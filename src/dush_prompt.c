@@ -0,0 +1,349 @@
+#ifndef DUSH_PROMPT_C
+#define DUSH_PROMPT_C
+
+////////////////////////////////
+//~ Prompt
+
+//- Git
+
+static String
+git_branch_from_dir(Arena *arena, String dir) {
+	String result = {0};
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	
+	// Look for ".git" in the directory and in each of its parents.
+	String current = dir;
+	while (current.len > 0) {
+		String temp[] = {current, get_separator(), string_from_lit(".git")};
+		String git_path = strings_concat(scratch.arena, temp, array_count(temp));
+		
+		File_Attributes attributes = {0};
+		if (file_attributes(git_path, &attributes)) {
+			String git_dir = git_path;
+			
+			// In worktrees and submodules ".git" is a file that says where the real one is.
+			if (!(attributes.flags & File_Flag_IS_DIRECTORY)) {
+				Read_File_Result link = read_file(scratch.arena, git_path);
+				String contents = string_skip_chop_whitespace(string_from_sliceu8(link.contents));
+				if (link.ok && string_starts_with(contents, string_from_lit("gitdir:"))) {
+					git_dir = string_skip_chop_whitespace(string_skip(contents, 7));
+					if (!path_is_abs(git_dir)) {
+						String temp2[] = {current, get_separator(), git_dir};
+						git_dir = strings_concat(scratch.arena, temp2, array_count(temp2));
+					}
+				}
+			}
+			
+			String temp2[] = {git_dir, get_separator(), string_from_lit("HEAD")};
+			Read_File_Result head = read_file(scratch.arena, strings_concat(scratch.arena, temp2, array_count(temp2)));
+			if (head.ok) {
+				String ref = string_skip_chop_whitespace(string_from_sliceu8(head.contents));
+				if (string_starts_with(ref, string_from_lit("ref: refs/heads/"))) {
+					ref = string_skip(ref, 16);
+				} else if (string_starts_with(ref, string_from_lit("ref: "))) {
+					ref = string_skip(ref, 5);
+				} else {
+					// Detached HEAD: show the abbreviated commit hash.
+					ref = string_stop(ref, 7);
+				}
+				result = string_clone(arena, ref);
+			}
+			break;
+		}
+		
+		i64 separator_end = path_last_separator(current);
+		if (separator_end <= 0) break;
+		
+		// Keep the separator only for the root, e.g. "/home" -> "/".
+		String parent = string_stop(current, separator_end - 1);
+		if (parent.len == 0) parent = string_stop(current, separator_end);
+		if (parent.len >= current.len) break;
+		
+		current = parent;
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+//- Prompt helpers
+
+static void
+_prompt_worker_proc(void *param) {
+	Prompt        *prompt = cast(Prompt *) param;
+	Prompt_Worker *worker = &prompt->worker;
+	
+	trace_set_thread_name(string_from_lit("prompt"));
+	
+	Arena arena = {0};
+	arena_init(&arena, .reserve_size = megabytes(64));
+	
+	u8  dir[PROMPT_PATH_CAP];
+	u64 handled_id = 0;
+	
+	mutex_lock(&worker->mutex);
+	while (!worker->quit) {
+		if (worker->request_id == handled_id) {
+			condition_variable_wait(&worker->changed, &worker->mutex, -1);
+			continue;
+		}
+		
+		u64 id = worker->request_id;
+		i64 dir_len = worker->request_dir_len;
+		memcpy(dir, worker->request_dir, dir_len);
+		handled_id = id;
+		
+		if (worker->simulated_delay_us > 0) {
+			u64 deadline = time_now_us() + worker->simulated_delay_us;
+			for (u64 now = time_now_us(); now < deadline && !worker->quit; now = time_now_us()) {
+				condition_variable_wait(&worker->changed, &worker->mutex, cast(i64) (deadline - now));
+			}
+		}
+		mutex_unlock(&worker->mutex);
+		
+		Trace_Span span = trace_begin("git branch", string(dir, dir_len));
+		String branch = git_branch_from_dir(&arena, string(dir, dir_len));
+		branch.len = min(branch.len, PROMPT_BRANCH_CAP);
+		trace_end(span);
+		
+		mutex_lock(&worker->mutex);
+		
+		// A result for an older request would be for the wrong directory.
+		if (id == worker->request_id) {
+			// Outside of a repository there is no branch, and its data is NULL.
+			if (branch.len > 0) memcpy(worker->result_branch, branch.data, branch.len);
+			worker->result_branch_len = branch.len;
+			worker->result_id = id;
+			condition_variable_broadcast(&worker->changed);
+			console_wake(prompt->waker);
+		}
+		arena_reset(&arena);
+	}
+	mutex_unlock(&worker->mutex);
+	
+	arena_fini(&arena);
+	scratch_arenas_fini();
+}
+
+// Must be called with the mutex locked, once the result of the current request arrived.
+// Returns true if the branch changed.
+static bool
+_prompt_take_result(Prompt *prompt) {
+	Prompt_Worker *worker = &prompt->worker;
+	
+	String old_branch = string(prompt->branch, prompt->branch_len);
+	String new_branch = string(worker->result_branch, worker->result_branch_len);
+	bool   changed    = !string_equals(old_branch, new_branch);
+	
+	memcpy(prompt->branch, new_branch.data, new_branch.len);
+	prompt->branch_len = new_branch.len;
+	memcpy(prompt->branch_dir, worker->request_dir, worker->request_dir_len);
+	prompt->branch_dir_len = worker->request_dir_len;
+	prompt->pending = false;
+	
+	return changed;
+}
+
+static String
+_prompt_text(Prompt *prompt, Arena *arena) {
+	Scratch scratch = scratch_begin(&arena, 1);
+	
+	String *pieces = push_array(scratch.arena, String, prompt->segment_count);
+	if (pieces != NULL) {
+		for (i64 i = 0; i < prompt->segment_count; i += 1) {
+			Prompt_Segment *segment = &prompt->segments[i];
+			String piece = {0};
+			switch (segment->kind) {
+				case Prompt_Segment_TEXT: {
+					piece = segment->text;
+				} break;
+				case Prompt_Segment_CURRENT_DIR: {
+					piece = prompt->state.current_dir;
+				} break;
+				case Prompt_Segment_GIT_BRANCH: {
+					if (prompt->branch_len > 0) {
+						piece = push_stringf(scratch.arena, " (%.*s)", cast(int) prompt->branch_len, prompt->branch);
+					}
+				} break;
+				case Prompt_Segment_JOB_COUNT: {
+					if (prompt->state.job_count > 0) {
+						piece = push_stringf(scratch.arena, " [%lld job%s]", cast(long long) prompt->state.job_count,
+											 prompt->state.job_count == 1 ? "" : "s");
+					}
+				} break;
+				case Prompt_Segment_EXIT_STATUS: {
+					if (prompt->state.last_exit_code != 0) {
+						piece = push_stringf(scratch.arena, " [%d]", cast(int) prompt->state.last_exit_code);
+					}
+				} break;
+				case Prompt_Segment_COUNT: break;
+			}
+			// Segments that render nothing may have no data, which strings_concat() would copy from.
+			pieces[i] = piece.len > 0 ? piece : string_from_lit("");
+		}
+	}
+	
+	String result = pieces != NULL ? strings_concat(arena, pieces, prompt->segment_count) : string_from_lit("");
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+//- Prompt functions
+
+static bool
+prompt_init(Prompt *prompt, String format, u64 budget_us) {
+	memset(prompt, 0, sizeof(Prompt));
+	prompt->budget_us = budget_us;
+	
+	if (format.len == 0) {
+		format = string_from_lit(PROMPT_DEFAULT_FORMAT);
+	}
+	
+	bool ok = arena_init(&prompt->arena, .reserve_size = megabytes(1));
+	if (ok) {
+		// There can't be more segments than bytes in the format.
+		prompt->segments = push_array(&prompt->arena, Prompt_Segment, format.len);
+		ok = prompt->segments != NULL;
+	}
+	
+	if (ok) {
+		i64 text_start = 0;
+		for (i64 at = 0; at <= format.len; at += 1) {
+			Prompt_Segment_Kind kind = Prompt_Segment_COUNT;
+			if (at + 1 < format.len && format.data[at] == '\\') {
+				switch (format.data[at + 1]) {
+					case 'w': kind = Prompt_Segment_CURRENT_DIR; break;
+					case 'g': kind = Prompt_Segment_GIT_BRANCH;  break;
+					case 'j': kind = Prompt_Segment_JOB_COUNT;   break;
+					case '?': kind = Prompt_Segment_EXIT_STATUS; break;
+					case '\\': kind = Prompt_Segment_TEXT;       break;
+				}
+			}
+			
+			// Unknown escapes are left as they are.
+			bool is_escape = kind != Prompt_Segment_COUNT;
+			if ((is_escape || at == format.len) && at > text_start) {
+				Prompt_Segment *segment = &prompt->segments[prompt->segment_count];
+				segment->kind = Prompt_Segment_TEXT;
+				segment->text = string(format.data + text_start, at - text_start);
+				segment->text = string_clone(&prompt->arena, segment->text);
+				prompt->segment_count += 1;
+			}
+			
+			if (is_escape) {
+				Prompt_Segment *segment = &prompt->segments[prompt->segment_count];
+				segment->kind = kind;
+				if (kind == Prompt_Segment_TEXT) {
+					segment->text = string_from_lit("\\");
+				}
+				prompt->segment_count += 1;
+				
+				prompt->has_git_branch |= kind == Prompt_Segment_GIT_BRANCH;
+				at += 1;
+				text_start = at + 1;
+			}
+		}
+	}
+	
+	if (ok && prompt->has_git_branch) {
+		mutex_init(&prompt->worker.mutex);
+		condition_variable_init(&prompt->worker.changed);
+		prompt->waker = console_waker_create();
+	}
+	
+	return ok;
+}
+
+static void
+prompt_fini(Prompt *prompt) {
+	Prompt_Worker *worker = &prompt->worker;
+	if (prompt->has_git_branch) {
+		if (worker->started) {
+			mutex_lock(&worker->mutex);
+			worker->quit = true;
+			condition_variable_broadcast(&worker->changed);
+			mutex_unlock(&worker->mutex);
+			thread_join(&worker->thread);
+		}
+		
+		condition_variable_fini(&worker->changed);
+		mutex_fini(&worker->mutex);
+		console_waker_destroy(prompt->waker);
+	}
+	
+	arena_fini(&prompt->arena);
+	memset(prompt, 0, sizeof(Prompt));
+}
+
+static String
+prompt_render(Prompt *prompt, Arena *arena, Prompt_State state) {
+	prompt->renders += 1;
+	
+	// The state is kept for prompt_poll(), which could be called after the caller's memory is gone.
+	state.current_dir.len = min(state.current_dir.len, PROMPT_PATH_CAP);
+	memcpy(prompt->state_dir, state.current_dir.data, state.current_dir.len);
+	state.current_dir.data = prompt->state_dir;
+	prompt->state = state;
+	
+	Prompt_Worker *worker = &prompt->worker;
+	if (prompt->has_git_branch && !worker->started) {
+		worker->started = thread_start(&worker->thread, _prompt_worker_proc, prompt);
+	}
+	
+	if (worker->started) {
+		String dir = prompt->state.current_dir;
+		
+		mutex_lock(&worker->mutex);
+		
+		worker->request_id += 1;
+		memcpy(worker->request_dir, dir.data, dir.len);
+		worker->request_dir_len = dir.len;
+		condition_variable_broadcast(&worker->changed);
+		
+		u64 deadline = time_now_us() + prompt->budget_us;
+		for (u64 now = time_now_us(); worker->result_id != worker->request_id && now < deadline; now = time_now_us()) {
+			condition_variable_wait(&worker->changed, &worker->mutex, cast(i64) (deadline - now));
+		}
+		
+		if (worker->result_id == worker->request_id) {
+			_prompt_take_result(prompt);
+		} else {
+			// Print the prompt now and redraw it later. The last known branch is most likely
+			// still right if the directory didn't change.
+			prompt->pending = true;
+			prompt->late_results += 1;
+			if (!string_equals(dir, string(prompt->branch_dir, prompt->branch_dir_len))) {
+				prompt->branch_len = 0;
+			}
+		}
+		
+		mutex_unlock(&worker->mutex);
+	}
+	
+	return _prompt_text(prompt, arena);
+}
+
+static bool
+prompt_poll(Prompt *prompt, Arena *arena, String *text) {
+	bool changed = false;
+	
+	Prompt_Worker *worker = &prompt->worker;
+	if (prompt->pending) {
+		mutex_lock(&worker->mutex);
+		if (worker->result_id == worker->request_id) {
+			changed = _prompt_take_result(prompt);
+		}
+		mutex_unlock(&worker->mutex);
+	}
+	
+	if (changed) {
+		*text = _prompt_text(prompt, arena);
+	}
+	return changed;
+}
+
+#endif
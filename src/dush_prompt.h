@@ -0,0 +1,121 @@
+#ifndef DUSH_PROMPT_H
+#define DUSH_PROMPT_H
+
+////////////////////////////////
+//~ Prompt
+
+//- Prompt constants
+
+// \w is the current directory, \g the git branch, \j the number of jobs and \? the exit status
+// of the last command. Segments that have nothing to show take no space.
+#if !defined(PROMPT_DEFAULT_FORMAT)
+#define PROMPT_DEFAULT_FORMAT "\\w\\g\\j\\?>"
+#endif
+
+// How long printing the prompt waits for the segments computed in the background. Past this,
+// the prompt is printed with the last known values and redrawn when the results arrive.
+#if !defined(PROMPT_DEFAULT_BUDGET_US)
+#define PROMPT_DEFAULT_BUDGET_US 3000
+#endif
+
+#if !defined(PROMPT_PATH_CAP)
+#define PROMPT_PATH_CAP 4096
+#endif
+
+#if !defined(PROMPT_BRANCH_CAP)
+#define PROMPT_BRANCH_CAP 256
+#endif
+
+//- Prompt types
+
+typedef enum Prompt_Segment_Kind {
+	Prompt_Segment_TEXT,
+	Prompt_Segment_CURRENT_DIR, // \w
+	Prompt_Segment_GIT_BRANCH,  // \g, computed in the background
+	Prompt_Segment_JOB_COUNT,   // \j
+	Prompt_Segment_EXIT_STATUS, // \?
+	Prompt_Segment_COUNT,
+} Prompt_Segment_Kind;
+
+typedef struct Prompt_Segment Prompt_Segment;
+struct Prompt_Segment {
+	Prompt_Segment_Kind kind;
+	String              text; // Only for Prompt_Segment_TEXT
+};
+
+// What the shell knows when it prints the prompt.
+typedef struct Prompt_State Prompt_State;
+struct Prompt_State {
+	String current_dir;
+	i32    last_exit_code;
+	i64    job_count;
+};
+
+// The work shared with the background thread. Everything in here is protected by the mutex.
+typedef struct Prompt_Worker Prompt_Worker;
+struct Prompt_Worker {
+	Thread             thread;
+	Mutex              mutex;
+	Condition_Variable changed; // Signaled when there's a new request, a new result or it's time to quit.
+	bool               started;
+	bool               quit;
+	
+	u64 request_id;
+	u8  request_dir[PROMPT_PATH_CAP];
+	i64 request_dir_len;
+	
+	u64 result_id;
+	u8  result_branch[PROMPT_BRANCH_CAP];
+	i64 result_branch_len;
+	
+	u64 simulated_delay_us; // Makes every result arrive this much later. For benchmarks.
+};
+
+typedef struct Prompt Prompt;
+struct Prompt {
+	Arena           arena; // Holds the segments.
+	Prompt_Segment *segments;
+	i64             segment_count;
+	bool            has_git_branch;
+	u64             budget_us;
+	
+	Prompt_State state;
+	u8           state_dir[PROMPT_PATH_CAP];
+	
+	// The branch shown in the prompt, and the directory it belongs to.
+	u8  branch[PROMPT_BRANCH_CAP];
+	i64 branch_len;
+	u8  branch_dir[PROMPT_PATH_CAP];
+	i64 branch_dir_len;
+	
+	// Set when the prompt was printed before the result of the current request arrived.
+	bool pending;
+	
+	// Woken when a late result arrives, so that the line editor redraws the prompt.
+	Console_Waker waker;
+	
+	Prompt_Worker worker;
+	
+	// Statistics
+	u64 renders;
+	u64 late_results;
+};
+
+//- Prompt functions
+
+// An empty format means PROMPT_DEFAULT_FORMAT.
+static bool   prompt_init(Prompt *prompt, String format, u64 budget_us);
+static void   prompt_fini(Prompt *prompt);
+
+// Waits at most the budget for the background segments, then returns the prompt text.
+static String prompt_render(Prompt *prompt, Arena *arena, Prompt_State state);
+
+// If a result that was late for the last prompt_render() arrived since, and it changes the
+// prompt, returns true and the new text.
+static bool   prompt_poll(Prompt *prompt, Arena *arena, String *text);
+
+// The git branch of the repository that contains the directory, or an empty string. HEAD is
+// read directly, git is not run.
+static String git_branch_from_dir(Arena *arena, String dir);
+
+#endif
@@ -0,0 +1,2597 @@
+#ifndef DUSH_SCRIPT_C
+#define DUSH_SCRIPT_C
+
+////////////////////////////////
+//~ Script parsing
+
+//- Parser types
+
+typedef u8 Script_Token_Kind;
+enum {
+	Script_Token_END,
+	Script_Token_WORD,
+	Script_Token_SEPARATOR,  // A newline or a ';'.
+	Script_Token_BACKGROUND, // A '&', which ends the command before it and runs it in the background.
+	Script_Token_AND,        // "&&"
+	Script_Token_OR,         // "||"
+};
+
+typedef struct Script_Token Script_Token;
+struct Script_Token {
+	Script_Token_Kind kind;
+	i32    line;
+	String text; // Of a word, as written, and the characters of the others but END.
+	i64    end;  // Where the next token starts to be looked for.
+	i32    end_line;
+	bool   continued; // It ends the source with a backslash and a newline, so a line is missing.
+};
+
+// The parser runs twice over the same source. The first time the arrays are NULL and it only
+// counts what it would write into them (writes go to the dummies), so that the second time
+// everything is written into a single block of the right size.
+typedef struct Script_Parser Script_Parser;
+struct Script_Parser {
+	Script *script;
+	Arena  *arena;
+	String  source;
+	i64     cursor;
+	i32     line;
+	bool    continued; // Of the last token moved past.
+	
+	i32 node_count;
+	i32 word_count;
+	i32 part_count;
+	i32 expr_count;
+	i32 function_count;
+	
+	// The parts of the word being parsed. They are only added to the script when the word is
+	// done, after those of the words inside its $(...) and ${name op word}.
+	Script_Part      *word_parts;
+	i32               word_part_count;
+	Script_Word_Flags word_flags;
+	
+	bool   failed;
+	bool   incomplete;
+	i32    error_line;
+	String error;
+	
+	Script_Node dummy_node;
+	Script_Expr dummy_expr;
+};
+
+// Binary arithmetic operators, the two-character ones before their prefixes.
+typedef struct Script_Binary_Op Script_Binary_Op;
+struct Script_Binary_Op {
+	String         text;
+	i32            precedence;
+	Script_Expr_Op op;
+};
+
+read_only static Script_Binary_Op script_binary_ops[] = {
+	{string_from_lit_const("||"), 1,  Script_Expr_OR},
+	{string_from_lit_const("&&"), 2,  Script_Expr_AND},
+	{string_from_lit_const("|"),  3,  Script_Expr_BIT_OR},
+	{string_from_lit_const("^"),  4,  Script_Expr_BIT_XOR},
+	{string_from_lit_const("&"),  5,  Script_Expr_BIT_AND},
+	{string_from_lit_const("=="), 6,  Script_Expr_EQUAL},
+	{string_from_lit_const("!="), 6,  Script_Expr_NOT_EQUAL},
+	{string_from_lit_const("<<"), 8,  Script_Expr_SHIFT_LEFT},
+	{string_from_lit_const(">>"), 8,  Script_Expr_SHIFT_RIGHT},
+	{string_from_lit_const("<="), 7,  Script_Expr_LESS_EQUAL},
+	{string_from_lit_const(">="), 7,  Script_Expr_GREATER_EQUAL},
+	{string_from_lit_const("<"),  7,  Script_Expr_LESS},
+	{string_from_lit_const(">"),  7,  Script_Expr_GREATER},
+	{string_from_lit_const("+"),  9,  Script_Expr_ADD},
+	{string_from_lit_const("-"),  9,  Script_Expr_SUB},
+	{string_from_lit_const("*"),  10, Script_Expr_MUL},
+	{string_from_lit_const("/"),  10, Script_Expr_DIV},
+	{string_from_lit_const("%"),  10, Script_Expr_MOD},
+};
+
+// Assignments, the longer ones first. The others than '=' also apply their operator to the
+// variable and the value.
+read_only static Script_Binary_Op script_assignment_ops[] = {
+	{string_from_lit_const("<<="), 0, Script_Expr_SHIFT_LEFT},
+	{string_from_lit_const(">>="), 0, Script_Expr_SHIFT_RIGHT},
+	{string_from_lit_const("+="),  0, Script_Expr_ADD},
+	{string_from_lit_const("-="),  0, Script_Expr_SUB},
+	{string_from_lit_const("*="),  0, Script_Expr_MUL},
+	{string_from_lit_const("/="),  0, Script_Expr_DIV},
+	{string_from_lit_const("%="),  0, Script_Expr_MOD},
+	{string_from_lit_const("&="),  0, Script_Expr_BIT_AND},
+	{string_from_lit_const("^="),  0, Script_Expr_BIT_XOR},
+	{string_from_lit_const("|="),  0, Script_Expr_BIT_OR},
+	{string_from_lit_const("="),   0, Script_Expr_ASSIGN},
+};
+
+// The operators of ${name op word}, the longer ones first.
+typedef struct Script_Param_Syntax Script_Param_Syntax;
+struct Script_Param_Syntax {
+	String          text;
+	Script_Param_Op op;
+	bool            colon;
+};
+
+read_only static Script_Param_Syntax script_param_ops[] = {
+	{string_from_lit_const(":-"), Script_Param_DEFAULT,             true},
+	{string_from_lit_const(":="), Script_Param_ASSIGN,              true},
+	{string_from_lit_const(":+"), Script_Param_ALTERNATE,           true},
+	{string_from_lit_const("-"),  Script_Param_DEFAULT,             false},
+	{string_from_lit_const("="),  Script_Param_ASSIGN,              false},
+	{string_from_lit_const("+"),  Script_Param_ALTERNATE,           false},
+	{string_from_lit_const("##"), Script_Param_TRIM_LONGEST_PREFIX, false},
+	{string_from_lit_const("#"),  Script_Param_TRIM_PREFIX,         false},
+	{string_from_lit_const("%%"), Script_Param_TRIM_LONGEST_SUFFIX, false},
+	{string_from_lit_const("%"),  Script_Param_TRIM_SUFFIX,         false},
+	{string_from_lit_const("//"), Script_Param_REPLACE_ALL,         false},
+	{string_from_lit_const("/"),  Script_Param_REPLACE,             false},
+	{string_from_lit_const("^^"), Script_Param_UPPER,               false},
+	{string_from_lit_const(",,"), Script_Param_LOWER,               false},
+	{string_from_lit_const(":"),  Script_Param_SUBSTRING,           false},
+};
+
+//- Parser helpers
+
+static void
+_script_fail_va_list(Script_Parser *p, i32 line, bool incomplete, char *format, va_list args) {
+	if (!p->failed) {
+		p->error      = push_stringf_va_list(p->arena, format, args);
+		p->failed     = true;
+		p->incomplete = incomplete;
+		p->error_line = line;
+	}
+}
+
+static void
+_script_fail(Script_Parser *p, i32 line, char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	_script_fail_va_list(p, line, false, format, args);
+	va_end(args);
+}
+
+// For a source that ends too early, which the lines that come after it could complete.
+static void
+_script_fail_incomplete(Script_Parser *p, i32 line, char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	_script_fail_va_list(p, line, true, format, args);
+	va_end(args);
+}
+
+static i32
+_script_new_node(Script_Parser *p, Script_Node_Kind kind, i32 line) {
+	i32 index = p->node_count;
+	p->node_count += 1;
+	
+	Script_Node *node = p->script->nodes != NULL ? &p->script->nodes[index] : &p->dummy_node;
+	memset(node, 0, sizeof(Script_Node));
+	node->kind       = kind;
+	node->line       = line;
+	node->next       = -1;
+	node->first_word = p->word_count;
+	node->body[0]    = -1;
+	node->body[1]    = -1;
+	node->body[2]    = -1;
+	
+	return index;
+}
+
+static Script_Node *
+_script_node(Script_Parser *p, i32 index) {
+	return p->script->nodes != NULL && index >= 0 ? &p->script->nodes[index] : &p->dummy_node;
+}
+
+static Script_Part *
+_script_new_part(Script_Parser *p, Script_Part_Kind kind, bool quoted) {
+	Script_Part *part = &p->word_parts[p->word_part_count];
+	memset(part, 0, sizeof(Script_Part));
+	part->kind        = kind;
+	part->quoted      = quoted;
+	part->operands[0] = -1;
+	part->operands[1] = -1;
+	p->word_part_count += 1;
+	return part;
+}
+
+// Adds words that were parsed, one after the other, and returns the index of the first one.
+static i32
+_script_add_words(Script_Parser *p, Script_Word *words, i32 count) {
+	i32 result = p->word_count;
+	if (p->script->words != NULL && count > 0) {
+		memcpy(&p->script->words[result], words, cast(u64) count * sizeof(Script_Word));
+	}
+	p->word_count += count;
+	return result;
+}
+
+static i32
+_script_new_expr(Script_Parser *p, Script_Expr_Op op, i32 left, i32 right) {
+	i32 index = p->expr_count;
+	p->expr_count += 1;
+	
+	Script_Expr *expr = p->script->exprs != NULL ? &p->script->exprs[index] : &p->dummy_expr;
+	memset(expr, 0, sizeof(Script_Expr));
+	expr->op    = op;
+	expr->left  = left;
+	expr->right = right;
+	
+	return index;
+}
+
+static bool
+_script_is_name(String s) {
+	bool result = s.len > 0;
+	for (i64 i = 0; result && i < s.len; i += 1) {
+		result = _expand_is_name_char(s.data[i], i == 0);
+	}
+	return result;
+}
+
+static bool
+_script_is_blank(u8 c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Where the quote that s starts with closes, or -1. A backslash escapes the next byte in double
+// quotes, not in single quotes.
+static i64
+_script_quote_end(String s) {
+	i64 result = -1;
+	if (s.data[0] == '\'') {
+		i64 end = string_find_first(string_skip(s, 1), '\'');
+		if (end >= 0) result = end + 1;
+	} else {
+		for (i64 i = 1; i < s.len; i += 1) {
+			if (s.data[i] == '\\') {
+				i += 1;
+			} else if (s.data[i] == '"') {
+				result = i;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+// s starts with "$((", "$(" or "${". Returns how many bytes there are up to and including the
+// "))", ')' or '}' that closes it, or 0 if nothing does. Quotes, escaped bytes and the groups
+// inside the group are skipped over.
+static i64
+_script_dollar_group_len(String s) {
+	i64 result = 0;
+	
+	if (string_starts_with(s, string_from_lit("$(("))) {
+		i64 depth = 0;
+		for (i64 i = 3; i < s.len; i += 1) {
+			if (s.data[i] == '(') {
+				depth += 1;
+			} else if (s.data[i] == ')') {
+				if (depth == 0) {
+					if (i + 1 < s.len && s.data[i + 1] == ')') result = i + 2;
+					break;
+				}
+				depth -= 1;
+			}
+		}
+	} else if (string_starts_with(s, string_from_lit("$(")) || string_starts_with(s, string_from_lit("${"))) {
+		u8  close = s.data[1] == '(' ? ')' : '}';
+		i64 i     = 2;
+		while (i < s.len && result == 0) {
+			u8 c = s.data[i];
+			if (c == '\'' || c == '"') {
+				i64 end = _script_quote_end(string_skip(s, i));
+				if (end < 0) break;
+				i += end + 1;
+			} else if (c == '\\') {
+				i += 2;
+			} else if (c == '$' && i + 1 < s.len && (s.data[i + 1] == '(' || s.data[i + 1] == '{')) {
+				i64 group = _script_dollar_group_len(string_skip(s, i));
+				if (group == 0) break;
+				i += group;
+			} else if (c == close) {
+				result = i + 1;
+			} else {
+				i += 1;
+			}
+		}
+	}
+	
+	return result;
+}
+
+// Where the first c outside of quotes and $ groups, and not escaped, is in s, or -1.
+static i64
+_script_find_unquoted(String s, u8 c) {
+	i64 result = -1;
+	
+	u8  quote = 0;
+	i64 i     = 0;
+	while (i < s.len) {
+		u8 at = s.data[i];
+		if (at == '\\' && quote != '\'') {
+			i += 2;
+		} else if (quote != 0) {
+			if (at == quote) quote = 0;
+			i += 1;
+		} else if (at == c) {
+			result = i;
+			break;
+		} else if (at == '\'' || at == '"') {
+			quote = at;
+			i += 1;
+		} else if (at == '$') {
+			i += max(1, _script_dollar_group_len(string_skip(s, i)));
+		} else {
+			i += 1;
+		}
+	}
+	
+	return result;
+}
+
+// Skips blanks, comments and lines that end with a backslash, but not newlines, which separate
+// statements.
+static i64
+_script_skip_blanks(String source, i64 cursor, i32 *line) {
+	while (cursor < source.len) {
+		u8 c = source.data[cursor];
+		if (_script_is_blank(c)) {
+			cursor += 1;
+		} else if (c == '\\' && cursor + 1 < source.len && source.data[cursor + 1] == '\n') {
+			cursor += 2;
+			*line  += 1;
+		} else if (c == '#') {
+			while (cursor < source.len && source.data[cursor] != '\n') {
+				cursor += 1;
+			}
+		} else {
+			break;
+		}
+	}
+	return cursor;
+}
+
+// The token at the cursor, without moving past it.
+static Script_Token
+_script_peek(Script_Parser *p) {
+	Script_Token result = {0};
+	
+	String source = p->source;
+	i32    line   = p->line;
+	i64    cursor = _script_skip_blanks(source, p->cursor, &line);
+	
+	result.line = line;
+	if (cursor >= source.len) {
+		// Only a line that ends with a backslash is skipped with its newline.
+		result.kind      = Script_Token_END;
+		result.continued = cursor > p->cursor && source.data[cursor - 1] == '\n';
+	} else if (source.data[cursor] == '\n' || source.data[cursor] == ';') {
+		result.kind = Script_Token_SEPARATOR;
+		result.text = string(source.data + cursor, 1);
+		if (source.data[cursor] == '\n') line += 1;
+		cursor += 1;
+	} else if (string_starts_with(string_skip(source, cursor), string_from_lit("&&")) ||
+			   string_starts_with(string_skip(source, cursor), string_from_lit("||"))) {
+		result.kind = source.data[cursor] == '&' ? Script_Token_AND : Script_Token_OR;
+		result.text = string(source.data + cursor, 2);
+		cursor += 2;
+	} else if (source.data[cursor] == '&') {
+		result.kind = Script_Token_BACKGROUND;
+		result.text = string(source.data + cursor, 1);
+		cursor += 1;
+	} else {
+		// Like _expand_scan_word(), and $((...)), $(...) and ${...} are taken whole since they
+		// may contain spaces.
+		result.kind = Script_Token_WORD;
+		
+		i64 start = cursor;
+		u8  quote = 0;
+		while (cursor < source.len) {
+			u8 c = source.data[cursor];
+			if (quote == 0 && (isspace(c) || c == ';' || c == '&')) break;
+			if (quote == 0 && c == '|' && cursor + 1 < source.len && source.data[cursor + 1] == '|') break;
+			
+			i64 group = 0;
+			if (c == '$' && quote != '\'') {
+				group = _script_dollar_group_len(string_skip(source, cursor));
+			}
+			
+			if (c == '\\' && quote != '\'' && cursor + 1 < source.len) {
+				// What comes after a backslash is part of the word, even a blank or a quote.
+				if (source.data[cursor + 1] == '\n') {
+					line += 1;
+					result.continued = cursor + 2 == source.len;
+				}
+				cursor += 2;
+			} else if (group > 0) {
+				for (i64 i = 0; i < group; i += 1) {
+					if (source.data[cursor + i] == '\n') line += 1;
+				}
+				cursor += group;
+			} else {
+				if (quote == 0 && (c == '\'' || c == '"')) {
+					quote = c;
+				} else if (quote != 0 && c == quote) {
+					quote = 0;
+				} else if (c == '\n') {
+					line += 1;
+				}
+				cursor += 1;
+			}
+		}
+		
+		result.text = string(source.data + start, cursor - start);
+	}
+	
+	result.end      = cursor;
+	result.end_line = line;
+	return result;
+}
+
+static void
+_script_advance(Script_Parser *p, Script_Token token) {
+	p->cursor    = token.end;
+	p->line      = token.end_line;
+	p->continued = token.continued;
+}
+
+static bool
+_script_is_keyword(Script_Token token, char *keyword) {
+	return token.kind == Script_Token_WORD && string_equals(token.text, string_from_cstring(keyword));
+}
+
+// The words that end a list where the statement that holds the list goes on.
+static bool
+_script_ends_list(Script_Token token) {
+	return _script_is_keyword(token, "then") || _script_is_keyword(token, "elif") ||
+		_script_is_keyword(token, "else") || _script_is_keyword(token, "fi") ||
+		_script_is_keyword(token, "do") || _script_is_keyword(token, "done") ||
+		_script_is_keyword(token, "}");
+}
+
+static void
+_script_skip_separators(Script_Parser *p) {
+	for (Script_Token token = _script_peek(p); token.kind == Script_Token_SEPARATOR; token = _script_peek(p)) {
+		_script_advance(p, token);
+	}
+}
+
+static void
+_script_expect(Script_Parser *p, char *keyword, char *what) {
+	Script_Token token = _script_peek(p);
+	if (_script_is_keyword(token, keyword)) {
+		_script_advance(p, token);
+	} else if (token.kind == Script_Token_END) {
+		_script_fail_incomplete(p, token.line, "expected '%s' %s before the end", keyword, what);
+	} else if (token.kind == Script_Token_SEPARATOR) {
+		_script_fail(p, token.line, "expected '%s' %s", keyword, what);
+	} else {
+		_script_fail(p, token.line, "expected '%s' %s, not '%.*s'", keyword, what, string_expand(token.text));
+	}
+}
+
+//- Arithmetic parsing
+
+static i32 _script_parse_assignment(Script_Parser *p, String text, i64 *cursor, i32 line);
+
+static i64
+_script_skip_expr_blanks(String text, i64 cursor) {
+	while (cursor < text.len && isspace(text.data[cursor])) {
+		cursor += 1;
+	}
+	return cursor;
+}
+
+static i32
+_script_parse_operand(Script_Parser *p, String text, i64 *cursor, i32 line) {
+	i32 result = -1;
+	
+	i64 at = _script_skip_expr_blanks(text, *cursor);
+	u8  c  = at < text.len ? text.data[at] : 0;
+	
+	if (c == '-' || c == '+' || c == '!' || c == '~') {
+		at += 1;
+		i32 operand = _script_parse_operand(p, text, &at, line);
+		if      (c == '-') result = _script_new_expr(p, Script_Expr_NEGATE, operand, -1);
+		else if (c == '!') result = _script_new_expr(p, Script_Expr_NOT, operand, -1);
+		else if (c == '~') result = _script_new_expr(p, Script_Expr_BIT_NOT, operand, -1);
+		else               result = operand;
+	} else if (c == '(') {
+		at += 1;
+		result = _script_parse_assignment(p, text, &at, line);
+		at = _script_skip_expr_blanks(text, at);
+		if (at < text.len && text.data[at] == ')') {
+			at += 1;
+		} else {
+			_script_fail(p, line, "missing ')' in arithmetic");
+		}
+	} else if (isdigit(c)) {
+		i64 start = at;
+		while (at < text.len && isalnum(text.data[at])) {
+			at += 1;
+		}
+		String digits = string(text.data + start, at - start);
+		
+		u32 base = 10;
+		if (string_starts_with(digits, string_from_lit("0x")) || string_starts_with(digits, string_from_lit("0X"))) {
+			digits = string_skip(digits, 2);
+			base   = 16;
+		}
+		
+		i64 value = 0;
+		if (string_to_i64(digits, base, &value)) {
+			result = _script_new_expr(p, Script_Expr_NUMBER, -1, -1);
+			if (p->script->exprs != NULL) p->script->exprs[result].value = value;
+		} else {
+			_script_fail(p, line, "'%.*s' is not a number", cast(int) (at - start), text.data + start);
+		}
+	} else {
+		// A name, with or without a '$', or ${name}, or an argument.
+		String name = {0};
+		if (c == '$') {
+			String reference = {0};
+			i64 consumed = _expand_variable_reference(string_skip(text, at), &reference);
+			if (consumed > 0) {
+				name = reference;
+				at  += consumed;
+			} else if (at + 1 < text.len && isdigit(text.data[at + 1])) {
+				name = string(text.data + at + 1, 1);
+				at  += 2;
+			}
+		} else {
+			i64 start = at;
+			while (at < text.len && _expand_is_name_char(text.data[at], at == start)) {
+				at += 1;
+			}
+			name = string(text.data + start, at - start);
+		}
+		
+		i64 argument = 0;
+		if (name.len > 0 && string_to_i64(name, 10, &argument)) {
+			result = _script_new_expr(p, Script_Expr_ARGUMENT, -1, -1);
+			if (p->script->exprs != NULL) p->script->exprs[result].value = argument;
+		} else if (name.len > 0) {
+			result = _script_new_expr(p, Script_Expr_VARIABLE, -1, -1);
+			if (p->script->exprs != NULL) p->script->exprs[result].name = name;
+		} else if (at < text.len) {
+			_script_fail(p, line, "unexpected '%c' in arithmetic", text.data[at]);
+		} else {
+			_script_fail(p, line, "missing a number at the end of the arithmetic");
+		}
+	}
+	
+	*cursor = at;
+	return result;
+}
+
+// Precedence climbing: parses operands joined by operators that bind at least as tightly as
+// min_precedence. Every operator is left-associative.
+static i32
+_script_parse_expr(Script_Parser *p, String text, i64 *cursor, i32 line, i32 min_precedence) {
+	i32 result = _script_parse_operand(p, text, cursor, line);
+	
+	while (!p->failed) {
+		i64 at = _script_skip_expr_blanks(text, *cursor);
+		
+		Script_Binary_Op *found = NULL;
+		for (i64 i = 0; i < array_count(script_binary_ops); i += 1) {
+			if (string_starts_with(string_skip(text, at), script_binary_ops[i].text)) {
+				found = &script_binary_ops[i];
+				break;
+			}
+		}
+		if (found == NULL || found->precedence < min_precedence) break;
+		
+		*cursor = at + found->text.len;
+		i32 right = _script_parse_expr(p, text, cursor, line, found->precedence + 1);
+		result = _script_new_expr(p, found->op, result, right);
+	}
+	
+	return result;
+}
+
+// cond ? a : b, which binds less tightly than every binary operator, and from the right.
+static i32
+_script_parse_conditional(Script_Parser *p, String text, i64 *cursor, i32 line) {
+	i32 result = _script_parse_expr(p, text, cursor, line, 1);
+	
+	i64 at = _script_skip_expr_blanks(text, *cursor);
+	if (!p->failed && at < text.len && text.data[at] == '?') {
+		*cursor = at + 1;
+		i32 then_expr = _script_parse_assignment(p, text, cursor, line);
+		
+		at = _script_skip_expr_blanks(text, *cursor);
+		if (at < text.len && text.data[at] == ':') {
+			*cursor = at + 1;
+			i32 else_expr = _script_parse_conditional(p, text, cursor, line);
+			result = _script_new_expr(p, Script_Expr_CONDITIONAL, result, then_expr);
+			if (p->script->exprs != NULL) p->script->exprs[result].value = else_expr;
+		} else {
+			_script_fail(p, line, "missing ':' after '?' in arithmetic");
+		}
+	}
+	
+	return result;
+}
+
+// name = value, and the other assignments, which bind the least tightly and from the right.
+static i32
+_script_parse_assignment(Script_Parser *p, String text, i64 *cursor, i32 line) {
+	i32 result = -1;
+	
+	i64 at    = _script_skip_expr_blanks(text, *cursor);
+	i64 start = at;
+	while (at < text.len && _expand_is_name_char(text.data[at], at == start)) {
+		at += 1;
+	}
+	String name = string(text.data + start, at - start);
+	String rest = string_skip(text, _script_skip_expr_blanks(text, at));
+	
+	Script_Binary_Op *found = NULL;
+	if (name.len > 0 && !string_starts_with(rest, string_from_lit("=="))) {
+		for (i64 i = 0; i < array_count(script_assignment_ops); i += 1) {
+			if (string_starts_with(rest, script_assignment_ops[i].text)) {
+				found = &script_assignment_ops[i];
+				break;
+			}
+		}
+	}
+	
+	if (found != NULL) {
+		*cursor = (rest.data - text.data) + found->text.len;
+		i32 value = _script_parse_assignment(p, text, cursor, line);
+		if (found->op != Script_Expr_ASSIGN) {
+			i32 variable = _script_new_expr(p, Script_Expr_VARIABLE, -1, -1);
+			if (p->script->exprs != NULL) p->script->exprs[variable].name = name;
+			value = _script_new_expr(p, found->op, variable, value);
+		}
+		result = _script_new_expr(p, Script_Expr_ASSIGN, -1, value);
+		if (p->script->exprs != NULL) p->script->exprs[result].name = name;
+	} else {
+		result = _script_parse_conditional(p, text, cursor, line);
+	}
+	
+	return result;
+}
+
+static i32
+_script_parse_arithmetic(Script_Parser *p, String text, i32 line) {
+	i64 cursor = 0;
+	i32 result = _script_parse_assignment(p, text, &cursor, line);
+	
+	cursor = _script_skip_expr_blanks(text, cursor);
+	if (!p->failed && cursor < text.len) {
+		_script_fail(p, line, "unexpected '%.*s' in arithmetic", cast(int) (text.len - cursor), text.data + cursor);
+	}
+	
+	return result;
+}
+
+//- Word parsing
+
+static i32         _script_parse_nested_list(Script_Parser *p, String text, i32 line);
+static Script_Word _script_parse_word(Script_Parser *p, String text, String name, i32 line);
+
+// A word of ${name op word}, which is added on its own. Returns its index.
+static i32
+_script_parse_operand_word(Script_Parser *p, String text, i32 line) {
+	Script_Word word = _script_parse_word(p, text, string_from_lit(""), line);
+	p->word_flags |= word.flags & Script_Word_EFFECTS;
+	return _script_add_words(p, &word, 1);
+}
+
+// inner is what is between the braces of ${...}.
+static void
+_script_parse_parameter(Script_Parser *p, String inner, bool quoted, i32 line) {
+	// ${#name} is the length of the value, but ${#} alone is the number of arguments.
+	bool   length = inner.len > 1 && inner.data[0] == '#';
+	String rest   = length ? string_skip(inner, 1) : inner;
+	
+	i64 name_len = 0;
+	if (rest.len > 0 && (rest.data[0] == '#' || rest.data[0] == '@' || rest.data[0] == '*')) {
+		name_len = 1;
+	} else if (rest.len > 0 && isdigit(rest.data[0])) {
+		while (name_len < rest.len && isdigit(rest.data[name_len])) {
+			name_len += 1;
+		}
+	} else {
+		while (name_len < rest.len && _expand_is_name_char(rest.data[name_len], name_len == 0)) {
+			name_len += 1;
+		}
+	}
+	String name = string_stop(rest, name_len);
+	rest = string_skip(rest, name_len);
+	
+	Script_Part_Kind kind     = Script_Part_VARIABLE;
+	i64              argument = 0;
+	if (string_equals(name, string_from_lit("#"))) {
+		kind = Script_Part_ARG_COUNT;
+	} else if (string_equals(name, string_from_lit("@")) || string_equals(name, string_from_lit("*"))) {
+		kind = Script_Part_ALL_ARGS;
+	} else if (string_to_i64(name, 10, &argument) && argument <= INT32_MAX) {
+		kind = Script_Part_ARGUMENT;
+	}
+	
+	Script_Part *part = _script_new_part(p, kind, quoted);
+	part->number = cast(i32) argument;
+	if (kind == Script_Part_VARIABLE) {
+		part->text = name;
+	}
+	
+	Script_Param_Syntax *syntax = NULL;
+	for (i64 i = 0; i < array_count(script_param_ops) && rest.len > 0 && !length; i += 1) {
+		if (string_starts_with(rest, script_param_ops[i].text)) {
+			syntax = &script_param_ops[i];
+			break;
+		}
+	}
+	
+	bool simple = kind == Script_Part_VARIABLE || kind == Script_Part_ARGUMENT;
+	if (name.len == 0 || (rest.len > 0 && (syntax == NULL || !simple)) || (length && !simple)) {
+		_script_fail(p, line, "bad substitution: '${%.*s}'", string_expand(inner));
+	} else if (length) {
+		part->op = Script_Param_LENGTH;
+	} else if (syntax != NULL) {
+		String operand = string_skip(rest, syntax->text.len);
+		part->op    = syntax->op;
+		part->colon = syntax->colon;
+		
+		switch (syntax->op) {
+			case Script_Param_ASSIGN: {
+				if (kind != Script_Part_VARIABLE) {
+					_script_fail(p, line, "can't assign to '$%.*s'", string_expand(name));
+				}
+				p->word_flags |= Script_Word_EFFECTS;
+				part->operands[0] = _script_parse_operand_word(p, operand, line);
+			} break;
+			
+			case Script_Param_REPLACE:
+			case Script_Param_REPLACE_ALL: {
+				// The replacement may be left out, with its '/', to delete what matches.
+				i64 slash = _script_find_unquoted(operand, '/');
+				part->operands[0] = _script_parse_operand_word(p, slash >= 0 ? string_stop(operand, slash) : operand, line);
+				if (slash >= 0) {
+					part->operands[1] = _script_parse_operand_word(p, string_skip(operand, slash + 1), line);
+				}
+			} break;
+			
+			case Script_Param_SUBSTRING: {
+				i64 colon = _script_find_unquoted(operand, ':');
+				part->operands[0] = _script_parse_arithmetic(p, colon >= 0 ? string_stop(operand, colon) : operand, line);
+				if (colon >= 0) {
+					part->operands[1] = _script_parse_arithmetic(p, string_skip(operand, colon + 1), line);
+				}
+			} break;
+			
+			case Script_Param_UPPER:
+			case Script_Param_LOWER: {
+				if (operand.len > 0) {
+					_script_fail(p, line, "bad substitution: '${%.*s}'", string_expand(inner));
+				}
+			} break;
+			
+			default: {
+				part->operands[0] = _script_parse_operand_word(p, operand, line);
+			} break;
+		}
+	}
+}
+
+// text starts with a '$'. Adds the part it stands for and returns how many bytes it takes, or
+// returns 0 if the '$' is to be taken literally.
+static i64
+_script_parse_dollar(Script_Parser *p, String text, bool quoted, i32 line) {
+	i64 result = 0;
+	
+	u8 c = text.len >= 2 ? text.data[1] : 0;
+	if (c == '(' || c == '{') {
+		bool arithmetic = string_starts_with(text, string_from_lit("$(("));
+		result = _script_dollar_group_len(text);
+		if (result == 0) {
+			_script_fail_incomplete(p, line, arithmetic ? "missing '))'" : c == '(' ? "missing ')'" : "missing '}'");
+		} else if (arithmetic) {
+			Script_Part *part = _script_new_part(p, Script_Part_ARITHMETIC, quoted);
+			part->number = _script_parse_arithmetic(p, string(text.data + 3, result - 5), line);
+		} else if (c == '(') {
+			Script_Part *part = _script_new_part(p, Script_Part_COMMAND, quoted);
+			part->number = _script_parse_nested_list(p, string(text.data + 2, result - 3), line);
+			p->word_flags |= Script_Word_EFFECTS;
+		} else {
+			_script_parse_parameter(p, string(text.data + 2, result - 3), quoted, line);
+		}
+	} else if (c == '#' || c == '@' || c == '*') {
+		_script_new_part(p, c == '#' ? Script_Part_ARG_COUNT : Script_Part_ALL_ARGS, quoted);
+		result = 2;
+	} else if (c == '!' || c == '?') {
+		_script_new_part(p, c == '!' ? Script_Part_LAST_JOB : Script_Part_STATUS, quoted);
+		result = 2;
+	} else if (isdigit(c)) {
+		Script_Part *part = _script_new_part(p, Script_Part_ARGUMENT, quoted);
+		part->number = c - '0';
+		result = 2;
+	} else {
+		String name = {0};
+		result = _expand_variable_reference(text, &name);
+		if (result > 0) {
+			Script_Part *part = _script_new_part(p, Script_Part_VARIABLE, quoted);
+			part->text = name;
+		}
+	}
+	
+	return result;
+}
+
+// Splits the text of a word into parts, with the same quoting rules as _expand_scan_word(),
+// and adds them to the script. The word itself is added by the caller, once the words it
+// holds in $(...) and ${name op word} are.
+static Script_Word
+_script_parse_word(Script_Parser *p, String text, String name, i32 line) {
+	Script_Word result = {0};
+	result.name = name;
+	
+	// There can't be more parts than bytes, plus one.
+	Scratch           scratch     = scratch_begin(&p->arena, 1);
+	Script_Part      *saved_parts = p->word_parts;
+	i32               saved_count = p->word_part_count;
+	Script_Word_Flags saved_flags = p->word_flags;
+	p->word_parts      = push_nozero_aligned(scratch.arena, cast(u64) (text.len + 1) * sizeof(Script_Part), alignof(Script_Part));
+	p->word_part_count = 0;
+	p->word_flags      = 0;
+	if (p->word_parts == NULL) {
+		_script_fail(p, line, "out of memory");
+		text = string_from_lit("");
+	}
+	
+	u8  quote         = 0;
+	i64 literal_start = 0;
+	i64 i = 0;
+	while (i < text.len) {
+		u8  c = text.data[i];
+		i64 consumed = 0;
+		
+		if (c == '\\' && i + 1 < text.len && (quote == 0 || (quote == '"' && _expand_is_escapable_in_quotes(text.data[i + 1])))) {
+			// The byte after the backslash is taken as it is, on its own, so that it is quoted;
+			// a newline after it is removed with it.
+			if (i > literal_start) {
+				Script_Part *part = _script_new_part(p, Script_Part_LITERAL, quote != 0);
+				part->text = string(text.data + literal_start, i - literal_start);
+			}
+			if (text.data[i + 1] != '\n') {
+				Script_Part *part = _script_new_part(p, Script_Part_LITERAL, true);
+				part->text = string(text.data + i + 1, 1);
+			}
+			i += 2;
+			literal_start = i;
+			continue;
+		} else if ((quote == 0 && (c == '\'' || c == '"')) || (quote != 0 && c == quote)) {
+			consumed = 1;
+		} else if (c == '$' && quote != '\'') {
+			// The literal text before it has to come first.
+			i32 before = p->word_part_count;
+			if (i > literal_start) {
+				Script_Part *part = _script_new_part(p, Script_Part_LITERAL, quote != 0);
+				part->text = string(text.data + literal_start, i - literal_start);
+			}
+			
+			consumed = _script_parse_dollar(p, string_skip(text, i), quote != 0, line);
+			if (consumed == 0) {
+				// Taken literally after all: take the part back, and go on with it.
+				p->word_part_count = before;
+				i += 1;
+				continue;
+			}
+			
+			i += consumed;
+			literal_start = i;
+			continue;
+		} else if (quote == 0 && (c == '*' || c == '?')) {
+			p->word_flags |= Script_Word_GLOB;
+		}
+		
+		if (consumed > 0) {
+			// A quote starts or ends.
+			if (i > literal_start) {
+				Script_Part *part = _script_new_part(p, Script_Part_LITERAL, quote != 0);
+				part->text = string(text.data + literal_start, i - literal_start);
+			}
+			quote = quote == 0 ? c : 0;
+			i += consumed;
+			literal_start = i;
+		} else {
+			i += 1;
+		}
+	}
+	
+	if (i > literal_start) {
+		Script_Part *part = _script_new_part(p, Script_Part_LITERAL, quote != 0);
+		part->text = string(text.data + literal_start, i - literal_start);
+	}
+	
+	// The word took everything up to the end looking for the quote.
+	if (quote != 0) {
+		_script_fail_incomplete(p, line, "missing the closing quote");
+	}
+	
+	result.first_part = p->part_count;
+	result.part_count = p->word_part_count;
+	result.flags      = p->word_flags;
+	if (p->script->parts != NULL && result.part_count > 0) {
+		memcpy(&p->script->parts[p->part_count], p->word_parts, cast(u64) result.part_count * sizeof(Script_Part));
+	}
+	p->part_count += result.part_count;
+	
+	p->word_parts      = saved_parts;
+	p->word_part_count = saved_count;
+	p->word_flags      = saved_flags;
+	scratch_end(scratch);
+	
+	return result;
+}
+
+//- Statement parsing
+
+static i32 _script_parse_list(Script_Parser *p);
+
+// A compound statement must be followed by the end of the statement.
+static void
+_script_expect_statement_end(Script_Parser *p, char *keyword) {
+	Script_Token token = _script_peek(p);
+	if (token.kind == Script_Token_WORD && !_script_ends_list(token)) {
+		_script_fail(p, token.line, "expected ';' or a newline after '%s', not '%.*s'", keyword, string_expand(token.text));
+	}
+}
+
+// The list inside $(...), which is parsed as if it were a script of its own.
+static i32
+_script_parse_nested_list(Script_Parser *p, String text, i32 line) {
+	String saved_source = p->source;
+	i64    saved_cursor = p->cursor;
+	i32    saved_line   = p->line;
+	
+	bool   saved_continued = p->continued;
+	
+	p->source = text;
+	p->cursor = 0;
+	p->line   = line;
+	bool failed = p->failed;
+	i32  result = _script_parse_list(p);
+	
+	Script_Token token = _script_peek(p);
+	if (!p->failed && token.kind != Script_Token_END) {
+		_script_fail(p, token.line, "unexpected '%.*s' in $(...)", string_expand(token.text));
+	}
+	
+	// The ')' is there already, so no line that comes after can complete what's inside.
+	if (!failed) p->incomplete = false;
+	p->continued = saved_continued;
+	
+	p->source = saved_source;
+	p->cursor = saved_cursor;
+	p->line   = saved_line;
+	return result;
+}
+
+// The words up to the end of the statement go to a buffer, and are added to the script when
+// they are all parsed: the words of the commands in their $(...) come first.
+static Script_Word *
+_script_word_buffer(Script_Parser *p, Arena *arena, i32 *cap) {
+	Script_Parser lookahead = *p;
+	i32 count = 0;
+	for (Script_Token token = _script_peek(&lookahead); token.kind == Script_Token_WORD; token = _script_peek(&lookahead)) {
+		_script_advance(&lookahead, token);
+		count += 1;
+	}
+	
+	Script_Word *result = push_array(arena, Script_Word, count);
+	if (result == NULL && count > 0) {
+		_script_fail(p, p->line, "out of memory");
+		count = 0;
+	}
+	*cap = count;
+	return result;
+}
+
+static i32
+_script_parse_command(Script_Parser *p) {
+	Script_Token token = _script_peek(p);
+	i32 result = _script_new_node(p, Script_Node_COMMAND, token.line);
+	
+	Script_Node_Flags flags = 0;
+	if (_script_is_keyword(token, "time")) {
+		_script_advance(p, token);
+		flags |= Script_Node_TIMED;
+	}
+	
+	Scratch      scratch = scratch_begin(&p->arena, 1);
+	i32          cap     = 0;
+	Script_Word *words   = _script_word_buffer(p, scratch.arena, &cap);
+	
+	i32 word_count       = 0;
+	i32 assignment_count = 0;
+	for (token = _script_peek(p); token.kind == Script_Token_WORD && word_count < cap && !p->failed; token = _script_peek(p)) {
+		_script_advance(p, token);
+		
+		// Assignments are only taken as such before the command.
+		i64 equals = string_find_first(token.text, '=');
+		String name = string_stop(token.text, equals);
+		if (word_count == assignment_count && equals > 0 && _script_is_name(name)) {
+			words[word_count] = _script_parse_word(p, string_skip(token.text, equals + 1), name, token.line);
+			assignment_count += 1;
+		} else {
+			words[word_count] = _script_parse_word(p, token.text, string_from_lit(""), token.line);
+		}
+		word_count += 1;
+	}
+	
+	// Which is also the end of the statement.
+	if (token.kind == Script_Token_BACKGROUND) {
+		_script_advance(p, token);
+		flags |= Script_Node_BACKGROUND;
+	}
+	
+	Script_Node *node = _script_node(p, result);
+	node->flags            = flags;
+	node->first_word       = _script_add_words(p, words, word_count);
+	node->word_count       = word_count;
+	node->assignment_count = assignment_count;
+	
+	scratch_end(scratch);
+	return result;
+}
+
+// After the "if" or "elif". An elif is an if in the else list, which ends with the same fi.
+static i32
+_script_parse_if(Script_Parser *p, i32 line) {
+	i32 result = _script_new_node(p, Script_Node_IF, line);
+	
+	i32 condition = _script_parse_list(p);
+	_script_expect(p, "then", "after the condition of 'if'");
+	i32 then_list = _script_parse_list(p);
+	i32 else_list = -1;
+	
+	Script_Token token = _script_peek(p);
+	if (_script_is_keyword(token, "elif")) {
+		_script_advance(p, token);
+		else_list = _script_parse_if(p, token.line);
+	} else {
+		if (_script_is_keyword(token, "else")) {
+			_script_advance(p, token);
+			else_list = _script_parse_list(p);
+		}
+		_script_expect(p, "fi", "to end 'if'");
+	}
+	
+	Script_Node *node = _script_node(p, result);
+	node->body[0] = condition;
+	node->body[1] = then_list;
+	node->body[2] = else_list;
+	
+	return result;
+}
+
+static i32
+_script_parse_loop_body(Script_Parser *p, char *what) {
+	_script_expect(p, "do", what);
+	i32 result = _script_parse_list(p);
+	_script_expect(p, "done", "to end the loop");
+	return result;
+}
+
+static i32
+_script_parse_function(Script_Parser *p, String name, i32 line) {
+	i32 result = _script_new_node(p, Script_Node_FUNCTION, line);
+	
+	if (!_script_is_name(name)) {
+		_script_fail(p, line, "'%.*s' is not a valid function name", string_expand(name));
+	}
+	
+	_script_skip_separators(p);
+	_script_expect(p, "{", "before the body of the function");
+	i32 body = _script_parse_list(p);
+	_script_expect(p, "}", "to end the function");
+	
+	Script_Node *node = _script_node(p, result);
+	node->name    = name;
+	node->body[1] = body;
+	p->function_count += 1;
+	
+	return result;
+}
+
+static i32
+_script_parse_statement(Script_Parser *p) {
+	i32 result = -1;
+	
+	Script_Token token = _script_peek(p);
+	Script_Token after = {0};
+	{
+		Script_Parser lookahead = *p;
+		_script_advance(&lookahead, token);
+		after = _script_peek(&lookahead);
+	}
+	
+	if (_script_is_keyword(token, "if")) {
+		_script_advance(p, token);
+		result = _script_parse_if(p, token.line);
+		_script_expect_statement_end(p, "fi");
+	} else if (_script_is_keyword(token, "while") || _script_is_keyword(token, "until")) {
+		_script_advance(p, token);
+		result = _script_new_node(p, Script_Node_WHILE, token.line);
+		
+		i32 condition = _script_parse_list(p);
+		i32 body      = _script_parse_loop_body(p, "after the condition of the loop");
+		
+		Script_Node *node = _script_node(p, result);
+		node->flags   = _script_is_keyword(token, "until") ? Script_Node_UNTIL : 0;
+		node->body[0] = condition;
+		node->body[1] = body;
+		_script_expect_statement_end(p, "done");
+	} else if (_script_is_keyword(token, "for")) {
+		_script_advance(p, token);
+		_script_advance(p, after);
+		result = _script_new_node(p, Script_Node_FOR, token.line);
+		
+		if (after.kind != Script_Token_WORD || !_script_is_name(after.text)) {
+			_script_fail(p, token.line, "expected a variable name after 'for'");
+		}
+		
+		Script_Node_Flags flags = 0;
+		i32 first_word = p->word_count;
+		i32 word_count = 0;
+		Script_Token next = _script_peek(p);
+		if (_script_is_keyword(next, "in")) {
+			_script_advance(p, next);
+			flags |= Script_Node_IN;
+			
+			Scratch      scratch = scratch_begin(&p->arena, 1);
+			i32          cap     = 0;
+			Script_Word *words   = _script_word_buffer(p, scratch.arena, &cap);
+			for (next = _script_peek(p); next.kind == Script_Token_WORD && word_count < cap; next = _script_peek(p)) {
+				_script_advance(p, next);
+				words[word_count] = _script_parse_word(p, next.text, string_from_lit(""), next.line);
+				word_count += 1;
+			}
+			first_word = _script_add_words(p, words, word_count);
+			scratch_end(scratch);
+		}
+		_script_skip_separators(p);
+		i32 body = _script_parse_loop_body(p, "after the list of 'for'");
+		
+		Script_Node *node = _script_node(p, result);
+		node->flags      = flags;
+		node->name       = after.text;
+		node->first_word = first_word;
+		node->word_count = word_count;
+		node->body[1]    = body;
+		_script_expect_statement_end(p, "done");
+	} else if (_script_is_keyword(token, "function")) {
+		_script_advance(p, token);
+		_script_advance(p, after);
+		
+		Script_Token parens = _script_peek(p);
+		if (_script_is_keyword(parens, "()")) {
+			_script_advance(p, parens);
+		}
+		
+		result = _script_parse_function(p, after.kind == Script_Token_WORD ? after.text : string_from_lit(""), token.line);
+		_script_expect_statement_end(p, "}");
+	} else if (token.kind == Script_Token_WORD && string_ends_with(token.text, string_from_lit("()"))) {
+		_script_advance(p, token);
+		result = _script_parse_function(p, string_chop(token.text, 2), token.line);
+		_script_expect_statement_end(p, "}");
+	} else if (token.kind == Script_Token_WORD && _script_is_keyword(after, "()")) {
+		_script_advance(p, token);
+		_script_advance(p, after);
+		result = _script_parse_function(p, token.text, token.line);
+		_script_expect_statement_end(p, "}");
+	} else if (_script_is_keyword(token, "{") || _script_is_keyword(token, "in") || token.kind == Script_Token_BACKGROUND ||
+			   token.kind == Script_Token_AND || token.kind == Script_Token_OR) {
+		_script_fail(p, token.line, "unexpected '%.*s'", string_expand(token.text));
+	} else {
+		result = _script_parse_command(p);
+	}
+	
+	return result;
+}
+
+// Statements up to the end, or up to a word that ends the list, which is left for the caller.
+static i32
+_script_parse_list(Script_Parser *p) {
+	i32 first = -1;
+	i32 last  = -1;
+	
+	Script_Node_Flags flags = 0;
+	while (!p->failed) {
+		_script_skip_separators(p);
+		
+		Script_Token token = _script_peek(p);
+		if (token.kind == Script_Token_END || _script_ends_list(token)) break;
+		
+		i32 node = _script_parse_statement(p);
+		if (node >= 0) {
+			if (first < 0) {
+				first = node;
+			} else {
+				_script_node(p, last)->next = node;
+			}
+			last = node;
+			_script_node(p, node)->flags |= flags;
+		}
+		
+		// Commands take the '&' that follows them. '&&' and '||' are kept on the statement after
+		// them, which can be on the next line.
+		flags = 0;
+		Script_Token after = _script_peek(p);
+		if (after.kind == Script_Token_BACKGROUND) {
+			_script_fail(p, after.line, "'&' can only follow a command");
+		} else if (after.kind == Script_Token_AND || after.kind == Script_Token_OR) {
+			_script_advance(p, after);
+			flags = after.kind == Script_Token_AND ? Script_Node_AND : Script_Node_OR;
+			
+			Script_Token next = _script_peek(p);
+			for (; next.kind == Script_Token_SEPARATOR && next.text.data[0] == '\n'; next = _script_peek(p)) {
+				_script_advance(p, next);
+			}
+			if (next.kind == Script_Token_END) {
+				_script_fail_incomplete(p, after.line, "expected a statement after '%.*s' before the end", string_expand(after.text));
+			} else if (next.kind != Script_Token_WORD || _script_ends_list(next)) {
+				_script_fail(p, after.line, "expected a statement after '%.*s'", string_expand(after.text));
+			}
+		}
+	}
+	
+	return first;
+}
+
+static void
+_script_parse(Script_Parser *p) {
+	p->script->first = _script_parse_list(p);
+	
+	Script_Token token = _script_peek(p);
+	if (!p->failed && token.kind != Script_Token_END) {
+		_script_fail(p, token.line, "unexpected '%.*s'", string_expand(token.text));
+	} else if (!p->failed && (token.continued || p->continued)) {
+		_script_fail_incomplete(p, token.line, "expected a line after the '\\' at the end");
+	}
+}
+
+//- Parser functions
+
+static void _script_optimize(Arena *arena, Script *script);
+
+static Script *
+script_parse(Arena *arena, String source, String name) {
+	Script *result = push_type(arena, Script);
+	
+	if (result != NULL) {
+		//- Pass 1: check the syntax, and count what there is to write.
+		Script_Parser counter = {0};
+		counter.script = result;
+		counter.arena  = arena;
+		counter.source = source;
+		counter.line   = 1;
+		_script_parse(&counter);
+		
+		result->name = name;
+		if (counter.failed) {
+			result->error      = counter.error;
+			result->error_line = counter.error_line;
+			result->incomplete = counter.incomplete;
+		} else {
+			//- Pass 2: write everything into a single block, with a copy of the source.
+			u64 nodes_size = cast(u64) counter.node_count * sizeof(Script_Node);
+			u64 words_size = cast(u64) counter.word_count * sizeof(Script_Word);
+			u64 parts_size = cast(u64) counter.part_count * sizeof(Script_Part);
+			u64 exprs_size = cast(u64) counter.expr_count * sizeof(Script_Expr);
+			u64 arrays_size = nodes_size + words_size + parts_size + exprs_size;
+			
+			// One more byte so that not even an empty script gets an empty block.
+			u8 *block = push_nozero_aligned(arena, arrays_size + cast(u64) source.len + 1, alignof(Script_Node));
+			if (block != NULL) {
+				result->nodes  = cast(Script_Node *) block;
+				result->words  = cast(Script_Word *) (block + nodes_size);
+				result->parts  = cast(Script_Part *) (block + nodes_size + words_size);
+				result->exprs  = cast(Script_Expr *) (block + nodes_size + words_size + parts_size);
+				result->source = string(block + arrays_size, source.len);
+				if (source.len > 0) memcpy(result->source.data, source.data, source.len);
+				result->source.data[source.len] = 0;
+				
+				Script_Parser writer = {0};
+				writer.script = result;
+				writer.arena  = arena;
+				writer.source = result->source;
+				writer.line   = 1;
+				_script_parse(&writer);
+				
+				assert(!writer.failed && writer.node_count == counter.node_count &&
+					   writer.word_count == counter.word_count && writer.part_count == counter.part_count &&
+					   writer.expr_count == counter.expr_count);
+				
+				result->node_count     = writer.node_count;
+				result->word_count     = writer.word_count;
+				result->part_count     = writer.part_count;
+				result->expr_count     = writer.expr_count;
+				result->function_count = writer.function_count;
+				result->ok             = true;
+				
+				_script_optimize(arena, result);
+			} else {
+				result->error = string_from_lit("out of memory");
+			}
+		}
+	}
+	
+	return result;
+}
+
+////////////////////////////////
+//~ Script optimizer
+
+//- Optimizer helpers
+
+static String
+_script_format_i64(char *buffer, i64 value) {
+	char *end = buffer + 24;
+	char *at  = end;
+	u64 magnitude = value < 0 ? 0 - cast(u64) value : cast(u64) value;
+	do {
+		at -= 1;
+		*at = cast(char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+	if (value < 0) {
+		at -= 1;
+		*at = '-';
+	}
+	return string(cast(u8 *) at, end - at);
+}
+
+// The operators that always evaluate both of their operands. Returns false on a division by
+// zero.
+static bool
+_script_arithmetic(Script_Expr_Op op, i64 left, i64 right, i64 *value) {
+	bool ok = true;
+	
+	// Wrap around on overflow instead of being undefined.
+	u64 a = cast(u64) left;
+	u64 b = cast(u64) right;
+	switch (op) {
+		case Script_Expr_ADD:           *value = cast(i64) (a + b); break;
+		case Script_Expr_SUB:           *value = cast(i64) (a - b); break;
+		case Script_Expr_MUL:           *value = cast(i64) (a * b); break;
+		case Script_Expr_LESS:          *value = left <  right; break;
+		case Script_Expr_LESS_EQUAL:    *value = left <= right; break;
+		case Script_Expr_GREATER:       *value = left >  right; break;
+		case Script_Expr_GREATER_EQUAL: *value = left >= right; break;
+		case Script_Expr_EQUAL:         *value = left == right; break;
+		case Script_Expr_NOT_EQUAL:     *value = left != right; break;
+		case Script_Expr_BIT_AND:       *value = cast(i64) (a & b); break;
+		case Script_Expr_BIT_XOR:       *value = cast(i64) (a ^ b); break;
+		case Script_Expr_BIT_OR:        *value = cast(i64) (a | b); break;
+		
+		// Shifting by 64 or more, or by a negative count, is undefined; only the low bits of the
+		// count are used, like x86 does.
+		case Script_Expr_SHIFT_LEFT:    *value = cast(i64) (a << (b & 63)); break;
+		case Script_Expr_SHIFT_RIGHT:   *value = left >> (b & 63); break;
+		
+		case Script_Expr_DIV:
+		case Script_Expr_MOD: {
+			if (right == 0) {
+				ok = false;
+			} else if (right == -1) {
+				// INT64_MIN / -1 overflows.
+				*value = op == Script_Expr_DIV ? cast(i64) (0 - a) : 0;
+			} else {
+				*value = op == Script_Expr_DIV ? left / right : left % right;
+			}
+		} break;
+		
+		default: {
+			assert(false && "Unknown arithmetic operator.");
+			ok = false;
+		} break;
+	}
+	
+	return ok;
+}
+
+// Replaces the expressions whose operands are numbers with the number they evaluate to. Operands
+// come before the expressions that use them, so a single pass folds whole trees. A division by
+// zero is left for when it runs, to be reported there.
+static void
+_script_fold_exprs(Script *script) {
+	for (i32 i = 0; i < script->expr_count; i += 1) {
+		Script_Expr *expr = &script->exprs[i];
+		
+		switch (expr->op) {
+			case Script_Expr_NUMBER:
+			case Script_Expr_VARIABLE:
+			case Script_Expr_ARGUMENT:
+			case Script_Expr_ASSIGN: {
+				// Not constant, or done at run time.
+			} break;
+			
+			case Script_Expr_NEGATE:
+			case Script_Expr_NOT:
+			case Script_Expr_BIT_NOT: {
+				Script_Expr *left = &script->exprs[expr->left];
+				if (left->op == Script_Expr_NUMBER) {
+					if      (expr->op == Script_Expr_NEGATE) expr->value = cast(i64) (0 - cast(u64) left->value);
+					else if (expr->op == Script_Expr_NOT)    expr->value = left->value == 0;
+					else                                     expr->value = ~left->value;
+					expr->op = Script_Expr_NUMBER;
+				}
+			} break;
+			
+			case Script_Expr_CONDITIONAL: {
+				// The branch that is taken takes its place.
+				Script_Expr *left = &script->exprs[expr->left];
+				if (left->op == Script_Expr_NUMBER) {
+					*expr = script->exprs[left->value != 0 ? expr->right : cast(i32) expr->value];
+				}
+			} break;
+			
+			case Script_Expr_AND:
+			case Script_Expr_OR: {
+				// Either the left operand decides, or the right one is the value.
+				Script_Expr *left  = &script->exprs[expr->left];
+				Script_Expr *right = &script->exprs[expr->right];
+				if (left->op == Script_Expr_NUMBER) {
+					if ((left->value != 0) != (expr->op == Script_Expr_AND)) {
+						expr->op    = Script_Expr_NUMBER;
+						expr->value = left->value != 0;
+					} else if (right->op == Script_Expr_NUMBER) {
+						expr->op    = Script_Expr_NUMBER;
+						expr->value = right->value != 0;
+					}
+				}
+			} break;
+			
+			default: {
+				Script_Expr *left  = &script->exprs[expr->left];
+				Script_Expr *right = &script->exprs[expr->right];
+				i64 value = 0;
+				if (left->op == Script_Expr_NUMBER && right->op == Script_Expr_NUMBER &&
+					_script_arithmetic(expr->op, left->value, right->value, &value)) {
+					expr->op    = Script_Expr_NUMBER;
+					expr->value = value;
+				}
+			} break;
+		}
+	}
+}
+
+// Expands the words that are the same every time they are expanded, once. The ones that can't
+// be pushed onto the arena are simply expanded every time.
+static void
+_script_fold_words(Arena *arena, Script *script) {
+	for (i32 i = 0; i < script->word_count; i += 1) {
+		Script_Word *word = &script->words[i];
+		
+		// Globs are matched against the files every time.
+		bool constant = !(word->flags & Script_Word_GLOB);
+		i64  cap = 0;
+		for (i32 j = 0; constant && j < word->part_count; j += 1) {
+			Script_Part *part = &script->parts[word->first_part + j];
+			if (part->kind == Script_Part_LITERAL) {
+				cap += part->text.len;
+			} else if (part->kind == Script_Part_ARITHMETIC && script->exprs[part->number].op == Script_Expr_NUMBER) {
+				cap += 24;
+			} else {
+				constant = false;
+			}
+		}
+		
+		u8 *data = constant ? push_nozero(arena, cap + 1) : NULL;
+		if (data != NULL) {
+			i64 len = 0;
+			for (i32 j = 0; j < word->part_count; j += 1) {
+				Script_Part *part  = &script->parts[word->first_part + j];
+				String       value = part->text;
+				char         buffer[24];
+				if (part->kind == Script_Part_ARITHMETIC) {
+					value = _script_format_i64(buffer, script->exprs[part->number].value);
+				}
+				memcpy(data + len, value.data, value.len);
+				len += value.len;
+			}
+			data[len] = 0;
+			
+			word->value  = string(data, len);
+			word->flags |= Script_Word_CONSTANT;
+		}
+	}
+}
+
+//- Optimizer functions
+
+static void
+_script_optimize(Arena *arena, Script *script) {
+	_script_fold_exprs(script);
+	_script_fold_words(arena, script);
+	
+	for (i32 i = 0; i < script->node_count; i += 1) {
+		Script_Node *node = &script->nodes[i];
+		if (node->kind == Script_Node_COMMAND && node->word_count > node->assignment_count) {
+			Script_Word *command = &script->words[node->first_word + node->assignment_count];
+			if (command->flags & Script_Word_CONSTANT) {
+				node->builtin = builtin_find(command->value);
+				node->flags  |= Script_Node_RESOLVED;
+			}
+		}
+	}
+}
+
+////////////////////////////////
+//~ Script interpreter
+
+//- Interpreter types
+
+typedef struct Script_Exec Script_Exec;
+struct Script_Exec {
+	Shell        *shell;
+	Script_Scope *scope;
+	Script       *script; // The one the running nodes belong to, which changes in functions.
+	i32           condition_depth; // In the condition of an if or a loop, where set -e doesn't apply.
+	bool          substituted;     // A $(...) ran while the words of the command were expanded.
+};
+
+// A list of words that grows on an arena.
+typedef struct Script_Args Script_Args;
+struct Script_Args {
+	String *argv;
+	i64     argc;
+	i64     cap;
+};
+
+//- Interpreter helpers
+
+static void
+_script_error(Script_Exec *exec, i32 line, char *format, ...) {
+	fflush(stdout);
+	
+	String name = exec->script->name;
+	if (name.len > 0) {
+		fprintf(stderr, "%.*s:%d: ", string_expand(name), line);
+	} else {
+		fprintf(stderr, "dush: ");
+	}
+	
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	
+	fprintf(stderr, "\n");
+}
+
+static bool
+_script_args_push(Arena *arena, Script_Args *args, String arg) {
+	bool ok = true;
+	if (args->argc == args->cap) {
+		i64     cap  = max(8, args->cap * 2);
+		String *argv = push_array(arena, String, cap);
+		ok = argv != NULL;
+		if (ok) {
+			if (args->argc > 0) memcpy(argv, args->argv, cast(u64) args->argc * sizeof(String));
+			args->argv = argv;
+			args->cap  = cap;
+		}
+	}
+	if (ok) {
+		args->argv[args->argc] = arg;
+		args->argc += 1;
+	}
+	return ok;
+}
+
+static String
+_script_argument(Script_Scope *scope, i64 index) {
+	String result = {0};
+	if (index == 0) {
+		result = scope->name;
+	} else if (index <= scope->arg_count) {
+		result = scope->args[index - 1];
+	}
+	return result;
+}
+
+// Variables in arithmetic are numbers, and unset or empty ones are 0.
+static bool
+_script_number(Script_Exec *exec, i32 line, String text, i64 *value) {
+	text = string_skip_chop_whitespace(text);
+	
+	bool ok = true;
+	if (text.len == 0) {
+		*value = 0;
+	} else {
+		ok = string_to_i64(text, 10, value);
+		if (!ok) {
+			_script_error(exec, line, "'%.*s' is not a number", string_expand(text));
+		}
+	}
+	return ok;
+}
+
+static bool
+_script_evaluate(Script_Exec *exec, i32 line, i32 index, i64 *value) {
+	bool ok = true;
+	
+	Script_Expr *expr  = &exec->script->exprs[index];
+	i64          left  = 0;
+	i64          right = 0;
+	
+	switch (expr->op) {
+		case Script_Expr_NUMBER: {
+			*value = expr->value;
+		} break;
+		
+		case Script_Expr_VARIABLE: {
+			ok = _script_number(exec, line, variables_lookup(&exec->scope->variables, expr->name), value);
+		} break;
+		
+		case Script_Expr_ARGUMENT: {
+			ok = _script_number(exec, line, _script_argument(exec->scope, expr->value), value);
+		} break;
+		
+		case Script_Expr_NEGATE:
+		case Script_Expr_NOT:
+		case Script_Expr_BIT_NOT: {
+			ok = _script_evaluate(exec, line, expr->left, &left);
+			if (ok) {
+				if      (expr->op == Script_Expr_NEGATE) *value = cast(i64) (0 - cast(u64) left);
+				else if (expr->op == Script_Expr_NOT)    *value = left == 0;
+				else                                     *value = ~left;
+			}
+		} break;
+		
+		case Script_Expr_CONDITIONAL: {
+			ok = _script_evaluate(exec, line, expr->left, &left);
+			if (ok) ok = _script_evaluate(exec, line, left != 0 ? expr->right : cast(i32) expr->value, value);
+		} break;
+		
+		case Script_Expr_ASSIGN: {
+			ok = _script_evaluate(exec, line, expr->right, value);
+			if (ok) {
+				char buffer[24];
+				ok = variables_set(&exec->scope->variables, expr->name, _script_format_i64(buffer, *value));
+			}
+		} break;
+		
+		case Script_Expr_AND:
+		case Script_Expr_OR: {
+			ok = _script_evaluate(exec, line, expr->left, &left);
+			if (ok && (left != 0) == (expr->op == Script_Expr_AND)) {
+				ok = _script_evaluate(exec, line, expr->right, &right);
+				left = right;
+			}
+			if (ok) *value = left != 0;
+		} break;
+		
+		default: {
+			ok = _script_evaluate(exec, line, expr->left, &left) && _script_evaluate(exec, line, expr->right, &right);
+			if (ok && !_script_arithmetic(expr->op, left, right, value)) {
+				_script_error(exec, line, "division by zero");
+				ok = false;
+			}
+		} break;
+	}
+	
+	return ok;
+}
+
+static bool _script_expand_word(Script_Exec *exec, Arena *arena, i32 line, Script_Word *word, bool pattern, String *value);
+static i32  _script_run_list(Script_Exec *exec, i32 index);
+
+// Runs the list with its output captured, and returns what it printed without the newlines at
+// the end. The list runs in a scope of its own, like in a child shell: what it assigns, the
+// functions it defines, set -e and cd don't outlive it, break and continue don't reach the loops
+// outside, and exit and return only end the list.
+static bool
+_script_substitute(Script_Exec *exec, Arena *arena, i32 line, i32 list, String *value) {
+	Script_Scope *scope = exec->scope;
+	bool ok = true;
+	
+	Scratch scratch = scratch_begin(&arena, 1);
+	String  current_dir = get_current_directory(scratch.arena);
+	
+	Script_Scope child = {0};
+	child.functions     = scope->functions;
+	child.name          = scope->name;
+	child.args          = scope->args;
+	child.arg_count     = scope->arg_count;
+	child.status        = scope->status;
+	child.exit_on_error = scope->exit_on_error;
+	child.variables.parent = &scope->variables;
+	
+	Output_Capture capture = {0};
+	if (output_capture_begin(&capture)) {
+		Script_Exec child_exec = *exec;
+		child_exec.scope = &child;
+		_script_run_list(&child_exec, list);
+		
+		exec->substituted = true;
+		scope->status     = child.status;
+		if (child.flow == Script_Flow_INTERRUPT) {
+			scope->flow = Script_Flow_INTERRUPT;
+		}
+		
+		String output = output_capture_end(arena, &capture);
+		while (output.len > 0 && output.data[output.len - 1] == '\n') {
+			output.len -= 1;
+			if (output.len > 0 && output.data[output.len - 1] == '\r') output.len -= 1;
+		}
+		*value = output;
+	} else {
+		_script_error(exec, line, "could not capture the output of $(...)");
+		ok = false;
+	}
+	
+	if (current_dir.len > 0 && !string_equals(get_current_directory(scratch.arena), current_dir)) {
+		set_current_directory(current_dir);
+	}
+	
+	script_scope_fini(&child);
+	scratch_end(scratch);
+	return ok;
+}
+
+static bool
+_script_pattern(Script_Exec *exec, Arena *arena, i32 line, i32 word, Glob_Pattern *pattern) {
+	String text = {0};
+	bool ok = _script_expand_word(exec, arena, line, &exec->script->words[word], true, &text);
+	if (ok) {
+		*pattern = glob_compile(arena, text);
+		ok = pattern->segments != NULL;
+		
+		// Unlike names of files, values that start with a '.' aren't special.
+		pattern->match_hidden = true;
+	}
+	return ok;
+}
+
+// A byte that every match of the pattern starts with (or ends with), so that only the places
+// where it is have to be tried. Returns false if there isn't one.
+static bool
+_script_pattern_edge(Glob_Pattern *pattern, bool end, u8 *c) {
+	bool result = false;
+	
+	if (pattern->segment_count > 0 && (end ? pattern->anchored_end : pattern->anchored_start)) {
+		Glob_Segment *segment = &pattern->segments[end ? pattern->segment_count - 1 : 0];
+		i64           at      = end ? segment->text.len - 1 : 0;
+		if (segment->any == NULL || !segment->any[at]) {
+			*c     = segment->text.data[at];
+			result = true;
+		}
+	}
+	
+	return result;
+}
+
+// How long the shortest or the longest prefix (or suffix) of the value that the pattern
+// matches is, or 0 if none does.
+static i64
+_script_trim_len(Glob_Pattern *pattern, String value, bool suffix, bool longest) {
+	i64 result = 0;
+	
+	u8   edge     = 0;
+	bool has_edge = _script_pattern_edge(pattern, !suffix, &edge);
+	for (i64 i = 0; i <= value.len; i += 1) {
+		i64 len = longest ? value.len - i : i;
+		if (len < pattern->min_len) {
+			if (longest) break;
+			continue;
+		}
+		if (has_edge && (len == 0 || value.data[suffix ? value.len - len : len - 1] != edge)) continue;
+		
+		String candidate = suffix ? string(value.data + value.len - len, len) : string(value.data, len);
+		if (glob_match(pattern, candidate)) {
+			result = len;
+			break;
+		}
+	}
+	
+	return result;
+}
+
+// The value with the longest match of the pattern at the first place where there is one (or at
+// every place) replaced.
+static String
+_script_replace(Arena *arena, Glob_Pattern *pattern, String value, String replacement, bool all) {
+	String result = {0};
+	
+	u8   first     = 0;
+	u8   last      = 0;
+	bool has_first = _script_pattern_edge(pattern, false, &first);
+	bool has_last  = _script_pattern_edge(pattern, true, &last);
+	
+	// Every byte could be a match of its own.
+	u64 cap  = cast(u64) value.len + (all ? cast(u64) value.len : 1) * cast(u64) replacement.len;
+	u8 *data = push_nozero(arena, cap + 1);
+	if (data != NULL) {
+		i64 len    = 0;
+		i64 copied = 0;
+		i64 start  = 0;
+		while (start < value.len) {
+			i64 match_end = -1;
+			if (!has_first || value.data[start] == first) {
+				for (i64 end = value.len; end > start && end - start >= pattern->min_len; end -= 1) {
+					if (has_last && value.data[end - 1] != last) continue;
+					if (glob_match(pattern, string(value.data + start, end - start))) {
+						match_end = end;
+						break;
+					}
+				}
+			}
+			
+			if (match_end > 0) {
+				memcpy(data + len, value.data + copied, start - copied);
+				len += start - copied;
+				memcpy(data + len, replacement.data, replacement.len);
+				len += replacement.len;
+				
+				start  = match_end;
+				copied = match_end;
+				if (!all) break;
+			} else {
+				start += 1;
+			}
+		}
+		
+		memcpy(data + len, value.data + copied, value.len - copied);
+		len += value.len - copied;
+		data[len] = 0;
+		result = string(data, len);
+	}
+	
+	return result;
+}
+
+// The value of a ${name op word} part.
+static bool
+_script_parameter(Script_Exec *exec, Arena *arena, i32 line, Script_Part *part, String *result) {
+	Script_Scope *scope = exec->scope;
+	bool ok = true;
+	
+	String value = {0};
+	bool   set   = false;
+	if (part->kind == Script_Part_VARIABLE) {
+		set = variables_get(&scope->variables, part->text, &value);
+		if (!set) {
+			value = _expand_lookup_variable(part->text);
+			set   = value.data != NULL;
+		}
+	} else {
+		value = _script_argument(scope, part->number);
+		set   = part->number <= scope->arg_count;
+	}
+	bool empty = !set || (part->colon && value.len == 0);
+	
+	Script_Word *word = part->operands[0] >= 0 ? &exec->script->words[part->operands[0]] : NULL;
+	switch (part->op) {
+		case Script_Param_VALUE: {
+			*result = value;
+		} break;
+		
+		case Script_Param_LENGTH: {
+			// In characters, not bytes.
+			i64 length = 0;
+			for (i64 i = 0; i < value.len; i += 1) {
+				length += (value.data[i] & 0xC0) != 0x80;
+			}
+			char buffer[24];
+			*result = string_clone(arena, _script_format_i64(buffer, length));
+		} break;
+		
+		case Script_Param_DEFAULT:
+		case Script_Param_ASSIGN: {
+			*result = value;
+			if (empty) {
+				ok = _script_expand_word(exec, arena, line, word, false, result);
+				if (ok && part->op == Script_Param_ASSIGN) {
+					ok = variables_set(&scope->variables, part->text, *result);
+				}
+			}
+		} break;
+		
+		case Script_Param_ALTERNATE: {
+			*result = string_from_lit("");
+			if (!empty) {
+				ok = _script_expand_word(exec, arena, line, word, false, result);
+			}
+		} break;
+		
+		case Script_Param_TRIM_PREFIX:
+		case Script_Param_TRIM_LONGEST_PREFIX:
+		case Script_Param_TRIM_SUFFIX:
+		case Script_Param_TRIM_LONGEST_SUFFIX: {
+			Glob_Pattern pattern = {0};
+			ok = _script_pattern(exec, arena, line, part->operands[0], &pattern);
+			if (ok) {
+				bool suffix  = part->op == Script_Param_TRIM_SUFFIX || part->op == Script_Param_TRIM_LONGEST_SUFFIX;
+				bool longest = part->op == Script_Param_TRIM_LONGEST_PREFIX || part->op == Script_Param_TRIM_LONGEST_SUFFIX;
+				i64  len     = _script_trim_len(&pattern, value, suffix, longest);
+				*result = suffix ? string_chop(value, len) : string_skip(value, len);
+			}
+		} break;
+		
+		case Script_Param_REPLACE:
+		case Script_Param_REPLACE_ALL: {
+			Glob_Pattern pattern     = {0};
+			String       replacement = {0};
+			ok = _script_pattern(exec, arena, line, part->operands[0], &pattern);
+			if (ok && part->operands[1] >= 0) {
+				ok = _script_expand_word(exec, arena, line, &exec->script->words[part->operands[1]], false, &replacement);
+			}
+			if (ok) {
+				*result = _script_replace(arena, &pattern, value, replacement, part->op == Script_Param_REPLACE_ALL);
+				ok = result->data != NULL;
+			}
+		} break;
+		
+		case Script_Param_SUBSTRING: {
+			i64 offset = 0;
+			i64 length = value.len;
+			ok = _script_evaluate(exec, line, part->operands[0], &offset);
+			if (ok && part->operands[1] >= 0) {
+				ok = _script_evaluate(exec, line, part->operands[1], &length);
+			}
+			if (ok) {
+				// Negative offsets count from the end, and so does a negative length.
+				if (offset < 0) offset = max(0, value.len + offset);
+				offset = min(offset, value.len);
+				i64 end = length >= 0 ? offset + min(length, value.len - offset) : max(offset, value.len + length);
+				*result = string(value.data + offset, end - offset);
+			}
+		} break;
+		
+		case Script_Param_UPPER:
+		case Script_Param_LOWER: {
+			*result = string_clone(arena, value);
+			for (i64 i = 0; i < result->len; i += 1) {
+				u8 c = result->data[i];
+				result->data[i] = cast(u8) (part->op == Script_Param_UPPER ? toupper(c) : tolower(c));
+			}
+		} break;
+	}
+	
+	return ok;
+}
+
+// The value of each part of the word, and how long they are together.
+static bool
+_script_part_values(Script_Exec *exec, Arena *arena, i32 line, Script_Word *word, String *values, i64 *total_len) {
+	bool ok = true;
+	*total_len = 0;
+	
+	for (i32 i = 0; ok && i < word->part_count; i += 1) {
+		Script_Part *part = &exec->script->parts[word->first_part + i];
+		switch (part->kind) {
+			case Script_Part_LITERAL: {
+				values[i] = part->text;
+			} break;
+			
+			case Script_Part_VARIABLE:
+			case Script_Part_ARGUMENT: {
+				if (part->op != Script_Param_VALUE) {
+					ok = _script_parameter(exec, arena, line, part, &values[i]);
+				} else if (part->kind == Script_Part_VARIABLE) {
+					values[i] = variables_lookup(&exec->scope->variables, part->text);
+				} else {
+					values[i] = _script_argument(exec->scope, part->number);
+				}
+				
+				// What comes later in the word may change the variable the value is in.
+				if (ok && part->kind == Script_Part_VARIABLE && (word->flags & Script_Word_EFFECTS)) {
+					values[i] = string_clone(arena, values[i]);
+				}
+			} break;
+			
+			case Script_Part_COMMAND: {
+				ok = _script_substitute(exec, arena, line, part->number, &values[i]);
+			} break;
+			
+			case Script_Part_ARG_COUNT: {
+				char buffer[24];
+				values[i] = string_clone(arena, _script_format_i64(buffer, exec->scope->arg_count));
+			} break;
+			
+			case Script_Part_ALL_ARGS: {
+				values[i] = string_join_args(arena, exec->scope->args, exec->scope->arg_count);
+			} break;
+			
+			case Script_Part_LAST_JOB: {
+				values[i] = string_from_lit("");
+				if (exec->shell->last_job_pid != 0) {
+					char buffer[24];
+					values[i] = string_clone(arena, _script_format_i64(buffer, exec->shell->last_job_pid));
+				}
+			} break;
+			
+			case Script_Part_STATUS: {
+				char buffer[24];
+				values[i] = string_clone(arena, _script_format_i64(buffer, exec->scope->status));
+			} break;
+			
+			case Script_Part_ARITHMETIC: {
+				i64 value = 0;
+				ok = _script_evaluate(exec, line, part->number, &value);
+				if (ok) {
+					char buffer[24];
+					values[i] = string_clone(arena, _script_format_i64(buffer, value));
+				}
+			} break;
+		}
+		*total_len += values[i].len;
+	}
+	
+	return ok;
+}
+
+// Joins the values of the parts of the word.
+static bool
+_script_join_parts(Script_Exec *exec, Arena *arena, i32 line, Script_Word *word, bool pattern, String *value) {
+	String *values    = push_array(arena, String, word->part_count);
+	i64     total_len = 0;
+	bool    ok = (values != NULL || word->part_count == 0) && _script_part_values(exec, arena, line, word, values, &total_len);
+	
+	if (ok) {
+		u8 *data = push_nozero(arena, (pattern ? total_len * 2 : total_len) + 1);
+		ok = data != NULL;
+		if (ok) {
+			Expand_Sink sink = { .data = data };
+			for (i32 i = 0; i < word->part_count; i += 1) {
+				Script_Part *part = &exec->script->parts[word->first_part + i];
+				if (pattern && part->kind == Script_Part_LITERAL && !part->quoted) {
+					// Only escape the escape character.
+					for (i64 j = 0; j < values[i].len; j += 1) {
+						if (values[i].data[j] == '\\') {
+							sink.data[sink.len] = '\\';
+							sink.len += 1;
+						}
+						sink.data[sink.len] = values[i].data[j];
+						sink.len += 1;
+					}
+				} else {
+					_expand_emit(&sink, values[i], pattern);
+				}
+			}
+			sink.data[sink.len] = 0;
+			*value = string(sink.data, sink.len);
+		}
+	}
+	
+	return ok;
+}
+
+// The word as a single null-terminated string. For a glob, the parts that were quoted or came
+// from a variable get their wildcards escaped.
+static bool
+_script_expand_word(Script_Exec *exec, Arena *arena, i32 line, Script_Word *word, bool pattern, String *value) {
+	bool ok = true;
+	
+	if ((word->flags & Script_Word_CONSTANT) && !pattern) {
+		*value = word->value;
+	} else {
+		ok = _script_join_parts(exec, arena, line, word, pattern, value);
+	}
+	
+	return ok;
+}
+
+static bool
+_script_expand_words(Script_Exec *exec, Arena *arena, i32 line, i32 first_word, i32 word_count, Script_Args *args) {
+	bool ok = true;
+	
+	for (i32 i = 0; ok && i < word_count; i += 1) {
+		Script_Word *word = &exec->script->words[first_word + i];
+		Script_Part *first_part = &exec->script->parts[word->first_part];
+		
+		if (word->part_count == 1 && first_part->kind == Script_Part_ALL_ARGS) {
+			// $@ alone is one word per argument, and no word if there are none.
+			for (i64 j = 0; ok && j < exec->scope->arg_count; j += 1) {
+				ok = _script_args_push(arena, args, exec->scope->args[j]);
+			}
+		} else if (word->flags & Script_Word_GLOB) {
+			String pattern = {0};
+			ok = _script_expand_word(exec, arena, line, word, true, &pattern);
+			
+			Expanded_Command matches = {0};
+			if (ok) matches = expand_glob(arena, pattern);
+			
+			if (matches.argc > 0) {
+				for (i64 j = 0; ok && j < matches.argc; j += 1) {
+					ok = _script_args_push(arena, args, matches.argv[j]);
+				}
+			} else if (ok) {
+				// A pattern that matches nothing is kept as it was typed.
+				String value = {0};
+				ok = _script_expand_word(exec, arena, line, word, false, &value) && _script_args_push(arena, args, value);
+			}
+		} else {
+			String value = {0};
+			ok = _script_expand_word(exec, arena, line, word, false, &value) && _script_args_push(arena, args, value);
+		}
+	}
+	
+	return ok;
+}
+
+// Loops call it after their body ran. Returns true if they have to stop.
+static bool
+_script_loop_stops(Script_Scope *scope) {
+	bool result = scope->flow != Script_Flow_NORMAL;
+	
+	if (scope->flow == Script_Flow_BREAK || scope->flow == Script_Flow_CONTINUE) {
+		scope->flow_count -= 1;
+		if (scope->flow_count == 0) {
+			result = scope->flow == Script_Flow_BREAK;
+			scope->flow = Script_Flow_NORMAL;
+		}
+	}
+	
+	return result;
+}
+
+static i32
+_script_call(Script_Exec *exec, i32 line, Script_Function *function, String *argv, i64 argc) {
+	Shell        *shell = exec->shell;
+	Script_Scope *scope = exec->scope;
+	i32 result = 1;
+	
+	if (shell->call_depth >= SCRIPT_MAX_CALL_DEPTH) {
+		_script_error(exec, line, "%.*s: too many nested calls", string_expand(function->name));
+	} else {
+		String *saved_args       = scope->args;
+		i64     saved_arg_count  = scope->arg_count;
+		i32     saved_loop_depth = scope->loop_depth;
+		
+		// break and continue don't reach the loops of the caller.
+		scope->args       = argv + 1;
+		scope->arg_count  = argc - 1;
+		scope->loop_depth = 0;
+		shell->call_depth += 1;
+		
+		Script_Exec function_exec = *exec;
+		function_exec.script = function->script;
+		result = _script_run_list(&function_exec, function->body);
+		if (scope->flow == Script_Flow_RETURN) {
+			scope->flow = Script_Flow_NORMAL;
+		}
+		
+		shell->call_depth -= 1;
+		scope->args       = saved_args;
+		scope->arg_count  = saved_arg_count;
+		scope->loop_depth = saved_loop_depth;
+	}
+	
+	return result;
+}
+
+// Functions come before the builtins of the shell, and processes.
+static Script_Function *
+_script_find_function(Script_Scope *scope, String name) {
+	Script_Function *result = NULL;
+	for (Script_Function *it = scope->functions; it != NULL; it = it->next) {
+		if (string_equals(it->name, name)) {
+			result = it;
+			break;
+		}
+	}
+	return result;
+}
+
+// The special builtins of POSIX shells, after which the assignments in front of them stay set.
+static bool
+_script_builtin_is_special(Builtin_Id builtin) {
+	bool result = false;
+	switch (builtin) {
+		case Builtin_BREAK:
+		case Builtin_COLON:
+		case Builtin_CONTINUE:
+		case Builtin_EXIT:
+		case Builtin_EXPORT:
+		case Builtin_RETURN:
+		case Builtin_SET:
+		case Builtin_UNSET: {
+			result = true;
+		} break;
+		
+		default: break;
+	}
+	return result;
+}
+
+// The builtins that change what the script does next, or its variables; the others are run by
+// the shell, with `env` for the processes they start. Only processes go in the background:
+// builtins and functions run right away, and leave a job that already ended.
+static i32
+_script_run_argv(Script_Exec *exec, i32 line, Builtin_Id builtin, String *argv, i64 argc, Command_Env env, bool background) {
+	Script_Scope *scope = exec->scope;
+	i32 result = 0;
+	
+	String command = argv[0];
+	switch (builtin) {
+		case Builtin_BREAK:
+		case Builtin_CONTINUE: {
+			i64 count = 1;
+			if (argc > 1 && (!string_to_i64(argv[1], 10, &count) || count < 1)) {
+				_script_error(exec, line, "%.*s: '%.*s' is not a loop count", string_expand(command), string_expand(argv[1]));
+				result = 1;
+			} else if (scope->loop_depth == 0) {
+				_script_error(exec, line, "%.*s: not in a loop", string_expand(command));
+				result = 1;
+			} else {
+				scope->flow       = builtin == Builtin_BREAK ? Script_Flow_BREAK : Script_Flow_CONTINUE;
+				scope->flow_count = min(count, scope->loop_depth);
+			}
+		} break;
+		
+		case Builtin_RETURN:
+		case Builtin_EXIT: {
+			// Without a status, the one of the last command.
+			i64 status = scope->status;
+			if (argc > 1 && !string_to_i64(argv[1], 10, &status)) {
+				_script_error(exec, line, "%.*s: '%.*s' is not a status", string_expand(command), string_expand(argv[1]));
+				status = 2;
+			}
+			result = cast(i32) (status & 0xFF);
+			scope->flow = builtin == Builtin_RETURN ? Script_Flow_RETURN : Script_Flow_EXIT;
+		} break;
+		
+		case Builtin_EXPORT: {
+			for (i64 i = 1; i < argc; i += 1) {
+				i64    equals = string_find_first(argv[i], '=');
+				String name   = equals >= 0 ? string_stop(argv[i], equals) : argv[i];
+				String value  = {0};
+				
+				bool has_value = equals >= 0;
+				if (has_value) {
+					value = string_skip(argv[i], equals + 1);
+					variables_set(&scope->variables, name, value);
+				} else {
+					has_value = variables_get(&scope->variables, name, &value);
+				}
+				
+				// The variable stays exported when it's assigned later, or before it's set.
+				if (!_script_is_name(name)) {
+					_script_error(exec, line, "export: '%.*s' is not a valid name", string_expand(name));
+					result = 1;
+				} else if (!variables_export(&scope->variables, name, true) || (has_value && !set_environment_variable(name, value))) {
+					_script_error(exec, line, "export: could not set '%.*s'", string_expand(name));
+					result = 1;
+				}
+			}
+		} break;
+		
+		case Builtin_UNSET: {
+			for (i64 i = 1; i < argc; i += 1) {
+				variables_unset(&scope->variables, argv[i]);
+			}
+		} break;
+		
+		case Builtin_SET: {
+			for (i64 i = 1; i < argc; i += 1) {
+				if (string_equals(argv[i], string_from_lit("-e")) || string_equals(argv[i], string_from_lit("+e"))) {
+					scope->exit_on_error = argv[i].data[0] == '-';
+				} else {
+					_script_error(exec, line, "set: '%.*s' is not a supported option", string_expand(argv[i]));
+					result = 2;
+				}
+			}
+		} break;
+		
+		default: {
+			Script_Function *function = _script_find_function(scope, command);
+			if (function != NULL) {
+				result = _script_call(exec, line, function, argv, argc);
+			} else {
+				// Adds the job itself.
+				result = shell_run_command(exec->shell, builtin, argv, argc, env, background);
+				background = false;
+			}
+		} break;
+	}
+	
+	if (background) {
+		shell_add_done_job(exec->shell, command, result);
+		result = 0;
+	}
+	
+	return result;
+}
+
+// What a variable assigned before a function call was, to give it back afterwards.
+typedef struct Script_Saved_Variable Script_Saved_Variable;
+struct Script_Saved_Variable {
+	String value;
+	bool   set;
+	bool   exported;
+};
+
+static i32
+_script_run_command(Script_Exec *exec, Script_Node *node) {
+	Script_Scope *scope = exec->scope;
+	i32 result = 1;
+	
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// Everything is expanded before the assignments take effect. Until then the status, which is
+	// $?, is the one of the command before, or of the last $(...) that ran.
+	exec->substituted = false;
+	Trace_Span  expand_span = trace_begin("expand", string_from_lit(""));
+	Script_Args args = {0};
+	bool ok = _script_expand_words(exec, scratch.arena, node->line, node->first_word + node->assignment_count,
+								   node->word_count - node->assignment_count, &args);
+	
+	String *values = push_array(scratch.arena, String, node->assignment_count);
+	for (i32 i = 0; ok && i < node->assignment_count; i += 1) {
+		ok = _script_expand_word(exec, scratch.arena, node->line, &exec->script->words[node->first_word + i], false, &values[i]);
+	}
+	trace_end(expand_span);
+	
+	// A Ctrl+C in a $(...) stops the command too.
+	if (ok && scope->flow == Script_Flow_NORMAL) {
+		Builtin_Id builtin  = Builtin_NONE;
+		bool       persist  = true;
+		bool       function = false;
+		if (args.argc > 0) {
+			builtin  = (node->flags & Script_Node_RESOLVED) ? node->builtin : builtin_find(args.argv[0]);
+			persist  = _script_builtin_is_special(builtin);
+			function = !persist && _script_find_function(scope, args.argv[0]) != NULL;
+		}
+		
+		// Assignments without a command stay set, and so do the ones before a special builtin.
+		// Before a function they are exported while it runs, and get back what they were after it,
+		// like in dash. Before any other command they are only in the environment of the processes
+		// and scripts it starts.
+		Command_Env env = {0};
+		env.variables = &scope->variables;
+		Script_Saved_Variable *saved = NULL;
+		if (function) {
+			saved = push_array(scratch.arena, Script_Saved_Variable, node->assignment_count);
+		}
+		if (persist || saved != NULL) {
+			for (i32 i = 0; i < node->assignment_count; i += 1) {
+				String name = exec->script->words[node->first_word + i].name;
+				if (saved != NULL) {
+					String value = {0};
+					saved[i].set      = variables_get(&scope->variables, name, &value);
+					saved[i].value    = string_clone(scratch.arena, value);
+					saved[i].exported = variables_exported(&scope->variables, name);
+				}
+				variables_set(&scope->variables, name, values[i]);
+				if (saved != NULL) variables_export(&scope->variables, name, true);
+			}
+		} else {
+			env.assignments = push_array(scratch.arena, String, node->assignment_count);
+			for (i32 i = 0; env.assignments != NULL && i < node->assignment_count; i += 1) {
+				String value  = values[i].len > 0 ? values[i] : string_from_lit("");
+				String temp[] = {exec->script->words[node->first_word + i].name, string_from_lit("="), value};
+				env.assignments[i] = strings_concat(scratch.arena, temp, array_count(temp));
+				if (env.assignments[i].data == NULL) break;
+				env.assignment_count += 1;
+			}
+		}
+		
+		bool          timed      = node->flags & Script_Node_TIMED;
+		Process_Usage time_begin = {0};
+		if (timed) {
+			time_begin = builtin_time_begin();
+			exec->shell->ran_process = false;
+		}
+		
+		if (args.argc > 0) {
+			result = _script_run_argv(exec, node->line, builtin, args.argv, args.argc, env, node->flags & Script_Node_BACKGROUND);
+			
+			// Backwards, so that a variable assigned twice gets the value from before both.
+			for (i32 i = node->assignment_count - 1; saved != NULL && i >= 0; i -= 1) {
+				String name = exec->script->words[node->first_word + i].name;
+				if (saved[i].set) {
+					variables_set(&scope->variables, name, saved[i].value);
+				} else {
+					variables_unset(&scope->variables, name);
+				}
+				variables_export(&scope->variables, name, saved[i].exported);
+			}
+		} else {
+			// Without a command, the status is the one of the last $(...), if there is one.
+			result = exec->substituted ? scope->status : 0;
+			if (node->flags & Script_Node_BACKGROUND) {
+				shell_add_done_job(exec->shell, exec->script->words[node->first_word].name, result);
+				result = 0;
+			}
+		}
+		
+		if (timed) {
+			fflush(stdout);
+			builtin_time_end(time_begin, exec->shell->ran_process);
+		}
+	}
+	
+	scratch_end(scratch);
+	
+	return result;
+}
+
+static i32
+_script_run_node(Script_Exec *exec, Script_Node *node) {
+	Script_Scope *scope = exec->scope;
+	i32 result = 0;
+	
+	switch (node->kind) {
+		case Script_Node_COMMAND: {
+			result = _script_run_command(exec, node);
+		} break;
+		
+		case Script_Node_IF: {
+			exec->condition_depth += 1;
+			i32 condition = _script_run_list(exec, node->body[0]);
+			exec->condition_depth -= 1;
+			if (scope->flow == Script_Flow_NORMAL) {
+				if (condition == 0) {
+					result = _script_run_list(exec, node->body[1]);
+				} else if (node->body[2] >= 0) {
+					result = _script_run_list(exec, node->body[2]);
+				}
+			} else {
+				result = condition;
+			}
+		} break;
+		
+		case Script_Node_WHILE: {
+			bool until = node->flags & Script_Node_UNTIL;
+			
+			scope->loop_depth += 1;
+			while (true) {
+				if (ctrl_c_pressed) {
+					scope->flow = Script_Flow_INTERRUPT;
+					result = 130;
+					break;
+				}
+				
+				exec->condition_depth += 1;
+				i32 condition = _script_run_list(exec, node->body[0]);
+				exec->condition_depth -= 1;
+				if (scope->flow != Script_Flow_NORMAL) {
+					if (_script_loop_stops(scope)) break;
+					continue;
+				}
+				if ((condition == 0) == until) break;
+				
+				result = _script_run_list(exec, node->body[1]);
+				if (_script_loop_stops(scope)) break;
+			}
+			scope->loop_depth -= 1;
+		} break;
+		
+		case Script_Node_FOR: {
+			Scratch scratch = scratch_begin(0, 0);
+			
+			// The values are expanded once, before the first iteration.
+			Script_Args values = {0};
+			bool ok = true;
+			if (node->flags & Script_Node_IN) {
+				ok = _script_expand_words(exec, scratch.arena, node->line, node->first_word, node->word_count, &values);
+			} else {
+				values.argv = scope->args;
+				values.argc = scope->arg_count;
+			}
+			
+			if (!ok) {
+				result = 1;
+			} else {
+				scope->loop_depth += 1;
+				for (i64 i = 0; i < values.argc; i += 1) {
+					if (ctrl_c_pressed) {
+						scope->flow = Script_Flow_INTERRUPT;
+						result = 130;
+						break;
+					}
+					
+					variables_set(&scope->variables, node->name, values.argv[i]);
+					result = _script_run_list(exec, node->body[1]);
+					if (_script_loop_stops(scope)) break;
+				}
+				scope->loop_depth -= 1;
+			}
+			
+			scratch_end(scratch);
+		} break;
+		
+		case Script_Node_FUNCTION: {
+			if (scope->arena.ptr == NULL && !arena_init(&scope->arena)) {
+				result = 1;
+			} else {
+				Script_Function *function = push_type(&scope->arena, Script_Function);
+				if (function != NULL) {
+					function->name   = node->name;
+					function->script = exec->script;
+					function->body   = node->body[1];
+					stack_push(scope->functions, function);
+				} else {
+					result = 1;
+				}
+			}
+		} break;
+	}
+	
+	return result;
+}
+
+// Runs the statements of the list until one of them changes the flow. Returns the status of
+// the last one that ran, or 0 if none did. The ones after '&&' and '||' are skipped when the
+// status says so, and the status stays the one that decided it.
+static i32
+_script_run_list(Script_Exec *exec, i32 index) {
+	Script_Scope *scope = exec->scope;
+	i32 result = 0;
+	
+	while (index >= 0 && scope->flow == Script_Flow_NORMAL) {
+		Script_Node *node = &exec->script->nodes[index];
+		index = node->next;
+		
+		bool skip = ((node->flags & Script_Node_AND) && result != 0) || ((node->flags & Script_Node_OR) && result == 0);
+		if (!skip) {
+			result = _script_run_node(exec, node);
+			scope->status = result;
+			
+			// set -e ends the script at a failure nothing tests.
+			bool tested = exec->condition_depth > 0 ||
+				(index >= 0 && (exec->script->nodes[index].flags & (Script_Node_AND|Script_Node_OR)));
+			if (result != 0 && scope->exit_on_error && !tested && scope->flow == Script_Flow_NORMAL) {
+				scope->flow = Script_Flow_EXIT;
+			}
+		}
+	}
+	
+	return result;
+}
+
+//- Interpreter functions
+
+static i32
+script_run(Shell *shell, Script_Scope *scope, Script *script) {
+	i32 result = 2;
+	
+	if (!script->ok) {
+		Script_Exec exec = {.shell = shell, .scope = scope, .script = script};
+		_script_error(&exec, script->error_line, "%.*s", string_expand(script->error));
+		scope->status = result;
+	} else {
+		Script_Exec exec = {.shell = shell, .scope = scope, .script = script};
+		_script_run_list(&exec, script->first);
+		result = scope->status;
+		
+		// The script is over, so is what it was doing. exit is left for the caller to see, since
+		// it may have to end more than the script.
+		if (scope->flow != Script_Flow_EXIT) {
+			scope->flow = Script_Flow_NORMAL;
+		}
+		scope->flow_count = 0;
+		scope->loop_depth = 0;
+	}
+	
+	return result;
+}
+
+static Script *
+script_keep(Script_Scope *scope, Script *script) {
+	Script *result = script;
+	if (scope->arena.ptr != NULL || arena_init(&scope->arena)) {
+		result = script_parse(&scope->arena, script->source, script->name);
+	}
+	return result;
+}
+
+static void
+script_scope_fini(Script_Scope *scope) {
+	variables_fini(&scope->variables);
+	if (scope->arena.ptr != NULL) {
+		arena_fini(&scope->arena);
+	}
+	memset(scope, 0, sizeof(Script_Scope));
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef DUSH_SCRIPT_H
+#define DUSH_SCRIPT_H
+
+////////////////////////////////
+//~ Scripts
+
+// .dush scripts, and the lines typed at the prompt, are written in a small subset of the POSIX
+// shell language:
+//
+//   name=word...                   Sets shell variables.
+//   name=word... command word...   Puts the variables in the environment of the processes and
+//                                  scripts the command starts, for that command only. Before a
+//                                  function they are set while it runs, and before a special
+//                                  builtin (export, set, exit...) they stay set.
+//   [time] command word...         Runs a function, a builtin, a process or a script.
+//   command word... &              Starts the process and goes on without waiting for it; $!
+//                                  is its pid, and wait waits for it. Builtins, functions and
+//                                  scripts still run before the shell goes on.
+//   statement && statement         Runs the second statement only if the first succeeds, and
+//   statement || statement         with || only if it fails. They go from left to right, so
+//                                  a && b || c runs c if either a or b fails.
+//   if list; then list; [elif list; then list;]... [else list;] fi
+//   while list; do list; done      And until, which loops while the list fails.
+//   for name [in word...]; do list; done
+//   name() { list; }               Defines a function; its arguments are $1, $2...
+//   break [n], continue [n], return [status], exit [status]
+//   export name[=word]..., unset name...
+//   set -e, set +e                 Turns on or off exiting when a command fails, except in the
+//                                  condition of if, while and until, or before && and ||.
+//   # comment
+//
+// Statements are separated by newlines, ';', '&', '&&' or '||', and newlines can follow '&&' and
+// '||'. A list succeeds if the last command that ran in it does.
+//
+// A backslash quotes the character after it, and a newline after it joins the two lines. In
+// double quotes it only does so before $, `, ", \ and a newline, and stays as it is before the
+// others; in single quotes it is always itself.
+//
+// Words are expanded like by expand_command_line(), plus $((arithmetic)), $(list), $1..$9,
+// ${10}..., $0 (the script), $# and $@ (the arguments), $? (the status of the last command), and
+// $! (the last background process).
+// There is no field splitting: "$x" and $x are the same single word, except that $@ alone is one
+// word per argument.
+//
+// $(list) is the output of the list, without its trailing newlines. The list runs in the
+// shell itself, not in a child: exit, return and break only leave the list, but the variables
+// it sets stay set.
+//
+// ${name}, and ${1}... for the arguments, can also take an operator:
+//   ${#name}                       The length of the value.
+//   ${name:-word}, ${name-word}    The word if the value is empty or unset (or only unset).
+//   ${name:=word}, ${name=word}    The same, and the variable is set to the word.
+//   ${name:+word}, ${name+word}    The word if the value is not empty or unset, else nothing.
+//   ${name#pattern}, ${name##pattern}
+//                                  The value without the shortest or longest prefix that
+//                                  matches the pattern, which uses * and ?.
+//   ${name%pattern}, ${name%%pattern}
+//                                  The same with a suffix.
+//   ${name/pattern/word}, ${name//pattern/word}
+//                                  The first or every match of the pattern replaced by the word.
+//   ${name:offset}, ${name:offset:length}
+//                                  Part of the value; both are arithmetic, and a negative one
+//                                  counts from the end.
+//   ${name^^}, ${name,,}           The value in uppercase or lowercase.
+//
+// Arithmetic is done on 64-bit integers, with + - * / %, << >> & ^ | ~, comparisons that give 1
+// or 0, ! && ||, c ? a : b, parentheses, and = += -= *= /= %= <<= >>= &= ^= |= which set a
+// variable. Names in it are variables (with or without a '$'), and unset ones are 0.
+//
+// A script is parsed once into flat arrays of nodes, words and word parts; the interpreter
+// only walks those, so nothing is tokenized again when a loop body runs a million times. After
+// parsing, arithmetic on constants is folded, words that expand to the same thing every time are
+// expanded once, and the builtins that commands name are looked up once.
+
+//- Script constants
+
+// How deep functions can call each other, and scripts run each other, before it's an error.
+#if !defined(SCRIPT_MAX_CALL_DEPTH)
+#define SCRIPT_MAX_CALL_DEPTH 1000
+#endif
+
+//- Script types
+
+typedef u8 Script_Part_Kind;
+enum {
+	Script_Part_LITERAL,    // text
+	Script_Part_VARIABLE,   // text is the name
+	Script_Part_ARGUMENT,   // $0, $1... number is the index
+	Script_Part_ARG_COUNT,  // $#
+	Script_Part_ALL_ARGS,   // $@, and $* which is the same without field splitting
+	Script_Part_ARITHMETIC, // number is the index of the root expression
+	Script_Part_COMMAND,    // $(list), number is the index of the list
+	Script_Part_LAST_JOB,   // $!
+	Script_Part_STATUS,     // $?
+};
+
+// What is done with the value of a VARIABLE or ARGUMENT part. The operands are words, except
+// for SUBSTRING where they are expressions; -1 if there is none.
+typedef u8 Script_Param_Op;
+enum {
+	Script_Param_VALUE,
+	Script_Param_LENGTH,
+	Script_Param_DEFAULT,     // operands[0] is the word
+	Script_Param_ASSIGN,      // operands[0] is the word
+	Script_Param_ALTERNATE,   // operands[0] is the word
+	Script_Param_TRIM_PREFIX, // operands[0] is the pattern, and for the rest too
+	Script_Param_TRIM_LONGEST_PREFIX,
+	Script_Param_TRIM_SUFFIX,
+	Script_Param_TRIM_LONGEST_SUFFIX,
+	Script_Param_REPLACE,     // operands[1] is the replacement
+	Script_Param_REPLACE_ALL,
+	Script_Param_SUBSTRING,   // operands[0] is the offset, operands[1] the length
+	Script_Param_UPPER,
+	Script_Param_LOWER,
+};
+
+typedef struct Script_Part Script_Part;
+struct Script_Part {
+	Script_Part_Kind kind;
+	bool             quoted; // Wildcards in it are taken literally.
+	Script_Param_Op  op;
+	bool             colon;  // DEFAULT, ASSIGN and ALTERNATE take empty values as unset.
+	i32              number;
+	i32              operands[2];
+	String           text;   // A slice of the script's copy of the source.
+};
+
+typedef u8 Script_Word_Flags;
+enum {
+	Script_Word_GLOB     = 1 << 0, // Has unquoted wildcards.
+	Script_Word_EFFECTS  = 1 << 1, // Has $(...) or ${name=word}, which can change variables
+	                               // while the word is expanded.
+	Script_Word_CONSTANT = 1 << 2, // Only has literal parts, and arithmetic on constants, and no
+	                               // unquoted wildcards; value is what it expands to.
+};
+
+typedef struct Script_Word Script_Word;
+struct Script_Word {
+	i32               first_part;
+	i32               part_count;
+	Script_Word_Flags flags;
+	String            name;  // Of the variable, for name=word; the parts are the value.
+	String            value; // Null-terminated, for CONSTANT.
+};
+
+typedef u8 Script_Expr_Op;
+enum {
+	Script_Expr_NUMBER,
+	Script_Expr_VARIABLE,
+	Script_Expr_ARGUMENT,
+	Script_Expr_NEGATE,
+	Script_Expr_NOT,
+	Script_Expr_MUL,
+	Script_Expr_DIV,
+	Script_Expr_MOD,
+	Script_Expr_ADD,
+	Script_Expr_SUB,
+	Script_Expr_LESS,
+	Script_Expr_LESS_EQUAL,
+	Script_Expr_GREATER,
+	Script_Expr_GREATER_EQUAL,
+	Script_Expr_EQUAL,
+	Script_Expr_NOT_EQUAL,
+	Script_Expr_AND,
+	Script_Expr_OR,
+	Script_Expr_BIT_NOT,
+	Script_Expr_SHIFT_LEFT,
+	Script_Expr_SHIFT_RIGHT,
+	Script_Expr_BIT_AND,
+	Script_Expr_BIT_XOR,
+	Script_Expr_BIT_OR,
+	Script_Expr_CONDITIONAL, // left ? right : value
+	Script_Expr_ASSIGN,      // name = right; a += b is a = a + b.
+};
+
+// Operands come before the expressions that use them.
+typedef struct Script_Expr Script_Expr;
+struct Script_Expr {
+	Script_Expr_Op op;
+	i32            left;
+	i32            right;
+	i64            value; // NUMBER, the index of an ARGUMENT, and the else branch of a CONDITIONAL
+	String         name;  // VARIABLE and ASSIGN
+};
+
+typedef u8 Script_Node_Kind;
+enum {
+	Script_Node_COMMAND,  // words: assignments first, then the command and its arguments
+	Script_Node_IF,       // body[0] is the condition, body[1] the then list, body[2] the else list
+	Script_Node_WHILE,    // body[0] is the condition, body[1] the loop
+	Script_Node_FOR,      // name is the variable, words the values, body[1] the loop
+	Script_Node_FUNCTION, // name, and body[1]
+};
+
+typedef u8 Script_Node_Flags;
+enum {
+	Script_Node_TIMED      = 1 << 0, // COMMAND started with "time".
+	Script_Node_UNTIL      = 1 << 1, // WHILE loops while the condition fails.
+	Script_Node_IN         = 1 << 2, // FOR has an "in" list; without one it goes over $@.
+	Script_Node_RESOLVED   = 1 << 3, // COMMAND's command word is constant, and builtin is what it names.
+	Script_Node_BACKGROUND = 1 << 4, // COMMAND was followed by '&'.
+	Script_Node_AND        = 1 << 5, // Came after '&&': only runs if the status is 0.
+	Script_Node_OR         = 1 << 6, // Came after '||': only runs if it isn't.
+};
+
+// Lists are chains of nodes linked by next; -1 ends them, and is the empty list.
+typedef struct Script_Node Script_Node;
+struct Script_Node {
+	Script_Node_Kind  kind;
+	Script_Node_Flags flags;
+	Builtin_Id        builtin;
+	i32               line;
+	i32               next;
+	i32               first_word;
+	i32               word_count;
+	i32               assignment_count;
+	i32               body[3];
+	String            name;
+};
+
+// Everything lives in a single block: the arrays, and a copy of the source that the parts point
+// into. The values of constant words come right after it. `first` is the list the script runs.
+typedef struct Script Script;
+struct Script {
+	String       name;
+	String       source;
+	Script_Node *nodes;
+	Script_Word *words;
+	Script_Part *parts;
+	Script_Expr *exprs;
+	i32          node_count;
+	i32          word_count;
+	i32          part_count;
+	i32          expr_count;
+	i32          function_count;
+	i32          first;
+	
+	bool         ok;
+	bool         incomplete; // The error is that the source ends too early, in a quote or an if for example.
+	i32          error_line;
+	String       error;
+};
+
+typedef struct Script_Function Script_Function;
+struct Script_Function {
+	Script_Function *next;
+	String           name;
+	Script          *script;
+	i32              body;
+};
+
+// Set by break, continue, return and exit, and by Ctrl+C, to stop what is running up to
+// whatever they stop.
+typedef u8 Script_Flow;
+enum {
+	Script_Flow_NORMAL,
+	Script_Flow_BREAK,
+	Script_Flow_CONTINUE,
+	Script_Flow_RETURN,
+	Script_Flow_EXIT,
+	Script_Flow_INTERRUPT,
+};
+
+// What commands run in. The shell has one for the lines typed at the prompt; each script it
+// runs gets its own, so like in a child shell the variables and functions it sets are gone
+// when it ends.
+typedef struct Shell Shell;
+typedef struct Script_Scope Script_Scope;
+struct Script_Scope {
+	Variables        variables;
+	Arena            arena;     // The functions, and the scripts they were defined in.
+	Script_Function *functions;
+	
+	String           name;      // $0
+	String          *args;      // $1...
+	i64              arg_count;
+	
+	Script_Flow      flow;
+	i64              flow_count; // How many loops break and continue still have to leave.
+	i32              loop_depth;
+	i32              status;     // Of the last command.
+	bool             exit_on_error; // set -e
+};
+
+//- Script functions
+
+// The script is pushed onto the arena, always; if it has a syntax error, ok is false and error
+// says what is wrong at error_line.
+static Script *script_parse(Arena *arena, String source, String name);
+
+// Runs the script in the scope and returns the status of its last command, or the one it
+// exited with. The functions it defines are kept in the scope.
+static i32  script_run(Shell *shell, Script_Scope *scope, Script *script);
+
+// A copy of the script in the arena of the scope, for a script that defines functions which
+// have to outlive it (like the lines typed at the prompt).
+static Script *script_keep(Script_Scope *scope, Script *script);
+
+static void script_scope_fini(Script_Scope *scope);
+
+#endif
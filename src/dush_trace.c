@@ -0,0 +1,186 @@
+#ifndef DUSH_TRACE_C
+#define DUSH_TRACE_C
+
+////////////////////////////////
+//~ Tracing
+
+//- Tracing helpers
+
+static Trace_Buffer *
+_trace_thread_buffer(void) {
+	Trace_Buffer *buffer = trace_thread_buffer;
+	if (buffer == NULL) {
+		Arena arena = {0};
+		if (arena_init(&arena, .reserve_size = TRACE_BUFFER_RESERVE_SIZE)) {
+			buffer = push_type(&arena, Trace_Buffer);
+		}
+		if (buffer != NULL) {
+			buffer->arena        = arena;
+			buffer->thread_index = atomic_fetch_add_u32(&trace_state.thread_count, 1);
+			snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread %u", buffer->thread_index);
+			
+			// Lock-free push onto the list of buffers.
+			u64 head = 0;
+			do {
+				head = atomic_load_u64(cast(u64 *) &trace_state.first_buffer);
+				buffer->next = cast(Trace_Buffer *) head;
+			} while (!atomic_compare_exchange_u64(cast(u64 *) &trace_state.first_buffer, head, cast(u64) buffer));
+			
+			trace_thread_buffer = buffer;
+		} else if (arena.ptr != NULL) {
+			arena_fini(&arena);
+		}
+	}
+	return buffer;
+}
+
+static void
+_trace_write_string(File_Writer *writer, String s) {
+	i64 start = 0;
+	for (i64 i = 0; i < s.len; i += 1) {
+		u8 c = s.data[i];
+		if (c == '"' || c == '\\' || c < 0x20) {
+			file_writer_append(writer, string_skip(string_stop(s, i), start));
+			char escaped[8];
+			int  escaped_len = snprintf(escaped, sizeof(escaped), c == '"' ? "\\\"" : c == '\\' ? "\\\\" : "\\u%04x", c);
+			file_writer_append(writer, string(cast(u8 *) escaped, escaped_len));
+			start = i + 1;
+		}
+	}
+	file_writer_append(writer, string_skip(s, start));
+}
+
+//- Tracing functions
+
+static void
+trace_init(void) {
+	char *file_name = getenv("DUSH_TRACE");
+	if (file_name != NULL && file_name[0] != 0) {
+		trace_state.enabled   = true;
+		trace_state.file_name = string_from_cstring(file_name);
+		trace_state.start_ns  = time_now_ns();
+		trace_set_thread_name(string_from_lit("main"));
+	}
+}
+
+static void
+trace_fini(void) {
+	if (trace_state.enabled) {
+		trace_state.enabled = false;
+		
+		Scratch scratch = scratch_begin(0, 0);
+		
+		File_Handle file = file_open(trace_state.file_name, File_Open_WRITE|File_Open_CREATE|File_Open_TRUNCATE);
+		SliceU8 backing  = push_sliceu8(scratch.arena, kilobytes(64));
+		if (file.value != 0 && backing.data != NULL) {
+			File_Writer writer = {0};
+			file_writer_init(&writer, file, backing);
+			file_writer_append(&writer, string_from_lit("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+			
+			bool first = true;
+			char line[256];
+			for (Trace_Buffer *buffer = trace_state.first_buffer; buffer != NULL; buffer = buffer->next) {
+				int len = snprintf(line, sizeof(line), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+								   first ? "" : ",\n", buffer->thread_index);
+				file_writer_append(&writer, string(cast(u8 *) line, len));
+				_trace_write_string(&writer, string_from_cstring(buffer->thread_name));
+				file_writer_append(&writer, string_from_lit("\"}}"));
+				first = false;
+				
+				for (u64 i = 0; i < buffer->event_count; i += 1) {
+					Trace_Event *event = &buffer->events[i];
+					u64 start_ns = event->start_ns - trace_state.start_ns;
+					len = snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"cat\":\"dush\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"name\":\"%s\"",
+								   buffer->thread_index, cast(unsigned long long) start_ns / 1000, cast(unsigned long long) start_ns % 1000,
+								   cast(unsigned long long) event->duration_ns / 1000, cast(unsigned long long) event->duration_ns % 1000, event->name);
+					file_writer_append(&writer, string(cast(u8 *) line, len));
+					if (event->detail_len > 0) {
+						file_writer_append(&writer, string_from_lit(",\"args\":{\"detail\":\""));
+						_trace_write_string(&writer, string(cast(u8 *) event->detail, event->detail_len));
+						file_writer_append(&writer, string_from_lit("\"}"));
+					}
+					file_writer_append(&writer, string_from_lit("}"));
+				}
+				
+				if (buffer->dropped_count > 0) {
+					fprintf(stderr, "dush: the trace of %s is missing %llu spans\n", buffer->thread_name,
+							cast(unsigned long long) buffer->dropped_count);
+				}
+			}
+			
+			file_writer_append(&writer, string_from_lit("\n]}\n"));
+			if (!file_writer_flush(&writer)) {
+				fprintf(stderr, "dush: could not write the trace to '%.*s'\n", string_expand(trace_state.file_name));
+			}
+		} else {
+			fprintf(stderr, "dush: could not write the trace to '%.*s': %.*s\n", string_expand(trace_state.file_name),
+					string_expand(last_file_error_string()));
+		}
+		file_close(file);
+		
+		scratch_end(scratch);
+		
+		Trace_Buffer *buffer = trace_state.first_buffer;
+		while (buffer != NULL) {
+			Trace_Buffer *next  = buffer->next;
+			Arena         arena = buffer->arena;
+			arena_fini(&arena);
+			buffer = next;
+		}
+		trace_state.first_buffer = NULL;
+		trace_thread_buffer      = NULL;
+	}
+}
+
+static Trace_Span
+trace_begin(char *name, String detail) {
+	Trace_Span span = {0};
+	if (trace_state.enabled) {
+		span.name     = name;
+		span.detail   = detail;
+		span.start_ns = time_now_ns();
+	}
+	return span;
+}
+
+static void
+trace_end(Trace_Span span) {
+	if (span.name != NULL && trace_state.enabled) {
+		u64 end_ns = time_now_ns();
+		
+		Trace_Buffer *buffer = _trace_thread_buffer();
+		if (buffer != NULL) {
+			// Nothing else is pushed onto the arena of the buffer, so the events stay contiguous.
+			Trace_Event *event = cast(Trace_Event *) push_nozero_aligned(&buffer->arena, sizeof(Trace_Event), alignof(Trace_Event));
+			if (event != NULL) {
+				if (buffer->events == NULL) {
+					buffer->events = event;
+				}
+				assert(event == buffer->events + buffer->event_count);
+				
+				event->name        = span.name;
+				event->start_ns    = span.start_ns;
+				event->duration_ns = end_ns - span.start_ns;
+				event->detail_len  = cast(u8) min(span.detail.len, TRACE_DETAIL_CAP);
+				memcpy(event->detail, span.detail.data, event->detail_len);
+				buffer->event_count += 1;
+			} else {
+				buffer->dropped_count += 1;
+			}
+		}
+	}
+}
+
+static void
+trace_set_thread_name(String name) {
+	if (trace_state.enabled) {
+		Trace_Buffer *buffer = _trace_thread_buffer();
+		if (buffer != NULL) {
+			i64 len = min(name.len, TRACE_THREAD_NAME_CAP - 1);
+			memcpy(buffer->thread_name, name.data, len);
+			buffer->thread_name[len] = 0;
+		}
+	}
+}
+
+#endif
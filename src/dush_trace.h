@@ -0,0 +1,85 @@
+#ifndef DUSH_TRACE_H
+#define DUSH_TRACE_H
+
+////////////////////////////////
+//~ Tracing
+
+// With DUSH_TRACE=<file>, the shell records how long its own steps take (rendering the prompt,
+// reading and expanding a line, looking up the PATH, reading files, starting and waiting for
+// processes, running builtins) and writes them to the file at exit as Chrome trace events, which
+// chrome://tracing and ui.perfetto.dev open.
+//
+// Every thread records into a buffer of its own, so recording takes no lock and no atomic
+// read-modify-write. Buffers are only read when the trace is written, after the workers are done.
+// When tracing is off, a span costs a branch.
+
+//- Tracing constants
+
+// Per thread. Spans past it are counted but dropped.
+#if !defined(TRACE_BUFFER_RESERVE_SIZE)
+#define TRACE_BUFFER_RESERVE_SIZE megabytes(256)
+#endif
+
+#define TRACE_DETAIL_CAP   40
+#define TRACE_THREAD_NAME_CAP 32
+
+//- Tracing types
+
+// Copied when the span ends, so that the buffers don't refer to memory of the code they trace.
+typedef struct Trace_Event Trace_Event;
+struct Trace_Event {
+	char *name; // A string literal.
+	u64   start_ns;
+	u64   duration_ns;
+	u8    detail_len;
+	char  detail[TRACE_DETAIL_CAP];
+};
+
+typedef struct Trace_Buffer Trace_Buffer;
+struct Trace_Buffer {
+	Trace_Buffer *next;
+	Arena         arena; // Holds this, and then nothing but the events.
+	Trace_Event  *events;
+	u64           event_count;
+	u64           dropped_count;
+	u32           thread_index;
+	char          thread_name[TRACE_THREAD_NAME_CAP];
+};
+
+typedef struct Trace_Span Trace_Span;
+struct Trace_Span {
+	char  *name;
+	String detail; // Must stay valid until the span ends.
+	u64    start_ns;
+};
+
+//- Tracing global variables
+
+typedef struct Trace_State Trace_State;
+struct Trace_State {
+	bool          enabled; // Only changes before other threads start and after they stopped.
+	String        file_name;
+	u64           start_ns;
+	Trace_Buffer *first_buffer; // Pushed to by each thread the first time it records a span.
+	u32           thread_count;
+};
+
+static Trace_State trace_state;
+
+per_thread Trace_Buffer *trace_thread_buffer;
+
+//- Tracing functions
+
+// Starts tracing if DUSH_TRACE names a file.
+static void trace_init(void);
+
+// Writes the trace if tracing was on. Every other thread must be done by then.
+static void trace_fini(void);
+
+static Trace_Span trace_begin(char *name, String detail);
+static void       trace_end(Trace_Span span);
+
+// Shown instead of "thread N" for the calling thread.
+static void trace_set_thread_name(String name);
+
+#endif
@@ -63,6 +63,9 @@ get_system_error_message_in_english(Arena *arena, int error) {
 static BOOL WINAPI
 ctrl_c_handler(DWORD signal) {
 	BOOL handled = (signal == CTRL_C_EVENT);
+	if (handled) {
+		ctrl_c_pressed = 1;
+	}
 	return handled;
 }
 
@@ -73,9 +76,13 @@ init_ctrl_c_handler(void) {
 	// instead we just provide a handler routine that does nothing.
 	//
 	// https://learn.microsoft.com/en-us/windows/console/setconsolectrlhandler?redirectedfrom=MSDN#parameters
-	if (!SetConsoleCtrlHandler(ctrl_c_handler, TRUE)) {
-		int last_error = GetLastError();
-		(void)last_error;
+	static bool installed = false;
+	if (!installed) {
+		if (!SetConsoleCtrlHandler(ctrl_c_handler, TRUE)) {
+			int last_error = GetLastError();
+			(void)last_error;
+		}
+		installed = true;
 	}
 }
 
@@ -144,11 +151,50 @@ get_system_path(Arena *arena) {
 	return result;
 }
 
+// CreateProcess looks in the directory of the shell and in the current directory before the
+// PATH, and adds extensions, so the shell leaves the search to it.
+static String
+find_executable(Arena *arena, Path_Cache *cache, String command, bool *missing) {
+	(void)arena;
+	(void)cache;
+	(void)command;
+	*missing = false;
+	return string_from_lit("");
+}
+
+static String
+get_home_directory(Arena *arena) {
+	String result = {0};
+	
+	char *home = getenv("USERPROFILE");
+	if (home != NULL) {
+		result = string_clone(arena, string_from_cstring(home));
+	}
+	
+	return result;
+}
+
 ////////////////////////////////
 //~ Other
 
-static void
+static bool
+set_environment_variable(String name, String value) {
+	Scratch scratch = scratch_begin(0, 0);
+	
+	// _putenv_s() changes both the C runtime's copy, which getenv() reads, and the environment of
+	// the process, which CreateProcessA passes on.
+	char *name_nt  = cstring_from_string(scratch.arena, name);
+	char *value_nt = cstring_from_string(scratch.arena, value);
+	bool  ok = name_nt != NULL && value_nt != NULL && _putenv_s(name_nt, value_nt) == 0;
+	
+	scratch_end(scratch);
+	
+	return ok;
+}
+
+static bool
 set_current_directory(String dir) {
+	bool ok = false;
 	Scratch scratch = scratch_begin(0, 0);
 	
 	// I don't fully understand the rules under which SetCurrentDirectory operates, but *sometimes* it fails
@@ -182,6 +228,8 @@ set_current_directory(String dir) {
 			
 			fprintf(stderr, "Could not change directory to '%s': %.*s",
 					dir_nt, string_expand(message));
+		} else {
+			ok = true;
 		}
 	} else {
 		errno = ENOMEM;
@@ -190,6 +238,8 @@ set_current_directory(String dir) {
 	}
 	
 	scratch_end(scratch);
+	
+	return ok;
 }
 
 #endif
@@ -0,0 +1,168 @@
+// Runs dush under a pseudo-terminal, types keys one at a time and counts how many bytes
+// dush writes back for each of them. Fails if any key costs more than its budget.
+// Linux only.
+//
+// Usage: line_editor_bytes [path to dush]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+typedef struct Step Step;
+struct Step {
+	char *name;
+	char *keys;
+	int   budget; // Maximum bytes dush may write in response.
+};
+
+static int
+spawn_in_pty(char *path, int *pid_out) {
+	int master = posix_openpt(O_RDWR|O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		return -1;
+	}
+	
+	int pid = fork();
+	if (pid == 0) {
+		setsid();
+		int slave = open(ptsname(master), O_RDWR);
+		dup2(slave, 0);
+		dup2(slave, 1);
+		dup2(slave, 2);
+		close(slave);
+		close(master);
+		
+		setenv("DUSH_HISTORY", "/tmp/dush_line_editor_bytes_history", 1);
+		execl(path, path, (char *)0);
+		_exit(127);
+	}
+	
+	*pid_out = pid;
+	return master;
+}
+
+// Reads until dush has been quiet for `quiet_ms`. Returns how many bytes were read.
+static int
+drain(int fd, int quiet_ms, char *last, int last_cap) {
+	int total = 0;
+	while (1) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+		if (poll(&pfd, 1, quiet_ms) <= 0) break;
+		
+		char buffer[4096];
+		int n = read(fd, buffer, sizeof(buffer));
+		if (n <= 0) break;
+		
+		if (last != NULL) {
+			int keep = n < last_cap - 1 ? n : last_cap - 1;
+			memcpy(last, buffer + n - keep, keep);
+			last[keep] = 0;
+		}
+		total += n;
+	}
+	return total;
+}
+
+static void
+print_escaped(char *s) {
+	for (; *s; s += 1) {
+		if (*s == 0x1b)      printf("\\e");
+		else if (*s == '\b') printf("\\b");
+		else if (*s == '\r') printf("\\r");
+		else if (*s == '\n') printf("\\n");
+		else                 putchar(*s);
+	}
+}
+
+int
+main(int argc, char **argv) {
+	char *dush = argc > 1 ? argv[1] : "./dush";
+	unlink("/tmp/dush_line_editor_bytes_history");
+	
+	int pid = 0;
+	int fd = spawn_in_pty(dush, &pid);
+	if (fd < 0) {
+		perror("Could not open a pseudo-terminal");
+		return 1;
+	}
+	
+	// Wait for the first prompt.
+	drain(fd, 300, NULL, 0);
+	
+	Step steps[] = {
+		{"type 'e'",          "e",        1},
+		{"type 'c'",          "c",        1},
+		{"type 'h'",          "h",        1},
+		{"type 'o'",          "o",        1},
+		{"type ' '",          " ",        1},
+		{"type 'w'",          "w",        1},
+		{"type 'o'",          "o",        1},
+		{"type 'r'",          "r",        1},
+		{"type 'l'",          "l",        1},
+		{"type 'd'",          "d",        1},
+		{"left",              "\x1b[D",   1},
+		{"left",              "\x1b[D",   1},
+		{"left",              "\x1b[D",   1},
+		{"insert 'X'",        "X",        4},
+		{"backspace (middle)","\x7f",     4},
+		{"right",             "\x1b[C",   1},
+		{"end",               "\x05",     3},
+		{"backspace (end)",   "\x7f",     3},
+		{"home",              "\x01",     4},
+		{"paste 'echo '",     "echo ",    9},
+		{"enter",             "\r",       4096},
+		{"history up",        "\x1b[A",   64},
+		{"ctrl+u",            "\x15",     64},
+		{"ctrl+c",            "\x03",     4096},
+	};
+	
+	int failures = 0;
+	int total = 0;
+	int total_naive = 0;
+	int line_len = 0;
+	int prompt_len = (int) strlen(getcwd((char[4096]){0}, 4096)) + 1;
+	
+	printf("%-20s %6s %6s %8s  %s\n", "step", "bytes", "budget", "redraw", "output");
+	for (int i = 0; i < (int)(sizeof(steps)/sizeof(steps[0])); i += 1) {
+		Step *step = &steps[i];
+		write(fd, step->keys, strlen(step->keys));
+		
+		char last[64] = {0};
+		int n = drain(fd, 100, last, sizeof(last));
+		
+		// What a full redraw ("\r" + prompt + line + erase to end of line + cursor move) would cost.
+		if (step->keys[0] >= 0x20 && step->keys[0] < 0x7f) line_len += (int) strlen(step->keys);
+		int naive = 1 + prompt_len + line_len + 3 + 4;
+		
+		printf("%-20s %6d %6d %8d  ", step->name, n, step->budget, naive);
+		print_escaped(last);
+		printf("\n");
+		
+		if (n > step->budget) {
+			printf("  FAIL: over budget\n");
+			failures += 1;
+		}
+		
+		if (step->budget < 4096) {
+			total += n;
+			total_naive += naive;
+		}
+	}
+	
+	printf("total %d bytes for the editing keys, %d with full redraws\n", total, total_naive);
+	
+	write(fd, "\x04", 1);
+	drain(fd, 200, NULL, 0);
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	close(fd);
+	unlink("/tmp/dush_line_editor_bytes_history");
+	
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+// Runs dush under a pseudo-terminal like a user would and measures:
+// - time to prompt: from starting dush until the first prompt is printed
+// - round trip: from pressing Enter until the next prompt, for a builtin, for tests/hello and for
+//   tests/greet (which reads a line of its own, so its input goes through dush to the child)
+// - throughput: pasting a long stream of commands at once, until the last prompt
+// Fails if dush stops responding, e.g. because it dropped input that was typed ahead.
+// Linux only.
+//
+// Usage: pty_end_to_end [path to dush] [directory with hello and greet]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define PROMPT "dush-e2e> "
+#define TIMEOUT_MS 5000
+
+typedef struct Session Session;
+struct Session {
+	int  fd;
+	int  pid;
+	long bytes_read;
+	char tail[256]; // The end of the output, to find markers split between reads.
+	int  tail_len;
+};
+
+static double
+now_us(void) {
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int
+compare_double(const void *a, const void *b) {
+	double x = *(double *) a;
+	double y = *(double *) b;
+	return (x > y) - (x < y);
+}
+
+static int
+session_start(Session *session, char *path) {
+	memset(session, 0, sizeof(*session));
+	
+	int master = posix_openpt(O_RDWR|O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		return 0;
+	}
+	
+	int pid = fork();
+	if (pid == 0) {
+		setsid();
+		int slave = open(ptsname(master), O_RDWR);
+		dup2(slave, 0);
+		dup2(slave, 1);
+		dup2(slave, 2);
+		close(slave);
+		close(master);
+		
+		setenv("DUSH_HISTORY", "/tmp/dush_pty_end_to_end_history", 1);
+		setenv("DUSH_PROMPT", PROMPT, 1);
+		execl(path, path, (char *)0);
+		_exit(127);
+	}
+	
+	session->fd  = master;
+	session->pid = pid;
+	return pid > 0;
+}
+
+static void
+session_end(Session *session) {
+	write(session->fd, "exit\r", 5);
+	
+	struct pollfd pfd = { .fd = session->fd, .events = POLLIN };
+	char buffer[4096];
+	while (poll(&pfd, 1, 200) > 0 && read(session->fd, buffer, sizeof(buffer)) > 0) {}
+	
+	kill(session->pid, SIGTERM);
+	waitpid(session->pid, NULL, 0);
+	close(session->fd);
+}
+
+// Counts the markers in new output, looking back into the tail for the ones split between reads.
+static int
+session_consume(Session *session, char *data, int len, char *marker) {
+	int found = 0;
+	int marker_len = (int) strlen(marker);
+	
+	char window[256 + 4096];
+	int  keep = session->tail_len < marker_len - 1 ? session->tail_len : marker_len - 1;
+	memcpy(window, session->tail + session->tail_len - keep, keep);
+	memcpy(window + keep, data, len);
+	int window_len = keep + len;
+	
+	for (char *at = window; at + marker_len <= window + window_len; ) {
+		char *match = memmem(at, window + window_len - at, marker, marker_len);
+		if (match == NULL) break;
+		found += 1;
+		at = match + marker_len;
+	}
+	
+	int tail_keep = window_len < (int) sizeof(session->tail) ? window_len : (int) sizeof(session->tail);
+	memcpy(session->tail, window + window_len - tail_keep, tail_keep);
+	session->tail_len = tail_keep;
+	
+	session->bytes_read += len;
+	return found;
+}
+
+// Reads until the marker was seen `count` times. Writes `input` along the way, without letting
+// either side of the pty fill up.
+static int
+session_wait(Session *session, char *marker, int count, char *input, long input_len) {
+	int  found   = 0;
+	long written = 0;
+	double deadline = now_us() + TIMEOUT_MS * 1000.0;
+	
+	while (found < count) {
+		struct pollfd pfd = { .fd = session->fd, .events = POLLIN | (written < input_len ? POLLOUT : 0) };
+		int timeout = (int) ((deadline - now_us()) / 1000);
+		if (timeout <= 0 || poll(&pfd, 1, timeout) <= 0) break;
+		
+		if (pfd.revents & POLLIN) {
+			char buffer[4096];
+			int n = (int) read(session->fd, buffer, sizeof(buffer));
+			if (n <= 0) break;
+			found += session_consume(session, buffer, n, marker);
+			deadline = now_us() + TIMEOUT_MS * 1000.0;
+		}
+		
+		if ((pfd.revents & POLLOUT) && written < input_len) {
+			long chunk = input_len - written < 512 ? input_len - written : 512;
+			long n = write(session->fd, input + written, chunk);
+			if (n > 0) written += n;
+		}
+	}
+	
+	return found >= count;
+}
+
+static int
+report(char *name, double *samples, int count) {
+	qsort(samples, count, sizeof(double), compare_double);
+	printf("%-28s p50 %9.1f us  p90 %9.1f us  max %9.1f us\n", name,
+		   samples[count / 2], samples[count * 9 / 10], samples[count - 1]);
+	return 1;
+}
+
+// Types a command and times until the output contains `expect`, which should end with the next
+// prompt. `reply` is typed once dush echoed the command line, for children that read input.
+static int
+round_trips(char *dush, char *name, char *command, char *reply, char *expect, int count) {
+	Session session = {0};
+	if (!session_start(&session, dush) || !session_wait(&session, PROMPT, 1, NULL, 0)) {
+		printf("%-28s FAIL: no prompt\n", name);
+		return 0;
+	}
+	
+	double *samples = malloc(count * sizeof(double));
+	int ok = 1;
+	for (int i = 0; i < count && ok; i += 1) {
+		double start = now_us();
+		write(session.fd, command, strlen(command));
+		if (reply != NULL) {
+			char echoed[4096];
+			snprintf(echoed, sizeof(echoed), "%.*s\r\n", (int) strlen(command) - 1, command);
+			ok = session_wait(&session, echoed, 1, NULL, 0);
+			write(session.fd, reply, strlen(reply));
+		}
+		ok = ok && session_wait(&session, expect, 1, NULL, 0);
+		samples[i] = now_us() - start;
+	}
+	
+	if (ok) {
+		report(name, samples, count);
+	} else {
+		printf("%-28s FAIL: no response\n", name);
+	}
+	
+	free(samples);
+	session_end(&session);
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	char *dush = argc > 1 ? argv[1] : "./dush";
+	char *dir  = argc > 2 ? argv[2] : ".";
+	unlink("/tmp/dush_pty_end_to_end_history");
+	signal(SIGPIPE, SIG_IGN);
+	
+	int ok = 1;
+	
+	// Time to prompt
+	{
+		int count = 50;
+		double samples[50];
+		for (int i = 0; i < count && ok; i += 1) {
+			Session session = {0};
+			double start = now_us();
+			ok = session_start(&session, dush) && session_wait(&session, PROMPT, 1, NULL, 0);
+			samples[i] = now_us() - start;
+			session_end(&session);
+		}
+		if (ok) {
+			report("time to prompt", samples, count);
+		} else {
+			printf("%-28s FAIL: no prompt\n", "time to prompt");
+		}
+	}
+	
+	// Round trips
+	char hello[4096];
+	char greet[4096];
+	snprintf(hello, sizeof(hello), "%s/hello\r", dir);
+	snprintf(greet, sizeof(greet), "%s/greet\r", dir);
+	
+	ok = round_trips(dush, "round trip: echo",        "echo round trip\r", NULL,    "\nround trip\r\n\r\n" PROMPT,  200) && ok;
+	ok = round_trips(dush, "round trip: hello",       hello,               NULL,    "Hello, World!\r\n\r\n" PROMPT, 100) && ok;
+	ok = round_trips(dush, "round trip: greet input", greet,               "pty\r", "Hello, pty!\r\n\r\n" PROMPT,   100) && ok;
+	
+	// Throughput: paste many commands at once.
+	{
+		int  count = 2000;
+		long line_len = 80;
+		char *input = malloc(count * line_len);
+		long input_len = 0;
+		for (int i = 0; i < count; i += 1) {
+			input_len += sprintf(input + input_len, "echo %05d the quick brown fox jumps over the lazy dog 0123456789 abc\r", i);
+		}
+		
+		Session session = {0};
+		if (session_start(&session, dush) && session_wait(&session, PROMPT, 1, NULL, 0)) {
+			long before = session.bytes_read;
+			double start = now_us();
+			if (session_wait(&session, PROMPT, count, input, input_len)) {
+				double elapsed = now_us() - start;
+				long bytes = session.bytes_read - before;
+				printf("%-28s %d commands in %.1f ms: %.0f commands/s, %.2f MB/s of output\n", "throughput: pasted commands",
+					   count, elapsed / 1e3, count / (elapsed / 1e6), bytes / elapsed);
+			} else {
+				printf("%-28s FAIL: input was lost, not every command ran\n", "throughput: pasted commands");
+				ok = 0;
+			}
+		} else {
+			printf("%-28s FAIL: no prompt\n", "throughput: pasted commands");
+			ok = 0;
+		}
+		session_end(&session);
+		free(input);
+	}
+	
+	unlink("/tmp/dush_pty_end_to_end_history");
+	return ok ? 0 : 1;
+}
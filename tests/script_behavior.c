@@ -0,0 +1,208 @@
+// Runs small dush scripts and checks what they print and the status dush exits with: the
+// interpreter, $(...), expansions, &&, ||, $?, set -e, the builtins that replace helper
+// processes and the environment processes get. Each script runs in a fresh temporary directory
+// that also holds words.txt, with `input` on its standard input, or is itself the standard input
+// of dush, which then prints "$ " as its prompt. Fails if any case differs.
+// Linux only.
+//
+// Usage: script_behavior [path to dush]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define TIMEOUT_MS 5000
+
+typedef struct Case Case;
+struct Case {
+	char *name;
+	char *script;
+	char *input;
+	char *expected;
+	int   status;
+	int   from_stdin;
+};
+
+static Case cases[] = {
+	// Interpreter
+	{"if elif else",          "if [ 1 -eq 2 ]; then echo a; elif [ 2 -eq 2 ]; then echo b; else echo c; fi\n", "", "b\n", 0},
+	{"for loop",              "x=a\nfor i in 1 2 3; do x=$x$i; done\necho $x\n", "", "a123\n", 0},
+	{"while loop",            "i=0; s=0\nwhile [ $i -lt 1000 ]; do s=$((s + i * 2)); i=$((i + 1)); done\necho $s\n", "", "999000\n", 0},
+	{"function arguments",    "f() { echo \"$1-$2\"; return 4; }\nf a b\necho $?\n", "", "a-b\n4\n", 0},
+	{"function defined later", "g() { h; }\nh() { echo late; }\ng\n", "", "late\n", 0},
+	{"function redefined",    "f() { echo one; }\nf\nf() { echo two; }\nf\n", "", "one\ntwo\n", 0},
+	{"script arguments",      "echo $# \"[$1]\"\n", "", "0 []\n", 0},
+	{"unset",                 "x=5; unset x; echo \"[$x]\"\n", "", "[]\n", 0},
+	{"exit",                  "echo a; exit 7; echo b\n", "", "a\n", 7},
+	
+	// Constant folding must not freeze what changes at run time.
+	{"literal expansion",     "echo $((2 * 3 + 1))\n", "", "7\n", 0},
+	{"loop variable",         "for i in 1 2 3; do x=$i; echo $x; done\n", "", "1\n2\n3\n", 0},
+	{"arithmetic",            "echo $((7 % 3)) $((1 << 4)) $((-3 / 2))\n", "", "1 16 -1\n", 0},
+	{"PATH change",           "for i in 1 2; do export PATH=/nonexistent; ls; echo $?; export PATH=/usr/bin:/bin; done\n", "", "127\n127\n", 0},
+	
+	// $(...) runs in its own scope.
+	{"substitution output",   "a=$(echo $(echo nested))\necho $a\n", "", "nested\n", 0},
+	{"substitution cd",       "cd /\nx=$(cd /tmp; pwd)\npwd\necho $x\n", "", "/\n/tmp\n", 0},
+	{"substitution variable", "x=$(y=leaked)\necho \"[$y]\"\n", "", "[]\n", 0},
+	{"substitution set -e",   "x=$(set -e)\nfalse\necho still\n", "", "still\n", 0},
+	{"substitution status",   "x=$(false)\necho $?\nx=$(exit 3)\necho $?\n", "", "1\n3\n", 0},
+	
+	// Sequencing and exit status
+	{"status",                "false; echo $?; true; echo $?\n", "", "1\n0\n", 0},
+	{"or",                    "false || echo b\n", "", "b\n", 0},
+	{"and then or",           "true && false || echo c\n", "", "c\n", 0},
+	{"failed cd",             "cd /nonexistent && echo ran\necho $?\n", "", "1\n", 0},
+	{"set -e",                "set -e\ncd /nonexistent\necho survived\n", "", "", 1},
+	{"set -e in a function",  "set -e\nf() { false; echo inside; }\nf\necho after\n", "", "", 1},
+	{"set -e and conditions", "set -e\nif false; then echo no; fi\nfalse || true\nfalse && true\nx=$(false) || true\necho after\n", "", "after\n", 0},
+	{"function status",       "f() { return 0; }\nf && echo ok || echo bad\n", "", "ok\n", 0},
+	{"background builtins",   "false & wait $!; echo $?\nf() { return 3; }\nf & wait $!; echo $?\nx=1 & wait $!; echo $?\necho hi & [ -n \"$!\" ] && echo pid\n", "", "1\n3\n0\nhi\npid\n", 0},
+	
+	// Builtins and expansion operators
+	{"basename dirname",      "basename /a/b/c.txt .txt\ndirname /a/b/c.txt\n", "", "c\n/a/b\n", 0},
+	{"expr",                  "expr 3 + 4\nexpr 3 '*' 4\nexpr 5 - 7\n", "", "7\n12\n-2\n", 0},
+	{"trims",                 "p=/usr/lib/libc.so\necho ${p##*/} ${p%/*} ${p#*/} ${p%%.*}\n", "", "libc.so /usr/lib usr/lib/libc.so /usr/lib/libc\n", 0},
+	{"test",                  "test 3 -gt 2 && echo yes\n[ abc = abd ] || echo no\ntest -d /; echo $?\n", "", "yes\nno\n0\n", 0},
+	{"wc",                    "wc -l words.txt\nwc -w words.txt\nwc -c\n", "hello world\n", "2 words.txt\n3 words.txt\n12\n", 0},
+	{"wc missing file",       "wc -w missing.txt; echo $?\n", "", "1\n", 0},
+	{"tr",                    "tr a-z A-Z\n", "hello world\n", "HELLO WORLD\n", 0},
+	{"tr -d",                 "tr -d o\n", "hello world\n", "hell wrld\n", 0},
+	
+	// Arguments reach external commands as they are.
+	{"quoted arguments",      "/bin/echo 'a\"b' c\n/bin/echo \"a  b\"  c\n", "", "a\"b c\na  b c\n", 0},
+	{"empty argument",        "printf '[%s]\\n' '' x\n", "", "[]\n[x]\n", 0},
+	
+	// The environment of processes: assignments in front of a command are only for it.
+	{"prefix assignments",    "FOO=bar printenv FOO\necho \"[$FOO]\"\nY=2 :\necho $Y\n", "", "bar\n[]\n2\n", 0},
+	{"prefix PATH",           "PATH=/nonexistent ls; echo $?\nls words.txt\n", "", "127\nwords.txt\n", 0},
+	{"function assignments",  "f() { printenv Z; Z=4; }\nZ=3 f\necho \"[$Z]\"\n", "", "3\n[]\n", 0},
+	{"exported updates",      "export X\nX=1\nprintenv X\nHOME=/x\nprintenv HOME\n", "", "1\n/x\n", 0},
+	
+	// Quoting, and statements over several lines.
+	{"escapes",               "echo \"a\\\"b\" \"\\$x\" 'c\\d' e\\ f \\*\n", "", "a\"b $x c\\d e f *\n", 0},
+	{"line continuation",     "echo a \\\n  b\nx=1\\\n2; echo $x\n", "", "a b\n12\n", 0},
+	{"unterminated quote",    "echo a\necho \"abc\n", "", "", 2},
+	{"continuation lines",    "if true; then\n echo x\nfi\necho \"a\nb\"\n", "", "\n$ > > x\n\n$ > a\nb\n\n$ ", 0, 1},
+};
+
+static int
+write_file(char *path, char *contents) {
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd < 0) return 0;
+	long len = strlen(contents);
+	int ok = write(fd, contents, len) == len;
+	close(fd);
+	return ok;
+}
+
+// Runs dush on `script_path` in `dir`, or without a script if it's NULL. Returns 0 if it couldn't
+// be run or didn't finish in time.
+static int
+run(char *dush, char *dir, char *script_path, char *input, char *output, int output_cap, int *status_out) {
+	int in_pipe[2];
+	int out_pipe[2];
+	if (pipe(in_pipe) != 0 || pipe(out_pipe) != 0) return 0;
+	
+	int pid = fork();
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(in_pipe[0], 0);
+		dup2(out_pipe[1], 1);
+		dup2(null, 2);
+		close(in_pipe[0]);
+		close(in_pipe[1]);
+		close(out_pipe[0]);
+		close(out_pipe[1]);
+		close(null);
+		
+		if (chdir(dir) != 0) _exit(127);
+		if (script_path == NULL) {
+			setenv("DUSH_PROMPT", "$ ", 1);
+			execl(dush, dush, (char *)0);
+		}
+		execl(dush, dush, script_path, (char *)0);
+		_exit(127);
+	}
+	close(in_pipe[0]);
+	close(out_pipe[1]);
+	
+	// The inputs are far smaller than a pipe's buffer.
+	long input_len = strlen(input);
+	int ok = write(in_pipe[1], input, input_len) == input_len;
+	close(in_pipe[1]);
+	
+	int len = 0;
+	while (ok) {
+		struct pollfd pfd = { .fd = out_pipe[0], .events = POLLIN };
+		if (poll(&pfd, 1, TIMEOUT_MS) <= 0) {
+			ok = 0;
+			break;
+		}
+		
+		char buffer[4096];
+		int n = read(out_pipe[0], buffer, sizeof(buffer));
+		if (n <= 0) break;
+		int copy = n < output_cap - 1 - len ? n : output_cap - 1 - len;
+		memcpy(output + len, buffer, copy);
+		len += copy;
+	}
+	output[len] = 0;
+	close(out_pipe[0]);
+	
+	if (!ok) kill(pid, SIGKILL);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	*status_out = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+	char *dush = argc > 1 ? argv[1] : "./dush";
+	
+	char dir[] = "/tmp/dush_script_behavior_XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		printf("FAIL: could not create a temporary directory\n");
+		return 1;
+	}
+	
+	char script_path[4096];
+	char words_path[4096];
+	snprintf(script_path, sizeof(script_path), "%s/case.dush", dir);
+	snprintf(words_path, sizeof(words_path), "%s/words.txt", dir);
+	
+	int failed = 0;
+	int count  = sizeof(cases) / sizeof(cases[0]);
+	for (int i = 0; i < count; i += 1) {
+		Case *c = &cases[i];
+		
+		char output[4096];
+		int  status = 0;
+		char *path  = c->from_stdin ? NULL : script_path;
+		char *input = c->from_stdin ? c->script : c->input;
+		int  ran = write_file(script_path, c->script) && write_file(words_path, "one two\nthree\n") &&
+			run(dush, dir, path, input, output, sizeof(output), &status);
+		
+		if (!ran) {
+			printf("%-24s FAIL: dush could not be run, or did not finish in %d ms\n", c->name, TIMEOUT_MS);
+			failed += 1;
+		} else if (strcmp(output, c->expected) != 0 || status != c->status) {
+			printf("%-24s FAIL\n  expected status %d and output:\n%s  got status %d and output:\n%s", c->name, c->status, c->expected, status, output);
+			failed += 1;
+		}
+	}
+	
+	unlink(script_path);
+	unlink(words_path);
+	rmdir(dir);
+	
+	printf("%d of %d cases passed\n", count - failed, count);
+	return failed > 0;
+}